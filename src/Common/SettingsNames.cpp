@@ -77,12 +77,15 @@ const QString SettingsNames::cacheOfflineNone = QStringLiteral("memory");
 const QString SettingsNames::cacheOfflineXDays = QStringLiteral("days");
 const QString SettingsNames::cacheOfflineAll = QStringLiteral("all");
 const QString SettingsNames::cacheOfflineNumberDaysKey = QStringLiteral("offline.cache.numDays");
+const QString SettingsNames::cacheMemoryPartBudgetKey = QStringLiteral("offline.cache.memoryPartBudgetMB");
+const QString SettingsNames::cryptoDecryptedCacheBudgetKey = QStringLiteral("crypto.decryptedCache.budgetMB");
 const QString SettingsNames::xtConnectCacheDirectory = QStringLiteral("xtconnect.cachedir");
 const QString SettingsNames::xtSyncMailboxList = QStringLiteral("xtconnect.listOfMailboxes");
 const QString SettingsNames::xtDbHost = QStringLiteral("xtconnect.db.hostname");
 const QString SettingsNames::xtDbPort = QStringLiteral("xtconnect.db.port");
 const QString SettingsNames::xtDbDbName = QStringLiteral("xtconnect.db.dbname");
 const QString SettingsNames::xtDbUser = QStringLiteral("xtconnect.db.username");
+const QString SettingsNames::xtParallelConnections = QStringLiteral("xtconnect.parallelConnections");
 const QString SettingsNames::guiMsgListShowThreading = QStringLiteral("gui/msgList.showThreading");
 const QString SettingsNames::guiMsgListHideRead = QStringLiteral("gui/msgList.hideRead");
 const QString SettingsNames::guiMailboxListShowOnlySubscribed = QStringLiteral("gui/mailboxList.showOnlySubscribed");
@@ -39,9 +39,11 @@ struct SettingsNames {
            imapBlacklistedCapabilities, imapUseSystemProxy, imapNeedsNetwork, imapNumberRefreshInterval;
     static const QString composerSaveToImapKey, composerImapSentKey, smtpUseBurlKey;
     static const QString cacheMetadataKey, cacheMetadataMemory,
-           cacheOfflineKey, cacheOfflineNone, cacheOfflineXDays, cacheOfflineAll, cacheOfflineNumberDaysKey;
+           cacheOfflineKey, cacheOfflineNone, cacheOfflineXDays, cacheOfflineAll, cacheOfflineNumberDaysKey,
+           cacheMemoryPartBudgetKey;
+    static const QString cryptoDecryptedCacheBudgetKey;
     static const QString xtConnectCacheDirectory, xtSyncMailboxList, xtDbHost, xtDbPort,
-           xtDbDbName, xtDbUser;
+           xtDbDbName, xtDbUser, xtParallelConnections;
     static const QString guiMsgListShowThreading;
     static const QString guiMsgListHideRead;
     static const QString guiMailboxListShowOnlySubscribed;
@@ -61,6 +61,12 @@ bool is_running(const std::future<void> &future)
     return future.wait_for(std::chrono::duration_values<std::chrono::seconds>::zero()) == std::future_status::timeout;
 }
 
+/** @short Is the @arg index among the siblings which were reported by a dataChanged() signal? */
+bool isWithinChangedRange(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QModelIndex &index)
+{
+    return index.isValid() && index.parent() == topLeft.parent() && index.row() >= topLeft.row() && index.row() <= bottomRight.row();
+}
+
 }
 
 namespace Cryptography {
@@ -76,6 +82,64 @@ QString protocolToString(const Protocol protocol)
     Q_UNREACHABLE();
 }
 
+DecryptedMessageCache::DecryptedMessageCache()
+    : m_hits(0)
+    , m_misses(0)
+{
+    m_entries.setMaxCost(0);
+}
+
+void DecryptedMessageCache::setBudget(const int bytes)
+{
+    m_entries.setMaxCost(qMax(0, bytes));
+}
+
+void DecryptedMessageCache::clear()
+{
+    m_entries.clear();
+}
+
+const DecryptedMessageCache::Entry *DecryptedMessageCache::find(const QString &key)
+{
+    if (key.isEmpty() || !m_entries.maxCost())
+        return nullptr;
+    const Entry *entry = m_entries.object(key);
+    if (entry)
+        ++m_hits;
+    else
+        ++m_misses;
+    return entry;
+}
+
+void DecryptedMessageCache::insert(const QString &key, const QByteArray &plaintext, const SignatureDataBundle &status)
+{
+    if (key.isEmpty() || !m_entries.maxCost())
+        return;
+    // QCache takes ownership even when the entry is too big to fit
+    m_entries.insert(key, new Entry{plaintext, status}, qMax(1, plaintext.size()));
+}
+
+QString DecryptedMessageCache::keyForPart(const QModelIndex &part)
+{
+    const uint uidValidity = part.data(RoleMailboxUidValidity).toUInt();
+    const uint uid = part.data(RoleMessageUid).toUInt();
+    if (!uidValidity || !uid)
+        return QString();
+    return part.data(RoleMailboxName).toString() + QLatin1Char('\n') + QString::number(uidValidity) + QLatin1Char('\n')
+            + QString::number(uid) + QLatin1Char('\n') + part.data(RolePartPathToPart).toString();
+}
+
+quint64 DecryptedMessageCache::hits() const
+{
+    return m_hits;
+}
+
+quint64 DecryptedMessageCache::misses() const
+{
+    return m_misses;
+}
+
+
 GpgMeReplacer::GpgMeReplacer()
     : PartReplacer()
 {
@@ -85,6 +149,8 @@ GpgMeReplacer::GpgMeReplacer()
 
 GpgMeReplacer::~GpgMeReplacer()
 {
+    m_decryptedMessageCache.clear();
+
     if (!m_orphans.empty()) {
         QElapsedTimer t;
         t.start();
@@ -134,6 +200,11 @@ MessagePart::Ptr GpgMeReplacer::createPart(MessageModel *model, MessagePart *par
     return original;
 }
 
+DecryptedMessageCache *GpgMeReplacer::decryptedMessageCache()
+{
+    return &m_decryptedMessageCache;
+}
+
 void GpgMeReplacer::registerOrhpanedCryptoTask(std::future<void> task)
 {
     auto it = m_orphans.begin();
@@ -227,7 +298,9 @@ void GpgMePart::internalUpdateState(const SignatureDataBundle &d)
     m_statusIcon = d.statusIcon;
     m_signatureIdentityName = d.signatureUid;
     m_signDate = d.signatureDate;
-    m_crypto.get();
+    // There's no background operation when the result comes from the DecryptedMessageCache
+    if (m_crypto.valid())
+        m_crypto.get();
     emitDataChanged();
 }
 
@@ -618,7 +691,12 @@ GpgMeSigned::~GpgMeSigned()
 
 void GpgMeSigned::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
-    Q_ASSERT(topLeft == bottomRight);
+    if (topLeft.row() != bottomRight.row()) {
+        // A range of messages has changed; the parts are always reported individually
+        if (isWithinChangedRange(topLeft, bottomRight, m_enclosingMessage))
+            handleDataChanged(m_enclosingMessage, m_enclosingMessage);
+        return;
+    }
     if (!m_plaintextPart.isValid()) {
         forwardFailure(tr("Signed message is gone"), QString(), QStringLiteral("state-offline"));
         return;
@@ -763,7 +841,12 @@ GpgMeEncrypted::~GpgMeEncrypted()
 
 void GpgMeEncrypted::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
-    Q_ASSERT(topLeft == bottomRight);
+    if (topLeft.row() != bottomRight.row()) {
+        // A range of messages has changed; the parts are always reported individually
+        if (isWithinChangedRange(topLeft, bottomRight, m_enclosingMessage))
+            handleDataChanged(m_enclosingMessage, m_enclosingMessage);
+        return;
+    }
     if (!m_encPart.isValid()) {
         forwardFailure(tr("Encrypted message is gone"), QString(), QStringLiteral("state-offline"));
         return;
@@ -799,6 +882,15 @@ void GpgMeEncrypted::handleDataChanged(const QModelIndex &topLeft, const QModelI
         }
     }
 
+    m_cacheKey = DecryptedMessageCache::keyForPart(m_encPart);
+    if (auto cached = m_replacer->decryptedMessageCache()->find(m_cacheKey)) {
+        // The entry might get evicted as a side effect of the model updates, so better make a copy
+        const DecryptedMessageCache::Entry entry = *cached;
+        insertDecryptedData(true, entry.plaintext);
+        internalUpdateState(entry.status);
+        return;
+    }
+
     m_statusTLDR = tr("Decrypting...");
 
     auto cipherData = m_encPart.data(RolePartData).toByteArray();
@@ -877,21 +969,33 @@ void GpgMeEncrypted::handleDataChanged(const QModelIndex &topLeft, const QModelI
             longStatus += LF + tr("Original filename: %1").arg(QString::fromUtf8(fname));
         }
 
+        const SignatureDataBundle status{wasSigned, sigOkDisregardingTrust, sigValidVerified, tldr, longStatus, icon, signer, signDate};
         if (p) {
             bool ok = QMetaObject::invokeMethod(p, "processDecryptedData", Qt::QueuedConnection,
                                                 Q_ARG(bool, decryptedOk),
-                                                Q_ARG(QByteArray, dp.data()));
+                                                Q_ARG(QByteArray, dp.data()),
+                                                // must use full namespace qualification
+                                                Q_ARG(Cryptography::SignatureDataBundle, status));
             Q_ASSERT(ok); Q_UNUSED(ok);
         } else {
             qDebug() << "[async crypto: GpgMeEncrypted is gone, not sending cleartext data]";
         }
-        submitVerifyResult(p, {wasSigned, sigOkDisregardingTrust, sigValidVerified, tldr, longStatus, icon, signer, signDate});
+        submitVerifyResult(p, status);
     });
 
     emitDataChanged();
 }
 
-void GpgMeEncrypted::processDecryptedData(const bool ok, const QByteArray &data)
+void GpgMeEncrypted::processDecryptedData(const bool ok, const QByteArray &data, const SignatureDataBundle &status)
+{
+    if (ok) {
+        // Failures are not remembered; they might be caused by a cancelled passphrase prompt, for example
+        m_replacer->decryptedMessageCache()->insert(m_cacheKey, data, status);
+    }
+    insertDecryptedData(ok, data);
+}
+
+void GpgMeEncrypted::insertDecryptedData(const bool ok, const QByteArray &data)
 {
     if (!m_versionPart.isValid() || !m_encPart.isValid() || !m_proxyParentIndex.isValid()) {
         forwardFailure(tr("Encrypted message is gone"), QString(), QStringLiteral("state-offline"));
@@ -25,6 +25,7 @@
 
 #include <future>
 #include <memory>
+#include <QCache>
 #include <QDateTime>
 #include <QModelIndex>
 #include "Cryptography/MessagePart.h"
@@ -48,6 +49,48 @@ struct SignatureDataBundle {
     QDateTime signatureDate;
 };
 
+/** @short Memory-only cache of the messages which were decrypted during this session
+
+Decryption might be expensive, especially with smartcards or when the key is protected by a passphrase which has
+to be obtained through the agent. The cache remembers the plaintext and the signature status of successfully decrypted
+parts, so that showing the same message again does not have to go through GpgME once again. The size of the cache is
+bounded by the amount of plaintext it holds, and the least recently used entries are evicted first. Nothing is ever
+written to disk.
+
+The cache is disabled unless a non-zero budget is set.
+*/
+class DecryptedMessageCache {
+public:
+    struct Entry {
+        QByteArray plaintext;
+        SignatureDataBundle status;
+    };
+
+    DecryptedMessageCache();
+
+    /** @short Set the maximal amount of plaintext in bytes; zero disables the cache and throws away its contents */
+    void setBudget(const int bytes);
+    /** @short Forget everything */
+    void clear();
+
+    /** @short Find the cached result of decrypting the part identified by the @arg key, or nullptr */
+    const Entry *find(const QString &key);
+    void insert(const QString &key, const QByteArray &plaintext, const SignatureDataBundle &status);
+
+    /** @short Build a cache key for a part from the IMAP model; returns an empty string if the part cannot be identified */
+    static QString keyForPart(const QModelIndex &part);
+
+    /** @short How many lookups were answered from the cache */
+    quint64 hits() const;
+    /** @short How many lookups had to decrypt the message again */
+    quint64 misses() const;
+
+private:
+    QCache<QString, Entry> m_entries;
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
 /** @short What sort of crypto messages is this? */
 enum class Protocol {
     OpenPGP,
@@ -63,8 +106,11 @@ public:
                                 const QModelIndex &sourceItemIndex, const QModelIndex &proxyParentIndex) override;
 
     void registerOrhpanedCryptoTask(std::future<void> task);
+
+    DecryptedMessageCache *decryptedMessageCache();
 private:
     std::vector<std::future<void>> m_orphans;
+    DecryptedMessageCache m_decryptedMessageCache;
 };
 
 /** @short Wrapper for asynchronous PGP related operations using GpgME++ */
@@ -132,10 +178,14 @@ public:
 
 private slots:
     virtual void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight) override;
-    void processDecryptedData(const bool ok, const QByteArray &data);
+    void processDecryptedData(const bool ok, const QByteArray &data, const Cryptography::SignatureDataBundle &status);
 
 private:
+    void insertDecryptedData(const bool ok, const QByteArray &data);
+
     QPersistentModelIndex m_versionPart, m_encPart;
+    /** @short Identification of the encrypted part within the DecryptedMessageCache */
+    QString m_cacheKey;
     bool m_decryptionSupported;
     bool m_decryptionFailed;
 };
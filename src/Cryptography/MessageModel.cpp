@@ -52,6 +52,13 @@ void MessageModel::mapDataChanged(const QModelIndex &topLeft, const QModelIndex
     if (!root.isValid())
         return;
 
+    if (topLeft.row() != bottomRight.row()) {
+        // A range of messages has changed, and our message might be one of them
+        if (topLeft.parent() == m_message.parent() && m_message.row() >= topLeft.row() && m_message.row() <= bottomRight.row())
+            mapDataChanged(m_message, m_message);
+        return;
+    }
+
     auto topLeftIt = m_map.constFind(topLeft);
     auto bottomRightIt = m_map.constFind(bottomRight);
     if (topLeftIt != m_map.constEnd() && bottomRightIt != m_map.constEnd()) {
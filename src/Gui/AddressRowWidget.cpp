@@ -41,7 +41,8 @@ static int plainChars(const QLabel *l)
 
 AddressRowWidget::AddressRowWidget(QWidget *parent, const QString &description,
                                    const QList<Imap::Message::MailAddress> &addresses, MessageView *messageView):
-    QWidget(parent), m_expander(0), m_expandedLength(0)
+    QWidget(parent), m_expander(0), m_expandedLength(0), m_messageView(messageView), m_collapsedCount(0),
+    m_collapsedWidgetsCreated(false)
 {
     FlowLayout *lay = new FlowLayout(this, 0, 0, 0);
     setLayout(lay);
@@ -53,65 +54,95 @@ AddressRowWidget::AddressRowWidget(QWidget *parent, const QString &description,
 
 void AddressRowWidget::addAddresses(const QString &description, const QList<Imap::Message::MailAddress> &addresses, MessageView *messageView)
 {
-    if (m_expander)
-        layout()->removeWidget(m_expander);
+    m_messageView = messageView;
+    if (m_expander) {
+        collapse(description, addresses);
+        return;
+    }
+
     if (!description.isEmpty()) {
         QLabel *title = new QLabel(description, this);
         title->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
         title->setTextInteractionFlags(Qt::TextSelectableByMouse | Qt::LinksAccessibleByMouse);
         layout()->addWidget(title);
-        if (m_expander)
-            title->hide();
     }
-    int collapse = m_expander ? m_expander->expanding() : 0;
     for (int i = 0; i < addresses.size(); ++i) {
+        if (i > 1 && m_expandedLength > nonExpandingLength) {
+            collapse(QString(), addresses.mid(i));
+            return;
+        }
         auto *w = new OneEnvelopeAddress(this, addresses[i], messageView,
                                          i == addresses.size() - 1 ?
                                          OneEnvelopeAddress::Position::Last :
                                          OneEnvelopeAddress::Position::Middle);
         m_expandedLength += plainChars(w);
         layout()->addWidget(w);
-        if (collapse || (i > 1 && m_expandedLength > nonExpandingLength)) {
-            w->hide();
-            ++collapse;
-        }
     }
-    if (collapse && !m_expander) {
-        m_expander = new Expander(this, collapse);
+}
+
+/** @short Put the @arg addresses behind the m_expander, their widgets are only created once the user asks for them */
+void AddressRowWidget::collapse(const QString &description, const QList<Imap::Message::MailAddress> &addresses)
+{
+    if (addresses.isEmpty())
+        return;
+
+    m_collapsedCount += addresses.size();
+
+    if (!m_expander) {
+        m_expander = new Expander(this, m_collapsedCount);
         connect(m_expander, &Expander::clicked, this, &AddressRowWidget::toggle);
-    }
-    if (m_expander)
         layout()->addWidget(m_expander);
+    }
+    if (m_collapsedWidgetsCreated) {
+        createCollapsedWidgets(description, addresses);
+    } else {
+        m_collapsed << qMakePair(description, addresses);
+    }
+    if (m_expander->expanding())
+        m_expander->setExpanding(m_collapsedCount);
+}
+
+/** @short Create the widgets for addresses which are hidden behind the m_expander */
+void AddressRowWidget::createCollapsedWidgets(const QString &description, const QList<Imap::Message::MailAddress> &addresses)
+{
+    const bool visible = !m_expander->expanding();
+    // The expander shall remain the very last item
+    layout()->removeWidget(m_expander);
+    if (!description.isEmpty()) {
+        QLabel *title = new QLabel(description, this);
+        title->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+        title->setTextInteractionFlags(Qt::TextSelectableByMouse | Qt::LinksAccessibleByMouse);
+        title->setVisible(visible);
+        layout()->addWidget(title);
+        m_collapsedWidgets << title;
+    }
+    for (int i = 0; i < addresses.size(); ++i) {
+        auto *w = new OneEnvelopeAddress(this, addresses[i], m_messageView,
+                                         i == addresses.size() - 1 ?
+                                         OneEnvelopeAddress::Position::Last :
+                                         OneEnvelopeAddress::Position::Middle);
+        w->setVisible(visible);
+        layout()->addWidget(w);
+        m_collapsedWidgets << w;
+    }
+    layout()->addWidget(m_expander);
 }
 
 void AddressRowWidget::toggle()
 {
     Q_ASSERT(m_expander);
-    if (m_expander->expanding()) {
-        m_expander->setExpanding(false);
-        for (int i = 0; i < layout()->count(); ++i) {
-            if (QWidget *w = layout()->itemAt(i)->widget())
-                w->show();
-        }
-    } else {
-        int chars = 0, addresses = 0;
-        int collapse = 0;
-        for (int i = 0; i < layout()->count(); ++i) {
-            QWidget *w = layout()->itemAt(i)->widget();
-            if (collapse && w != m_expander) {
-                ++collapse;
-                w->hide();
-                continue;
-            }
-            if (OneEnvelopeAddress *oea = qobject_cast<OneEnvelopeAddress*>(w)) {
-                ++addresses;
-                chars += plainChars(oea);
-                if ((collapse = (addresses > 1 && chars > nonExpandingLength)))
-                    w->hide();
-            }
-        }
-        m_expander->setExpanding(collapse);
+    const bool expand = m_expander->expanding();
+    m_expander->setExpanding(expand ? 0 : m_collapsedCount);
+    if (!m_collapsedWidgetsCreated) {
+        Q_ASSERT(expand);
+        m_collapsedWidgetsCreated = true;
+        for (auto it = m_collapsed.constBegin(); it != m_collapsed.constEnd(); ++it)
+            createCollapsedWidgets(it->first, it->second);
+        m_collapsed.clear();
+        return;
     }
+    Q_FOREACH(QWidget *w, m_collapsedWidgets)
+        w->setVisible(expand);
 }
 
 Expander::Expander(QWidget *parent, int count) : QLabel(parent)
@@ -23,12 +23,7 @@
 #define GUI_ADDRESSROWWIDGET_H
 
 #include <QLabel>
-
-namespace Imap {
-namespace Message {
-class MailAddress;
-}
-}
+#include "Imap/Parser/MailAddress.h"
 
 namespace Gui {
 
@@ -52,7 +47,12 @@ private:
     int m_expanding;
 };
 
-/** @short Widget displaying the message envelope */
+/** @short Widget displaying the message envelope
+
+Only the first few addresses get their own OneEnvelopeAddress widget right away. Whatever doesn't fit is kept aside and
+the widgets for these addresses are only created when the user expands the row for the first time, so that messages
+with thousands of recipients open quickly.
+*/
 class AddressRowWidget : public QWidget
 {
     Q_OBJECT
@@ -65,8 +65,20 @@ private slots:
 private:
     AddressRowWidget(const AddressRowWidget &) = delete;
     AddressRowWidget &operator=(const AddressRowWidget &) = delete;
+    void collapse(const QString &description, const QList<Imap::Message::MailAddress> &addresses);
+    void createCollapsedWidgets(const QString &description, const QList<Imap::Message::MailAddress> &addresses);
+
     Expander *m_expander;
     uint m_expandedLength;
+    MessageView *m_messageView;
+    /** @short Addresses (along with their leading description) which are hidden behind the m_expander */
+    QList<QPair<QString, QList<Imap::Message::MailAddress>>> m_collapsed;
+    /** @short Number of addresses hidden behind the m_expander */
+    int m_collapsedCount;
+    /** @short Have the widgets for the m_collapsed addresses been created already? */
+    bool m_collapsedWidgetsCreated;
+    /** @short Widgets which get shown and hidden along with the m_expander */
+    QList<QWidget *> m_collapsedWidgets;
 };
 
 }
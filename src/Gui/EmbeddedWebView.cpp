@@ -42,6 +42,9 @@
 
 namespace {
 
+/** @short Do at most one layout pass per this many milliseconds, i.e. one per frame at 60 Hz */
+const int CONSTRAIN_SIZE_INTERVAL = 16;
+
 /** @short RAII pattern for counter manipulation */
 class Incrementor {
     int *m_int;
@@ -66,6 +69,8 @@ EmbeddedWebView::EmbeddedWebView(QWidget *parent, QNetworkAccessManager *network
     : QWebView(parent)
     , m_scrollParent(nullptr)
     , m_resizeInProgress(0)
+    , m_constrainedWidth(-1)
+    , m_sizeConstraintPending(false)
     , m_staticWidth(0)
     , m_colorScheme(ColorScheme::System)
 {
@@ -89,7 +94,7 @@ EmbeddedWebView::EmbeddedWebView(QWidget *parent, QNetworkAccessManager *network
     page()->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
     connect(this, &QWebView::linkClicked, this, &EmbeddedWebView::slotLinkClicked);
     connect(this, &QWebView::loadFinished, this, &EmbeddedWebView::handlePageLoadFinished);
-    connect(page()->mainFrame(), &QWebFrame::contentsSizeChanged, this, &EmbeddedWebView::handlePageLoadFinished);
+    connect(page()->mainFrame(), &QWebFrame::contentsSizeChanged, this, &EmbeddedWebView::handleContentsSizeChanged);
 
     // Scrolling is implemented on upper layers
     page()->mainFrame()->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
@@ -105,9 +110,9 @@ EmbeddedWebView::EmbeddedWebView(QWidget *parent, QNetworkAccessManager *network
     connect(m_autoScrollTimer, &QTimer::timeout, this, &EmbeddedWebView::autoScroll);
 
     m_sizeContrainTimer = new QTimer(this);
-    m_sizeContrainTimer->setInterval(50);
+    m_sizeContrainTimer->setInterval(CONSTRAIN_SIZE_INTERVAL);
     m_sizeContrainTimer->setSingleShot(true);
-    connect(m_sizeContrainTimer, &QTimer::timeout, this, &EmbeddedWebView::constrainSize);
+    connect(m_sizeContrainTimer, &QTimer::timeout, this, &EmbeddedWebView::handleConstrainSizeTimeout);
 
     setContextMenuPolicy(Qt::NoContextMenu);
     findScrollParent();
@@ -124,23 +129,21 @@ void EmbeddedWebView::constrainSize()
 
     // Prevent expensive operation where a resize triggers one extra resizing operation.
     // This is very visible on large attachments, and in fact could possibly lead to recursion as the
-    // contentsSizeChanged signal is connected to handlePageLoadFinished.
+    // contentsSizeChanged signal leads back here.
     if (m_resizeInProgress > 1)
         return;
 
-    // the m_scrollParentPadding measures the summed up horizontal paddings of this view compared to
-    // its m_scrollParent
+    const int width = wantedWidth();
     setMinimumSize(0,0);
     setMaximumSize(QWIDGETSIZE_MAX, QWIDGETSIZE_MAX);
     if (m_staticWidth) {
-        resize(m_staticWidth, QWIDGETSIZE_MAX - 1);
-        page()->setViewportSize(QSize(m_staticWidth, 32));
+        resize(width, QWIDGETSIZE_MAX - 1);
     } else {
         // resize so that the viewport has much vertical and wanted horizontal space
-        resize(m_scrollParent->width() - m_scrollParentPadding, QWIDGETSIZE_MAX);
-        // resize the PAGES viewport to this width and a minimum height
-        page()->setViewportSize(QSize(m_scrollParent->width() - m_scrollParentPadding, 32));
+        resize(width, QWIDGETSIZE_MAX);
     }
+    // resize the PAGES viewport to this width and a minimum height
+    page()->setViewportSize(QSize(width, 32));
     // now the page has an idea about it's demanded size
     const QSize bestSize = page()->mainFrame()->contentsSize();
     // set the viewport to that size! - Otherwise it'd still be our "suggestion"
@@ -148,6 +151,61 @@ void EmbeddedWebView::constrainSize()
     // fix the widgets size so the layout doesn't have much choice
     setFixedSize(bestSize);
     m_sizeContrainTimer->stop(); // we caused spurious resize events
+    m_constrainedWidth = width;
+    m_sizeConstraintPending = false;
+}
+
+/** @short Ask for a layout pass which happens at most once per frame, no matter how many requests arrive in the meanwhile */
+void EmbeddedWebView::requestConstrainSize()
+{
+    if (!m_sizeContrainTimer->isActive())
+        m_sizeContrainTimer->start();
+}
+
+void EmbeddedWebView::handleConstrainSizeTimeout()
+{
+    if (!(m_scrollParent && page() && page()->mainFrame()))
+        return;
+
+    const int width = wantedWidth();
+    if (m_constrainedWidth == width) {
+        // Neither the contents nor the width has changed, e.g. when the parent got only taller
+        return;
+    }
+
+    if (!isInScrollViewport()) {
+        // Nobody can see the result, so the layout of the page and its new height can wait until the user scrolls
+        // here. The width cannot wait, though, a stale one would make the whole scroll area wider than its viewport.
+        if (width != this->width()) {
+            Incrementor dummy(&m_resizeInProgress);
+            setFixedWidth(width);
+            m_constrainedWidth = -1;
+        }
+        m_sizeConstraintPending = true;
+        return;
+    }
+
+    constrainSize();
+}
+
+/** @short Width of the viewport in which the page shall be laid out */
+int EmbeddedWebView::wantedWidth() const
+{
+    // the m_scrollParentPadding measures the summed up horizontal paddings of this view compared to
+    // its m_scrollParent
+    return m_staticWidth ? m_staticWidth : m_scrollParent->width() - m_scrollParentPadding;
+}
+
+/** @short Is at least a part of this view shown within the viewport of its scroll parent? */
+bool EmbeddedWebView::isInScrollViewport() const
+{
+    if (!isVisible())
+        return false;
+    QAbstractScrollArea *area = qobject_cast<QAbstractScrollArea*>(m_scrollParent);
+    if (!area)
+        return true;
+    QWidget *viewport = area->viewport();
+    return QRect(mapTo(viewport, QPoint(0, 0)), size()).intersects(viewport->rect());
 }
 
 void EmbeddedWebView::slotLinkClicked(const QUrl &url)
@@ -167,6 +225,7 @@ void EmbeddedWebView::slotLinkClicked(const QUrl &url)
 
 void EmbeddedWebView::handlePageLoadFinished()
 {
+    m_constrainedWidth = -1;
     constrainSize();
 
     // We've already set in in our constructor, but apparently it isn't enough (Qt 4.8.0 on X11).
@@ -177,6 +236,21 @@ void EmbeddedWebView::handlePageLoadFinished()
     page()->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
 }
 
+void EmbeddedWebView::handleContentsSizeChanged()
+{
+    // Our own layout pass changes the contents size as well
+    if (m_resizeInProgress)
+        return;
+    m_constrainedWidth = -1;
+    requestConstrainSize();
+}
+
+void EmbeddedWebView::handleScrollParentScrolled()
+{
+    if (m_sizeConstraintPending)
+        requestConstrainSize();
+}
+
 void EmbeddedWebView::changeEvent(QEvent *e)
 {
     QWebView::changeEvent(e);
@@ -189,7 +263,7 @@ bool EmbeddedWebView::eventFilter(QObject *o, QEvent *e)
     if (o == m_scrollParent) {
         if (e->type() == QEvent::Resize) {
             if (!m_staticWidth)
-                m_sizeContrainTimer->start();
+                requestConstrainSize();
         } else if (e->type() == QEvent::Enter) {
             m_autoScrollPixels = 0;
             m_autoScrollTimer->stop();
@@ -238,6 +312,7 @@ void EmbeddedWebView::findScrollParent()
 {
     if (m_scrollParent)
         m_scrollParent->removeEventFilter(this);
+    disconnect(m_scrollParentScrolled);
     m_scrollParent = 0;
     const int frameWidth = 2*style()->pixelMetric(QStyle::PM_DefaultFrameWidth);
     m_scrollParentPadding = frameWidth;
@@ -267,8 +342,12 @@ void EmbeddedWebView::findScrollParent()
         runner = p;
     }
     m_scrollParentPadding += style()->pixelMetric(QStyle::PM_ScrollBarExtent, 0, m_scrollParent);
-    if (m_scrollParent)
+    if (m_scrollParent) {
         m_scrollParent->installEventFilter(this);
+        // Views which were skipped while out of sight have to catch up once they get scrolled into view
+        m_scrollParentScrolled = connect(static_cast<QAbstractScrollArea*>(m_scrollParent)->verticalScrollBar(),
+                                         &QScrollBar::valueChanged, this, &EmbeddedWebView::handleScrollParentScrolled);
+    }
 }
 
 void EmbeddedWebView::showEvent(QShowEvent *se)
@@ -281,6 +360,8 @@ void EmbeddedWebView::showEvent(QShowEvent *se)
         resize(640,480);
     } else if (!m_scrollParent) // it would be much easier if the parents were just passed with the constructor ;-)
         findScrollParent();
+    if (m_sizeConstraintPending)
+        requestConstrainSize();
 }
 
 QSize EmbeddedWebView::sizeHint() const
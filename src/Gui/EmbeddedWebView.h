@@ -74,16 +74,28 @@ protected:
     void constrainSize();
 private:
     void findScrollParent();
+    void requestConstrainSize();
+    int wantedWidth() const;
+    bool isInScrollViewport() const;
 private slots:
     void autoScroll();
     void slotLinkClicked(const QUrl &url);
     void handlePageLoadFinished();
+    void handleContentsSizeChanged();
+    void handleScrollParentScrolled();
+    void handleConstrainSizeTimeout();
 private:
     QWidget *m_scrollParent;
+    QMetaObject::Connection m_scrollParentScrolled;
     int m_scrollParentPadding;
     int m_resizeInProgress;
     QTimer *m_autoScrollTimer;
+    /** @short Coalesces all requests for a new layout within a single frame */
     QTimer *m_sizeContrainTimer;
+    /** @short Width which the last layout pass was done for, or -1 if the contents have changed since then */
+    int m_constrainedWidth;
+    /** @short A layout pass was skipped because the view was not visible within its scroll parent */
+    bool m_sizeConstraintPending;
     int m_autoScrollPixels;
     int m_staticWidth;
     QString m_customCss;
@@ -21,6 +21,7 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <QAbstractProxyModel>
 #include <QDragMoveEvent>
 #include <QDropEvent>
 #include <QMenu>
@@ -147,6 +148,31 @@ void MailBoxTreeView::setDesiredExpansion(const QStringList &mailboxNames)
     resetWatchedMailboxes();
 }
 
+bool MailBoxTreeView::isMailboxVisible(const QModelIndex &mailbox) const
+{
+    // Find the chain of proxies between the model of this view and the model of the index
+    QList<const QAbstractProxyModel *> proxies;
+    const QAbstractItemModel *current = model();
+    while (current && current != mailbox.model()) {
+        auto proxy = qobject_cast<const QAbstractProxyModel *>(current);
+        if (!proxy)
+            return false;
+        proxies.prepend(proxy);
+        current = proxy->sourceModel();
+    }
+    if (!current)
+        return false;
+
+    QModelIndex index = mailbox;
+    Q_FOREACH(const QAbstractProxyModel *proxy, proxies) {
+        index = proxy->mapFromSource(index);
+        if (!index.isValid())
+            return false;
+    }
+    // Children of collapsed items have an empty rectangle
+    return viewport()->rect().intersects(visualRect(index));
+}
+
 /** @short Ensure that we watch stuff that we need to watch */
 void MailBoxTreeView::resetWatchedMailboxes()
 {
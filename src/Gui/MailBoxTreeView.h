@@ -42,6 +42,8 @@ public:
     explicit MailBoxTreeView(QWidget *parent = nullptr);
     void setDesiredExpansion(const QStringList &mailboxNames);
     void setModel(QAbstractItemModel *model) override;
+    /** @short Is the @arg mailbox, which is an index from any of the underlying models, visible right now? */
+    bool isMailboxVisible(const QModelIndex &mailbox) const;
 signals:
     /** @short User has changed their mind about the expanded/collapsed state of the mailbox tree
 
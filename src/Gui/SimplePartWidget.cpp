@@ -39,14 +39,23 @@
 #include "Imap/Network/FileDownloadManager.h"
 #include "Imap/Model/Utils.h"
 #include "UiUtils/Color.h"
+#include "UiUtils/Formatting.h"
 #include "UiUtils/IconLoader.h"
 
+namespace {
+
+/** @short Plain text parts which are bigger than this are shown while their download is still in progress */
+const quint64 PREVIEW_THRESHOLD = 512 * 1024;
+
+}
+
 namespace Gui
 {
 
 SimplePartWidget::SimplePartWidget(QWidget *parent, Imap::Network::MsgPartNetAccessManager *manager,
                                    const QModelIndex &partIndex, MessageView *messageView):
-    EmbeddedWebView(parent, manager), m_partIndex(partIndex), m_messageView(messageView), m_netAccessManager(manager)
+    EmbeddedWebView(parent, manager), m_partIndex(partIndex), m_previewMode(false), m_messageView(messageView),
+    m_netAccessManager(manager)
 {
     Q_ASSERT(partIndex.isValid());
 
@@ -55,12 +64,12 @@ SimplePartWidget::SimplePartWidget(QWidget *parent, Imap::Network::MsgPartNetAcc
         connect(this, &QWebView::loadFinished, m_messageView, &MessageView::onWebViewLoadFinished);
     }
 
-    QUrl url;
-    url.setScheme(QStringLiteral("trojita-imap"));
-    url.setHost(QStringLiteral("msg"));
-    url.setPath(partIndex.data(Imap::Mailbox::RolePartPathToPart).toString());
+    m_url.setScheme(QStringLiteral("trojita-imap"));
+    m_url.setHost(QStringLiteral("msg"));
+    m_url.setPath(partIndex.data(Imap::Mailbox::RolePartPathToPart).toString());
     if (partIndex.data(Imap::Mailbox::RolePartMimeType).toString() == QLatin1String("text/plain")) {
-        if (partIndex.data(Imap::Mailbox::RolePartOctets).toULongLong() < 100 * 1024) {
+        const quint64 octets = partIndex.data(Imap::Mailbox::RolePartOctets).toULongLong();
+        if (octets < 100 * 1024) {
             connect(this, &QWebView::loadFinished, this, &SimplePartWidget::slotMarkupPlainText);
         } else {
             QFont font(QFontDatabase::systemFont(QFontDatabase::FixedFont));
@@ -68,9 +77,19 @@ SimplePartWidget::SimplePartWidget(QWidget *parent, Imap::Network::MsgPartNetAcc
             addCustomStylesheet(QStringLiteral("pre{word-wrap:normal !important;white-space:pre !important;}"));
             QWebSettings *s = settings();
             s->setFontFamily(QWebSettings::StandardFont, font.family());
+
+            // Huge log dumps and the like are shown as soon as their first chunk arrives
+            partIndex.data(Imap::Mailbox::RolePartForceFetchFromCache);
+            m_previewMode = octets > PREVIEW_THRESHOLD && !partIndex.data(Imap::Mailbox::RoleIsFetched).toBool();
         }
     }
-    load(url);
+    if (m_previewMode) {
+        connect(partIndex.model(), &QAbstractItemModel::dataChanged, this, &SimplePartWidget::slotPartDataChanged);
+        connect(this, &QWebView::linkClicked, this, &SimplePartWidget::slotPreviewLinkClicked);
+        showPreview();
+    } else {
+        load(m_url);
+    }
 
     m_savePart = new QAction(UiUtils::loadIcon(QStringLiteral("document-save")), tr("Save this message part..."), this);
     connect(m_savePart, &QAction::triggered, this, &SimplePartWidget::slotDownloadPart);
@@ -119,6 +138,49 @@ void SimplePartWidget::slotMarkupPlainText()
                                                            palette.link().color(), palette.linkVisited().color()));
 }
 
+/** @short Show the leading part of the data which have been downloaded so far, along with a link for loading more */
+void SimplePartWidget::showPreview()
+{
+    if (!m_partIndex.isValid())
+        return;
+
+    if (m_partIndex.data(Imap::Mailbox::RoleIsFetched).toBool() || m_partIndex.data(Imap::Mailbox::RoleIsUnavailable).toBool()) {
+        // Either we have everything now, or nothing more is going to arrive; the regular code path handles both
+        m_previewMode = false;
+        disconnect(m_partIndex.model(), &QAbstractItemModel::dataChanged, this, &SimplePartWidget::slotPartDataChanged);
+        disconnect(this, &QWebView::linkClicked, this, &SimplePartWidget::slotPreviewLinkClicked);
+        load(m_url);
+        return;
+    }
+
+    const QByteArray data = m_partIndex.data(Imap::Mailbox::RolePartPreviewData).toByteArray();
+    if (data.isEmpty()) {
+        // The first chunk hasn't arrived yet
+        return;
+    }
+
+    QString text = Imap::decodeByteArray(data, m_partIndex.data(Imap::Mailbox::RolePartCharset).toByteArray());
+    QString more = tr("Show more (%1 of %2 loaded)").arg(
+                UiUtils::Formatting::prettySize(data.size()),
+                UiUtils::Formatting::prettySize(m_partIndex.data(Imap::Mailbox::RolePartOctets).toULongLong()));
+    setHtml(QStringLiteral("<html><head><meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\"></head>"
+                           "<body><pre>%1</pre><p><a href=\"trojita-preview:more\">%2</a></p></body></html>")
+            .arg(text.toHtmlEscaped(), more.toHtmlEscaped()));
+}
+
+void SimplePartWidget::slotPartDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    Q_UNUSED(bottomRight);
+    if (topLeft == m_partIndex)
+        showPreview();
+}
+
+void SimplePartWidget::slotPreviewLinkClicked(const QUrl &url)
+{
+    if (url.scheme() == QLatin1String("trojita-preview") && m_partIndex.isValid())
+        m_partIndex.data(Imap::Mailbox::RolePartPreviewFetchMore);
+}
+
 void SimplePartWidget::slotFileNameRequested(QString *fileName)
 {
     *fileName = QFileDialog::getSaveFileName(this, tr("Save Attachment"),
@@ -130,15 +192,22 @@ void SimplePartWidget::slotFileNameRequested(QString *fileName)
 QString SimplePartWidget::quoteMe() const
 {
     QString selection = selectedText();
-    if (selection.isEmpty())
-        return page()->mainFrame()->toPlainText();
-    else
+    if (!selection.isEmpty())
         return selection;
+    if (m_previewMode) {
+        // Just the text which has arrived so far, without the "Show more" link
+        return Imap::decodeByteArray(m_partIndex.data(Imap::Mailbox::RolePartPreviewData).toByteArray(),
+                                     m_partIndex.data(Imap::Mailbox::RolePartCharset).toByteArray());
+    }
+    return page()->mainFrame()->toPlainText();
 }
 
 void SimplePartWidget::reloadContents()
 {
-    EmbeddedWebView::reload();
+    if (m_previewMode)
+        showPreview();
+    else
+        EmbeddedWebView::reload();
 }
 
 const auto zoomConstant = 1.1;
@@ -69,12 +69,19 @@ private slots:
     void slotDownloadPart();
     void slotDownloadMessage();
     void slotDownloadImage(const QNetworkRequest &req);
+    void slotPartDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void slotPreviewLinkClicked(const QUrl &url);
 protected:
 signals:
     void linkHovered(const QString &link, const QString &title, const QString &textContent);
     void searchDialogRequested();
 private:
+    void showPreview();
+
     QPersistentModelIndex m_partIndex;
+    QUrl m_url;
+    /** @short Is the part being shown from a partial download? */
+    bool m_previewMode;
     QAction *m_savePart;
     QAction *m_saveMessage;
     QAction *m_findAction;
@@ -21,6 +21,7 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <QAuthenticator>
 #include <QDesktopServices>
 #include <QDesktopWidget>
@@ -28,6 +29,7 @@
 #include <QDockWidget>
 #include <QFileDialog>
 #include <QHeaderView>
+#include <QInputDialog>
 #include <QItemSelectionModel>
 #include <QKeyEvent>
 #include <QMenuBar>
@@ -43,6 +45,7 @@
 #include <QToolBar>
 #include <QToolButton>
 #include <QToolTip>
+#include <QTreeView>
 #include <QUrl>
 #include <QWheelEvent>
 
@@ -58,9 +61,12 @@
 #    include "Cryptography/GpgMe++.h"
 #  endif
 #endif
+#include "Imap/Model/ExportSink.h"
 #include "Imap/Model/ImapAccess.h"
+#include "Imap/Model/MailboxExporter.h"
 #include "Imap/Model/MailboxTree.h"
 #include "Imap/Model/Model.h"
+#include "Imap/Model/MultiMailboxSearchModel.h"
 #include "Imap/Model/ModelWatcher.h"
 #include "Imap/Model/MsgListModel.h"
 #include "Imap/Model/NetworkWatcher.h"
@@ -99,6 +105,7 @@
 #include "ui_AboutDialog.h"
 
 #include "Imap/Model/ModelTest/modeltest.h"
+#include "UiUtils/Formatting.h"
 #include "UiUtils/IconLoader.h"
 
 /** @short All user-facing widgets and related classes */
@@ -111,6 +118,7 @@ MainWindow::MainWindow(QSettings *settings): QMainWindow(), m_imapAccess(0), m_m
     m_mainStack(0), m_layoutMode(LAYOUT_COMPACT), m_skipSavingOfUI(true), m_delayedStateSaving(0), m_actionSortNone(0),
     m_ignoreStoredPassword(false), m_settings(settings), m_pluginManager(0), m_networkErrorMessageBox(0), m_trayIcon(0)
 {
+    std::fill(m_selectedFlagCounts, m_selectedFlagCounts + SELECTED_FLAGS_COUNT, 0);
     setAttribute(Qt::WA_AlwaysShowToolTips);
     // m_pluginManager must be created before calling createWidgets
     m_pluginManager = new Plugins::PluginManager(this, m_settings,
@@ -126,7 +134,11 @@ MainWindow::MainWindow(QSettings *settings): QMainWindow(), m_imapAccess(0), m_m
 #ifdef TROJITA_HAVE_CRYPTO_MESSAGES
     Plugins::PluginManager::MimePartReplacers replacers;
 #ifdef TROJITA_HAVE_GPGMEPP
-    replacers.emplace_back(std::make_shared<Cryptography::GpgMeReplacer>());
+    auto gpgMeReplacer = std::make_shared<Cryptography::GpgMeReplacer>();
+    // Keeping the decrypted messages around is opt-in, and they only ever live in memory
+    const int decryptedCacheBudgetMB = qBound(0, m_settings->value(Common::SettingsNames::cryptoDecryptedCacheBudgetKey, 0).toInt(), 1024);
+    gpgMeReplacer->decryptedMessageCache()->setBudget(decryptedCacheBudgetMB * 1024 * 1024);
+    replacers.emplace_back(gpgMeReplacer);
 #endif
     m_pluginManager->setMimePartReplacers(replacers);
 #endif
@@ -413,6 +425,14 @@ void MainWindow::createActions()
     m_actionMarkMailboxAsRead = new QAction(tr("&Mark Mailbox as Read"), this);
     connect(m_actionMarkMailboxAsRead, &QAction::triggered, this, &MainWindow::slotMarkCurrentMailboxRead);
 
+    //: "mailbox" as a "folder of messages", not as a "mail account"
+    m_actionExportMailbox = new QAction(tr("E&xport Mailbox..."), this);
+    connect(m_actionExportMailbox, &QAction::triggered, this, &MainWindow::slotExportCurrentMailbox);
+
+    //: "mailbox" as a "folder of messages", not as a "mail account"
+    m_actionSearchMailboxTree = new QAction(tr("Se&arch in Mailbox and Subfolders..."), this);
+    connect(m_actionSearchMailboxTree, &QAction::triggered, this, &MainWindow::slotSearchInCurrentMailboxTree);
+
     //: "mailbox" as a "folder of messages", not as a "mail account"
     deleteCurrentMailbox = new QAction(tr("&Remove Mailbox"), this);
     connect(deleteCurrentMailbox, &QAction::triggered, this, &MainWindow::slotDeleteCurrentMailbox);
@@ -823,16 +843,16 @@ void MainWindow::setupModels()
     connect(mboxTree, &MailBoxTreeView::activated,
             realMsgListModel,
             static_cast<void (Imap::Mailbox::MsgListModel::*)(const QModelIndex &)>(&Imap::Mailbox::MsgListModel::setMailbox));
-    connect(m_imapAccess->msgListModel(), &QAbstractItemModel::dataChanged, this, &MainWindow::updateMessageFlags);
+    connect(m_imapAccess->msgListModel(), &QAbstractItemModel::dataChanged, this, &MainWindow::updateSelectedMessageFlags);
     connect(qobject_cast<Imap::Mailbox::MsgListModel*>(m_imapAccess->msgListModel()), &Imap::Mailbox::MsgListModel::messagesAvailable,
             this, &MainWindow::slotScrollToUnseenMessage);
     connect(m_imapAccess->msgListModel(), &QAbstractItemModel::rowsInserted, msgListWidget, &MessageListWidget::slotAutoEnableDisableSearch);
     connect(m_imapAccess->msgListModel(), &QAbstractItemModel::rowsRemoved, msgListWidget, &MessageListWidget::slotAutoEnableDisableSearch);
-    connect(m_imapAccess->msgListModel(), &QAbstractItemModel::rowsRemoved, this, &MainWindow::updateMessageFlags);
+    connect(m_imapAccess->msgListModel(), &QAbstractItemModel::rowsRemoved, this, &MainWindow::resetSelectedMessages);
     connect(m_imapAccess->msgListModel(), &QAbstractItemModel::layoutChanged, msgListWidget, &MessageListWidget::slotAutoEnableDisableSearch);
-    connect(m_imapAccess->msgListModel(), &QAbstractItemModel::layoutChanged, this, &MainWindow::updateMessageFlags);
+    connect(m_imapAccess->msgListModel(), &QAbstractItemModel::layoutChanged, this, &MainWindow::resetSelectedMessages);
     connect(m_imapAccess->msgListModel(), &QAbstractItemModel::modelReset, msgListWidget, &MessageListWidget::slotAutoEnableDisableSearch);
-    connect(m_imapAccess->msgListModel(), &QAbstractItemModel::modelReset, this, &MainWindow::updateMessageFlags);
+    connect(m_imapAccess->msgListModel(), &QAbstractItemModel::modelReset, this, &MainWindow::resetSelectedMessages);
     connect(realMsgListModel, &Imap::Mailbox::MsgListModel::mailboxChanged, this, &MainWindow::slotMailboxChanged);
 
     connect(imapModel(), &Imap::Mailbox::Model::alertReceived, this, &MainWindow::alertReceived);
@@ -864,6 +884,9 @@ void MainWindow::setupModels()
 
     connect(imapModel(), &Imap::Mailbox::Model::capabilitiesUpdated, this, &MainWindow::slotCapabilitiesUpdated);
 
+    // Tearing down a huge tree of messages takes ages, and session managers won't wait for that
+    connect(qApp, &QCoreApplication::aboutToQuit, imapModel(), &Imap::Mailbox::Model::prepareForExit);
+
     connect(m_imapAccess->msgListModel(), &QAbstractItemModel::modelReset, this, &MainWindow::slotUpdateWindowTitle);
     connect(imapModel(), &Imap::Mailbox::Model::messageCountPossiblyChanged, this, &MainWindow::slotUpdateWindowTitle);
 
@@ -875,8 +898,21 @@ void MainWindow::setupModels()
     //ModelTest* tester = new ModelTest( prettyMboxModel, this ); // when testing, test just one model at time
 
     mboxTree->setModel(prettyMboxModel);
+    // Scrolling through a huge tree of mailboxes shall not result in a STATUS command for each row which flashed by.
+    // The INBOX is an exception because its unread count is shown in the tray icon.
+    imapModel()->setMessageCountDelay(250);
+    imapModel()->setMessageCountFilter([this](const QModelIndex &mailbox) {
+        return mailbox.data(Imap::Mailbox::RoleMailboxIsINBOX).toBool() || mboxTree->isMailboxVisible(mailbox);
+    });
     msgListWidget->tree->setModel(prettyMsgListModel);
-    connect(msgListWidget->tree->selectionModel(), &QItemSelectionModel::selectionChanged, this, &MainWindow::updateMessageFlags);
+    connect(msgListWidget->tree->selectionModel(), &QItemSelectionModel::selectionChanged, this, &MainWindow::updateSelectedMessages);
+    // Messages in a collapsed thread count as selected along with the thread root
+    auto resetIfSelected = [this](const QModelIndex &index) {
+        if (msgListWidget->tree->selectionModel()->isSelected(index))
+            resetSelectedMessages();
+    };
+    connect(msgListWidget->tree, &QTreeView::expanded, this, resetIfSelected);
+    connect(msgListWidget->tree, &QTreeView::collapsed, this, resetIfSelected);
 
     allTree->setModel(imapModel());
     taskTree->setModel(imapModel()->taskModel());
@@ -1125,6 +1161,9 @@ void MainWindow::showContextMenuMboxTree(const QPoint &position)
         actionList.append(createChildMailbox);
         actionList.append(deleteCurrentMailbox);
         actionList.append(m_actionMarkMailboxAsRead);
+        actionList.append(m_actionExportMailbox);
+        m_actionExportMailbox->setEnabled(!m_mailboxExporter);
+        actionList.append(m_actionSearchMailboxTree);
         actionList.append(resyncMbox);
         actionList.append(reloadMboxList);
 
@@ -1396,35 +1435,53 @@ void MainWindow::slotEditDraft()
     }
 }
 
-QModelIndexList MainWindow::translatedSelection() const
+/** @short UIDs of the selected messages, including those which are hidden in collapsed threads
+
+The UIDs are collected from the ranges of the selection, so that even a huge selection is cheap to capture.
+*/
+Imap::Sequence MainWindow::selectedUids() const
 {
-    QModelIndexList translatedIndexes;
-    QModelIndexList selected = msgListWidget->tree->selectionModel()->selectedIndexes();
-    const int originalItems = selected.length(); // only check collapsed/expanded status on original selection
-    for (int i = 0; i < selected.length(); ++i) {
-        const QModelIndex item = selected[i];
-        if (item.column() != 0 || !item.data(Imap::Mailbox::RoleMessageUid).isValid())
+    Imap::Uids uids;
+    QModelIndexList collapsed;
+    Q_FOREACH(const QItemSelectionRange &range, msgListWidget->tree->selectionModel()->selection()) {
+        if (range.left() != 0)
             continue;
-        translatedIndexes << Imap::deproxifiedIndex(item);
-        // Now see if this is a collapsed thread and include all the collapsed items as needed
-        // Also note that this is recursive - each child found is run through this same item loop for validity/child checks as well
-        if (i >= originalItems || !msgListWidget->tree->isExpanded(item)) {
-            for (int j = 0; j < item.model()->rowCount(item); ++j) {
-                selected << item.child(j, 0); // Make sure this is run through the main loop as well - don't add it directly
-            }
+        for (int row = range.top(); row <= range.bottom(); ++row) {
+            const QModelIndex item = range.model()->index(row, 0, range.parent());
+            if (const uint uid = item.data(Imap::Mailbox::RoleMessageUid).toUInt())
+                uids << uid;
+            if (!msgListWidget->tree->isExpanded(item))
+                collapsed << item;
+        }
+    }
+
+    // Everything below a collapsed thread counts, no matter whether the nested threads are expanded or not
+    while (!collapsed.isEmpty()) {
+        const QModelIndex item = collapsed.takeLast();
+        for (int j = 0; j < item.model()->rowCount(item); ++j) {
+            const QModelIndex child = item.child(j, 0);
+            if (const uint uid = child.data(Imap::Mailbox::RoleMessageUid).toUInt())
+                uids << uid;
+            collapsed << child;
         }
     }
-    return translatedIndexes;
+
+    return uids.isEmpty() ? Imap::Sequence() : Imap::Sequence::fromVector(uids);
+}
+
+QModelIndex MainWindow::currentMailbox() const
+{
+    return qobject_cast<Imap::Mailbox::MsgListModel *>(m_imapAccess->msgListModel())->currentMailbox();
 }
 
 void MainWindow::handleMarkAsRead(bool value)
 {
-    const QModelIndexList translatedIndexes = translatedSelection();
-    if (translatedIndexes.isEmpty()) {
+    const Imap::Sequence uids = selectedUids();
+    if (!uids.isValid()) {
         qDebug() << "Model::handleMarkAsRead: no valid messages";
     } else {
-        imapModel()->markMessagesRead(translatedIndexes, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
-        if (translatedIndexes.contains(m_messageWidget->messageView->currentMessage())) {
+        imapModel()->markMessagesRead(currentMailbox(), uids, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
+        if (uids.contains(m_messageWidget->messageView->currentMessage().data(Imap::Mailbox::RoleMessageUid).toUInt())) {
             m_messageWidget->messageView->stopAutoMarkAsRead();
         }
     }
@@ -1432,122 +1489,83 @@ void MainWindow::handleMarkAsRead(bool value)
 
 void MainWindow::slotNextUnread()
 {
-    QModelIndex current = msgListWidget->tree->currentIndex();
-
-    bool wrapped = false;
-    while (current.isValid()) {
-        if (!current.data(Imap::Mailbox::RoleMessageIsMarkedRead).toBool() && msgListWidget->tree->currentIndex() != current) {
-            m_messageWidget->messageView->setMessage(current);
-            msgListWidget->tree->setCurrentIndex(current);
-            return;
-        }
-
-        QModelIndex child = current.child(0, 0);
-        if (child.isValid()) {
-            current = child;
-            continue;
-        }
-
-        QModelIndex sibling = current.sibling(current.row() + 1, 0);
-        if (sibling.isValid()) {
-            current = sibling;
-            continue;
-        }
-
-        while (current.isValid() && msgListWidget->tree->model()->rowCount(current.parent()) - 1 == current.row()) {
-            current = current.parent();
-        }
-        current = current.sibling(current.row() + 1, 0);
-
-        if (!current.isValid() && !wrapped) {
-            wrapped = true;
-            current = msgListWidget->tree->model()->index(0, 0);
-        }
-    }
+    goToUnreadMessage(true);
 }
 
 void MainWindow::slotPreviousUnread()
 {
-    QModelIndex current = msgListWidget->tree->currentIndex();
-
-    bool wrapped = false;
-    while (current.isValid()) {
-        if (!current.data(Imap::Mailbox::RoleMessageIsMarkedRead).toBool() && msgListWidget->tree->currentIndex() != current) {
-            m_messageWidget->messageView->setMessage(current);
-            msgListWidget->tree->setCurrentIndex(current);
-            return;
-        }
+    goToUnreadMessage(false);
+}
 
-        QModelIndex candidate = current.sibling(current.row() - 1, 0);
-        while (candidate.isValid() && current.model()->hasChildren(candidate)) {
-            candidate = candidate.child(current.model()->rowCount(candidate) - 1, 0);
-            Q_ASSERT(candidate.isValid());
-        }
+/** @short Jump to the closest unread message in the given direction */
+void MainWindow::goToUnreadMessage(const bool forward)
+{
+    QModelIndex current = msgListWidget->tree->currentIndex();
+    if (!current.isValid())
+        return;
 
-        if (candidate.isValid()) {
-            current = candidate;
-        } else {
-            current = current.parent();
-        }
-        if (!current.isValid() && !wrapped) {
-            wrapped = true;
-            while (msgListWidget->tree->model()->hasChildren(current)) {
-                current = msgListWidget->tree->model()->index(msgListWidget->tree->model()->rowCount(current) - 1, 0, current);
-            }
-        }
+    auto threadingModel = qobject_cast<Imap::Mailbox::ThreadingMsgListModel *>(m_imapAccess->threadingMsgListModel());
+    Q_ASSERT(threadingModel);
+    QModelIndex unread = prettyMsgListModel->mapFromSource(
+                threadingModel->findUnreadMessage(prettyMsgListModel->mapToSource(current), forward));
+    if (unread.isValid() && unread != current) {
+        m_messageWidget->messageView->setMessage(unread);
+        msgListWidget->tree->setCurrentIndex(unread);
     }
 }
 
 void MainWindow::handleMarkAsDeleted(bool value)
 {
-    const QModelIndexList translatedIndexes = translatedSelection();
-    if (translatedIndexes.isEmpty()) {
+    const Imap::Sequence uids = selectedUids();
+    if (!uids.isValid()) {
         qDebug() << "Model::handleMarkAsDeleted: no valid messages";
     } else {
-        imapModel()->markMessagesDeleted(translatedIndexes, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
+        imapModel()->markMessagesDeleted(currentMailbox(), uids, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
     }
 }
 
 void MainWindow::handleMarkAsFlagged(const bool value)
 {
-    const QModelIndexList translatedIndexes = translatedSelection();
-    if (translatedIndexes.isEmpty()) {
+    const Imap::Sequence uids = selectedUids();
+    if (!uids.isValid()) {
         qDebug() << "Model::handleMarkAsFlagged: no valid messages";
     } else {
-        imapModel()->setMessageFlags(translatedIndexes, Imap::Mailbox::FlagNames::flagged, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
+        imapModel()->setMessageFlags(currentMailbox(), uids, Imap::Mailbox::FlagNames::flagged, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
     }
 }
 
 void MainWindow::handleMarkAsJunk(const bool value)
 {
-    const QModelIndexList translatedIndexes = translatedSelection();
-    if (translatedIndexes.isEmpty()) {
+    const Imap::Sequence uids = selectedUids();
+    if (!uids.isValid()) {
         qDebug() << "Model::handleMarkAsJunk: no valid messages";
     } else {
+        const QModelIndex mailbox = currentMailbox();
         if (value) {
-            imapModel()->setMessageFlags(translatedIndexes, Imap::Mailbox::FlagNames::notjunk, Imap::Mailbox::FLAG_REMOVE);
+            imapModel()->setMessageFlags(mailbox, uids, Imap::Mailbox::FlagNames::notjunk, Imap::Mailbox::FLAG_REMOVE);
         }
-        imapModel()->setMessageFlags(translatedIndexes, Imap::Mailbox::FlagNames::junk, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
+        imapModel()->setMessageFlags(mailbox, uids, Imap::Mailbox::FlagNames::junk, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
     }
 }
 
 void MainWindow::handleMarkAsNotJunk(const bool value)
 {
-    const QModelIndexList translatedIndexes = translatedSelection();
-    if (translatedIndexes.isEmpty()) {
+    const Imap::Sequence uids = selectedUids();
+    if (!uids.isValid()) {
         qDebug() << "Model::handleMarkAsNotJunk: no valid messages";
     } else {
+        const QModelIndex mailbox = currentMailbox();
         if (value) {
-          imapModel()->setMessageFlags(translatedIndexes, Imap::Mailbox::FlagNames::junk, Imap::Mailbox::FLAG_REMOVE);
+          imapModel()->setMessageFlags(mailbox, uids, Imap::Mailbox::FlagNames::junk, Imap::Mailbox::FLAG_REMOVE);
         }
-        imapModel()->setMessageFlags(translatedIndexes, Imap::Mailbox::FlagNames::notjunk, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
+        imapModel()->setMessageFlags(mailbox, uids, Imap::Mailbox::FlagNames::notjunk, value ? Imap::Mailbox::FLAG_ADD : Imap::Mailbox::FLAG_REMOVE);
     }
 }
 
 
 void MainWindow::slotExpunge()
 {
-    imapModel()->expungeMailbox(qobject_cast<Imap::Mailbox::MsgListModel *>(m_imapAccess->msgListModel())->currentMailbox());
+    imapModel()->expungeMailbox(currentMailbox());
 }
 
 void MainWindow::slotMarkCurrentMailboxRead()
@@ -1555,6 +1573,118 @@ void MainWindow::slotMarkCurrentMailboxRead()
     imapModel()->markMailboxAsRead(mboxTree->currentIndex());
 }
 
+void MainWindow::slotExportCurrentMailbox()
+{
+    QModelIndex root = mboxTree->currentIndex();
+    if (!root.isValid() || m_mailboxExporter)
+        return;
+
+    QStringList formats;
+    formats << tr("mbox (one file per mailbox)") << tr("Maildir (one file per message)");
+    bool ok;
+    QString format = QInputDialog::getItem(this, tr("Export Mailbox"), tr("Format:"), formats, 0, false, &ok);
+    if (!ok)
+        return;
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Export Mailbox"));
+    if (dir.isEmpty())
+        return;
+
+    // Only those child mailboxes which have already been listed are included
+    QStringList mailboxes;
+    QList<QModelIndex> pending;
+    pending << root;
+    while (!pending.isEmpty()) {
+        QModelIndex index = pending.takeFirst();
+        mailboxes << index.data(Imap::Mailbox::RoleMailboxName).toString();
+        for (int i = 0; i < index.model()->rowCount(index); ++i)
+            pending << index.model()->index(i, 0, index);
+    }
+
+    std::unique_ptr<Imap::Mailbox::ExportSink> sink;
+    if (format == formats[0])
+        sink.reset(new Imap::Mailbox::MboxExportSink(dir));
+    else
+        sink.reset(new Imap::Mailbox::MaildirExportSink(dir));
+
+    m_mailboxExporter = new Imap::Mailbox::MailboxExporter(this, imapModel(), mailboxes, std::move(sink),
+                                                           QDir(dir).filePath(QStringLiteral(".trojita-export-state")));
+    // The export has to select each mailbox in turn, so let's return to the one which was open before
+    QPersistentModelIndex previousMailbox =
+            qobject_cast<Imap::Mailbox::MsgListModel *>(m_imapAccess->msgListModel())->currentMailbox();
+    auto restoreMailbox = [this, previousMailbox]() {
+        if (previousMailbox.isValid())
+            imapModel()->switchToMailbox(previousMailbox);
+    };
+    connect(m_mailboxExporter.data(), &Imap::Mailbox::MailboxExporter::progress, this,
+            [this](const QString &mailbox, int done, int total) {
+        statusBar()->showMessage(tr("Exporting %1: %2 of %3 messages").arg(mailbox, QString::number(done), QString::number(total)));
+    });
+    connect(m_mailboxExporter.data(), &Imap::Mailbox::MailboxExporter::finished, this,
+            [this, restoreMailbox](quint64 messages, quint64 bytes, qint64 msecs) {
+        statusBar()->clearMessage();
+        m_mailboxExporter->deleteLater();
+        restoreMailbox();
+        const double seconds = qMax<qint64>(msecs, 1) / 1000.0;
+        QMessageBox::information(this, tr("Export Mailbox"),
+                                 tr("Exported %n message(s), %1 in %2 seconds (%3/s).", 0, static_cast<int>(messages))
+                                 .arg(UiUtils::Formatting::prettySize(bytes), QString::number(seconds, 'f', 1),
+                                      UiUtils::Formatting::prettySize(bytes / seconds)));
+    });
+    connect(m_mailboxExporter.data(), &Imap::Mailbox::MailboxExporter::failed, this,
+            [this, restoreMailbox](const QString &message) {
+        statusBar()->clearMessage();
+        m_mailboxExporter->deleteLater();
+        restoreMailbox();
+        QMessageBox::warning(this, tr("Export Mailbox"), tr("The export has stopped: %1").arg(message));
+    });
+    m_mailboxExporter->start();
+}
+
+void MainWindow::slotSearchInCurrentMailboxTree()
+{
+    QModelIndex root = mboxTree->currentIndex();
+    if (!root.isValid())
+        return;
+    const QString mailbox = root.data(Imap::Mailbox::RoleMailboxName).toString();
+
+    // Reuse whatever is in the quick search bar, if anything
+    QStringList conditions = msgListWidget->searchConditions();
+    if (conditions.isEmpty()) {
+        bool ok;
+        QString text = QInputDialog::getText(this, tr("Search in %1").arg(mailbox), tr("Find messages containing:"),
+                                             QLineEdit::Normal, QString(), &ok);
+        if (!ok || text.isEmpty())
+            return;
+        conditions << QStringLiteral("TEXT") << text;
+    }
+
+    QTreeView *view = new QTreeView();
+    view->setAttribute(Qt::WA_DeleteOnClose);
+    view->setRootIsDecorated(false);
+    // Only the visible rows are asked for their data, which is what makes the model download their metadata
+    view->setUniformRowHeights(true);
+    view->setHeaderHidden(true);
+    view->resize(600, 400);
+    view->setWindowTitle(tr("Searching in %1...").arg(mailbox));
+
+    auto searchModel = new Imap::Mailbox::MultiMailboxSearchModel(view, imapModel());
+    view->setModel(searchModel);
+    connect(searchModel, &Imap::Mailbox::MultiMailboxSearchModel::searchFinished, view, [view, searchModel, mailbox]() {
+        view->setWindowTitle(tr("%n message(s) found in %1", 0, searchModel->rowCount()).arg(mailbox));
+    });
+    connect(searchModel, &Imap::Mailbox::MultiMailboxSearchModel::searchFailed, view, [view, mailbox](const QString &message) {
+        view->setWindowTitle(tr("Search in %1 failed").arg(mailbox));
+        QMessageBox::warning(view, tr("Search in %1").arg(mailbox), message);
+    });
+    connect(view, &QAbstractItemView::activated, this, [this, searchModel](const QModelIndex &index) {
+        QModelIndex message = searchModel->messageIndex(index.row());
+        if (message.isValid())
+            msgListDoubleClicked(message);
+    });
+    searchModel->search(QStringList() << mailbox, conditions);
+    view->show();
+}
+
 void MainWindow::slotCreateMailboxBelowCurrent()
 {
     createMailboxBelow(mboxTree->currentIndex());
@@ -1619,10 +1749,17 @@ void MainWindow::updateMessageFlags()
 
 void MainWindow::updateMessageFlagsOf(const QModelIndex &index)
 {
-    QModelIndexList indexes = index.isValid() ? QModelIndexList() << index : translatedSelection();
-    const bool isValid = !indexes.isEmpty() &&
-                         // either we operate on the -already valided- selection or the index must be valid
-                         (!index.isValid() || index.data(Imap::Mailbox::RoleMessageUid).toUInt() > 0);
+    // Either the flags of a single message, or the counts of the whole selection which are maintained incrementally
+    int total = m_selectedMessageFlags.size();
+    int counts[SELECTED_FLAGS_COUNT];
+    std::copy(m_selectedFlagCounts, m_selectedFlagCounts + SELECTED_FLAGS_COUNT, counts);
+    if (index.isValid()) {
+        total = index.data(Imap::Mailbox::RoleMessageUid).toUInt() > 0 ? 1 : 0;
+        const int flags = selectedMessageFlagsOf(index);
+        for (int i = 0; i < SELECTED_FLAGS_COUNT; ++i)
+            counts[i] = total && (flags & (1 << i)) ? 1 : 0;
+    }
+    const bool isValid = total > 0;
     const bool okToModify = imapModel()->isNetworkAvailable() && isValid;
 
     markAsRead->setEnabled(okToModify);
@@ -1631,22 +1768,11 @@ void MainWindow::updateMessageFlagsOf(const QModelIndex &index)
     markAsJunk->setEnabled(okToModify);
     markAsNotJunk->setEnabled(okToModify);
 
-    bool isRead    = isValid,
-         isDeleted = isValid,
-         isFlagged = isValid,
-         isJunk    = isValid,
-         isNotJunk = isValid;
-    Q_FOREACH (const QModelIndex &i, indexes) {
-#define UPDATE_STATE(PROP) \
-        if (is##PROP && !i.data(Imap::Mailbox::RoleMessageIsMarked##PROP).toBool()) \
-            is##PROP = false;
-        UPDATE_STATE(Read)
-        UPDATE_STATE(Deleted)
-        UPDATE_STATE(Flagged)
-        UPDATE_STATE(Junk)
-        UPDATE_STATE(NotJunk)
-#undef UPDATE_STATE
-    }
+    const bool isRead = isValid && counts[SELECTED_READ] == total,
+               isDeleted = isValid && counts[SELECTED_DELETED] == total,
+               isFlagged = isValid && counts[SELECTED_FLAGGED] == total,
+               isJunk = isValid && counts[SELECTED_JUNK] == total,
+               isNotJunk = isValid && counts[SELECTED_NOTJUNK] == total;
     markAsRead->setChecked(isRead);
     markAsDeleted->setChecked(isDeleted);
     markAsFlagged->setChecked(isFlagged);
@@ -1654,6 +1780,103 @@ void MainWindow::updateMessageFlagsOf(const QModelIndex &index)
     markAsNotJunk->setChecked(isNotJunk && !isJunk);
 }
 
+/** @short Bitmask of those flags of a message which are shown by the message actions */
+int MainWindow::selectedMessageFlagsOf(const QModelIndex &message)
+{
+    int res = 0;
+    if (message.data(Imap::Mailbox::RoleMessageIsMarkedRead).toBool())
+        res |= 1 << SELECTED_READ;
+    if (message.data(Imap::Mailbox::RoleMessageIsMarkedDeleted).toBool())
+        res |= 1 << SELECTED_DELETED;
+    if (message.data(Imap::Mailbox::RoleMessageIsMarkedFlagged).toBool())
+        res |= 1 << SELECTED_FLAGGED;
+    if (message.data(Imap::Mailbox::RoleMessageIsMarkedJunk).toBool())
+        res |= 1 << SELECTED_JUNK;
+    if (message.data(Imap::Mailbox::RoleMessageIsMarkedNotJunk).toBool())
+        res |= 1 << SELECTED_NOTJUNK;
+    return res;
+}
+
+void MainWindow::countSelectedFlags(const int flags, const int delta)
+{
+    for (int i = 0; i < SELECTED_FLAGS_COUNT; ++i) {
+        if (flags & (1 << i))
+            m_selectedFlagCounts[i] += delta;
+    }
+}
+
+/** @short Add or remove the @arg item to/from the selection state, along with whatever is hidden in it when it is a collapsed thread */
+void MainWindow::trackSelectedMessage(const QModelIndex &item, const bool selected)
+{
+    const bool withDescendants = !msgListWidget->tree->isExpanded(item);
+    QModelIndexList pending;
+    pending << item;
+    while (!pending.isEmpty()) {
+        const QModelIndex message = pending.takeLast();
+        if (const uint uid = message.data(Imap::Mailbox::RoleMessageUid).toUInt()) {
+            auto it = m_selectedMessageFlags.find(uid);
+            if (selected && it == m_selectedMessageFlags.end()) {
+                const int flags = selectedMessageFlagsOf(message);
+                m_selectedMessageFlags.insert(uid, flags);
+                countSelectedFlags(flags, 1);
+            } else if (!selected && it != m_selectedMessageFlags.end()) {
+                countSelectedFlags(*it, -1);
+                m_selectedMessageFlags.erase(it);
+            }
+        }
+        if (withDescendants) {
+            for (int j = 0; j < message.model()->rowCount(message); ++j)
+                pending << message.child(j, 0);
+        }
+    }
+}
+
+/** @short Apply a change of the selection; the cost depends on the size of the change, not on the size of the selection */
+void MainWindow::updateSelectedMessages(const QItemSelection &selected, const QItemSelection &deselected)
+{
+    Q_FOREACH(const QItemSelectionRange &range, deselected) {
+        if (range.left() != 0)
+            continue;
+        for (int row = range.top(); row <= range.bottom(); ++row)
+            trackSelectedMessage(range.model()->index(row, 0, range.parent()), false);
+    }
+    Q_FOREACH(const QItemSelectionRange &range, selected) {
+        if (range.left() != 0)
+            continue;
+        for (int row = range.top(); row <= range.bottom(); ++row)
+            trackSelectedMessage(range.model()->index(row, 0, range.parent()), true);
+    }
+    updateMessageFlags();
+}
+
+/** @short Recount the flags of the whole selection after the list of messages has changed its structure */
+void MainWindow::resetSelectedMessages()
+{
+    m_selectedMessageFlags.clear();
+    std::fill(m_selectedFlagCounts, m_selectedFlagCounts + SELECTED_FLAGS_COUNT, 0);
+    updateSelectedMessages(msgListWidget->tree->selectionModel()->selection(), QItemSelection());
+}
+
+/** @short Update the flag counts for those selected messages whose data have changed */
+void MainWindow::updateSelectedMessageFlags(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (!m_selectedMessageFlags.isEmpty() && topLeft.isValid()) {
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+            const QModelIndex message = topLeft.sibling(row, 0);
+            auto it = m_selectedMessageFlags.find(message.data(Imap::Mailbox::RoleMessageUid).toUInt());
+            if (it == m_selectedMessageFlags.end())
+                continue;
+            const int flags = selectedMessageFlagsOf(message);
+            if (flags != *it) {
+                countSelectedFlags(*it, -1);
+                countSelectedFlags(flags, 1);
+                *it = flags;
+            }
+        }
+    }
+    updateMessageFlags();
+}
+
 void MainWindow::updateActionsOnlineOffline(bool online)
 {
     reloadMboxList->setEnabled(online);
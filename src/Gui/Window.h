@@ -23,6 +23,7 @@
 #ifndef TROJITA_WINDOW_H
 #define TROJITA_WINDOW_H
 
+#include <QHash>
 #include <QMainWindow>
 #include <QModelIndex>
 #include <QPointer>
@@ -55,11 +56,14 @@ namespace Imap
 {
 
 class ImapAccess;
+class Sequence;
 
 namespace Mailbox
 {
 
+class MailboxExporter;
 class Model;
+class MultiMailboxSearchModel;
 class PrettyMailboxModel;
 class ThreadingMsgListModel;
 class PrettyMsgListModel;
@@ -156,6 +160,8 @@ private slots:
     void msgListDoubleClicked(const QModelIndex &);
     void slotCreateMailboxBelowCurrent();
     void slotMarkCurrentMailboxRead();
+    void slotExportCurrentMailbox();
+    void slotSearchInCurrentMailboxTree();
     void slotCreateTopMailbox();
     void slotDeleteCurrentMailbox();
     void handleTrayIconChange();
@@ -166,6 +172,9 @@ private slots:
     void slotShowOnlySubscribed();
     void updateMessageFlags();
     void updateMessageFlagsOf(const QModelIndex &index);
+    void updateSelectedMessages(const QItemSelection &selected, const QItemSelection &deselected);
+    void updateSelectedMessageFlags(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void resetSelectedMessages();
     void scrollMessageUp();
     void slotMessageModelChanged(QAbstractItemModel *model);
     void showConnectionStatus(uint parserId, Imap::ConnectionState state);
@@ -237,7 +246,12 @@ private:
     void createSysTray();
     void removeSysTray();
 
-    QModelIndexList translatedSelection() const;
+    Imap::Sequence selectedUids() const;
+    QModelIndex currentMailbox() const;
+    void goToUnreadMessage(const bool forward);
+    void trackSelectedMessage(const QModelIndex &item, const bool selected);
+    void countSelectedFlags(const int flags, const int delta);
+    static int selectedMessageFlagsOf(const QModelIndex &message);
 
     Imap::ImapAccess *m_imapAccess;
 
@@ -331,6 +345,8 @@ private:
     QAction *m_actionLayoutWide;
     QAction *m_actionLayoutOneAtTime;
     QAction *m_actionMarkMailboxAsRead;
+    QAction *m_actionExportMailbox;
+    QAction *m_actionSearchMailboxTree;
 
     QAction *m_actionSubscribeMailbox;
     QAction *m_actionShowOnlySubscribed;
@@ -358,6 +374,22 @@ private:
     MainWindow &operator=(const MainWindow &); // don't implement
 
     QSystemTrayIcon *m_trayIcon;
+
+    QPointer<Imap::Mailbox::MailboxExporter> m_mailboxExporter;
+
+    /** @short Flags which affect the state of the message actions */
+    enum SelectedMessageFlag {
+        SELECTED_READ,
+        SELECTED_DELETED,
+        SELECTED_FLAGGED,
+        SELECTED_JUNK,
+        SELECTED_NOTJUNK,
+        SELECTED_FLAGS_COUNT
+    };
+    /** @short Bitmask of SelectedMessageFlag for each selected message, indexed by its UID */
+    QHash<uint, int> m_selectedMessageFlags;
+    /** @short Number of selected messages which have each of the SelectedMessageFlag set */
+    int m_selectedFlagCounts[SELECTED_FLAGS_COUNT];
     QPoint m_headerDragStart;
 };
 
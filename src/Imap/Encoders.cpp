@@ -256,63 +256,150 @@ namespace {
         return res;
     }
 
-    /** @short Decode an encoded-word as per RFC2047 into a unicode string */
-    static QString decodeWord(const QByteArray &fullWord, const QByteArray &charset, const QByteArray &encoding, const QByteArray &encoded)
+    /** @short Decode the payload of an RFC2047 encoded-word into a unicode string
+
+    The @arg ok is set to false if the encoding is not recognized.
+    */
+    static QString decodeWord(const QChar *encoding, const int encodingSize, const QByteArray &charset, const QByteArray &encoded, bool *ok)
     {
-        if (encoding == "Q") {
-            return Imap::decodeByteArray(translateQuotedPrintableToBin(encoded), charset);
-        } else if (encoding == "B") {
-            return Imap::decodeByteArray(QByteArray::fromBase64(encoded), charset);
-        } else {
-            return QString::fromUtf8(fullWord);
+        *ok = true;
+        if (encodingSize == 1) {
+            switch (encoding->unicode()) {
+            case 'Q':
+            case 'q':
+                return Imap::decodeByteArray(translateQuotedPrintableToBin(encoded), charset);
+            case 'B':
+            case 'b':
+                return Imap::decodeByteArray(QByteArray::fromBase64(encoded), charset);
+            }
         }
+        *ok = false;
+        return QString();
     }
 
-    /** @short Decode a header in the RFC 2047 format into a unicode string */
-    static QString decodeWordSequence(const QByteArray& input)
+    /** @short Position of the first occurrence of the two-character sequence @arg first, @arg second at or after @arg from
+
+    Returns -1 when there's no such sequence.
+    */
+    static inline int findPair(const QChar *data, const int size, int from, const ushort first, const ushort second)
     {
-        QRegExp whitespace(QLatin1String("^\\s+$"));
+        for (; from < size - 1; ++from) {
+            if (data[from].unicode() == first && data[from + 1].unicode() == second)
+                return from;
+        }
+        return -1;
+    }
 
-        // the regexp library operates on unicode strings, unfortunately
-        QString str = QString::fromUtf8(input);
+    /** @short Result of matching a single encoded-word */
+    enum class EncodedWordMatch {
+        Found, /**< A complete encoded-word starts at the requested position */
+        NotHere, /**< There is no encoded-word at this position, but there might be one later on */
+        NoMore /**< There cannot be any encoded-word at this or any later position */
+    };
 
-        QString out;
+    /** @short Try to match an encoded-word whose leading "=?" starts at @arg start
 
-        // Any idea why this isn't matching?
-        //QRegExp encodedWord("\\b=\\?\\S+\\?\\S+\\?\\S*\\?=\\b");
-        QRegExp encodedWord(QLatin1String("\"?=\\?(\\S+)\\?(\\S+)\\?(.*)\\?=\"?"));
+    This is a hand-written equivalent of the "=\\?(\\S+)\\?(\\S+)\\?(.*)\\?=" regular expression in its minimal mode, which
+    is what the previous versions used. The charset and the encoding have to consist of non-whitespace characters, the payload can
+    contain anything up to the first "?=" after the encoding. On success, the positions of the two separating question marks and of
+    the terminating "?=" are stored in the output arguments.
+    */
+    static EncodedWordMatch matchEncodedWord(const QChar *data, const int size, const int start, int *charsetEnd, int *encodingEnd, int *payloadEnd)
+    {
+        const ushort questionMark = QuestionMark;
+        int i = start + 2;
+        int firstMark = -1;
+        // Both the charset and the encoding are non-empty runs of non-whitespace characters
+        for (; i < size && !data[i].isSpace(); ++i) {
+            if (data[i].unicode() != questionMark)
+                continue;
+            if (firstMark == -1) {
+                if (i > start + 2)
+                    firstMark = i;
+            } else if (i > firstMark + 1) {
+                *charsetEnd = firstMark;
+                *encodingEnd = i;
+                *payloadEnd = findPair(data, size, i + 1, questionMark, Equals);
+                // If there's no terminator after this point, no later encoded-word can be complete either
+                return *payloadEnd == -1 ? EncodedWordMatch::NoMore : EncodedWordMatch::Found;
+            }
+        }
+        return EncodedWordMatch::NotHere;
+    }
 
-        // set minimal=true, to match sequences which do not have white space in between 2 encoded words; otherwise by default greedy matching is performed
-        // eg. "Sm=?ISO-8859-1?B?9g==?=rg=?ISO-8859-1?B?5Q==?=sbord" will match "=?ISO-8859-1?B?9g==?=rg=?ISO-8859-1?B?5Q==?=" as a single encoded word without minimal=true
-        // with minimal=true, "=?ISO-8859-1?B?9g==?=" will be the first encoded word and "=?ISO-8859-1?B?5Q==?=" the second.
-        // -- assuming there are no nested encodings, will there be?
-        encodedWord.setMinimal(true);
+    /** @short Is the given chunk of text made of whitespace only, and non-empty? */
+    static inline bool isWhitespaceOnly(const QChar *begin, const QChar *end)
+    {
+        if (begin == end)
+            return false;
+        for (; begin != end; ++begin) {
+            if (!begin->isSpace())
+                return false;
+        }
+        return true;
+    }
 
-        int pos = 0;
-        int lastPos = 0;
+    /** @short Decode a header in the RFC 2047 format into a unicode string
 
-        while (pos != -1) {
-            pos = encodedWord.indexIn(str, pos);
-            if (pos != -1) {
-                int endPos = pos + encodedWord.matchedLength();
+    Most of the headers do not contain any encoded-words at all, so these are returned right away. The rest is processed in a single
+    pass over the input without any temporary copies of the plain-text parts.
 
-                QString preceding(str.mid(lastPos, (pos - lastPos)));
-                QString decoded = decodeWord(str.mid(pos, (endPos - pos)).toUtf8(), encodedWord.cap(1).toLatin1(),
-                                             encodedWord.cap(2).toUpper().toLatin1(), encodedWord.cap(3).toLatin1());
+    This reproduces the behavior of the original regexp-based decoder, including its quirks -- a double quote immediately
+    preceding an encoded-word is eaten, and a whitespace-only run of text is skipped when it precedes an encoded-word.
+    */
+    static QString decodeWordSequence(const QByteArray& input)
+    {
+        // Fast path: an encoded-word always starts with "=?", and these are ASCII characters which cannot be a part of any
+        // multibyte UTF-8 sequence
+        if (input.indexOf("=?") == -1)
+            return QString::fromUtf8(input);
 
-                // If there is only whitespace between two encoded words, it should not be included
-                if (!whitespace.exactMatch(preceding))
-                    out.append(preceding);
+        const QString str = QString::fromUtf8(input);
+        const QChar *data = str.constData();
+        const int size = str.size();
 
-                out.append(decoded);
+        QString out;
+        out.reserve(size);
+
+        int lastPos = 0;
+        int pos = findPair(data, size, 0, Equals, QuestionMark);
+        while (pos != -1) {
+            int charsetEnd, encodingEnd, payloadEnd;
+            EncodedWordMatch match = matchEncodedWord(data, size, pos, &charsetEnd, &encodingEnd, &payloadEnd);
+            if (match == EncodedWordMatch::NoMore)
+                break;
+            if (match == EncodedWordMatch::NotHere) {
+                pos = findPair(data, size, pos + 1, Equals, QuestionMark);
+                continue;
+            }
 
-                pos = endPos;
-                lastPos = pos;
+            // An optional leading double quote is a part of the encoded-word, provided it hasn't been consumed already
+            int wordStart = pos;
+            if (wordStart > lastPos && data[wordStart - 1].unicode() == '"')
+                --wordStart;
+            const int endPos = payloadEnd + 2;
+
+            // If there is only whitespace between two encoded words, it should not be included
+            if (!isWhitespaceOnly(data + lastPos, data + wordStart))
+                out.append(data + lastPos, wordStart - lastPos);
+
+            bool ok;
+            QString decoded = decodeWord(data + charsetEnd + 1, encodingEnd - charsetEnd - 1,
+                                         str.midRef(pos + 2, charsetEnd - pos - 2).toLatin1(),
+                                         str.midRef(encodingEnd + 1, payloadEnd - encodingEnd - 1).toLatin1(), &ok);
+            if (!ok) {
+                // Unknown encoding, so let's just use the encoded-word verbatim
+                out.append(data + wordStart, endPos - wordStart);
+            } else {
+                out.append(decoded);
             }
+
+            lastPos = endPos;
+            pos = findPair(data, size, endPos, Equals, QuestionMark);
         }
 
         // Copy anything left
-        out.append(str.midRef(lastPos));
+        out.append(data + lastPos, size - lastPos);
 
         return out;
     }
@@ -30,6 +30,10 @@ AbstractCache::~AbstractCache()
 {
 }
 
+void AbstractCache::flush()
+{
+}
+
 void AbstractCache::setErrorHandler(const std::function<void(const QString &)> &handler)
 {
     m_errorHandler = handler;
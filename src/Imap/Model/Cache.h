@@ -118,6 +118,11 @@ public:
     virtual QStringList msgFlags(const QString &mailbox, const uint uid) const = 0;
     /** @short Save flags for one message in mailbox */
     virtual void setMsgFlags(const QString &mailbox, const uint uid, const QStringList &flags) = 0;
+    /** @short Add the @arg flag to the saved flags of all messages with the listed UIDs at once
+
+    Messages whose flags are not in the cache are left alone.
+    */
+    virtual void addMsgFlag(const QString &mailbox, const Imap::Uids &uids, const QString &flag) = 0;
 
     /** @short Return part data or a null QByteArray if none available */
     virtual QByteArray messagePart(const QString &mailbox, const uint uid, const QByteArray &partId) const = 0;
@@ -134,6 +139,9 @@ public:
     /** @short How many days is it OK not to mark entries as accessed? */
     virtual void setRenewalThreshold(const int days) = 0;
 
+    /** @short Make sure that all pending changes are stored, e.g. before the application exits */
+    virtual void flush();
+
     /** @short Inform about runtime failures */
     void setErrorHandler(const std::function<void(const QString &)> &handler);
 
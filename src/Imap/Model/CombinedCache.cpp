@@ -20,10 +20,20 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <QTimer>
 #include "CombinedCache.h"
 #include "DiskPartCache.h"
 #include "SQLCache.h"
 
+namespace {
+/** @short Number of messages to remove in one go */
+const int expiryBatchSize = 50;
+/** @short How long to keep removing the batches before returning to the event loop, in milliseconds */
+const int expirySliceDuration = 20;
+/** @short Delay between two subsequent slices, in milliseconds */
+const int expirySliceInterval = 200;
+}
+
 namespace Imap
 {
 namespace Mailbox
@@ -110,6 +120,11 @@ void CombinedCache::setMsgFlags(const QString &mailbox, const uint uid, const QS
     sqlCache->setMsgFlags(mailbox, uid, flags);
 }
 
+void CombinedCache::addMsgFlag(const QString &mailbox, const Imap::Uids &uids, const QString &flag)
+{
+    sqlCache->addMsgFlag(mailbox, uids, flag);
+}
+
 AbstractCache::MessageDataBundle CombinedCache::messageMetadata(const QString &mailbox, const uint uid) const
 {
     return sqlCache->messageMetadata(mailbox, uid);
@@ -159,5 +174,46 @@ void CombinedCache::setRenewalThreshold(const int days)
     sqlCache->setRenewalThreshold(days);
 }
 
+void CombinedCache::flush()
+{
+    sqlCache->flush();
+}
+
+void CombinedCache::startExpiry(const int days, const std::function<void(const ExpiryReport &)> &onFinished)
+{
+    m_expiryDate = QDate::currentDate().addDays(-days);
+    m_expiryReport = ExpiryReport();
+    m_expiryFinished = onFinished;
+    m_expiryDuration.start();
+    if (!m_expiryTimer) {
+        m_expiryTimer.reset(new QTimer());
+        m_expiryTimer->setInterval(expirySliceInterval);
+        m_expiryTimer->setObjectName(QStringLiteral("cacheExpiry"));
+        QObject::connect(m_expiryTimer.get(), &QTimer::timeout, m_expiryTimer.get(), [this](){ this->expiryStep(); });
+    }
+    m_expiryTimer->start();
+}
+
+void CombinedCache::expiryStep()
+{
+    QElapsedTimer slice;
+    slice.start();
+    do {
+        auto expired = sqlCache->expireMessages(m_expiryDate, expiryBatchSize, &m_expiryReport.bytes);
+        for (auto it = expired.constBegin(); it != expired.constEnd(); ++it) {
+            m_expiryReport.bytes += diskPartCache->clearMessage(it->first, it->second);
+        }
+        m_expiryReport.messages += expired.size();
+
+        if (expired.size() < expiryBatchSize) {
+            m_expiryTimer->stop();
+            m_expiryReport.duration = m_expiryDuration.elapsed();
+            if (m_expiryFinished)
+                m_expiryFinished(m_expiryReport);
+            return;
+        }
+    } while (slice.elapsed() < expirySliceDuration);
+}
+
 }
 }
@@ -24,8 +24,11 @@
 #define IMAP_MODEL_COMBINEDCACHE_H
 
 #include <memory>
+#include <QElapsedTimer>
 #include "Cache.h"
 
+class QTimer;
+
 namespace Imap
 {
 
@@ -79,6 +82,7 @@ public:
 
     virtual QStringList msgFlags(const QString &mailbox, const uint uid) const;
     virtual void setMsgFlags(const QString &mailbox, const uint uid, const QStringList &flags);
+    virtual void addMsgFlag(const QString &mailbox, const Imap::Uids &uids, const QString &flag);
 
     virtual QByteArray messagePart(const QString &mailbox, const uint uid, const QByteArray &partId) const;
     virtual void setMsgPart(const QString &mailbox, const uint uid, const QByteArray &partId, const QByteArray &data);
@@ -89,10 +93,35 @@ public:
 
     virtual void setRenewalThreshold(const int days);
 
+    virtual void flush();
+
     /** @short Open a connection to the cache */
     bool open();
 
+    /** @short Summary of a finished cache expiry */
+    struct ExpiryReport {
+        /** @short Number of messages which got removed */
+        uint messages;
+        /** @short Amount of data which got removed, both from the database and from the disk */
+        quint64 bytes;
+        /** @short Wall-clock time from the start of the expiry till its end, in milliseconds */
+        qint64 duration;
+
+        ExpiryReport(): messages(0), bytes(0), duration(0) {}
+    };
+
+    /** @short Start removing messages which haven't been accessed during the last @arg days
+
+    The work is performed incrementally in short slices driven from the event loop, so that it doesn't block anything.
+    The @arg onFinished gets called when there's nothing more to remove.
+    */
+    void startExpiry(const int days, const std::function<void(const ExpiryReport &)> &onFinished);
+
 private:
+    /** @short Remove another batch of expired messages */
+    void expiryStep();
+
+
     /** @short Name of the DB connection */
     QString name;
     /** @short Directory to serve as a cache root */
@@ -101,6 +130,14 @@ private:
     std::unique_ptr<SQLCache> sqlCache;
     /** @short Cache for bigger message parts */
     std::unique_ptr<DiskPartCache> diskPartCache;
+
+    /** @short Drives the incremental cache expiry */
+    std::unique_ptr<QTimer> m_expiryTimer;
+    /** @short Messages which were last accessed before this date are going to be removed */
+    QDate m_expiryDate;
+    ExpiryReport m_expiryReport;
+    QElapsedTimer m_expiryDuration;
+    std::function<void(const ExpiryReport &)> m_expiryFinished;
 };
 
 }
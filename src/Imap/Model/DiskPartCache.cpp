@@ -87,14 +87,18 @@ void DiskPartCache::clearAllMessages(const QString &mailbox)
     }
 }
 
-void DiskPartCache::clearMessage(const QString mailbox, const uint uid)
+quint64 DiskPartCache::clearMessage(const QString mailbox, const uint uid)
 {
+    quint64 freed = 0;
     QDir dir(dirForMailbox(mailbox));
-    Q_FOREACH(const QString& fname, dir.entryList(QStringList() << QString::fromUtf8("%1_*.cache").arg(QString::number(uid)))) {
-        if (! dir.remove(fname)) {
-            m_errorHandler(QObject::tr("Couldn't remove file %1 for message %2, mailbox %3").arg(fname, QString::number(uid), mailbox));
+    Q_FOREACH(const QFileInfo &file, dir.entryInfoList(QStringList() << QString::fromUtf8("%1_*.cache").arg(QString::number(uid)))) {
+        if (! dir.remove(file.fileName())) {
+            m_errorHandler(QObject::tr("Couldn't remove file %1 for message %2, mailbox %3").arg(file.fileName(), QString::number(uid), mailbox));
+        } else {
+            freed += file.size();
         }
     }
+    return freed;
 }
 
 QByteArray DiskPartCache::messagePart(const QString &mailbox, const uint uid, const QByteArray &partId) const
@@ -46,8 +46,8 @@ public:
 
     /** @short Delete all data of message parts which belongs to that particular mailbox */
     void clearAllMessages(const QString &mailbox);
-    /** @short Delete all data for a particular message in the given mailbox */
-    void clearMessage(const QString mailbox, const uint uid);
+    /** @short Delete all data for a particular message in the given mailbox, return the number of bytes freed */
+    quint64 clearMessage(const QString mailbox, const uint uid);
 
     /** @short Return data for some message part, or a null QByteArray if not found */
     QByteArray messagePart(const QString &mailbox, const uint uid, const QByteArray &partId) const;
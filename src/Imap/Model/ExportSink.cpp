@@ -0,0 +1,226 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QHostInfo>
+#include <QLocale>
+#include "ExportSink.h"
+#include "SpecialFlagNames.h"
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+ExportSink::ExportSink(const QString &rootDir)
+    : m_root(rootDir)
+{
+}
+
+ExportSink::~ExportSink()
+{
+}
+
+QString ExportSink::errorString() const
+{
+    return m_errorString;
+}
+
+QStringList ExportSink::pathComponents(const QString &mailbox, const QString &separator)
+{
+    QStringList res = separator.isEmpty() ? QStringList() << mailbox : mailbox.split(separator);
+    for (auto it = res.begin(); it != res.end(); ++it) {
+        // Whatever could escape from the target directory or confuse the file system gets replaced
+        it->replace(QLatin1Char('/'), QLatin1Char('_'));
+        it->replace(QLatin1Char('\\'), QLatin1Char('_'));
+        it->replace(QLatin1Char(':'), QLatin1Char('_'));
+        if (it->isEmpty() || it->startsWith(QLatin1Char('.')))
+            it->prepend(QLatin1Char('_'));
+    }
+    return res;
+}
+
+
+MboxExportSink::MboxExportSink(const QString &rootDir)
+    : ExportSink(rootDir)
+{
+}
+
+MboxExportSink::~MboxExportSink()
+{
+    flush();
+}
+
+bool MboxExportSink::beginMailbox(const QString &mailbox, const QString &separator)
+{
+    if (m_file.isOpen() && !flush())
+        return false;
+    m_file.close();
+
+    QStringList components = pathComponents(mailbox, separator);
+    QString fileName = components.takeLast() + QLatin1String(".mbox");
+    QString dirName = components.join(QLatin1Char('/'));
+    if (!dirName.isEmpty() && !m_root.mkpath(dirName)) {
+        m_errorString = QCoreApplication::translate("Imap::Mailbox::ExportSink", "Cannot create directory %1")
+                .arg(m_root.filePath(dirName));
+        return false;
+    }
+
+    m_file.setFileName(m_root.filePath(dirName.isEmpty() ? fileName : dirName + QLatin1Char('/') + fileName));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool MboxExportSink::writeMessage(const QByteArray &data, const QDateTime &internalDate, const QStringList &flags)
+{
+    Q_UNUSED(flags);
+    Q_ASSERT(m_file.isOpen());
+    if (m_file.write(mboxrdEntry(data, internalDate)) == -1) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool MboxExportSink::flush()
+{
+    if (m_file.isOpen() && !m_file.flush()) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QByteArray MboxExportSink::mboxrdEntry(const QByteArray &data, const QDateTime &internalDate)
+{
+    QDateTime when = (internalDate.isValid() ? internalDate : QDateTime::currentDateTime()).toUTC();
+    QLocale c = QLocale::c();
+
+    QByteArray res;
+    res.reserve(data.size() + data.size() / 40 + 64);
+    // The asctime() format, which has the day padded with a space
+    res += "From MAILER-DAEMON ";
+    res += c.toString(when, QStringLiteral("ddd MMM ")).toLatin1();
+    res += QByteArray::number(when.date().day()).rightJustified(2, ' ');
+    res += c.toString(when, QStringLiteral(" hh:mm:ss yyyy")).toLatin1();
+    res += '\n';
+
+    int start = 0;
+    while (start < data.size()) {
+        int end = data.indexOf('\n', start);
+        int next = end == -1 ? data.size() : end + 1;
+        if (end == -1)
+            end = data.size();
+        int lineEnd = (end > start && data[end - 1] == '\r') ? end - 1 : end;
+
+        // mboxrd: any line which looks like a separator, possibly already quoted, gets one more level of quoting
+        int pos = start;
+        while (pos < lineEnd && data[pos] == '>')
+            ++pos;
+        if (lineEnd - pos >= 5 && qstrncmp(data.constData() + pos, "From ", 5) == 0)
+            res += '>';
+
+        res.append(data.constData() + start, lineEnd - start);
+        res += '\n';
+        start = next;
+    }
+    res += '\n';
+    return res;
+}
+
+
+MaildirExportSink::MaildirExportSink(const QString &rootDir)
+    : ExportSink(rootDir)
+    , m_counter(0)
+{
+    QString host = QHostInfo::localHostName();
+    host.replace(QLatin1Char('/'), QStringLiteral("\\057"));
+    host.replace(QLatin1Char(':'), QStringLiteral("\\072"));
+    m_uniqueSuffix = QStringLiteral("P%1.%2").arg(QString::number(QCoreApplication::applicationPid()), host);
+}
+
+bool MaildirExportSink::beginMailbox(const QString &mailbox, const QString &separator)
+{
+    QString dirName = pathComponents(mailbox, separator).join(QLatin1Char('/'));
+    Q_FOREACH(const QString &subdir, QStringList() << QStringLiteral("cur") << QStringLiteral("new") << QStringLiteral("tmp")) {
+        if (!m_root.mkpath(dirName + QLatin1Char('/') + subdir)) {
+            m_errorString = QCoreApplication::translate("Imap::Mailbox::ExportSink", "Cannot create directory %1")
+                    .arg(m_root.filePath(dirName + QLatin1Char('/') + subdir));
+            return false;
+        }
+    }
+    m_mailbox = QDir(m_root.filePath(dirName));
+    return true;
+}
+
+bool MaildirExportSink::writeMessage(const QByteArray &data, const QDateTime &internalDate, const QStringList &flags)
+{
+    Q_UNUSED(internalDate);
+    QString baseName = QStringLiteral("%1.Q%2%3").arg(QString::number(QDateTime::currentMSecsSinceEpoch() / 1000),
+                                                      QString::number(++m_counter), m_uniqueSuffix);
+
+    QFile file(m_mailbox.filePath(QLatin1String("tmp/") + baseName));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.flush()) {
+        m_errorString = file.errorString();
+        file.remove();
+        return false;
+    }
+    file.close();
+
+    if (!file.rename(m_mailbox.filePath(QLatin1String("cur/") + baseName + maildirInfo(flags)))) {
+        m_errorString = file.errorString();
+        file.remove();
+        return false;
+    }
+    return true;
+}
+
+bool MaildirExportSink::flush()
+{
+    // Each message is complete on disk as soon as it has been moved to cur/
+    return true;
+}
+
+QString MaildirExportSink::maildirInfo(const QStringList &flags)
+{
+    // The letters have to be sorted alphabetically
+    QString res;
+    if (flags.contains(QStringLiteral("\\Draft"), Qt::CaseInsensitive))
+        res += QLatin1Char('D');
+    if (flags.contains(FlagNames::flagged, Qt::CaseInsensitive))
+        res += QLatin1Char('F');
+    if (flags.contains(FlagNames::forwarded, Qt::CaseInsensitive))
+        res += QLatin1Char('P');
+    if (flags.contains(FlagNames::answered, Qt::CaseInsensitive))
+        res += QLatin1Char('R');
+    if (flags.contains(FlagNames::seen, Qt::CaseInsensitive))
+        res += QLatin1Char('S');
+    if (flags.contains(FlagNames::deleted, Qt::CaseInsensitive))
+        res += QLatin1Char('T');
+    return QLatin1String(":2,") + res;
+}
+
+}
+}
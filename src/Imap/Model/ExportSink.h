@@ -0,0 +1,119 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAP_MODEL_EXPORTSINK_H
+#define IMAP_MODEL_EXPORTSINK_H
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+/** @short Namespace for IMAP interaction */
+namespace Imap
+{
+
+/** @short Classes for handling of mailboxes and connections */
+namespace Mailbox
+{
+
+/** @short Local storage for messages exported from an IMAP server
+
+Messages are passed in one at a time, so that there is never a need to keep a whole
+mailbox in memory. The beginMailbox() shall be called before writing messages which
+belong to a particular mailbox.
+*/
+class ExportSink
+{
+public:
+    virtual ~ExportSink();
+
+    /** @short Prepare for storing messages from the given @arg mailbox */
+    virtual bool beginMailbox(const QString &mailbox, const QString &separator) = 0;
+    /** @short Store the full source of a message */
+    virtual bool writeMessage(const QByteArray &data, const QDateTime &internalDate, const QStringList &flags) = 0;
+    /** @short Make sure that all messages written so far have reached the disk */
+    virtual bool flush() = 0;
+
+    /** @short Description of the last failure */
+    QString errorString() const;
+
+    /** @short Split a mailbox name into components which are safe to use as file names */
+    static QStringList pathComponents(const QString &mailbox, const QString &separator);
+
+protected:
+    explicit ExportSink(const QString &rootDir);
+
+    QDir m_root;
+    QString m_errorString;
+};
+
+/** @short Store each mailbox as a single file in the mboxrd format
+
+A mailbox "a/b" ends up in a file "a/b.mbox" below the root directory. Messages are
+appended, so an export can continue where it stopped.
+*/
+class MboxExportSink : public ExportSink
+{
+public:
+    explicit MboxExportSink(const QString &rootDir);
+    virtual ~MboxExportSink();
+
+    virtual bool beginMailbox(const QString &mailbox, const QString &separator);
+    virtual bool writeMessage(const QByteArray &data, const QDateTime &internalDate, const QStringList &flags);
+    virtual bool flush();
+
+    /** @short Convert a message into an mboxrd entry, including the "From " separator line */
+    static QByteArray mboxrdEntry(const QByteArray &data, const QDateTime &internalDate);
+
+private:
+    QFile m_file;
+};
+
+/** @short Store each message as a separate file in a Maildir
+
+A mailbox "a/b" becomes the "a/b" directory with the usual "cur", "new" and "tmp"
+subdirectories. Messages are written into "tmp" and moved into "cur" once complete.
+*/
+class MaildirExportSink : public ExportSink
+{
+public:
+    explicit MaildirExportSink(const QString &rootDir);
+
+    virtual bool beginMailbox(const QString &mailbox, const QString &separator);
+    virtual bool writeMessage(const QByteArray &data, const QDateTime &internalDate, const QStringList &flags);
+    virtual bool flush();
+
+    /** @short The ":2," suffix of a Maildir file name which describes the IMAP @arg flags */
+    static QString maildirInfo(const QStringList &flags);
+
+private:
+    QDir m_mailbox;
+    QString m_uniqueSuffix;
+    quint64 m_counter;
+};
+
+}
+
+}
+
+#endif /* IMAP_MODEL_EXPORTSINK_H */
@@ -323,13 +323,13 @@ void ImapAccess::doConnect()
     std::shared_ptr<Imap::Mailbox::AbstractCache> cache;
 
     if (!shouldUsePersistentCache) {
-        cache.reset(new Imap::Mailbox::MemoryCache());
+        cache = createMemoryCache();
     } else {
         cache.reset(new Imap::Mailbox::CombinedCache(QStringLiteral("trojita-imap-cache"), m_cacheDir));
         cache->setErrorHandler([this](const QString &e) { this->onCacheError(e); });
         if (! static_cast<Imap::Mailbox::CombinedCache *>(cache.get())->open()) {
             // Error message was already shown by the cacheError() slot
-            cache.reset(new Imap::Mailbox::MemoryCache());
+            cache = createMemoryCache();
         } else {
             if (m_settings->value(Common::SettingsNames::cacheOfflineKey).toString() == Common::SettingsNames::cacheOfflineAll) {
                 cache->setRenewalThreshold(0);
@@ -340,6 +340,15 @@ void ImapAccess::doConnect()
                 if (!ok)
                     num = defaultCacheLifetime;
                 cache->setRenewalThreshold(num);
+                static_cast<Imap::Mailbox::CombinedCache *>(cache.get())->startExpiry(num,
+                        [this](const Imap::Mailbox::CombinedCache::ExpiryReport &report) {
+                    if (!m_imapModel)
+                        return;
+                    m_imapModel->logTrace(0, Common::LOG_OTHER, QStringLiteral("Cache"),
+                                          QStringLiteral("Expired %1 messages, %2 freed in %3 ms").arg(
+                                              QString::number(report.messages), UiUtils::Formatting::prettySize(report.bytes),
+                                              QString::number(report.duration)));
+                });
             }
         }
     }
@@ -404,11 +413,23 @@ void ImapAccess::doConnect()
 void ImapAccess::onCacheError(const QString &message)
 {
     if (m_imapModel) {
-        m_imapModel->setCache(std::make_shared<Imap::Mailbox::MemoryCache>());
+        m_imapModel->setCache(createMemoryCache());
     }
     emit cacheError(message);
 }
 
+std::shared_ptr<Imap::Mailbox::AbstractCache> ImapAccess::createMemoryCache() const
+{
+    const quint64 defaultBudgetMB = 0;
+    bool ok;
+    quint64 budget = m_settings->value(Common::SettingsNames::cacheMemoryPartBudgetKey, defaultBudgetMB).toULongLong(&ok);
+    if (!ok)
+        budget = defaultBudgetMB;
+    auto cache = std::make_shared<Imap::Mailbox::MemoryCache>();
+    cache->setPartBudget(budget * 1024 * 1024);
+    return cache;
+}
+
 QAbstractItemModel *ImapAccess::imapModel() const
 {
     return m_imapModel;
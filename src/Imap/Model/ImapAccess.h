@@ -23,6 +23,7 @@
 #ifndef TROJITA_IMAPACCESS_H
 #define TROJITA_IMAPACCESS_H
 
+#include <memory>
 #include <QObject>
 #include <QSslError>
 
@@ -46,6 +47,7 @@ class PasswordWatcher;
 namespace Imap {
 
 namespace Mailbox {
+class AbstractCache;
 class MailboxModel;
 class Model;
 class MsgListModel;
@@ -154,6 +156,9 @@ private slots:
     void desiredNetworkPolicyChanged(const Imap::Mailbox::NetworkPolicy policy);
 
 private:
+    /** @short Create a memory-only cache, configured as per the user's settings */
+    std::shared_ptr<Imap::Mailbox::AbstractCache> createMemoryCache() const;
+
     QSettings *m_settings;
     Imap::Mailbox::Model *m_imapModel;
     Imap::Mailbox::MailboxModel *m_mailboxModel;
@@ -64,9 +64,16 @@ enum {
     RoleMailboxUidValidity,
     /** @short Is the mailbox subscribed?
 
-    If the server doesn't support RFC5258, this can return wrong answer.
+    Until the list of subscribed mailboxes is known, this relies on RFC5258 and can return wrong answer on servers which
+    do not support it.
     */
     RoleMailboxIsSubscribed,
+    /** @short Is there a subscribed mailbox anywhere below this one?
+
+    Asking for this role requests the list of subscriptions from the server. Before it arrives, any mailbox which might
+    possibly have child mailboxes is reported as having subscribed descendants. This role never triggers a LIST.
+    */
+    RoleMailboxHasSubscribedDescendants,
 
     /** @short UID of the message */
     RoleMessageUid,
@@ -170,6 +177,16 @@ enum {
     RolePartForceFetchFromCache,
     /** @short Pointer to the internal buffer */
     RolePartBufferPtr,
+    /** @short Leading complete lines of a part's data which have been downloaded so far
+
+    Asking for this role starts a download of the first chunk of the part instead of the whole part. Once all data
+    are available, this is equivalent to RolePartData.
+    */
+    RolePartPreviewData,
+    /** @short Is there anything more to download beyond what RolePartPreviewData returns? */
+    RolePartPreviewIsTruncated,
+    /** @short Request the next chunk of a truncated part */
+    RolePartPreviewFetchMore,
 
     /** @short QModelIndex of the message a part is associated to */
     RolePartMessageIndex,
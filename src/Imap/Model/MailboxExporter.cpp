@@ -0,0 +1,418 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QTimer>
+#include "MailboxExporter.h"
+#include "ExportSink.h"
+#include "FullMessageCombiner.h"
+#include "ItemRoles.h"
+#include "MailboxFinder.h"
+#include "MailboxModel.h"
+#include "MailboxTree.h"
+#include "Utils.h"
+
+namespace {
+
+/** @short Default number of messages which are being downloaded at once */
+const int DEFAULT_WINDOW_SIZE = 50;
+
+/** @short Save the export state after this many messages */
+const int CHECKPOINT_INTERVAL = 200;
+
+const quint32 STATE_MAGIC = 0x54524a45; // "TRJE"
+const quint32 STATE_VERSION = 1;
+
+}
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+ExportState::ExportState(const QString &fileName)
+    : m_fileName(fileName)
+{
+}
+
+bool ExportState::load()
+{
+    m_state.clear();
+    if (m_fileName.isEmpty() || !QFile::exists(m_fileName))
+        return true;
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_2);
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != STATE_MAGIC || version != STATE_VERSION) {
+        m_errorString = QCoreApplication::translate("Imap::Mailbox::ExportState", "%1 is not a valid export state file")
+                .arg(m_fileName);
+        return false;
+    }
+    stream >> m_state;
+    if (stream.status() != QDataStream::Ok) {
+        m_state.clear();
+        m_errorString = QCoreApplication::translate("Imap::Mailbox::ExportState", "Cannot read %1").arg(m_fileName);
+        return false;
+    }
+    return true;
+}
+
+bool ExportState::save()
+{
+    if (m_fileName.isEmpty())
+        return true;
+
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream << STATE_MAGIC << STATE_VERSION << m_state;
+    if (!file.commit()) {
+        m_errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+uint ExportState::lastUid(const QString &mailbox, const uint uidValidity) const
+{
+    auto it = m_state.constFind(mailbox);
+    if (it == m_state.constEnd() || it->first != uidValidity)
+        return 0;
+    return it->second;
+}
+
+void ExportState::setLastUid(const QString &mailbox, const uint uidValidity, const uint uid)
+{
+    m_state[mailbox] = qMakePair(uidValidity, uid);
+}
+
+QString ExportState::errorString() const
+{
+    return m_errorString;
+}
+
+
+MailboxExporter::MailboxExporter(QObject *parent, Model *model, const QStringList &mailboxes,
+                                 std::unique_ptr<ExportSink> sink, const QString &stateFile)
+    : QObject(parent)
+    , m_model(model)
+    , m_finder(0)
+    , m_mailboxes(mailboxes)
+    , m_sink(std::move(sink))
+    , m_state(stateFile)
+    , m_phase(PHASE_IDLE)
+    , m_currentMailbox(-1)
+    , m_uidValidity(0)
+    , m_lastUid(0)
+    , m_windowSize(DEFAULT_WINDOW_SIZE)
+    , m_pumping(false)
+    , m_done(0)
+    , m_total(0)
+    , m_sinceCheckpoint(0)
+    , m_messages(0)
+    , m_bytes(0)
+{
+    Q_ASSERT(m_model);
+    Q_ASSERT(m_sink);
+    // The MailboxFinder only works on top of a proxy model which contains just the mailboxes
+    m_finder = new MailboxFinder(this, new MailboxModel(this, m_model));
+    connect(m_finder, &MailboxFinder::mailboxFound, this, &MailboxExporter::slotMailboxFound);
+    connect(m_model, &Model::mailboxSyncingProgress, this, &MailboxExporter::slotMailboxSyncingProgress);
+    // The message metadata might arrive after the message body
+    connect(m_model, &QAbstractItemModel::dataChanged, this, [this]() {
+        pump();
+    });
+}
+
+MailboxExporter::~MailboxExporter()
+{
+    abort();
+}
+
+void MailboxExporter::setWindowSize(const int size)
+{
+    m_windowSize = qMax(1, size);
+}
+
+void MailboxExporter::start()
+{
+    Q_ASSERT(m_phase == PHASE_IDLE);
+    m_timer.start();
+    if (!m_state.load()) {
+        fail(m_state.errorString());
+        return;
+    }
+    nextMailbox();
+}
+
+void MailboxExporter::cancel()
+{
+    if (m_phase == PHASE_DONE)
+        return;
+
+    // Everything which has been written so far is complete, so it is safe to remember it
+    bool ok = m_phase != PHASE_FETCHING || checkpoint();
+    abort();
+    if (ok)
+        emit failed(tr("The export was cancelled"));
+}
+
+void MailboxExporter::nextMailbox()
+{
+    ++m_currentMailbox;
+    if (m_currentMailbox >= m_mailboxes.size()) {
+        m_phase = PHASE_DONE;
+        emit finished(m_messages, m_bytes, m_timer.elapsed());
+        return;
+    }
+
+    m_phase = PHASE_FINDING;
+    m_mailboxIndex = QModelIndex();
+    m_finder->addMailbox(m_mailboxes[m_currentMailbox]);
+}
+
+void MailboxExporter::slotMailboxFound(const QString &mailbox, const QModelIndex &index)
+{
+    if (m_phase != PHASE_FINDING || mailbox != m_mailboxes[m_currentMailbox])
+        return;
+
+    m_mailboxIndex = Imap::deproxifiedIndex(index);
+    if (!m_mailboxIndex.data(RoleMailboxIsSelectable).toBool()) {
+        nextMailbox();
+        return;
+    }
+
+    if (!m_model->isNetworkAvailable()) {
+        fail(tr("Cannot export mailbox %1 while offline").arg(mailbox));
+        return;
+    }
+
+    if (!m_sink->beginMailbox(mailbox, m_mailboxIndex.data(RoleMailboxSeparator).toString())) {
+        fail(m_sink->errorString());
+        return;
+    }
+
+    m_phase = PHASE_SYNCING;
+    m_model->switchToMailbox(m_mailboxIndex);
+    // When the mailbox is already selected and synchronized, there won't be any further progress report
+    QTimer::singleShot(0, this, &MailboxExporter::checkMailboxReady);
+}
+
+void MailboxExporter::slotMailboxSyncingProgress(const QModelIndex &mailbox, Imap::Mailbox::MailboxSyncingProgress state)
+{
+    if (m_phase == PHASE_SYNCING && state == STATE_DONE && mailbox == m_mailboxIndex)
+        collectMessages();
+}
+
+void MailboxExporter::checkMailboxReady()
+{
+    if (m_phase != PHASE_SYNCING)
+        return;
+
+    if (!m_mailboxIndex.isValid()) {
+        fail(tr("Mailbox %1 has disappeared").arg(m_mailboxes[m_currentMailbox]));
+        return;
+    }
+
+    QModelIndex list = m_mailboxIndex.child(0, 0);
+    if (list.data(RoleIsFetched).toBool() && !m_mailboxIndex.data(RoleMailboxItemsAreLoading).toBool())
+        collectMessages();
+}
+
+void MailboxExporter::collectMessages()
+{
+    m_phase = PHASE_FETCHING;
+    const QString &name = m_mailboxes[m_currentMailbox];
+    m_uidValidity = m_mailboxIndex.data(RoleMailboxUidValidity).toUInt();
+    m_lastUid = m_state.lastUid(name, m_uidValidity);
+
+    // Messages are sorted by their UID, so whatever is above the checkpoint has not been exported yet
+    QModelIndex list = m_mailboxIndex.child(0, 0);
+    const int count = m_model->rowCount(list);
+    m_queue.clear();
+    for (int i = 0; i < count; ++i) {
+        QModelIndex message = m_model->index(i, 0, list);
+        if (message.data(RoleMessageUid).toUInt() > m_lastUid)
+            m_queue << message;
+    }
+
+    m_done = 0;
+    m_total = m_queue.size();
+    m_sinceCheckpoint = 0;
+    emit progress(name, m_done, m_total);
+    pump();
+}
+
+void MailboxExporter::pump()
+{
+    // The combiners might report their completion synchronously from within load()
+    if (m_pumping || m_phase != PHASE_FETCHING)
+        return;
+    m_pumping = true;
+
+    bool progressed = true;
+    while (progressed && m_phase == PHASE_FETCHING) {
+        progressed = false;
+
+        while (m_inFlight.size() < m_windowSize && !m_queue.isEmpty()) {
+            PendingMessage pending;
+            pending.message = m_queue.takeFirst();
+            if (!pending.message.isValid())
+                continue;
+            pending.uid = pending.message.data(RoleMessageUid).toUInt();
+            // The INTERNALDATE is needed when writing; asking for it now makes it part of the pipelined requests
+            // instead of a late fetch after the message data have been released.
+            pending.message.data(RoleMessageInternalDate);
+            pending.combiner = new FullMessageCombiner(pending.message, this);
+            pending.completed = false;
+            FullMessageCombiner *combiner = pending.combiner;
+            m_inFlight << pending;
+
+            auto markDone = [this, combiner](const QString &error) {
+                for (auto it = m_inFlight.begin(); it != m_inFlight.end(); ++it) {
+                    if (it->combiner == combiner) {
+                        it->completed = true;
+                        it->error = error;
+                        break;
+                    }
+                }
+                pump();
+            };
+            connect(combiner, &FullMessageCombiner::completed, this, [markDone]() { markDone(QString()); });
+            connect(combiner, &FullMessageCombiner::failed, this, markDone);
+            combiner->load();
+            // Whatever was not available right away is being downloaded just for the export, so it should not stay in the cache
+            PendingMessage &requested = m_inFlight.last();
+            if (!requested.message.child(0, TreeItem::OFFSET_HEADER).data(RoleIsFetched).toBool())
+                requested.downloadedParts << QByteArrayLiteral("HEADER");
+            if (!requested.message.child(0, TreeItem::OFFSET_TEXT).data(RoleIsFetched).toBool())
+                requested.downloadedParts << QByteArrayLiteral("TEXT");
+            progressed = true;
+        }
+
+        while (m_phase == PHASE_FETCHING && !m_inFlight.isEmpty() && isReadyToWrite(m_inFlight.first())) {
+            if (!writeFirstMessage())
+                break;
+            progressed = true;
+        }
+    }
+
+    m_pumping = false;
+
+    if (m_phase == PHASE_FETCHING && m_queue.isEmpty() && m_inFlight.isEmpty()) {
+        if (checkpoint())
+            nextMailbox();
+    }
+}
+
+bool MailboxExporter::isReadyToWrite(const PendingMessage &pending) const
+{
+    if (!pending.completed)
+        return false;
+    if (!pending.error.isEmpty() || !pending.message.isValid())
+        return true;
+    return pending.message.data(RoleIsFetched).toBool() || pending.message.data(RoleIsUnavailable).toBool();
+}
+
+bool MailboxExporter::writeFirstMessage()
+{
+    PendingMessage pending = m_inFlight.takeFirst();
+    pending.combiner->disconnect(this);
+    pending.combiner->deleteLater();
+
+    if (!pending.error.isEmpty()) {
+        if (pending.message.isValid()) {
+            fail(tr("Cannot export message %1 from %2: %3")
+                 .arg(QString::number(pending.uid), m_mailboxes[m_currentMailbox], pending.error));
+            return false;
+        }
+        // The message got expunged in the meanwhile, so there's nothing to export
+    } else {
+        const QByteArray data = pending.combiner->data();
+        if (!m_sink->writeMessage(data, pending.message.data(RoleMessageInternalDate).toDateTime(),
+                                  pending.message.data(RoleMessageFlags).toStringList())) {
+            fail(m_sink->errorString());
+            return false;
+        }
+        ++m_messages;
+        m_bytes += data.size();
+        m_model->releaseMessageData(pending.message);
+        Q_FOREACH(const QByteArray &partId, pending.downloadedParts) {
+            m_model->cache()->forgetMessagePart(m_mailboxes[m_currentMailbox], pending.uid, partId);
+        }
+    }
+
+    m_lastUid = pending.uid;
+    emit progress(m_mailboxes[m_currentMailbox], ++m_done, m_total);
+    if (++m_sinceCheckpoint >= CHECKPOINT_INTERVAL)
+        return checkpoint();
+    return true;
+}
+
+bool MailboxExporter::checkpoint()
+{
+    m_sinceCheckpoint = 0;
+    if (!m_sink->flush()) {
+        fail(m_sink->errorString());
+        return false;
+    }
+    m_state.setLastUid(m_mailboxes[m_currentMailbox], m_uidValidity, m_lastUid);
+    if (!m_state.save()) {
+        fail(m_state.errorString());
+        return false;
+    }
+    return true;
+}
+
+void MailboxExporter::abort()
+{
+    m_phase = PHASE_DONE;
+    Q_FOREACH(const PendingMessage &pending, m_inFlight) {
+        pending.combiner->disconnect(this);
+        pending.combiner->deleteLater();
+    }
+    m_inFlight.clear();
+    m_queue.clear();
+}
+
+void MailboxExporter::fail(const QString &message)
+{
+    abort();
+    emit failed(message);
+}
+
+}
+}
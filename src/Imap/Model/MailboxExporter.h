@@ -0,0 +1,170 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAP_MODEL_MAILBOXEXPORTER_H
+#define IMAP_MODEL_MAILBOXEXPORTER_H
+
+#include <memory>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QPair>
+#include <QPersistentModelIndex>
+#include <QStringList>
+#include "Model.h"
+
+/** @short Namespace for IMAP interaction */
+namespace Imap
+{
+
+/** @short Classes for handling of mailboxes and connections */
+namespace Mailbox
+{
+
+class ExportSink;
+class FullMessageCombiner;
+class MailboxFinder;
+
+/** @short Remember how far an export has progressed in each mailbox
+
+The state is only valid as long as the UIDVALIDITY of a mailbox remains the same; when it changes,
+the export of that mailbox starts from scratch.
+*/
+class ExportState
+{
+public:
+    explicit ExportState(const QString &fileName);
+
+    /** @short Read the state from disk; a missing file means a fresh start */
+    bool load();
+    /** @short Atomically replace the state on disk */
+    bool save();
+
+    /** @short Highest UID which was exported from the @arg mailbox, or 0 */
+    uint lastUid(const QString &mailbox, const uint uidValidity) const;
+    void setLastUid(const QString &mailbox, const uint uidValidity, const uint uid);
+
+    QString errorString() const;
+
+private:
+    QString m_fileName;
+    /** @short (UIDVALIDITY, last exported UID) for each mailbox */
+    QMap<QString, QPair<uint, uint>> m_state;
+    QString m_errorString;
+};
+
+/** @short Export full messages from a list of mailboxes into an ExportSink
+
+The mailboxes are processed one after another. In each of them, the exporter asks for the complete
+source of a bounded number of messages at once, so that the server can process the FETCH commands
+in a pipelined manner, and writes them to the sink in UID order as they arrive. Data of each
+message are released from the Model once they have been written, which keeps the memory usage
+bounded regardless of the mailbox size. Messages whose parts are already in the cache are not
+downloaded again; parts which had to be downloaded are removed from the cache after they have
+been written, so that an export does not fill the persistent cache.
+
+The progress is checkpointed regularly, so an interrupted export continues where it stopped.
+*/
+class MailboxExporter : public QObject
+{
+    Q_OBJECT
+public:
+    MailboxExporter(QObject *parent, Model *model, const QStringList &mailboxes, std::unique_ptr<ExportSink> sink,
+                    const QString &stateFile);
+    virtual ~MailboxExporter();
+
+    /** @short How many messages can be requested from the server before the first of them gets written */
+    void setWindowSize(const int size);
+
+    void start();
+    /** @short Stop the export, remembering what has been written so far */
+    void cancel();
+
+signals:
+    void progress(const QString &mailbox, int done, int total);
+    void finished(quint64 messages, quint64 bytes, qint64 msecs);
+    void failed(const QString &message);
+
+private:
+    void slotMailboxFound(const QString &mailbox, const QModelIndex &index);
+    void slotMailboxSyncingProgress(const QModelIndex &mailbox, Imap::Mailbox::MailboxSyncingProgress state);
+    void checkMailboxReady();
+
+    void nextMailbox();
+    void collectMessages();
+    void pump();
+    bool writeFirstMessage();
+    bool checkpoint();
+    void abort();
+    void fail(const QString &message);
+
+    struct PendingMessage {
+        QPersistentModelIndex message;
+        uint uid;
+        FullMessageCombiner *combiner;
+        bool completed;
+        QString error;
+        /** @short Parts which were not in the cache before the export asked for them */
+        QList<QByteArray> downloadedParts;
+    };
+    /** @short Is the message's body complete, and are its metadata known? */
+    bool isReadyToWrite(const PendingMessage &pending) const;
+
+    typedef enum {
+        PHASE_IDLE, /**< Not started yet */
+        PHASE_FINDING, /**< Waiting for the MailboxFinder */
+        PHASE_SYNCING, /**< Waiting for the mailbox to get synchronized */
+        PHASE_FETCHING, /**< Downloading and writing messages */
+        PHASE_DONE /**< Finished, failed or cancelled */
+    } Phase;
+
+    Model *m_model;
+    MailboxFinder *m_finder;
+    QStringList m_mailboxes;
+    std::unique_ptr<ExportSink> m_sink;
+    ExportState m_state;
+    Phase m_phase;
+
+    int m_currentMailbox;
+    QPersistentModelIndex m_mailboxIndex;
+    uint m_uidValidity;
+    uint m_lastUid;
+
+    /** @short Messages which have not been requested yet */
+    QList<QPersistentModelIndex> m_queue;
+    /** @short Requested messages, in the order in which they have to be written */
+    QList<PendingMessage> m_inFlight;
+    int m_windowSize;
+    bool m_pumping;
+
+    int m_done;
+    int m_total;
+    int m_sinceCheckpoint;
+    quint64 m_messages;
+    quint64 m_bytes;
+    QElapsedTimer m_timer;
+};
+
+}
+
+}
+
+#endif /* IMAP_MODEL_MAILBOXEXPORTER_H */
@@ -35,6 +35,33 @@
 #include "SpecialFlagNames.h"
 #include <QtDebug>
 
+namespace {
+
+/** @short How much of the @arg raw data can be decoded on its own, without waiting for the next chunk
+
+Base64 is decoded in complete quanta of four characters. Everything else is decoded up to the last complete line, which
+also keeps quoted-printable escape sequences together.
+*/
+int decodablePrefixLength(const QByteArray &raw, const QByteArray &encoding)
+{
+    if (encoding == "base64") {
+        int usable = 0;
+        int quantum = 0;
+        for (int i = 0; i < raw.size(); ++i) {
+            const char c = raw[i];
+            if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/' || c == '=') {
+                if (++quantum == 4) {
+                    quantum = 0;
+                    usable = i + 1;
+                }
+            }
+        }
+        return usable;
+    }
+    return raw.lastIndexOf('\n') + 1;
+}
+
+}
 
 namespace Imap
 {
@@ -244,7 +271,10 @@ QVariant TreeItemMailbox::data(Model *const model, int role)
         return list->fetched() ? QVariant(syncState.uidValidity()) : QVariant();
     }
     case RoleMailboxIsSubscribed:
-        return QVariant::fromValue<bool>(m_metadata.flags.contains(QStringLiteral("\\SUBSCRIBED")));
+        return isSubscribed(model);
+    case RoleMailboxHasSubscribedDescendants:
+        model->askForSubscribedMailboxes();
+        return hasSubscribedDescendants(model);
     default:
         return QVariant();
     }
@@ -284,6 +314,23 @@ bool TreeItemMailbox::hasChildMailboxes(Model *const model)
     }
 }
 
+bool TreeItemMailbox::isSubscribed(Model *const model) const
+{
+    if (model->m_subscriptionsKnown)
+        return model->m_subscribedMailboxes.contains(mailbox());
+    return m_metadata.flags.contains(QStringLiteral("\\SUBSCRIBED"));
+}
+
+bool TreeItemMailbox::hasSubscribedDescendants(Model *const model)
+{
+    if (model->m_subscriptionsKnown)
+        return model->m_subscribedDescendants.contains(mailbox());
+    // Without the subscription list, anything which might have children has to be assumed to have subscribed ones
+    if (fetched() || isUnavailable())
+        return m_children.size() > 1;
+    return !hasNoChildMailboxesAlreadyKnown();
+}
+
 TreeItem *TreeItemMailbox::child(const int offset, Model *const model)
 {
     // accessing TreeItemMsgList doesn't need fetch()
@@ -327,12 +374,21 @@ void TreeItemMailbox::handleFetchResponse(Model *const model,
     // be putting it into a correct bucket^Hmessage.
     bool ignoreImmutableData = !list->fetched() && uidRecord == response.data.constEnd();
 
-    int number = response.number - 1;
-    if (number < 0 || number >= list->m_children.size())
-        throw UnknownMessageIndex(QStringLiteral("Got FETCH that is out of bounds -- got %1 messages").arg(
-                                      QString::number(list->m_children.size())).toUtf8().constData(), response);
+    TreeItemMessage *message = 0;
+    if (response.number == 0) {
+        // An RFC 9586 UIDFETCH, the message can be found by its UID only
+        Q_ASSERT(uidRecord != response.data.constEnd());
+        message = findMessageForUidFetch(model, static_cast<const Responses::RespData<uint>&>(*(uidRecord.value())).data);
+        if (!message)
+            throw UnknownMessageIndex("Got UIDFETCH for an UID which is not in the mailbox", response);
+    } else {
+        int number = response.number - 1;
+        if (number < 0 || number >= list->m_children.size())
+            throw UnknownMessageIndex(QStringLiteral("Got FETCH that is out of bounds -- got %1 messages").arg(
+                                          QString::number(list->m_children.size())).toUtf8().constData(), response);
 
-    TreeItemMessage *message = static_cast<TreeItemMessage *>(list->child(number, model));
+        message = static_cast<TreeItemMessage *>(list->child(number, model));
+    }
 
     // At first, have a look at the response and check the UID of the message
     if (uidRecord != response.data.constEnd()) {
@@ -345,6 +401,7 @@ void TreeItemMailbox::handleFetchResponse(Model *const model,
         } else if (message->uid() == 0) {
             // This is the first time we see the UID, so let's take a note
             message->m_uid = receivedUid;
+            list->updateUnreadIndex(message);
             changedMessage = message;
             if (message->loading()) {
                 // The Model tried to ask for data for this message. That couldn't succeeded because the UID
@@ -385,6 +442,7 @@ void TreeItemMailbox::handleFetchResponse(Model *const model,
     }
 
     bool updatedFlags = false;
+    bool receivedFlags = false;
 
     for (Responses::Fetch::dataType::const_iterator it = response.data.begin(); it != response.data.end(); ++ it) {
         if (it.key() == "UID") {
@@ -395,6 +453,7 @@ void TreeItemMailbox::handleFetchResponse(Model *const model,
             QStringList newFlags = model->normalizeFlags(static_cast<const Responses::RespData<QStringList>&>(*(it.value())).data);
             bool forceChange = !message->m_flagsHandled || (message->m_flags != newFlags);
             message->setFlags(list, newFlags);
+            receivedFlags = true;
             if (forceChange) {
                 updatedFlags = true;
                 changedMessage = message;
@@ -452,6 +511,47 @@ void TreeItemMailbox::handleFetchResponse(Model *const model,
             const QByteArray &rawHeaders = static_cast<const Responses::RespData<QByteArray>&>(*(it.value())).data;
             message->processAdditionalHeaders(model, rawHeaders);
             changedMessage = message;
+        } else if (it.key().startsWith("BODY[") && it.key().endsWith('>')) {
+            // A chunk of a partial download requested by Model::askForMsgPartPreview()
+            TreeItemPart *part = partIdToPtr(model, message, it.key());
+            if (! part)
+                throw UnknownMessageIndex("Got BODY[]<> fetch that did not resolve to any known part", response);
+            const int originPos = it.key().lastIndexOf('<') + 1;
+            bool ok;
+            const int origin = it.key().mid(originPos, it.key().size() - originPos - 1).toInt(&ok);
+            if (!ok)
+                throw UnknownMessageIndex("Can't parse the origin of a partial BODY[]<>", response);
+            // Ignore chunks which we haven't asked for, as well as those which arrive after the whole part got fetched
+            if (part->m_preview && part->m_preview->requestedSize && origin == part->m_preview->receivedSize) {
+                const QByteArray &data = static_cast<const Responses::RespData<QByteArray>&>(*(it.value())).data;
+                const bool complete = static_cast<uint>(data.size()) < part->m_preview->requestedSize
+                        || static_cast<quint64>(part->m_preview->receivedSize + data.size()) >= part->octets();
+                part->m_preview->receivedSize += data.size();
+                part->m_preview->requestedSize = 0;
+                if (complete && !part->loading()) {
+                    QByteArray decoded;
+                    Imap::decodeContentTransferEncoding(part->m_preview->rawTail + data, part->transferEncoding(), &decoded);
+                    *part->dataPtr() = part->m_preview->data + part->m_preview->dataTail + decoded;
+                    part->m_preview.reset();
+                    part->setFetchStatus(DONE);
+                    if (message->uid()) {
+                        model->cache()->setMsgPart(mailbox(), message->uid(), part->partId(), part->m_data);
+                    }
+                } else if (!complete) {
+                    // Decode just the new chunk, together with whatever was left over from the previous one
+                    QByteArray raw = part->m_preview->rawTail + data;
+                    const int usable = decodablePrefixLength(raw, part->transferEncoding());
+                    QByteArray decoded;
+                    Imap::decodeContentTransferEncoding(raw.left(usable), part->transferEncoding(), &decoded);
+                    part->m_preview->rawTail = raw.mid(usable);
+                    // Only show complete lines so that a partially transferred escape sequence does not leak through
+                    decoded.prepend(part->m_preview->dataTail);
+                    const int lineEnd = decoded.lastIndexOf('\n') + 1;
+                    part->m_preview->data.append(decoded.constData(), lineEnd);
+                    part->m_preview->dataTail = decoded.mid(lineEnd);
+                }
+                changedParts.append(part);
+            }
         } else if (it.key().startsWith("BODY[") || it.key().startsWith("BINARY[")) {
             if (it.key()[ it.key().size() - 1 ] != ']')
                 throw UnknownMessageIndex("Can't parse such BODY[]/BINARY[]", response);
@@ -480,6 +580,7 @@ void TreeItemMailbox::handleFetchResponse(Model *const model,
                 if (part->loading()) {
                     // got to decode the part data by hand
                     Imap::decodeContentTransferEncoding(data, part->transferEncoding(), part->dataPtr());
+                    part->m_preview.reset();
                     part->setFetchStatus(DONE);
                     changedParts.append(part);
                     if (message->uid()
@@ -492,6 +593,7 @@ void TreeItemMailbox::handleFetchResponse(Model *const model,
             } else {
                 // A BINARY FETCH item is already decoded for us, yay
                 part->m_data = data;
+                part->m_preview.reset();
                 part->setFetchStatus(DONE);
                 changedParts.append(part);
                 if (message->uid()) {
@@ -523,6 +625,9 @@ void TreeItemMailbox::handleFetchResponse(Model *const model,
         if (updatedFlags) {
             model->cache()->setMsgFlags(mailbox(), message->uid(), message->m_flags);
         }
+        if (receivedFlags) {
+            emit model->messageFlagsReceived(mailbox(), message->uid(), message->m_flags);
+        }
     }
 }
 
@@ -589,17 +694,23 @@ void TreeItemMailbox::handleVanished(Model *const model, const Responses::Vanish
     Q_ASSERT(list);
     QModelIndex listIndex = list->toIndex(model);
 
-    auto uids = resp.uids;
-    qSort(uids);
-    // Remove duplicates -- even that garbage can be present in a perfectly valid VANISHED :(
-    uids.erase(std::unique(uids.begin(), uids.end()), uids.end());
+    // The ranges are sorted and free of duplicates -- even that garbage can be present in a perfectly valid VANISHED :(
+    const auto &ranges = resp.uids.toRanges();
+    auto range = ranges.constEnd();
+    uint uid = 0;
 
     auto it = list->m_children.end();
-    while (!uids.isEmpty()) {
+    while (true) {
         // We have to process each UID separately because the UIDs in the mailbox are not necessarily present
-        // in a continuous range; zeros might be present
-        uint uid = uids.last();
-        uids.pop_back();
+        // in a continuous range; zeros might be present. Go from the highest one to the lowest.
+        if (range != ranges.constEnd() && uid > range->lo) {
+            --uid;
+        } else if (range != ranges.constBegin()) {
+            --range;
+            uid = range->hi;
+        } else {
+            break;
+        }
 
         if (uid == 0) {
             qDebug() << "VANISHED informs about removal of UID zero...";
@@ -750,8 +861,44 @@ void TreeItemMailbox::handleExists(Model *const model, const Responses::NumberRe
     model->emitMessageCountChanged(this);
 }
 
-TreeItemPart *TreeItemMailbox::partIdToPtr(Model *const model, TreeItemMessage *message, const QByteArray &msgId)
+/** @short Find the message which an UIDFETCH response refers to
+
+Without the sequence numbers, the only clue about messages whose UID is not known yet, i.e. the new arrivals, is that they
+are at the end of the mailbox, sorted by their UIDs.
+*/
+TreeItemMessage *TreeItemMailbox::findMessageForUidFetch(Model *const model, const uint uid)
+{
+    TreeItemMsgList *list = static_cast<TreeItemMsgList *>(m_children[0]);
+    auto it = model->findMessageOrNextOneByUid(list, uid);
+    if (it != list->m_children.end() && static_cast<TreeItemMessage *>(*it)->uid() == uid)
+        return static_cast<TreeItemMessage *>(*it);
+
+    if (it == list->m_children.end() || static_cast<TreeItemMessage *>(*it)->uid() != 0) {
+        // This UID is either gone, or it is lower than that of some message which we already know about
+        return 0;
+    }
+
+    // Rewind to the first of the new arrivals
+    while (it != list->m_children.begin() && static_cast<TreeItemMessage *>(*(it - 1))->uid() == 0)
+        --it;
+    if (it != list->m_children.begin() && static_cast<TreeItemMessage *>(*(it - 1))->uid() > uid) {
+        // The new arrivals would not be sorted by UID anymore
+        return 0;
+    }
+    return static_cast<TreeItemMessage *>(*it);
+}
+
+TreeItemPart *TreeItemMailbox::partIdToPtr(Model *const model, TreeItemMessage *message, const QByteArray &fetchId)
 {
+    // The partial fetch range, "<origin>" or "<origin.length>", does not matter for finding the part
+    QByteArray msgId = fetchId;
+    if (msgId.endsWith('>')) {
+        int pos = msgId.lastIndexOf('<');
+        if (pos == -1)
+            throw UnknownMessageIndex(QByteArray("Fetch identifier has no matching \"<\": " + msgId).constData());
+        msgId.truncate(pos);
+    }
+
     QByteArray partIdentification;
     if (msgId.startsWith("BODY[")) {
         partIdentification = msgId.mid(5, msgId.size() - 6);
@@ -905,6 +1052,7 @@ void TreeItemMsgList::recalcVariousMessageCounts(Model *model)
 {
     m_unreadMessageCount = 0;
     m_recentMessageCount = 0;
+    m_unreadUids.clear();
     for (int i = 0; i < m_children.size(); ++i) {
         TreeItemMessage *message = static_cast<TreeItemMessage *>(m_children[i]);
         bool isRead, isRecent;
@@ -912,8 +1060,11 @@ void TreeItemMsgList::recalcVariousMessageCounts(Model *model)
         if (!message->m_flagsHandled)
             message->m_wasUnread = ! isRead;
         message->m_flagsHandled = true;
-        if (!isRead)
+        if (!isRead) {
             ++m_unreadMessageCount;
+            if (message->m_uid)
+                m_unreadUids.insert(message->m_uid);
+        }
         if (isRecent)
             ++m_recentMessageCount;
     }
@@ -949,6 +1100,17 @@ void TreeItemMsgList::resetWasUnreadState()
     }
 }
 
+/** @short Add or remove the @arg message from the index of unread messages based on its current flags */
+void TreeItemMsgList::updateUnreadIndex(TreeItemMessage *message)
+{
+    if (!message->m_uid)
+        return;
+    if (message->m_flagsHandled && !message->isMarkedAsRead())
+        m_unreadUids.insert(message->m_uid);
+    else
+        m_unreadUids.erase(message->m_uid);
+}
+
 bool TreeItemMsgList::numbersFetched() const
 {
     return m_numberFetchingStatus == DONE;
@@ -1470,6 +1632,7 @@ void TreeItemMessage::setFlags(TreeItemMsgList *list, const QStringList &flags)
             }
         }
     }
+    list->updateUnreadIndex(this);
 }
 
 /** @short Process the data found in the headers passed along and file in auxiliary metadata
@@ -1617,6 +1780,15 @@ void TreeItemPart::fetchFromCache(Model *const model)
     model->askForMsgPart(this, true);
 }
 
+/** @short Start downloading the leading part of the data, unless it's available already */
+void TreeItemPart::fetchPreview(Model *const model)
+{
+    if (m_preview || fetched() || loading() || isUnavailable())
+        return;
+
+    model->askForMsgPartPreview(this);
+}
+
 unsigned int TreeItemPart::rowCount(Model *const model)
 {
     // no call to fetch() required
@@ -1676,6 +1848,17 @@ QVariant TreeItemPart::data(Model *const model, int role)
         return QVariant();
     case RolePartBufferPtr:
         return QVariant::fromValue(dataPtr());
+    case RolePartPreviewData:
+        fetchPreview(model);
+        if (fetched())
+            return m_data;
+        return m_preview ? m_preview->data : QByteArray();
+    case RolePartPreviewIsTruncated:
+        return !fetched() && m_preview;
+    case RolePartPreviewFetchMore:
+        if (m_preview)
+            model->askForMsgPartPreview(this);
+        return QVariant();
     case RolePartBodyFldParam:
         return QVariant::fromValue(m_bodyFldParam);
     }
@@ -1840,6 +2023,7 @@ void TreeItemPart::silentlyReleaseMemoryRecursive()
         m_partRaw = 0;
     }
     m_data.clear();
+    m_preview.reset();
     setFetchStatus(NONE);
     qDeleteAll(m_children);
     m_children.clear();
@@ -24,6 +24,7 @@
 #define IMAP_MAILBOXTREE_H
 
 #include <memory>
+#include <set>
 #include <QList>
 #include <QModelIndex>
 #include <QPointer>
@@ -170,6 +171,13 @@ public:
     No network activity will be caused. If the answer is not known for sure, we return false (meaning "don't know").
     */
     bool hasNoChildMailboxesAlreadyKnown();
+    /** @short Is this mailbox subscribed? */
+    bool isSubscribed(Model *const model) const;
+    /** @short Returns true if there's a subscribed mailbox anywhere below this one
+
+    No network activity will be caused; the answer comes from the subscription list which is maintained by the Model.
+    */
+    bool hasSubscribedDescendants(Model *const model);
 
     QString mailbox() const { return m_metadata.mailbox; }
     QString separator() const { return m_metadata.separator; }
@@ -193,7 +201,8 @@ public:
     void saveSyncStateAndUids(Model *model);
 
 private:
-    TreeItemPart *partIdToPtr(Model *model, TreeItemMessage *message, const QByteArray &msgId);
+    TreeItemPart *partIdToPtr(Model *model, TreeItemMessage *message, const QByteArray &fetchId);
+    TreeItemMessage *findMessageForUidFetch(Model *const model, const uint uid);
 
     /** @short ImapTask which is currently responsible for well-being of this mailbox */
     QPointer<KeepMailboxOpenTask> maintainingTask;
@@ -211,6 +220,12 @@ class TreeItemMsgList: public TreeItem
     int m_totalMessageCount;
     int m_unreadMessageCount;
     int m_recentMessageCount;
+    /** @short UIDs of messages which are known to be unread, kept in ascending order
+
+    Entries of expunged messages are not removed eagerly; whoever looks up a message through this index
+    shall verify that it is still present.
+    */
+    std::set<uint> m_unreadUids;
 public:
     explicit TreeItemMsgList(TreeItem *parent);
 
@@ -226,6 +241,7 @@ public:
     void recalcVariousMessageCounts(Model *model);
     void recalcVariousMessageCountsOnExpunge(Model *model, TreeItemMessage *expungedMessage);
     void resetWasUnreadState();
+    void updateUnreadIndex(TreeItemMessage *message);
     bool numbersFetched() const;
 };
 
@@ -357,6 +373,21 @@ class TreeItemPart: public TreeItem
     Imap::Message::AbstractMessage::bodyFldParam_t m_bodyFldParam;
     mutable TreeItemPart *m_partMime;
     mutable TreeItemPart *m_partRaw;
+
+    /** @short Progress of a chunked download of a big part, see Model::askForMsgPartPreview() */
+    struct PreviewState {
+        /** @short Number of bytes of the raw data received so far */
+        int receivedSize;
+        /** @short The end of the received raw data which cannot be decoded before the next chunk arrives */
+        QByteArray rawTail;
+        /** @short The decoded data, cut after the last complete line */
+        QByteArray data;
+        /** @short The decoded data after the last complete line */
+        QByteArray dataTail;
+        /** @short Size of the chunk which is being downloaded, or zero when idle */
+        uint requestedSize;
+    };
+    std::unique_ptr<PreviewState> m_preview;
 public:
     TreeItemPart(TreeItem *parent, const QByteArray &mimeType);
     ~TreeItemPart();
@@ -367,6 +398,7 @@ public:
 
     virtual void fetchFromCache(Model *const model);
     virtual void fetch(Model *const model);
+    void fetchPreview(Model *const model);
     virtual unsigned int rowCount(Model *const model);
     virtual unsigned int columnCount();
     virtual QVariant data(Model *const model, int role);
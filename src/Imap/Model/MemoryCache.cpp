@@ -31,9 +31,15 @@ namespace Imap
 namespace Mailbox
 {
 
+MemoryCache::MemoryCache()
+    : m_partBytes(0)
+    , m_partBudget(0)
+{
+}
+
 QList<MailboxMetadata> MemoryCache::childMailboxes(const QString &mailbox) const
 {
-    return mailboxes[ mailbox ];
+    return mailboxes.value(mailbox);
 }
 
 bool MemoryCache::childMailboxesFresh(const QString &mailbox) const
@@ -51,7 +57,7 @@ void MemoryCache::setChildMailboxes(const QString &mailbox, const QList<MailboxM
 
 SyncState MemoryCache::mailboxSyncState(const QString &mailbox) const
 {
-    return syncState[mailbox];
+    return syncState.value(mailbox);
 }
 
 void MemoryCache::setMailboxSyncState(const QString &mailbox, const SyncState &state)
@@ -83,9 +89,13 @@ void MemoryCache::clearAllMessages(const QString &mailbox)
 #ifdef CACHE_DEBUG
     qDebug() << "pruging all info for mailbox" << mailbox;
 #endif
-    flags.remove(mailbox);
-    msgMetadata.remove(mailbox);
-    parts.remove(mailbox);
+    auto it = messages.find(mailbox);
+    if (it != messages.end()) {
+        for (auto partsIt = it->parts.constBegin(); partsIt != it->parts.constEnd(); ++partsIt) {
+            dropParts(*partsIt);
+        }
+        messages.erase(it);
+    }
     threads.remove(mailbox);
 }
 
@@ -94,12 +104,16 @@ void MemoryCache::clearMessage(const QString mailbox, const uint uid)
 #ifdef CACHE_DEBUG
     qDebug() << "pruging all info for message" << mailbox << uid;
 #endif
-    if (flags.contains(mailbox))
-        flags[mailbox].remove(uid);
-    if (msgMetadata.contains(mailbox))
-        msgMetadata[mailbox].remove(uid);
-    if (parts.contains(mailbox))
-        parts[mailbox].remove(uid);
+    auto it = messages.find(mailbox);
+    if (it == messages.end())
+        return;
+    it->flags.remove(uid);
+    it->metadata.remove(uid);
+    auto partsIt = it->parts.find(uid);
+    if (partsIt != it->parts.end()) {
+        dropParts(*partsIt);
+        it->parts.erase(partsIt);
+    }
 }
 
 void MemoryCache::setMsgPart(const QString &mailbox, const uint uid, const QByteArray &partId, const QByteArray &data)
@@ -107,7 +121,19 @@ void MemoryCache::setMsgPart(const QString &mailbox, const uint uid, const QByte
 #ifdef CACHE_DEBUG
     qDebug() << "set message part" << mailbox << uid << partId << data.size();
 #endif
-    parts[mailbox][uid][partId] = data;
+    auto &messageParts = messages[mailbox].parts[uid];
+    auto it = messageParts.find(partId);
+    if (it == messageParts.end()) {
+        m_lru.push_front(LruItem(mailbox, uid, partId));
+        it = messageParts.insert(partId, PartData());
+        it->lru = m_lru.begin();
+    } else {
+        m_partBytes -= it->data.size();
+        m_lru.splice(m_lru.begin(), m_lru, it->lru);
+    }
+    it->data = data;
+    m_partBytes += data.size();
+    evictParts();
 }
 
 void MemoryCache::forgetMessagePart(const QString &mailbox, const uint uid, const QByteArray &partId)
@@ -115,8 +141,18 @@ void MemoryCache::forgetMessagePart(const QString &mailbox, const uint uid, cons
 #ifdef CACHE_DEBUG
     qDebug() << "forget message part" << mailbox << uid << partId;
 #endif
-    parts[mailbox][uid].remove(partId);
-
+    auto mailboxIt = messages.find(mailbox);
+    if (mailboxIt == messages.end())
+        return;
+    auto messageIt = mailboxIt->parts.find(uid);
+    if (messageIt == mailboxIt->parts.end())
+        return;
+    auto it = messageIt->find(partId);
+    if (it == messageIt->end())
+        return;
+    m_partBytes -= it->data.size();
+    m_lru.erase(it->lru);
+    messageIt->erase(it);
 }
 
 void MemoryCache::setMsgFlags(const QString &mailbox, uint uid, const QStringList &newFlags)
@@ -124,50 +160,66 @@ void MemoryCache::setMsgFlags(const QString &mailbox, uint uid, const QStringLis
 #ifdef CACHE_DEBUG
     qDebug() << "set FLAGS for" << mailbox << uid << newFlags;
 #endif
-    flags[mailbox][uid] = newFlags;
+    messages[mailbox].flags[uid] = newFlags;
+}
+
+void MemoryCache::addMsgFlag(const QString &mailbox, const Imap::Uids &uids, const QString &flag)
+{
+    auto it = messages.find(mailbox);
+    if (it == messages.end())
+        return;
+    Q_FOREACH(const uint uid, uids) {
+        auto flagsIt = it->flags.find(uid);
+        if (flagsIt != it->flags.end() && !flagsIt->contains(flag))
+            *flagsIt << flag;
+    }
 }
 
 QStringList MemoryCache::msgFlags(const QString &mailbox, const uint uid) const
 {
-    return flags[mailbox][uid];
+    auto it = messages.constFind(mailbox);
+    if (it == messages.constEnd())
+        return QStringList();
+    return it->flags.value(uid);
 }
 
 Imap::Uids MemoryCache::uidMapping(const QString &mailbox) const
 {
-    return seqToUid[mailbox];
+    return seqToUid.value(mailbox);
 }
 
 void MemoryCache::setMessageMetadata(const QString &mailbox, const uint uid, const MessageDataBundle &metadata)
 {
-    msgMetadata[mailbox][uid] = metadata;
+    messages[mailbox].metadata[uid] = metadata;
 }
 
 MemoryCache::MessageDataBundle MemoryCache::messageMetadata(const QString &mailbox, const uint uid) const
 {
-    const QMap<uint, MessageDataBundle> &firstLevel = msgMetadata[ mailbox ];
-    QMap<uint, MessageDataBundle>::const_iterator it = firstLevel.find(uid);
-    if (it == firstLevel.end()) {
+    auto it = messages.constFind(mailbox);
+    if (it == messages.constEnd())
         return MessageDataBundle();
-    }
-    return *it;
+    return it->metadata.value(uid);
 }
 
 QByteArray MemoryCache::messagePart(const QString &mailbox, const uint uid, const QByteArray &partId) const
 {
-    if (! parts.contains(mailbox))
+    auto mailboxIt = messages.constFind(mailbox);
+    if (mailboxIt == messages.constEnd())
         return QByteArray();
-    const auto & mailboxParts = parts[mailbox];
-    if (! mailboxParts.contains(uid))
+    auto messageIt = mailboxIt->parts.constFind(uid);
+    if (messageIt == mailboxIt->parts.constEnd())
         return QByteArray();
-    const auto & messageParts = mailboxParts[uid];
-    if (! messageParts.contains(partId))
+    auto it = messageIt->constFind(partId);
+    if (it == messageIt->constEnd())
         return QByteArray();
-    return messageParts[ partId ];
+    // This part is now the most recently used one
+    m_lru.splice(m_lru.begin(), m_lru, it->lru);
+    return it->data;
 }
 
 QVector<Imap::Responses::ThreadingNode> MemoryCache::messageThreading(const QString &mailbox)
 {
-    return threads[mailbox];
+    return threads.value(mailbox);
 }
 
 void MemoryCache::setMessageThreading(const QString &mailbox, const QVector<Imap::Responses::ThreadingNode> &threading)
@@ -180,5 +232,49 @@ void MemoryCache::setRenewalThreshold(const int days)
     Q_UNUSED(days);
 }
 
+void MemoryCache::setPartBudget(const quint64 bytes)
+{
+    m_partBudget = bytes;
+    evictParts();
+}
+
+quint64 MemoryCache::partBytes() const
+{
+    return m_partBytes;
+}
+
+void MemoryCache::dropParts(const QHash<QByteArray, PartData> &messageParts)
+{
+    for (auto it = messageParts.constBegin(); it != messageParts.constEnd(); ++it) {
+        m_partBytes -= it->data.size();
+        m_lru.erase(it->lru);
+    }
+}
+
+void MemoryCache::evictParts()
+{
+    if (!m_partBudget)
+        return;
+
+    // The most recently stored part is always kept, even if it alone doesn't fit
+    while (m_partBytes > m_partBudget && m_lru.size() > 1) {
+        const LruItem &victim = m_lru.back();
+#ifdef CACHE_DEBUG
+        qDebug() << "evicting message part" << victim.mailbox << victim.uid << victim.partId;
+#endif
+        auto mailboxIt = messages.find(victim.mailbox);
+        Q_ASSERT(mailboxIt != messages.end());
+        auto messageIt = mailboxIt->parts.find(victim.uid);
+        Q_ASSERT(messageIt != mailboxIt->parts.end());
+        auto it = messageIt->find(victim.partId);
+        Q_ASSERT(it != messageIt->end());
+        m_partBytes -= it->data.size();
+        messageIt->erase(it);
+        if (messageIt->isEmpty())
+            mailboxIt->parts.erase(messageIt);
+        m_lru.pop_back();
+    }
+}
+
 }
 }
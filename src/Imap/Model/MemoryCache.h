@@ -23,8 +23,9 @@
 #ifndef IMAP_MODEL_MEMORYCACHE_H
 #define IMAP_MODEL_MEMORYCACHE_H
 
+#include <list>
+#include <QHash>
 #include "Cache.h"
-#include <QMap>
 
 /** @short Namespace for IMAP interaction */
 namespace Imap
@@ -36,12 +37,18 @@ namespace Mailbox
 
 /** @short A cache implementation that uses in-memory cache
 
-    It also has an optional feature to dump the data to a local file and read
-    it back in. Is isn't suitable for real production use, but it's a good start.
+    All data are kept in hash tables, one set of per-message tables per mailbox.
+
+    The message parts can optionally be limited by a memory budget. When the
+    budget is exceeded, the least recently used parts are dropped. The rest of
+    the data (flags, message metadata, mailbox lists,...) is small enough and is
+    never evicted.
  */
 class MemoryCache : public AbstractCache
 {
 public:
+    MemoryCache();
+
     virtual QList<MailboxMetadata> childMailboxes(const QString &mailbox) const;
     virtual bool childMailboxesFresh(const QString &mailbox) const;
     virtual void setChildMailboxes(const QString &mailbox, const QList<MailboxMetadata> &data);
@@ -61,6 +68,7 @@ public:
 
     virtual QStringList msgFlags(const QString &mailbox, const uint uid) const;
     virtual void setMsgFlags(const QString &mailbox, const uint uid, const QStringList &newFlags);
+    virtual void addMsgFlag(const QString &mailbox, const Imap::Uids &uids, const QString &flag);
 
     virtual QByteArray messagePart(const QString &mailbox, const uint uid, const QByteArray &partId) const;
     virtual void setMsgPart(const QString &mailbox, const uint uid, const QByteArray &partId, const QByteArray &data);
@@ -71,14 +79,52 @@ public:
 
     virtual void setRenewalThreshold(const int days);
 
+    /** @short Limit the total size of the cached message parts to @arg bytes
+
+    Zero means that there is no limit, which is the default.
+    */
+    void setPartBudget(const quint64 bytes);
+    /** @short Total size of the message parts which are currently cached */
+    quint64 partBytes() const;
+
 private:
-    QMap<QString, QList<MailboxMetadata> > mailboxes;
-    QMap<QString, SyncState> syncState;
-    QMap<QString, Imap::Uids> seqToUid;
-    QMap<QString, QMap<uint,QStringList> > flags;
-    QMap<QString, QMap<uint, MessageDataBundle> > msgMetadata;
-    QMap<QString, QMap<uint, QMap<QByteArray, QByteArray> > > parts;
-    QMap<QString, QVector<Imap::Responses::ThreadingNode> > threads;
+    /** @short Full identification of a message part as stored in the LRU list */
+    struct LruItem {
+        QString mailbox;
+        uint uid;
+        QByteArray partId;
+        LruItem(const QString &mailbox, const uint uid, const QByteArray &partId): mailbox(mailbox), uid(uid), partId(partId) {}
+    };
+    /** @short Least recently used parts go to the end of this list */
+    typedef std::list<LruItem> LruList;
+
+    struct PartData {
+        QByteArray data;
+        LruList::iterator lru;
+    };
+
+    /** @short Everything we know about messages in one mailbox */
+    struct MailboxData {
+        QHash<uint, QStringList> flags;
+        QHash<uint, MessageDataBundle> metadata;
+        QHash<uint, QHash<QByteArray, PartData> > parts;
+    };
+
+    /** @short Forget all parts of a message and update the LRU accordingly */
+    void dropParts(const QHash<QByteArray, PartData> &messageParts);
+    /** @short Remove the least recently used parts until we fit into the budget */
+    void evictParts();
+
+    QHash<QString, QList<MailboxMetadata> > mailboxes;
+    QHash<QString, SyncState> syncState;
+    QHash<QString, Imap::Uids> seqToUid;
+    QHash<QString, MailboxData> messages;
+    QHash<QString, QVector<Imap::Responses::ThreadingNode> > threads;
+
+    /** @short Parts in the order of their last access, most recent first */
+    mutable LruList m_lru;
+    quint64 m_partBytes;
+    quint64 m_partBudget;
 };
 
 }
@@ -20,6 +20,7 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <QAbstractProxyModel>
 #include <QAuthenticator>
 #include <QCoreApplication>
@@ -49,6 +50,12 @@ namespace
 
 using namespace Imap::Mailbox;
 
+/** @short How many bytes of a big message part to ask for at once, see Model::askForMsgPartPreview() */
+const uint PART_PREVIEW_CHUNK_SIZE = 256 * 1024;
+
+/** @short How long to wait for each connection's LOGOUT to get written when quitting, in milliseconds */
+const int LOGOUT_FLUSH_TIMEOUT = 200;
+
 /** @short Return true iff the two mailboxes have the same name
 
 It's an error to call this function on anything else but a mailbox.
@@ -93,6 +100,12 @@ bool messageHasUidZero(const TreeItem *const item)
     return message->uid() == 0;
 }
 
+/** @short Pack together everything which the "only subscribed mailboxes" filters look at */
+int subscriptionFilterState(TreeItemMailbox *mailbox, Model *model)
+{
+    return (mailbox->isSubscribed(model) ? 1 : 0) | (mailbox->hasSubscribedDescendants(model) ? 2 : 0);
+}
+
 }
 
 namespace Imap
@@ -110,6 +123,10 @@ Model::Model(QObject *parent, std::shared_ptr<AbstractCache> cache, SocketFactor
     , m_netPolicy(NETWORK_OFFLINE)
     , m_taskModel(nullptr)
     , m_hasImapPassword(PasswordAvailability::NOT_REQUESTED)
+    , m_subscriptionsState(SubscriptionsState::NOT_REQUESTED)
+    , m_subscriptionsKnown(false)
+    , m_responseBatchDepth(0)
+    , m_skipTreeDestruction(false)
 {
     m_startTls = m_socketFactory->startTlsRequired();
 
@@ -134,10 +151,19 @@ Model::Model(QObject *parent, std::shared_ptr<AbstractCache> cache, SocketFactor
     // polling every five minutes
     m_periodicMailboxNumbersRefresh->setInterval(5 * 60 * 1000);
     connect(m_periodicMailboxNumbersRefresh, &QTimer::timeout, this, &Model::invalidateAllMessageCounts);
+
+    m_delayedMessageCounts = new QTimer(this);
+    m_delayedMessageCounts->setSingleShot(true);
+    m_delayedMessageCounts->setInterval(0);
+    connect(m_delayedMessageCounts, &QTimer::timeout, this, &Model::sendDelayedMessageCountRequests);
 }
 
 Model::~Model()
 {
+    if (m_skipTreeDestruction) {
+        // The process is about to exit, so there's no point in walking the whole tree
+        return;
+    }
     delete m_mailboxes;
 }
 
@@ -165,6 +191,9 @@ void Model::responseReceived(const QMap<Parser *,ParserState>::iterator it)
 {
     Q_ASSERT(it->parser);
 
+    // Changes to messages and to the message counts are collected and announced once all of these responses are processed
+    beginBatchedChanges();
+
     int counter = 0;
     while (it->parser && it->parser->hasResponse()) {
         QSharedPointer<Imap::Responses::AbstractResponse> resp = it->parser->getResponse();
@@ -261,6 +290,8 @@ void Model::responseReceived(const QMap<Parser *,ParserState>::iterator it)
         }
     }
 
+    endBatchedChanges();
+
     if (!it->parser) {
         // He's dead, Jim
         m_taskModel->beginResetModel();
@@ -500,6 +531,85 @@ void Model::emitMessageCountChanged(TreeItemMailbox *const mailbox)
     emit messageCountPossiblyChanged(mailboxIndex);
 }
 
+void Model::queueDataChanged(TreeItemMessage *const message)
+{
+    if (!m_responseBatchDepth) {
+        QModelIndex index = message->toIndex(this);
+        emit dataChanged(index, index);
+        return;
+    }
+    m_queuedMessageChanges[static_cast<TreeItemMsgList *>(message->parent())] << message->row();
+}
+
+void Model::queueMessageCountChanged(TreeItemMailbox *const mailbox)
+{
+    if (!m_responseBatchDepth) {
+        emitMessageCountChanged(mailbox);
+        return;
+    }
+    if (!m_queuedMessageCountChanges.contains(mailbox))
+        m_queuedMessageCountChanges << mailbox;
+}
+
+void Model::beginBatchedChanges()
+{
+    ++m_responseBatchDepth;
+}
+
+void Model::endBatchedChanges()
+{
+    Q_ASSERT(m_responseBatchDepth > 0);
+    if (--m_responseBatchDepth == 0)
+        emitQueuedDataChanged();
+}
+
+/** @short Announce all changes which were queued by queueDataChanged() and queueMessageCountChanged()
+
+Rows of changed messages are merged into contiguous ranges, so that a flag update of a huge number of messages
+results in just a few signals.
+*/
+void Model::emitQueuedDataChanged()
+{
+    // The slots connected to our signals might very well queue more changes
+    QHash<TreeItemMsgList *, QVector<int>> messageChanges;
+    QList<TreeItemMailbox *> countChanges;
+    messageChanges.swap(m_queuedMessageChanges);
+    countChanges.swap(m_queuedMessageCountChanges);
+
+    for (auto it = messageChanges.begin(); it != messageChanges.end(); ++it) {
+        TreeItemMsgList *list = it.key();
+        QVector<int> &rows = it.value();
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        int i = 0;
+        while (i < rows.size()) {
+            int first = rows[i];
+            int last = first;
+            while (++i < rows.size() && rows[i] == last + 1)
+                ++last;
+            if (first < 0 || last >= list->m_children.size())
+                continue;
+            emit dataChanged(createIndex(first, 0, list->m_children[first]), createIndex(last, 0, list->m_children[last]));
+        }
+    }
+
+    Q_FOREACH(TreeItemMailbox *mailbox, countChanges) {
+        emitMessageCountChanged(mailbox);
+    }
+}
+
+void Model::beginInsertRows(const QModelIndex &parent, int first, int last)
+{
+    emitQueuedDataChanged();
+    QAbstractItemModel::beginInsertRows(parent, first, last);
+}
+
+void Model::beginRemoveRows(const QModelIndex &parent, int first, int last)
+{
+    emitQueuedDataChanged();
+    QAbstractItemModel::beginRemoveRows(parent, first, last);
+}
+
 /** @short Retrieval of a message part has completed */
 bool Model::finalizeFetchPart(TreeItemMailbox *const mailbox, const uint sequenceNo, const QByteArray &partId)
 {
@@ -518,6 +628,19 @@ bool Model::finalizeFetchPart(TreeItemMailbox *const mailbox, const uint sequenc
         qDebug() << "Can't verify part fetching status: part is not here!";
         return false;
     }
+    if (partId.endsWith('>')) {
+        // A chunk of a partial download, see askForMsgPartPreview()
+        if (part->m_preview && part->m_preview->requestedSize) {
+            part->m_preview.reset();
+            if (!part->loading() && !part->fetched()) {
+                part->setFetchStatus(TreeItem::UNAVAILABLE);
+            }
+            QModelIndex idx = part->toIndex(this);
+            emit dataChanged(idx, idx);
+            return false;
+        }
+        return true;
+    }
     if (part->loading()) {
         part->setFetchStatus(TreeItem::UNAVAILABLE);
         QModelIndex idx = part->toIndex(this);
@@ -832,6 +955,9 @@ void Model::askForChildrenOfMailbox(TreeItemMailbox *item, bool forceReload)
 void Model::reloadMailboxList()
 {
     m_mailboxes->rescanForChildMailboxes(this);
+    // The old subscription list remains in use until the fresh one arrives
+    if (m_subscriptionsState != SubscriptionsState::LOADING)
+        m_subscriptionsState = SubscriptionsState::NOT_REQUESTED;
 }
 
 void Model::askForMessagesInMailbox(TreeItemMsgList *item)
@@ -903,11 +1029,163 @@ void Model::askForNumberOfMessages(TreeItemMsgList *item)
         } else {
             item->m_numberFetchingStatus = TreeItem::UNAVAILABLE;
         }
+    } else if (m_delayedMessageCounts->interval() > 0) {
+        if (item->m_totalMessageCount == -1) {
+            // Show whatever we remember from the last time while the fresh numbers are on their way
+            Imap::Mailbox::SyncState syncState = cache()->mailboxSyncState(mailboxPtr->mailbox());
+            if (syncState.isUsableForNumbers()) {
+                item->m_unreadMessageCount = syncState.unSeenCount();
+                item->m_totalMessageCount = syncState.exists();
+                item->m_recentMessageCount = syncState.recent();
+                emitMessageCountChanged(mailboxPtr);
+            }
+        }
+        m_pendingMessageCounts << mailboxPtr->toIndex(this);
+        // Restarting the timer means that nothing gets sent while the view is still being scrolled
+        m_delayedMessageCounts->start();
     } else {
         m_taskFactory->createNumberOfMessagesTask(this, mailboxPtr->toIndex(this));
     }
 }
 
+void Model::sendDelayedMessageCountRequests()
+{
+    QList<QPersistentModelIndex> pending;
+    pending.swap(m_pendingMessageCounts);
+    Q_FOREACH(const QPersistentModelIndex &mailbox, pending) {
+        if (!mailbox.isValid())
+            continue;
+        TreeItemMailbox *mailboxPtr = dynamic_cast<TreeItemMailbox *>(static_cast<TreeItem *>(mailbox.internalPointer()));
+        Q_ASSERT(mailboxPtr);
+        TreeItemMsgList *list = dynamic_cast<TreeItemMsgList *>(mailboxPtr->m_children[0]);
+        Q_ASSERT(list);
+        if (list->m_numberFetchingStatus != TreeItem::LOADING) {
+            // Somebody else has provided the numbers in the meanwhile, perhaps through a SELECT
+            continue;
+        }
+        if (!isNetworkAvailable() || (m_messageCountFilter && !m_messageCountFilter(mailbox))) {
+            list->m_numberFetchingStatus = TreeItem::NONE;
+            continue;
+        }
+        m_taskFactory->createNumberOfMessagesTask(this, mailbox);
+    }
+}
+
+void Model::askForSubscribedMailboxes()
+{
+    if (m_subscriptionsState != SubscriptionsState::NOT_REQUESTED || !isNetworkAvailable())
+        return;
+    m_subscriptionsState = SubscriptionsState::LOADING;
+    m_taskFactory->createListSubscribedMailboxesTask(this);
+}
+
+/** @short Remember the complete list of subscribed mailboxes
+
+Each item of @arg mailboxes contains a mailbox name along with its hierarchy separator.
+*/
+void Model::setSubscribedMailboxes(const QList<QPair<QString, QString>> &mailboxes)
+{
+    // Only the mailboxes whose state has actually changed are reported, so that the proxies do not have to re-check
+    // the whole tree
+    QList<TreeItemMailbox *> known;
+    QList<int> before;
+    std::function<void(TreeItemMailbox *)> collect = [this, &known, &before, &collect](TreeItemMailbox *parent) {
+        for (int i = 1; i < parent->m_children.size(); ++i) {
+            TreeItemMailbox *mailbox = static_cast<TreeItemMailbox *>(parent->m_children[i]);
+            known << mailbox;
+            before << subscriptionFilterState(mailbox, this);
+            collect(mailbox);
+        }
+    };
+    collect(m_mailboxes);
+
+    m_subscribedMailboxes.clear();
+    m_subscribedDescendants.clear();
+    for (auto it = mailboxes.constBegin(); it != mailboxes.constEnd(); ++it) {
+        if (m_subscribedMailboxes.contains(it->first))
+            continue;
+        m_subscribedMailboxes.insert(it->first);
+        addSubscribedDescendant(it->first, it->second, 1);
+    }
+    m_subscriptionsKnown = true;
+    m_subscriptionsState = SubscriptionsState::LOADED;
+
+    for (int i = 0; i < known.size(); ++i) {
+        if (subscriptionFilterState(known[i], this) != before[i]) {
+            QModelIndex index = known[i]->toIndex(this);
+            emit dataChanged(index, index);
+        }
+    }
+}
+
+void Model::subscribedMailboxesUnavailable()
+{
+    // Don't try again until the mailbox list gets reloaded
+    m_subscriptionsState = SubscriptionsState::UNAVAILABLE;
+}
+
+/** @short Record a successful SUBSCRIBE or UNSUBSCRIBE of a @arg mailboxName */
+void Model::updateSubscription(const QString &mailboxName, const bool subscribed)
+{
+    TreeItemMailbox *mailbox = findMailboxByName(mailboxName);
+
+    // Subscribing to a mailbox can only affect the mailbox itself and its parents
+    QList<TreeItemMailbox *> affected;
+    for (TreeItem *item = mailbox ? mailbox : findParentMailboxByName(mailboxName); item && item != m_mailboxes;
+         item = item->parent()) {
+        affected << static_cast<TreeItemMailbox *>(item);
+    }
+    QList<int> before;
+    Q_FOREACH(TreeItemMailbox *item, affected) {
+        before << subscriptionFilterState(item, this);
+    }
+
+    if (mailbox) {
+        const QString flag = QStringLiteral("\\SUBSCRIBED");
+        if (subscribed && !mailbox->m_metadata.flags.contains(flag)) {
+            mailbox->m_metadata.flags.append(flag);
+        } else if (!subscribed) {
+            mailbox->m_metadata.flags.removeOne(flag);
+        }
+    }
+
+    if (m_subscriptionsKnown) {
+        const QString separator = affected.isEmpty() ? QString() : affected.first()->separator();
+        if (subscribed && !m_subscribedMailboxes.contains(mailboxName)) {
+            m_subscribedMailboxes.insert(mailboxName);
+            addSubscribedDescendant(mailboxName, separator, 1);
+        } else if (!subscribed && m_subscribedMailboxes.remove(mailboxName)) {
+            addSubscribedDescendant(mailboxName, separator, -1);
+        }
+    }
+
+    for (int i = 0; i < affected.size(); ++i) {
+        if (subscriptionFilterState(affected[i], this) != before[i]) {
+            QModelIndex index = affected[i]->toIndex(this);
+            emit dataChanged(index, index);
+        }
+    }
+}
+
+/** @short Adjust the number of subscribed descendants of all parents of the @arg mailbox by @arg delta */
+void Model::addSubscribedDescendant(const QString &mailbox, const QString &separator, const int delta)
+{
+    if (separator.isEmpty())
+        return;
+
+    int pos = mailbox.indexOf(separator);
+    while (pos != -1) {
+        if (pos > 0) {
+            const QString parent = mailbox.left(pos);
+            int &count = m_subscribedDescendants[parent];
+            count += delta;
+            if (count <= 0)
+                m_subscribedDescendants.remove(parent);
+        }
+        pos = mailbox.indexOf(separator, pos + separator.size());
+    }
+}
+
 void Model::askForMsgMetadata(TreeItemMessage *item, const PreloadingMode preloadMode)
 {
     Q_ASSERT(item->uid());
@@ -1062,11 +1340,70 @@ void Model::askForMsgPart(TreeItemPart *item, bool onlyFromCache)
     }
 }
 
+/** @short Download the next chunk of a message part
+
+Big text parts, like log dumps sent inline, take a long time to download. This function asks for a partial range
+of the part's raw data via the BODY[...]<origin.length> syntax, so that the leading part can be shown without waiting for
+the rest. The part becomes DONE, and gets stored in the cache, only when the last chunk arrives.
+*/
+void Model::askForMsgPartPreview(TreeItemPart *item)
+{
+    if (item->fetched() || item->loading() || item->isUnavailable())
+        return;
+
+    if (!item->m_preview) {
+        askForMsgPart(item, true);
+        if (item->accessFetchStatus() != TreeItem::NONE) {
+            // Either found in the cache, or we are offline
+            return;
+        }
+        item->m_preview.reset(new TreeItemPart::PreviewState());
+        item->m_preview->receivedSize = 0;
+        item->m_preview->requestedSize = 0;
+    }
+
+    if (item->m_preview->requestedSize) {
+        // The previous chunk hasn't arrived yet
+        return;
+    }
+
+    if (networkPolicy() == NETWORK_OFFLINE) {
+        // What we have got so far remains visible
+        return;
+    }
+
+    TreeItemMailbox *mailboxPtr = dynamic_cast<TreeItemMailbox *>(item->message()->parent()->parent());
+    Q_ASSERT(mailboxPtr);
+    Q_ASSERT(item->message()->uid());
+
+    item->m_preview->requestedSize = PART_PREVIEW_CHUNK_SIZE;
+    KeepMailboxOpenTask *keepTask = findTaskResponsibleFor(mailboxPtr);
+    keepTask->requestPartDownload(item->message()->m_uid,
+                                  item->partIdForFetch(TreeItemPart::FETCH_PART_IMAP)
+                                  + '<' + QByteArray::number(item->m_preview->receivedSize)
+                                  + '.' + QByteArray::number(item->m_preview->requestedSize) + '>',
+                                  item->m_preview->requestedSize);
+}
+
 void Model::resyncMailbox(const QModelIndex &mbox)
 {
     findTaskResponsibleFor(mbox)->resynchronizeMailbox();
 }
 
+void Model::prepareForExit()
+{
+    m_delayedMessageCounts->stop();
+    setNetworkPolicy(NETWORK_OFFLINE);
+    // The LOGOUT commands are only queued at this point, and the event loop is not going to run again.
+    // Make sure that they reach the network before the sockets get destroyed, but do not let a dead server block the exit.
+    for (auto it = m_parsers.constBegin(); it != m_parsers.constEnd(); ++it) {
+        if (it->parser && !it->parser->flushCommands(LOGOUT_FLUSH_TIMEOUT))
+            logTrace(it->parser->parserId(), Common::LOG_OTHER, QStringLiteral("Model"), QStringLiteral("LOGOUT not sent before exit"));
+    }
+    m_cache->flush();
+    m_skipTreeDestruction = true;
+}
+
 void Model::setNetworkPolicy(const NetworkPolicy policy)
 {
     bool networkReconnected = m_netPolicy == NETWORK_OFFLINE && policy != NETWORK_OFFLINE;
@@ -1236,7 +1573,24 @@ ImapTask *Model::setMessageFlags(const QModelIndexList &messages, const QString
 {
     Q_ASSERT(!messages.isEmpty());
     Q_ASSERT(messages.front().model() == this);
-    return m_taskFactory->createUpdateFlagsTask(this, messages, marked, QLatin1Char('(') + flag + QLatin1Char(')'));
+    QModelIndex mailbox = findMailboxForItems(messages);
+    Imap::Uids uids;
+    uids.reserve(messages.size());
+    Q_FOREACH(const QModelIndex &index, messages) {
+        TreeItemMessage *message = dynamic_cast<TreeItemMessage *>(static_cast<TreeItem *>(index.internalPointer()));
+        Q_ASSERT(message);
+        // Messages whose UID is not known yet cannot be addressed
+        if (message->uid())
+            uids << message->uid();
+    }
+    return setMessageFlags(mailbox, uids.isEmpty() ? Sequence() : Sequence::fromVector(uids), flag, marked);
+}
+
+ImapTask *Model::setMessageFlags(const QModelIndex &mailbox, const Imap::Sequence &uids, const QString flag, const FlagsOperation marked)
+{
+    Q_ASSERT(mailbox.isValid());
+    Q_ASSERT(mailbox.model() == this);
+    return m_taskFactory->createUpdateFlagsTask(this, mailbox, uids, marked, QLatin1Char('(') + flag + QLatin1Char(')'));
 }
 
 void Model::markMessagesDeleted(const QModelIndexList &messages, const FlagsOperation marked)
@@ -1244,6 +1598,11 @@ void Model::markMessagesDeleted(const QModelIndexList &messages, const FlagsOper
     this->setMessageFlags(messages, QStringLiteral("\\Deleted"), marked);
 }
 
+void Model::markMessagesDeleted(const QModelIndex &mailbox, const Imap::Sequence &uids, const FlagsOperation marked)
+{
+    this->setMessageFlags(mailbox, uids, QStringLiteral("\\Deleted"), marked);
+}
+
 void Model::markMailboxAsRead(const QModelIndex &mailbox)
 {
     if (!mailbox.isValid())
@@ -1262,6 +1621,11 @@ void Model::markMessagesRead(const QModelIndexList &messages, const FlagsOperati
     this->setMessageFlags(messages, QStringLiteral("\\Seen"), marked);
 }
 
+void Model::markMessagesRead(const QModelIndex &mailbox, const Imap::Sequence &uids, const FlagsOperation marked)
+{
+    this->setMessageFlags(mailbox, uids, QStringLiteral("\\Seen"), marked);
+}
+
 void Model::copyMoveMessages(TreeItemMailbox *sourceMbox, const QString &destMailboxName, Imap::Uids uids, const CopyMoveOperation op)
 {
     if (m_netPolicy == NETWORK_OFFLINE) {
@@ -1271,15 +1635,89 @@ void Model::copyMoveMessages(TreeItemMailbox *sourceMbox, const QString &destMai
 
     Q_ASSERT(sourceMbox);
 
-    qSort(uids);
+    if (uids.isEmpty())
+        return;
+
+    copyMoveMessages(sourceMbox->toIndex(this), destMailboxName, Sequence::fromVector(uids), op);
+}
+
+void Model::copyMoveMessages(const QModelIndex &sourceMailbox, const QString &destMboxName, const Imap::Sequence &uids,
+                             const CopyMoveOperation op)
+{
+    if (m_netPolicy == NETWORK_OFFLINE) {
+        // FIXME: error signalling
+        return;
+    }
+
+    Q_ASSERT(sourceMailbox.isValid());
+    Q_ASSERT(sourceMailbox.model() == this);
+    m_taskFactory->createCopyMoveMessagesTask(this, sourceMailbox, uids, destMboxName, op);
+}
+
+/** @short Return the message with the given UID if it is still present and unread
+
+This is used for validating the entries of the TreeItemMsgList::m_unreadUids which are removed lazily.
+*/
+TreeItemMessage *Model::findUnreadMessageByUid(TreeItemMsgList *list, const uint uid)
+{
+    auto it = findMessageOrNextOneByUid(list, uid);
+    if (it == list->m_children.end())
+        return 0;
+    TreeItemMessage *message = static_cast<TreeItemMessage *>(*it);
+    return message->uid() == uid && !message->isMarkedAsRead() ? message : 0;
+}
+
+QModelIndex Model::findUnreadMessage(const QModelIndex &mailbox, const uint uid, const bool forward)
+{
+    TreeItemMailbox *mailboxPtr = dynamic_cast<TreeItemMailbox *>(realTreeItem(mailbox));
+    if (!mailboxPtr)
+        return QModelIndex();
+    TreeItemMsgList *list = dynamic_cast<TreeItemMsgList *>(mailboxPtr->m_children[0]);
+    Q_ASSERT(list);
+
+    std::set<uint> &unread = list->m_unreadUids;
+    while (!unread.empty()) {
+        std::set<uint>::iterator it;
+        if (forward) {
+            it = unread.upper_bound(uid);
+            if (it == unread.end())
+                it = unread.begin();
+        } else {
+            it = unread.lower_bound(uid);
+            if (it == unread.begin())
+                it = unread.end();
+            --it;
+        }
+        if (*it == uid) {
+            // We went full circle; the current message is the only unread one
+            return QModelIndex();
+        }
+        if (TreeItemMessage *message = findUnreadMessageByUid(list, *it))
+            return message->toIndex(this);
+        unread.erase(it);
+    }
+    return QModelIndex();
+}
+
+QModelIndexList Model::unreadMessages(const QModelIndex &mailbox)
+{
+    QModelIndexList res;
+    TreeItemMailbox *mailboxPtr = dynamic_cast<TreeItemMailbox *>(realTreeItem(mailbox));
+    if (!mailboxPtr)
+        return res;
+    TreeItemMsgList *list = dynamic_cast<TreeItemMsgList *>(mailboxPtr->m_children[0]);
+    Q_ASSERT(list);
 
-    QModelIndexList messages;
-    Sequence seq;
-    Q_FOREACH(TreeItemMessage* m, findMessagesByUids(sourceMbox, uids)) {
-        messages << m->toIndex(this);
-        seq.add(m->uid());
+    std::set<uint> &unread = list->m_unreadUids;
+    for (auto it = unread.begin(); it != unread.end(); /* nothing */) {
+        if (TreeItemMessage *message = findUnreadMessageByUid(list, *it)) {
+            res << message->toIndex(this);
+            ++it;
+        } else {
+            it = unread.erase(it);
+        }
     }
-    m_taskFactory->createCopyMoveMessagesTask(this, messages, destMailboxName, op);
+    return res;
 }
 
 /** @short Convert a list of UIDs to a list of pointers to the relevant message nodes */
@@ -1306,6 +1744,34 @@ QList<TreeItemMessage *> Model::findMessagesByUids(const TreeItemMailbox *const
     return res;
 }
 
+/** @short Find messages whose UIDs are in the @arg uids, walking the list of messages just once
+
+The result is sorted by UID. UIDs of messages which are not present in the mailbox are silently skipped.
+*/
+QList<TreeItemMessage *> Model::findMessagesByUids(const TreeItemMailbox *const mailbox, const Imap::Sequence &uids)
+{
+    const TreeItemMsgList *const list = dynamic_cast<const TreeItemMsgList *const>(mailbox->m_children[0]);
+    Q_ASSERT(list);
+    QList<TreeItemMessage *> res;
+    if (!uids.isValid())
+        return res;
+
+    auto it = list->m_children.constBegin();
+    const auto end = list->m_children.constEnd();
+    Q_FOREACH(const Sequence::Range &range, uids.toRanges()) {
+        it = Common::lowerBoundWithUnknownElements(it, end, range.lo, messageHasUidZero, uidComparator);
+        for (; it != end; ++it) {
+            const uint uid = static_cast<TreeItemMessage *>(*it)->uid();
+            if (!uid)
+                continue;
+            if (uid > range.hi)
+                break;
+            res << static_cast<TreeItemMessage *>(*it);
+        }
+    }
+    return res;
+}
+
 /** @short Find a message with UID that matches the passed key, handling those with UID zero correctly
 
 If there's no such message, the next message with a valid UID is returned instead. If there are no such messages, the iterator can
@@ -1585,7 +2051,7 @@ KeepMailboxOpenTask *Model::findTaskResponsibleFor(TreeItemMailbox *mailboxPtr)
         Q_ASSERT(!m_parsers.isEmpty());
 
         for (QMap<Parser *,ParserState>::const_iterator it = m_parsers.constBegin(); it != m_parsers.constEnd(); ++it) {
-            if (it->connState == CONN_STATE_LOGOUT) {
+            if (it->connState == CONN_STATE_LOGOUT || it->isReserved) {
                 // this one is not usable
                 continue;
             }
@@ -1609,9 +2075,8 @@ void Model::genericHandleFetch(TreeItemMailbox *mailbox, const Imap::Responses::
         }
     }
     if (changedMessage) {
-        QModelIndex index = changedMessage->toIndex(this);
-        emit dataChanged(index, index);
-        emitMessageCountChanged(mailbox);
+        queueDataChanged(changedMessage);
+        queueMessageCountChanged(mailbox);
     }
 }
 
@@ -1728,11 +2193,12 @@ void Model::releaseMessageData(const QModelIndex &message)
 
 QStringList Model::capabilities() const
 {
-    if (m_parsers.isEmpty())
-        return QStringList();
-
-    if (m_parsers.constBegin()->capabilitiesFresh)
-        return m_parsers.constBegin()->capabilities;
+    // The reserved connections might still be logging in, so let's ask the one which is used for everything else
+    for (auto it = m_parsers.constBegin(); it != m_parsers.constEnd(); ++it) {
+        if (it->isReserved)
+            continue;
+        return it->capabilitiesFresh ? it->capabilities : QStringList();
+    }
 
     return QStringList();
 }
@@ -2057,6 +2523,20 @@ bool Model::isImapSubmissionSupported() const
     return caps.contains(QStringLiteral("UIDPLUS")) && caps.contains(QStringLiteral("X-DRAFT-I01-SENDMAIL"));
 }
 
+void Model::setMessageCountDelay(const int msecs)
+{
+    m_delayedMessageCounts->setInterval(msecs);
+    if (msecs == 0 && !m_pendingMessageCounts.isEmpty()) {
+        m_delayedMessageCounts->stop();
+        sendDelayedMessageCountRequests();
+    }
+}
+
+void Model::setMessageCountFilter(const std::function<bool(const QModelIndex &)> &filter)
+{
+    m_messageCountFilter = filter;
+}
+
 void Model::setNumberRefreshInterval(const int interval)
 {
     if (interval == m_periodicMailboxNumbersRefresh->interval())
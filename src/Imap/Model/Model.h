@@ -25,9 +25,13 @@
 #ifndef IMAP_MODEL_H
 #define IMAP_MODEL_H
 
+#include <functional>
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QPointer>
+#include <QSet>
 #include <QTimer>
+#include <QVector>
 #include "Cache.h"
 #include "../ConnectionState.h"
 #include "../Parser/Parser.h"
@@ -90,6 +94,18 @@ typedef enum { STATE_WAIT_FOR_CONN, /**< Waiting for connection to become active
                STATE_DONE /**< Mailbox is fully synchronized, both UIDs and flags are up to date */
              } MailboxSyncingProgress;
 
+/** @short Counters of the synchronization work which could be skipped thanks to an up-to-date cache */
+struct MailboxSyncStatistics {
+    /** @short How many times was a mailbox synchronized purely from the cached UID map and flags */
+    uint cachedResyncs;
+    /** @short Number of commands which a full resync would have sent */
+    uint savedCommands;
+    /** @short Estimated number of bytes which these commands and their responses would have taken */
+    quint64 savedBytes;
+
+    MailboxSyncStatistics(): cachedResyncs(0), savedCommands(0), savedBytes(0) {}
+};
+
 /** @short A model implementing view of the whole IMAP server */
 class Model: public QAbstractItemModel
 {
@@ -171,16 +187,30 @@ public:
     void markMailboxAsRead(const QModelIndex &mailbox);
     /** @short Add/Remove a flag for the indicated message */
     ImapTask *setMessageFlags(const QModelIndexList &messages, const QString flag, const FlagsOperation marked);
+    /** @short Add/Remove a flag for messages with the given UIDs in the @arg mailbox */
+    ImapTask *setMessageFlags(const QModelIndex &mailbox, const Imap::Sequence &uids, const QString flag, const FlagsOperation marked);
     /** @short Ask the server to set/unset the \\Deleted flag for the indicated messages */
     void markMessagesDeleted(const QModelIndexList &messages, const FlagsOperation marked);
+    void markMessagesDeleted(const QModelIndex &mailbox, const Imap::Sequence &uids, const FlagsOperation marked);
     /** @short Ask the server to set/unset the \\Seen flag for the indicated messages */
     void markMessagesRead(const QModelIndexList &messages, const FlagsOperation marked);
+    void markMessagesRead(const QModelIndex &mailbox, const Imap::Sequence &uids, const FlagsOperation marked);
 
     /** @short Run the EXPUNGE command in the specified mailbox */
     void expungeMailbox(const QModelIndex &mailbox);
 
+    /** @short Find the closest unread message after (or before) the message with the given @arg uid, wrapping around
+
+    The messages are considered in the order of their UIDs. The message with the @arg uid itself is never returned.
+    */
+    QModelIndex findUnreadMessage(const QModelIndex &mailbox, const uint uid, const bool forward);
+    /** @short Return all messages in the @arg mailbox which are known to be unread, sorted by their UIDs */
+    QModelIndexList unreadMessages(const QModelIndex &mailbox);
+
     /** @short Copy or move a sequence of messages between two mailboxes */
     void copyMoveMessages(TreeItemMailbox *sourceMbox, const QString &destMboxName, Imap::Uids uids, const CopyMoveOperation op);
+    void copyMoveMessages(const QModelIndex &sourceMailbox, const QString &destMboxName, const Imap::Sequence &uids,
+                          const CopyMoveOperation op);
 
     /** @short Create a new mailbox */
     void createMailbox(const QString &name, const AutoSubscription subscription = AutoSubscription::NO_EXPLICIT_SUBSCRIPTION);
@@ -265,6 +295,9 @@ public:
 
     QStringList normalizeFlags(const QStringList &source) const;
 
+    /** @short How much of the mailbox synchronization was avoided by trusting the cached state */
+    const MailboxSyncStatistics &syncStatistics() const { return m_syncStatistics; }
+
     QString imapUser() const;
     void setImapUser(const QString &imapUser);
     QString imapPassword() const;
@@ -287,6 +320,23 @@ public:
 
     void setNumberRefreshInterval(const int interval);
 
+    /** @short Wait for @arg msecs of quiet before asking the server for message counts
+
+    Views typically ask for the number of messages of every mailbox which they paint. When the user scrolls through
+    a huge mailbox tree, that would mean sending a STATUS command for each row which has ever been visible, even
+    for a short time. With a non-zero delay, the requests are collected until no new ones have been made for
+    that long, and only then the filter set through setMessageCountFilter() decides which of them are still
+    worth sending. In the meanwhile, the numbers which were saved in the cache are used.
+
+    The default value is zero which means that the server is asked right away.
+    */
+    void setMessageCountDelay(const int msecs);
+    /** @short Function which says whether a delayed request for message counts of a mailbox shall be sent
+
+    Requests which get rejected are forgotten; they will be made again when somebody asks for the numbers later.
+    */
+    void setMessageCountFilter(const std::function<bool(const QModelIndex &)> &filter);
+
 public slots:
     /** @short Ask for an updated list of mailboxes on the server */
     void reloadMailboxList();
@@ -312,6 +362,14 @@ public slots:
 
     QString imapAuthError() const;
 
+    /** @short Get ready for the application exit
+
+    Logs out from all servers and writes out the pending cache updates. The mailbox tree is not going to be freed item
+    by item when the Model gets destroyed afterwards; the OS will reclaim all of that memory at once when the process
+    exits, which is way faster than millions of individual deallocations. Only call this right before quitting.
+    */
+    void prepareForExit();
+
 private slots:
     /** @short Helper for low-level state change propagation */
     void handleSocketStateChanged(Imap::Parser *parser, Imap::ConnectionState state);
@@ -407,6 +465,9 @@ signals:
 
     void mailboxFirstUnseenMessage(const QModelIndex &maillbox, const QModelIndex &message);
 
+    /** @short The server has reported the current flags of a message, no matter whether they have changed */
+    void messageFlagsReceived(const QString &mailbox, uint uid, const QStringList &flags);
+
     /** @short Threading has arrived */
     void threadingAvailable(const QModelIndex &mailbox, const QByteArray &algorithm,
                             const QStringList &searchCriteria, const QVector<Imap::Responses::ThreadingNode> &mapping);
@@ -443,6 +504,7 @@ private:
     friend class UpdateFlagsTask;
     friend class UpdateFlagsOfAllMessagesTask;
     friend class ListChildMailboxesTask;
+    friend class ListSubscribedMailboxesTask;
     friend class NumberOfMessagesTask;
     friend class FetchMsgMetadataTask;
     friend class ExpungeMailboxTask;
@@ -466,6 +528,9 @@ private:
     friend class SubscribeUnsubscribeTask;
     friend class GenUrlAuthTask;
     friend class UidSubmitTask;
+    friend class MultiMailboxSearchTask;
+    friend class FetchSearchHitsTask;
+    friend class SearchMailboxesTask;
 
     friend class TestingTaskFactory; // needs access to socketFactory
     friend class DummyNetworkWatcher; // needs access to the network policy manipulation
@@ -475,6 +540,7 @@ private:
     friend class ::FakeCapabilitiesInjector; // for injecting fake capabilities
     friend class ::ImapModelIdleTest; // needs access to findTaskResponsibleFor() for IDLE testing
     friend class TaskPresentationModel; // needs access to the ParserState
+    friend class MultiMailboxSearchModel; // needs access to taskFactory, findMailboxByName and findMessagesByUids
     friend class ::LibMailboxSync; // needs access to accessParser/ParserState
 
     friend class Composer::ImapMessageAttachmentItem; // needs access to findMailboxByName and findMessagesByUids
@@ -484,11 +550,18 @@ private:
     void askForChildrenOfMailbox(TreeItemMailbox *item, bool forceReload);
     void askForMessagesInMailbox(TreeItemMsgList *item);
     void askForNumberOfMessages(TreeItemMsgList *item);
+    void askForSubscribedMailboxes();
+
+    void setSubscribedMailboxes(const QList<QPair<QString, QString>> &mailboxes);
+    void subscribedMailboxesUnavailable();
+    void updateSubscription(const QString &mailboxName, const bool subscribed);
+    void addSubscribedDescendant(const QString &mailbox, const QString &separator, const int delta);
 
     typedef enum {PRELOAD_PER_POLICY, PRELOAD_DISABLED} PreloadingMode;
 
     void askForMsgMetadata(TreeItemMessage *item, PreloadingMode preloadMode);
     void askForMsgPart(TreeItemPart *item, bool onlyFromCache=false);
+    void askForMsgPartPreview(TreeItemPart *item);
 
     void finalizeList(Parser *parser, TreeItemMailbox *const mailboxPtr);
     void finalizeIncrementalList(Parser *parser, const QString &parentMailboxName);
@@ -501,12 +574,29 @@ private:
     TreeItem *translatePtr(const QModelIndex &index) const;
 
     void emitMessageCountChanged(TreeItemMailbox *const mailbox);
+    /** @short Announce a change of the message, perhaps together with changes of its neighbors at the end of this batch of responses */
+    void queueDataChanged(TreeItemMessage *const message);
+    /** @short Call emitMessageCountChanged() for this mailbox, but at most once per batch of responses */
+    void queueMessageCountChanged(TreeItemMailbox *const mailbox);
+    /** @short Postpone whatever gets queued by queueDataChanged() until the matching endBatchedChanges() */
+    void beginBatchedChanges();
+    void endBatchedChanges();
+    /** @short Deliver the queued changes, then start inserting rows
+
+    The queued changes refer to row numbers, so they have to be announced before anything moves around, and not from
+    within the insertion. This hides QAbstractItemModel::beginInsertRows() on purpose.
+    */
+    void beginInsertRows(const QModelIndex &parent, int first, int last);
+    /** @short Deliver the queued changes, then start removing rows, see beginInsertRows() */
+    void beginRemoveRows(const QModelIndex &parent, int first, int last);
 
     TreeItemMailbox *findMailboxByName(const QString &name) const;
     TreeItemMailbox *findMailboxByName(const QString &name, const TreeItemMailbox *const root) const;
     TreeItemMailbox *findParentMailboxByName(const QString &name) const;
     QList<TreeItemMessage *> findMessagesByUids(const TreeItemMailbox *const mailbox, const Imap::Uids &uids);
+    QList<TreeItemMessage *> findMessagesByUids(const TreeItemMailbox *const mailbox, const Imap::Sequence &uids);
     TreeItemChildrenList::iterator findMessageOrNextOneByUid(TreeItemMsgList *list, const uint uid);
+    TreeItemMessage *findUnreadMessageByUid(TreeItemMsgList *list, const uint uid);
 
     static TreeItemMailbox *mailboxForSomeItem(QModelIndex index);
 
@@ -578,13 +668,47 @@ private:
 
     QTimer *m_periodicMailboxNumbersRefresh;
 
+    /** @short Waits for the scrolling to settle before asking for the delayed message counts */
+    QTimer *m_delayedMessageCounts;
+    QList<QPersistentModelIndex> m_pendingMessageCounts;
+    std::function<bool(const QModelIndex &)> m_messageCountFilter;
+
     QStringList m_capabilitiesBlacklist;
 
+    MailboxSyncStatistics m_syncStatistics;
+
+    /** @short Progress of the LSUB which obtains the whole subscription list */
+    enum class SubscriptionsState {
+        NOT_REQUESTED,
+        LOADING,
+        UNAVAILABLE,
+        LOADED,
+    };
+    SubscriptionsState m_subscriptionsState;
+    /** @short Are the m_subscribedMailboxes and m_subscribedDescendants usable, perhaps while a fresher copy is on its way? */
+    bool m_subscriptionsKnown;
+    /** @short Names of all subscribed mailboxes */
+    QSet<QString> m_subscribedMailboxes;
+    /** @short How many subscribed mailboxes are nested, at any depth, below a mailbox of the given name */
+    QHash<QString, int> m_subscribedDescendants;
+
+    /** @short How many batches of changes, such as calls to responseReceived(), are running right now */
+    int m_responseBatchDepth;
+    /** @short Rows of messages which have changed during the current batch of responses */
+    QHash<TreeItemMsgList *, QVector<int>> m_queuedMessageChanges;
+    /** @short Mailboxes whose message counts might have changed during the current batch of responses */
+    QList<TreeItemMailbox *> m_queuedMessageCountChanges;
+
+    /** @short Shall the mailbox tree be left for the OS to reclaim? See prepareForExit(). */
+    bool m_skipTreeDestruction;
+
 protected slots:
     void responseReceived();
     void responseReceived(Imap::Parser *parser);
     void askForChildrenOfMailbox(const QModelIndex &index, const Imap::Mailbox::CacheLoadingMode cacheMode);
     void askForMessagesInMailbox(const QModelIndex &index);
+    void sendDelayedMessageCountRequests();
+    void emitQueuedDataChanged();
 
     void runReadyTasks();
 
@@ -0,0 +1,427 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MultiMailboxSearchModel.h"
+#include <QTimer>
+#include "ItemRoles.h"
+#include "MailboxTree.h"
+#include "SpecialFlagNames.h"
+#include "TaskFactory.h"
+#include "Imap/Tasks/FetchSearchHitsTask.h"
+#include "Imap/Tasks/MultiMailboxSearchTask.h"
+#include "Imap/Tasks/SearchMailboxesTask.h"
+
+namespace {
+
+/** @short How many mailboxes are searched in parallel when the server does not support MULTISEARCH */
+const int MAX_PARALLEL_SEARCHES = 3;
+
+}
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+MultiMailboxSearchModel::MultiMailboxSearchModel(QObject *parent, Model *model)
+    : QAbstractListModel(parent)
+    , m_model(model)
+    , m_searching(false)
+{
+    Q_ASSERT(m_model);
+    connect(m_model, &Model::mailboxSyncingProgress, this, &MultiMailboxSearchModel::slotMailboxSyncingProgress);
+    connect(m_model, &QAbstractItemModel::dataChanged, this, &MultiMailboxSearchModel::slotDataChanged);
+}
+
+MultiMailboxSearchModel::~MultiMailboxSearchModel()
+{
+    stopSearchTasks();
+    if (m_fetchTask)
+        m_fetchTask->stop();
+}
+
+void MultiMailboxSearchModel::search(const QStringList &mailboxes, const QStringList &searchConditions)
+{
+    cancel();
+    if (m_fetchTask) {
+        m_fetchTask->disconnect(this);
+        m_fetchTask->stop();
+        m_fetchTask = 0;
+    }
+    beginResetModel();
+    m_hits.clear();
+    m_rowsByMailbox.clear();
+    m_metadata.clear();
+    m_pendingMetadata.clear();
+    m_syncRequested.clear();
+    endResetModel();
+    m_searching = true;
+
+    if (m_model->capabilities().contains(QStringLiteral("MULTISEARCH"))) {
+        MultiMailboxSearchTask *task = m_model->m_taskFactory->createMultiMailboxSearchTask(m_model, mailboxes, searchConditions);
+        connect(task, &MultiMailboxSearchTask::matchesFound, this, &MultiMailboxSearchModel::slotMatchesFound);
+        connect(task, &ImapTask::completed, this, &MultiMailboxSearchModel::finish);
+        connect(task, &ImapTask::failed, this, &MultiMailboxSearchModel::slotSearchFailed);
+        m_task = task;
+        return;
+    }
+
+    // Each mailbox has to be examined and searched on its own, so only those which are already known can be found
+    m_pendingMailboxes.clear();
+    Q_FOREACH(const QString &name, mailboxes) {
+        TreeItemMailbox *mailboxPtr = m_model->findMailboxByName(name);
+        if (!mailboxPtr)
+            continue;
+        QList<QModelIndex> pending;
+        pending << mailboxPtr->toIndex(m_model);
+        while (!pending.isEmpty()) {
+            QModelIndex mailbox = pending.takeFirst();
+            const QString mailboxName = mailbox.data(RoleMailboxName).toString();
+            if (mailbox.data(RoleMailboxIsSelectable).toBool() && !m_pendingMailboxes.contains(mailboxName))
+                m_pendingMailboxes << mailboxName;
+            // The first child is the list of messages
+            for (int i = 1; i < m_model->rowCount(mailbox); ++i)
+                pending << m_model->index(i, 0, mailbox);
+        }
+    }
+
+    if (m_pendingMailboxes.isEmpty()) {
+        finish();
+        return;
+    }
+
+    // Each task gets another mailbox once it is done with the previous one
+    for (int i = 0; i < MAX_PARALLEL_SEARCHES && !m_pendingMailboxes.isEmpty(); ++i) {
+        SearchMailboxesTask *task = m_model->m_taskFactory->createSearchMailboxesTask(m_model, searchConditions);
+        connect(task, &SearchMailboxesTask::mailboxSearched, this,
+                [this, task](const QString &mailbox, const uint uidValidity, const Imap::Uids &uids) {
+            slotMailboxSearched(task, mailbox, uidValidity, uids);
+        });
+        connect(task, &ImapTask::failed, this, [this, task](const QString &message) {
+            slotSearchTaskFailed(task, message);
+        });
+        m_searchTasks << task;
+        task->searchMailbox(m_pendingMailboxes.takeFirst());
+    }
+}
+
+void MultiMailboxSearchModel::cancel()
+{
+    if (m_task)
+        m_task->disconnect(this);
+    m_task = 0;
+    stopSearchTasks();
+    m_searching = false;
+}
+
+/** @short Close the connections of the tasks which search the individual mailboxes */
+void MultiMailboxSearchModel::stopSearchTasks()
+{
+    m_pendingMailboxes.clear();
+    Q_FOREACH(const QPointer<SearchMailboxesTask> &task, m_searchTasks) {
+        if (task) {
+            task->disconnect(this);
+            task->stop();
+        }
+    }
+    m_searchTasks.clear();
+}
+
+bool MultiMailboxSearchModel::isSearching() const
+{
+    return m_searching;
+}
+
+void MultiMailboxSearchModel::slotMailboxSearched(SearchMailboxesTask *task, const QString &mailbox, const uint uidValidity,
+                                                  const Imap::Uids &uids)
+{
+    // A mailbox which cannot be searched shall not prevent searching the other ones
+    if (uidValidity)
+        slotMatchesFound(mailbox, uidValidity, uids);
+
+    if (!m_pendingMailboxes.isEmpty()) {
+        task->searchMailbox(m_pendingMailboxes.takeFirst());
+        return;
+    }
+
+    task->disconnect(this);
+    task->stop();
+    m_searchTasks.removeOne(task);
+    if (m_searchTasks.isEmpty())
+        finish();
+}
+
+void MultiMailboxSearchModel::slotSearchTaskFailed(SearchMailboxesTask *task, const QString &message)
+{
+    // The mailbox which this task was searching is lost, but the other tasks can go on
+    task->disconnect(this);
+    m_searchTasks.removeOne(task);
+    if (!m_searchTasks.isEmpty())
+        return;
+
+    if (m_pendingMailboxes.isEmpty()) {
+        finish();
+    } else {
+        // Nobody is left to search the remaining mailboxes
+        m_pendingMailboxes.clear();
+        slotSearchFailed(message);
+    }
+}
+
+void MultiMailboxSearchModel::slotMatchesFound(const QString &mailbox, const uint uidValidity, const Imap::Uids &uids)
+{
+    if (uids.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), m_hits.size(), m_hits.size() + uids.size() - 1);
+    m_hits.reserve(m_hits.size() + uids.size());
+    QHash<uint, int> &rows = m_rowsByMailbox[mailbox];
+    Q_FOREACH(const uint uid, uids) {
+        Hit hit;
+        hit.mailbox = mailbox;
+        hit.uidValidity = uidValidity;
+        hit.uid = uid;
+        hit.metadataRequested = false;
+        rows[uid] = m_hits.size();
+        m_hits << hit;
+    }
+    endInsertRows();
+}
+
+void MultiMailboxSearchModel::finish()
+{
+    m_task = 0;
+    m_searching = false;
+    emit searchFinished();
+}
+
+void MultiMailboxSearchModel::slotSearchFailed(const QString &message)
+{
+    m_task = 0;
+    m_searching = false;
+    emit searchFailed(message);
+}
+
+int MultiMailboxSearchModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_hits.size();
+}
+
+QModelIndex MultiMailboxSearchModel::messageIndex(const int row) const
+{
+    QModelIndex message = knownMessageIndex(row);
+    if (message.isValid() || row < 0 || row >= m_hits.size())
+        return message;
+
+    const Hit &hit = m_hits[row];
+    TreeItemMailbox *mailboxPtr = m_model->findMailboxByName(hit.mailbox);
+    if (!mailboxPtr)
+        return QModelIndex();
+
+    QModelIndex list = m_model->index(0, 0, mailboxPtr->toIndex(m_model));
+    if (!list.data(RoleIsFetched).toBool() && !m_syncRequested.contains(hit.mailbox)) {
+        // Asking for the number of messages is what makes the Model synchronize the mailbox
+        m_syncRequested.insert(hit.mailbox);
+        m_model->rowCount(list);
+    }
+    return QModelIndex();
+}
+
+/** @short Index of the message in the underlying Model if its mailbox is synchronized already, without any network activity */
+QModelIndex MultiMailboxSearchModel::knownMessageIndex(const int row) const
+{
+    if (row < 0 || row >= m_hits.size())
+        return QModelIndex();
+
+    Hit &hit = m_hits[row];
+    if (hit.message.isValid())
+        return hit.message;
+
+    TreeItemMailbox *mailboxPtr = m_model->findMailboxByName(hit.mailbox);
+    if (!mailboxPtr)
+        return QModelIndex();
+
+    QModelIndex list = m_model->index(0, 0, mailboxPtr->toIndex(m_model));
+    if (!list.data(RoleIsFetched).toBool())
+        return QModelIndex();
+
+    if (mailboxPtr->syncState.uidValidity() != hit.uidValidity)
+        return QModelIndex();
+
+    QList<TreeItemMessage *> messages = m_model->findMessagesByUids(mailboxPtr, Imap::Uids() << hit.uid);
+    if (messages.isEmpty())
+        return QModelIndex();
+    hit.message = messages.front()->toIndex(m_model);
+    return hit.message;
+}
+
+QVariant MultiMailboxSearchModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.model() != this || index.row() >= m_hits.size())
+        return QVariant();
+
+    const Hit &hit = m_hits[index.row()];
+    switch (role) {
+    case RoleMailboxName:
+    case Qt::ToolTipRole:
+        return hit.mailbox;
+    case RoleMailboxUidValidity:
+        return hit.uidValidity;
+    case RoleMessageUid:
+        return hit.uid;
+    }
+
+    QModelIndex message = knownMessageIndex(index.row());
+    if (message.isValid() && message.data(RoleIsFetched).toBool()) {
+        // The Model has everything already
+        return message.data(role == Qt::DisplayRole ? static_cast<int>(RoleMessageSubject) : role);
+    }
+
+    auto metadata = m_metadata.constFind(index.row());
+    if (metadata == m_metadata.constEnd()) {
+        requestMetadata(index.row());
+        return role == Qt::DisplayRole ? QVariant(tr("Message %1 in %2").arg(QString::number(hit.uid), hit.mailbox)) : QVariant();
+    }
+
+    const Message::Envelope &envelope = metadata->data.envelope;
+    switch (role) {
+    case Qt::DisplayRole:
+    case RoleMessageSubject:
+        return envelope.subject;
+    case RoleMessageDate:
+        return envelope.date;
+    case RoleMessageFrom:
+        return TreeItemMessage::addresListToQVariant(envelope.from);
+    case RoleMessageTo:
+        return TreeItemMessage::addresListToQVariant(envelope.to);
+    case RoleMessageMessageId:
+        return envelope.messageId;
+    case RoleMessageEnvelope:
+        return QVariant::fromValue<Message::Envelope>(envelope);
+    case RoleMessageInternalDate:
+        return metadata->data.internalDate;
+    case RoleMessageSize:
+        return QVariant::fromValue(metadata->data.size);
+    case RoleMessageFlags:
+        return metadata->flags;
+    case RoleMessageIsMarkedRead:
+        return metadata->flags.contains(FlagNames::seen);
+    case RoleMessageIsMarkedFlagged:
+        return metadata->flags.contains(FlagNames::flagged);
+    }
+    return QVariant();
+}
+
+/** @short Ask for the metadata of a message which is going to be shown */
+void MultiMailboxSearchModel::requestMetadata(const int row) const
+{
+    Hit &hit = m_hits[row];
+    if (hit.metadataRequested)
+        return;
+    hit.metadataRequested = true;
+
+    // A view asks for all the visible rows at once, so let's send them together
+    if (m_pendingMetadata.isEmpty())
+        QTimer::singleShot(0, const_cast<MultiMailboxSearchModel *>(this), &MultiMailboxSearchModel::requestPendingMetadata);
+    m_pendingMetadata << row;
+}
+
+void MultiMailboxSearchModel::requestPendingMetadata()
+{
+    if (m_pendingMetadata.isEmpty())
+        return;
+
+    if (!m_fetchTask || m_fetchTask->isFinished()) {
+        m_fetchTask = m_model->m_taskFactory->createFetchSearchHitsTask(m_model);
+        connect(m_fetchTask.data(), &FetchSearchHitsTask::metadataAvailable, this, &MultiMailboxSearchModel::slotMetadataAvailable);
+    }
+
+    QMap<QPair<QString, uint>, Imap::Uids> requests;
+    Q_FOREACH(const int row, m_pendingMetadata) {
+        const Hit &hit = m_hits[row];
+        requests[qMakePair(hit.mailbox, hit.uidValidity)] << hit.uid;
+    }
+    m_pendingMetadata.clear();
+    for (auto it = requests.constBegin(); it != requests.constEnd(); ++it)
+        m_fetchTask->requestMetadata(it.key().first, it.key().second, it.value());
+}
+
+void MultiMailboxSearchModel::slotMetadataAvailable(const QString &mailbox, const uint uidValidity,
+                                                    const Imap::Mailbox::AbstractCache::MessageDataBundle &data,
+                                                    const QStringList &flags)
+{
+    auto rows = m_rowsByMailbox.constFind(mailbox);
+    if (rows == m_rowsByMailbox.constEnd())
+        return;
+    auto row = rows->constFind(data.uid);
+    if (row == rows->constEnd() || m_hits[*row].uidValidity != uidValidity)
+        return;
+
+    HitMetadata &metadata = m_metadata[*row];
+    metadata.data = data;
+    metadata.flags = flags;
+    emit dataChanged(index(*row), index(*row));
+}
+
+void MultiMailboxSearchModel::slotMailboxSyncingProgress(const QModelIndex &mailbox, Imap::Mailbox::MailboxSyncingProgress state)
+{
+    if (state != STATE_DONE)
+        return;
+
+    auto rows = m_rowsByMailbox.constFind(mailbox.data(RoleMailboxName).toString());
+    if (rows == m_rowsByMailbox.constEnd())
+        return;
+
+    // The hits from this mailbox can be resolved now
+    int first = m_hits.size(), last = -1;
+    Q_FOREACH(const int row, *rows) {
+        first = qMin(first, row);
+        last = qMax(last, row);
+    }
+    emit dataChanged(index(first), index(last));
+}
+
+void MultiMailboxSearchModel::slotDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (m_rowsByMailbox.isEmpty() || !dynamic_cast<TreeItemMessage *>(Model::realTreeItem(topLeft)))
+        return;
+
+    // The metadata of some messages have arrived
+    const QModelIndex list = topLeft.parent();
+    auto rows = m_rowsByMailbox.constFind(list.parent().data(RoleMailboxName).toString());
+    if (rows == m_rowsByMailbox.constEnd())
+        return;
+
+    int first = -1, last = -1;
+    Q_FOREACH(const int row, *rows) {
+        const QPersistentModelIndex &message = m_hits[row].message;
+        if (message.isValid() && message.parent() == list && message.row() >= topLeft.row() && message.row() <= bottomRight.row()) {
+            first = first == -1 ? row : qMin(first, row);
+            last = qMax(last, row);
+        }
+    }
+    if (first != -1)
+        emit dataChanged(index(first), index(last));
+}
+
+}
+}
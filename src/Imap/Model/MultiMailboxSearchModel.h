@@ -0,0 +1,137 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAP_MODEL_MULTIMAILBOXSEARCHMODEL_H
+#define IMAP_MODEL_MULTIMAILBOXSEARCHMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPersistentModelIndex>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include "Model.h"
+
+namespace Imap
+{
+
+namespace Mailbox
+{
+
+class FetchSearchHitsTask;
+class ImapTask;
+class SearchMailboxesTask;
+
+/** @short Results of a search which spans several mailboxes
+
+When the server supports the RFC 7377 MULTISEARCH extension, a single ESEARCH command covers the requested mailboxes
+along with all their descendants, and the matches are appended to this model as soon as they arrive. Otherwise, the
+mailboxes which have already been listed are EXAMINEd and searched through SearchMailboxesTask, over a few dedicated
+connections in parallel. Neither way touches the mailbox which is open on the main connection.
+
+Each row only refers to a message through its mailbox and UID. When a view asks for the row's data, only the metadata of
+that message are downloaded through a FetchSearchHitsTask, so the mailboxes with the hits do not have to be synchronized
+and nothing is downloaded for the hits which never get shown. The mailbox is synchronized only when a message is about
+to be opened, see messageIndex().
+*/
+class MultiMailboxSearchModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    MultiMailboxSearchModel(QObject *parent, Model *model);
+    virtual ~MultiMailboxSearchModel();
+
+    /** @short Search in the passed mailboxes and their child mailboxes, discarding the previous results */
+    void search(const QStringList &mailboxes, const QStringList &searchConditions);
+    /** @short Stop waiting for any further results */
+    void cancel();
+    bool isSearching() const;
+
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index, int role) const;
+
+    /** @short Index of the message in the underlying Model, or an invalid index when it is not available (yet)
+
+    The message's mailbox gets synchronized when it is not known yet, so this should only be called when the message is
+    actually going to be opened.
+    */
+    QModelIndex messageIndex(const int row) const;
+
+signals:
+    void searchFinished();
+    void searchFailed(const QString &message);
+
+private slots:
+    void slotMatchesFound(const QString &mailbox, const uint uidValidity, const Imap::Uids &uids);
+    void slotSearchFailed(const QString &message);
+    void slotMailboxSyncingProgress(const QModelIndex &mailbox, Imap::Mailbox::MailboxSyncingProgress state);
+    void slotDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void slotMetadataAvailable(const QString &mailbox, const uint uidValidity,
+                               const Imap::Mailbox::AbstractCache::MessageDataBundle &data, const QStringList &flags);
+    void requestPendingMetadata();
+
+private:
+    void slotMailboxSearched(SearchMailboxesTask *task, const QString &mailbox, const uint uidValidity, const Imap::Uids &uids);
+    void slotSearchTaskFailed(SearchMailboxesTask *task, const QString &message);
+    void stopSearchTasks();
+    void finish();
+    QModelIndex knownMessageIndex(const int row) const;
+    void requestMetadata(const int row) const;
+
+    struct Hit {
+        QString mailbox;
+        uint uidValidity;
+        uint uid;
+        QPersistentModelIndex message;
+        bool metadataRequested;
+    };
+
+    struct HitMetadata {
+        AbstractCache::MessageDataBundle data;
+        QStringList flags;
+    };
+
+    Model *m_model;
+    /** @short The matching messages; their indexes are resolved lazily */
+    mutable QVector<Hit> m_hits;
+    /** @short Rows of the hits, indexed by their mailbox and UID */
+    QHash<QString, QHash<uint, int>> m_rowsByMailbox;
+    /** @short Metadata of the hits which were downloaded without synchronizing their mailbox, indexed by row */
+    QHash<int, HitMetadata> m_metadata;
+    /** @short Rows whose metadata shall be requested once the control returns to the event loop */
+    mutable QVector<int> m_pendingMetadata;
+    mutable QPointer<FetchSearchHitsTask> m_fetchTask;
+    /** @short Mailboxes whose synchronization has been triggered by this model */
+    mutable QSet<QString> m_syncRequested;
+    /** @short Mailboxes which remain to be searched when the server does not support MULTISEARCH */
+    QStringList m_pendingMailboxes;
+    /** @short Tasks which search the individual mailboxes when the server does not support MULTISEARCH */
+    QList<QPointer<SearchMailboxesTask>> m_searchTasks;
+    QPointer<ImapTask> m_task;
+    bool m_searching;
+};
+
+}
+}
+
+#endif // IMAP_MODEL_MULTIMAILBOXSEARCHMODEL_H
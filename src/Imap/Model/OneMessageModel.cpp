@@ -229,11 +229,11 @@ void OneMessageModel::setMarkedRead(const bool marked)
 
 void OneMessageModel::handleModelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
-    Q_ASSERT(topLeft.row() == bottomRight.row());
     Q_ASSERT(topLeft.parent() == bottomRight.parent());
     Q_ASSERT(topLeft.model() == bottomRight.model());
 
-    if (m_message.isValid() && topLeft == m_message)
+    if (m_message.isValid() && m_message.parent() == topLeft.parent()
+            && m_message.row() >= topLeft.row() && m_message.row() <= bottomRight.row())
         emit flagsChanged();
 }
 
@@ -49,6 +49,10 @@ struct ParserState {
     QStringList capabilities;
     /** @short Is the @arg capabilities usable? */
     bool capabilitiesFresh;
+    /** @short Has the RFC 9586 UIDONLY mode been requested, i.e. are the message sequence numbers gone? */
+    bool uidOnly;
+    /** @short Is this connection dedicated to a single task, so that it must not be used for anything else? */
+    bool isReserved;
     /** @short LIST responses which were not processed yet */
     QList<Responses::List> listResponses;
 
@@ -149,8 +149,8 @@ bool PrettyMailboxModel::filterAcceptsRow(int source_row, const QModelIndex &sou
     QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
     Q_ASSERT(index.isValid());
 
-    // FIXME: walk the tree resursively from here instead of just checking for children
-    return index.data(RoleMailboxIsSubscribed).toBool() || sourceModel()->hasChildren(index);
+    // Both roles are answered from the Model's subscription list, so this neither recurses nor talks to the server
+    return index.data(RoleMailboxIsSubscribed).toBool() || index.data(RoleMailboxHasSubscribedDescendants).toBool();
 }
 
 bool PrettyMailboxModel::hasChildren(const QModelIndex &parent) const
@@ -21,8 +21,10 @@
 */
 
 #include "SQLCache.h"
+#include <algorithm>
 #include <QSqlError>
 #include <QSqlRecord>
+#include <QSet>
 #include <QTimer>
 #include "Common/SqlTransactionAutoAborter.h"
 
@@ -203,6 +205,12 @@ bool SQLCache::open(const QString &name, const QString &fileName)
         return false;
     }
 
+    // The index is only used for cache expiry and it's not a part of the data format, so it doesn't need a new DB version
+    if (!q.exec(QStringLiteral("CREATE INDEX IF NOT EXISTS msg_metadata_lastAccessDate ON msg_metadata (lastAccessDate)"))) {
+        emitError(QObject::tr("Can't create index on msg_metadata"), q);
+        return false;
+    }
+
     txn.commit();
 
     if (! prepareQueries()) {
@@ -362,6 +370,12 @@ bool SQLCache::prepareQueries()
         return false;
     }
 
+    queryAllMessageFlags = QSqlQuery(db);
+    if (! queryAllMessageFlags.prepare(QStringLiteral("SELECT uid, flags FROM flags WHERE mailbox = ?"))) {
+        emitError(QObject::tr("Failed to prepare queryAllMessageFlags"), queryAllMessageFlags);
+        return false;
+    }
+
     queryClearAllMessages1 = QSqlQuery(db);
     if (! queryClearAllMessages1.prepare(QStringLiteral("DELETE FROM msg_metadata WHERE mailbox = ?"))) {
         emitError(QObject::tr("Failed to prepare queryClearAllMessages1"), queryClearAllMessages1);
@@ -434,6 +448,14 @@ bool SQLCache::prepareQueries()
         return false;
     }
 
+    queryExpiredMessages = QSqlQuery(db);
+    if (!queryExpiredMessages.prepare(QStringLiteral("SELECT m.mailbox, m.uid, LENGTH(m.data) + "
+                                                     "IFNULL((SELECT SUM(LENGTH(p.data)) FROM parts p WHERE p.mailbox = m.mailbox AND p.uid = m.uid), 0) "
+                                                     "FROM msg_metadata m WHERE m.lastAccessDate < ? LIMIT ?"))) {
+        emitError(QObject::tr("Failed to prepare queryExpiredMessages"), queryExpiredMessages);
+        return false;
+    }
+
 #ifdef CACHE_DEBUG
     qDebug() << "SQLCache::_prepareQueries() succeeded";
 #endif
@@ -687,6 +709,52 @@ void SQLCache::setMsgFlags(const QString &mailbox, const uint uid, const QString
     }
 }
 
+void SQLCache::addMsgFlag(const QString &mailbox, const Imap::Uids &uids, const QString &flag)
+{
+#ifdef CACHE_DEBUG
+    qDebug() << "Adding flag" << flag << "to" << uids.size() << "messages in" << mailbox;
+#endif
+    // Read all flags of the mailbox at once and write back just the changed rows in a single batch
+    Imap::Uids sortedUids = uids;
+    std::sort(sortedUids.begin(), sortedUids.end());
+    queryAllMessageFlags.bindValue(0, mailboxName(mailbox));
+    if (! queryAllMessageFlags.exec()) {
+        emitError(QObject::tr("Query queryAllMessageFlags failed"), queryAllMessageFlags);
+        return;
+    }
+    QVariantList mailboxFields, uidFields, flagsFields;
+    while (queryAllMessageFlags.next()) {
+        const uint uid = queryAllMessageFlags.value(0).toUInt();
+        if (!std::binary_search(sortedUids.constBegin(), sortedUids.constEnd(), uid))
+            continue;
+        QStringList flags;
+        QDataStream input(queryAllMessageFlags.value(1).toByteArray());
+        input.setVersion(streamVersion);
+        input >> flags;
+        if (flags.contains(flag))
+            continue;
+        flags << flag;
+        QByteArray buf;
+        QDataStream stream(&buf, QIODevice::ReadWrite);
+        stream.setVersion(streamVersion);
+        stream << flags;
+        mailboxFields << mailboxName(mailbox);
+        uidFields << uid;
+        flagsFields << buf;
+    }
+    queryAllMessageFlags.finish();
+    if (uidFields.isEmpty())
+        return;
+
+    touchingDB();
+    querySetMessageFlags.bindValue(0, mailboxFields);
+    querySetMessageFlags.bindValue(1, uidFields);
+    querySetMessageFlags.bindValue(2, flagsFields);
+    if (! querySetMessageFlags.execBatch()) {
+        emitError(QObject::tr("Query querySetMessageFlags failed"), querySetMessageFlags);
+    }
+}
+
 AbstractCache::MessageDataBundle SQLCache::messageMetadata(const QString &mailbox, uint uid) const
 {
     AbstractCache::MessageDataBundle res;
@@ -821,6 +889,43 @@ void SQLCache::setMessageThreading(const QString &mailbox, const QVector<Imap::R
 
 }
 
+QVector<QPair<QString, uint> > SQLCache::expireMessages(const QDate &date, const int limit, quint64 *reclaimedBytes)
+{
+    Q_ASSERT(reclaimedBytes);
+    QVector<QPair<QString, uint> > res;
+    queryExpiredMessages.bindValue(0, accessingThresholdDate.daysTo(date) - m_updateAccessIfOlder);
+    queryExpiredMessages.bindValue(1, limit);
+    if (!queryExpiredMessages.exec()) {
+        emitError(QObject::tr("Query queryExpiredMessages failed"), queryExpiredMessages);
+        return res;
+    }
+    while (queryExpiredMessages.next()) {
+        res << qMakePair(queryExpiredMessages.value(0).toString(), queryExpiredMessages.value(1).toUInt());
+        *reclaimedBytes += queryExpiredMessages.value(2).toULongLong();
+    }
+    queryExpiredMessages.finish();
+
+    if (res.isEmpty())
+        return res;
+
+#ifdef CACHE_DEBUG
+    qDebug() << "Expiring" << res.size() << "messages";
+#endif
+    QSet<QString> mailboxes;
+    for (auto it = res.constBegin(); it != res.constEnd(); ++it) {
+        clearMessage(it->first, it->second);
+        mailboxes.insert(it->first);
+    }
+    // The threading refers to messages which we no longer know anything about
+    Q_FOREACH(const QString &mailbox, mailboxes) {
+        queryClearAllMessages4.bindValue(0, mailbox);
+        if (!queryClearAllMessages4.exec()) {
+            emitError(QObject::tr("Query queryClearAllMessages4 failed"), queryClearAllMessages4);
+        }
+    }
+    return res;
+}
+
 void SQLCache::touchingDB()
 {
     delayedCommit->start();
@@ -845,6 +950,13 @@ void SQLCache::timeToCommit()
     }
 }
 
+void SQLCache::flush()
+{
+    delayedCommit->stop();
+    tooMuchTimeWithoutCommit->stop();
+    timeToCommit();
+}
+
 void SQLCache::setRenewalThreshold(const int days)
 {
     m_updateAccessIfOlder = days;
@@ -96,6 +96,7 @@ public:
 
     virtual QStringList msgFlags(const QString &mailbox, const uint uid) const;
     virtual void setMsgFlags(const QString &mailbox, const uint uid, const QStringList &flags);
+    virtual void addMsgFlag(const QString &mailbox, const Imap::Uids &uids, const QString &flag);
 
     virtual QByteArray messagePart(const QString &mailbox, const uint uid, const QByteArray &partId) const;
     virtual void setMsgPart(const QString &mailbox, const uint uid, const QByteArray &partId, const QByteArray &data);
@@ -109,6 +110,19 @@ public:
 
     virtual void setRenewalThreshold(const int days);
 
+    virtual void flush();
+
+    /** @short Remove up to @arg limit messages which have not been accessed since @arg date
+
+    Because the "last accessed" timestamp is only updated once per the renewal threshold, the actual cutoff is moved back by
+    that threshold so that recently accessed messages are never removed.
+
+    All data for the affected messages is removed, as are the cached threading information of their mailboxes. The removed
+    messages are returned so that the caller can purge any data stored outside of the database. The size of the removed
+    data is added to the @arg reclaimedBytes.
+    */
+    QVector<QPair<QString, uint> > expireMessages(const QDate &date, const int limit, quint64 *reclaimedBytes);
+
 private:
     /** @short Broadcast an error from the SQL query */
     void emitError(const QString &message, const QSqlQuery &query) const;
@@ -154,6 +168,7 @@ private:
     mutable QSqlQuery querySetMessageMetadata;
     mutable QSqlQuery queryMessageFlags;
     mutable QSqlQuery querySetMessageFlags;
+    mutable QSqlQuery queryAllMessageFlags;
     mutable QSqlQuery queryClearAllMessages1;
     mutable QSqlQuery queryClearAllMessages2;
     mutable QSqlQuery queryClearAllMessages3;
@@ -166,6 +181,7 @@ private:
     mutable QSqlQuery queryForgetMessagePart;
     mutable QSqlQuery queryMessageThreading;
     mutable QSqlQuery querySetMessageThreading;
+    mutable QSqlQuery queryExpiredMessages;
 
     std::unique_ptr<QTimer> delayedCommit;
     std::unique_ptr<QTimer> tooMuchTimeWithoutCommit;
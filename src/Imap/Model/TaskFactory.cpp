@@ -32,15 +32,19 @@
 #include "Imap/Tasks/ExpungeMailboxTask.h"
 #include "Imap/Tasks/FetchMsgMetadataTask.h"
 #include "Imap/Tasks/FetchMsgPartTask.h"
+#include "Imap/Tasks/FetchSearchHitsTask.h"
 #include "Imap/Tasks/GenUrlAuthTask.h"
 #include "Imap/Tasks/GetAnyConnectionTask.h"
 #include "Imap/Tasks/IdTask.h"
 #include "Imap/Tasks/KeepMailboxOpenTask.h"
+#include "Imap/Tasks/MultiMailboxSearchTask.h"
 #include "Imap/Tasks/Fake_ListChildMailboxesTask.h"
 #include "Imap/Tasks/Fake_OpenConnectionTask.h"
+#include "Imap/Tasks/ListSubscribedMailboxesTask.h"
 #include "Imap/Tasks/NumberOfMessagesTask.h"
 #include "Imap/Tasks/ObtainSynchronizedMailboxTask.h"
 #include "Imap/Tasks/OpenConnectionTask.h"
+#include "Imap/Tasks/SearchMailboxesTask.h"
 #include "Imap/Tasks/UidSubmitTask.h"
 #include "Imap/Tasks/UpdateFlagsTask.h"
 #include "Imap/Tasks/UpdateFlagsOfAllMessagesTask.h"
@@ -65,10 +69,10 @@ OpenConnectionTask *TaskFactory::createOpenConnectionTask(Model *model)
     return new OpenConnectionTask(model);
 }
 
-CopyMoveMessagesTask *TaskFactory::createCopyMoveMessagesTask(Model *model, const QModelIndexList &messages,
+CopyMoveMessagesTask *TaskFactory::createCopyMoveMessagesTask(Model *model, const QModelIndex &mailbox, const Imap::Sequence &uids,
         const QString &targetMailbox, const CopyMoveOperation op)
 {
-    return new CopyMoveMessagesTask(model, messages, targetMailbox, op);
+    return new CopyMoveMessagesTask(model, mailbox, uids, targetMailbox, op);
 }
 
 CreateMailboxTask *TaskFactory::createCreateMailboxTask(Model *model, const QString &mailbox)
@@ -138,14 +142,16 @@ UpdateFlagsOfAllMessagesTask *TaskFactory::createUpdateFlagsOfAllMessagesTask(Mo
     return new UpdateFlagsOfAllMessagesTask(model, mailbox, flagOperation, flags);
 }
 
-UpdateFlagsTask *TaskFactory::createUpdateFlagsTask(Model *model, const QModelIndexList &messages, const FlagsOperation flagOperation, const QString &flags)
+UpdateFlagsTask *TaskFactory::createUpdateFlagsTask(Model *model, const QModelIndex &mailbox, const Imap::Sequence &uids,
+                                                    const FlagsOperation flagOperation, const QString &flags)
 {
-    return new UpdateFlagsTask(model, messages, flagOperation, flags);
+    return new UpdateFlagsTask(model, mailbox, uids, flagOperation, flags);
 }
 
-UpdateFlagsTask *TaskFactory::createUpdateFlagsTask(Model *model, CopyMoveMessagesTask *copyTask, const QList<QPersistentModelIndex> &messages, const FlagsOperation flagOperation, const QString &flags)
+UpdateFlagsTask *TaskFactory::createUpdateFlagsTask(Model *model, CopyMoveMessagesTask *copyTask, const QModelIndex &mailbox,
+                                                    const Imap::Sequence &uids, const FlagsOperation flagOperation, const QString &flags)
 {
-    return new UpdateFlagsTask(model, copyTask, messages, flagOperation, flags);
+    return new UpdateFlagsTask(model, copyTask, mailbox, uids, flagOperation, flags);
 }
 
 ThreadTask *TaskFactory::createThreadTask(Model *model, const QModelIndex &mailbox, const QByteArray &algorithm, const QStringList &searchCriteria)
@@ -185,6 +191,11 @@ AppendTask *TaskFactory::createAppendTask(Model *model, const QString &targetMai
     return new AppendTask(model, targetMailbox, data, flags, timestamp);
 }
 
+ListSubscribedMailboxesTask *TaskFactory::createListSubscribedMailboxesTask(Model *model)
+{
+    return new ListSubscribedMailboxesTask(model);
+}
+
 SubscribeUnsubscribeTask *TaskFactory::createSubscribeUnsubscribeTask(Model *model, const QString &mailboxName,
                                                                       const SubscribeUnsubscribeOperation operation)
 {
@@ -208,6 +219,22 @@ UidSubmitTask *TaskFactory::createUidSubmitTask(Model *model, const QString &mai
     return new UidSubmitTask(model, mailbox, uidValidity, uid, submitOptions);
 }
 
+MultiMailboxSearchTask *TaskFactory::createMultiMailboxSearchTask(Model *model, const QStringList &mailboxes,
+                                                                  const QStringList &searchConditions)
+{
+    return new MultiMailboxSearchTask(model, mailboxes, searchConditions);
+}
+
+FetchSearchHitsTask *TaskFactory::createFetchSearchHitsTask(Model *model)
+{
+    return new FetchSearchHitsTask(model);
+}
+
+SearchMailboxesTask *TaskFactory::createSearchMailboxesTask(Model *model, const QStringList &searchConditions)
+{
+    return new SearchMailboxesTask(model, searchConditions);
+}
+
 TestingTaskFactory::TestingTaskFactory(): TaskFactory(), fakeOpenConnectionTask(false), fakeListChildMailboxes(false)
 {
 }
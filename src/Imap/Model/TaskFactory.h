@@ -36,6 +36,7 @@
 namespace Imap
 {
 class Parser;
+class Sequence;
 namespace Mailbox
 {
 
@@ -52,6 +53,7 @@ class IdTask;
 class ImapTask;
 class KeepMailboxOpenTask;
 class ListChildMailboxesTask;
+class ListSubscribedMailboxesTask;
 class NumberOfMessagesTask;
 class ObtainSynchronizedMailboxTask;
 class OpenConnectionTask;
@@ -63,6 +65,9 @@ class UnSelectTask;
 class SortTask;
 class SubscribeUnsubscribeTask;
 class GenUrlAuthTask;
+class MultiMailboxSearchTask;
+class FetchSearchHitsTask;
+class SearchMailboxesTask;
 class UidSubmitTask;
 
 class Model;
@@ -74,7 +79,7 @@ class TaskFactory
 public:
     virtual ~TaskFactory();
 
-    virtual CopyMoveMessagesTask *createCopyMoveMessagesTask(Model *model, const QModelIndexList &messages,
+    virtual CopyMoveMessagesTask *createCopyMoveMessagesTask(Model *model, const QModelIndex &mailbox, const Imap::Sequence &uids,
             const QString &targetMailbox, const CopyMoveOperation op);
     virtual CreateMailboxTask *createCreateMailboxTask(Model *model, const QString &mailbox);
     virtual DeleteMailboxTask *createDeleteMailboxTask(Model *model, const QString &mailbox);
@@ -92,10 +97,10 @@ public:
     virtual OpenConnectionTask *createOpenConnectionTask(Model *model);
     virtual UpdateFlagsOfAllMessagesTask *createUpdateFlagsOfAllMessagesTask(Model *model, const QModelIndex &mailbox,
             const FlagsOperation flagOperation, const QString &flags);
-    virtual UpdateFlagsTask *createUpdateFlagsTask(Model *model, const QModelIndexList &messages, const FlagsOperation flagOperation,
-            const QString &flags);
+    virtual UpdateFlagsTask *createUpdateFlagsTask(Model *model, const QModelIndex &mailbox, const Imap::Sequence &uids,
+            const FlagsOperation flagOperation, const QString &flags);
     virtual UpdateFlagsTask *createUpdateFlagsTask(Model *model, CopyMoveMessagesTask *copyTask,
-            const QList<QPersistentModelIndex> &messages, const FlagsOperation flagOperation,
+            const QModelIndex &mailbox, const Imap::Sequence &uids, const FlagsOperation flagOperation,
             const QString &flags);
     virtual ThreadTask *createThreadTask(Model *model, const QModelIndex &mailbox, const QByteArray &algorithm, const QStringList &searchCriteria);
     virtual ThreadTask *createIncrementalThreadTask(Model *model, const QModelIndex &mailbox, const QByteArray &algorithm, const QStringList &searchCriteria);
@@ -106,6 +111,7 @@ public:
                                          const QStringList &flags, const QDateTime &timestamp);
     virtual AppendTask *createAppendTask(Model *model, const QString &targetMailbox, const QList<CatenatePair> &data,
                                          const QStringList &flags, const QDateTime &timestamp);
+    virtual ListSubscribedMailboxesTask *createListSubscribedMailboxesTask(Model *model);
     virtual SubscribeUnsubscribeTask *createSubscribeUnsubscribeTask(Model *model, const QString &mailboxName,
                                                                      const SubscribeUnsubscribeOperation operation);
     virtual SubscribeUnsubscribeTask *createSubscribeUnsubscribeTask(Model *model, ImapTask *parentTask, const QString &mailboxName,
@@ -114,6 +120,10 @@ public:
                                                  const uint uidValidity, const uint uid, const QString &part, const QString &access);
     virtual UidSubmitTask *createUidSubmitTask(Model *model, const QString &mailbox, const uint uidValidity, const uint uid,
                                                const UidSubmitOptionsList &submitOptions);
+    virtual MultiMailboxSearchTask *createMultiMailboxSearchTask(Model *model, const QStringList &mailboxes,
+                                                                 const QStringList &searchConditions);
+    virtual FetchSearchHitsTask *createFetchSearchHitsTask(Model *model);
+    virtual SearchMailboxesTask *createSearchMailboxesTask(Model *model, const QStringList &searchConditions);
 };
 
 class TestingTaskFactory: public TaskFactory
@@ -22,8 +22,10 @@
 
 #include "ThreadingMsgListModel.h"
 #include <algorithm>
+#include <vector>
 #include <QBuffer>
 #include <QDebug>
+#include <QMap>
 #include "Imap/Tasks/SortTask.h"
 #include "Imap/Tasks/ThreadTask.h"
 #include "ItemRoles.h"
@@ -119,44 +121,83 @@ QVariant ThreadingMsgListModel::headerData(int section, Qt::Orientation orientat
 
 void ThreadingMsgListModel::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
-    // We don't support updates which concern multiple rows at this time.
-    // Doing that would very likely require a completely different codepath due to threading...
     Q_ASSERT(topLeft.parent() == bottomRight.parent());
-    Q_ASSERT(topLeft.row() == bottomRight.row());
-    QModelIndex translated = mapFromSource(topLeft);
 
-    emit dataChanged(translated, translated.sibling(translated.row(), bottomRight.column()));
+    bool wasMissingUids = !unknownUids.isEmpty();
+    if (wasMissingUids) {
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+            auto message = dynamic_cast<TreeItemMessage*>(static_cast<TreeItemMessage*>(topLeft.sibling(row, topLeft.column()).internalPointer()));
+            Q_ASSERT(message);
+            if (message->uid() == 0) {
+                // UID is not yet known.
+                // This is a legal situation, for example when an unsolicited FETCH FLAGS arrives and there's no UID in there.
+                continue;
+            }
 
-    // We provide funny data like "does this thread contain unread messages?". Now the original signal might mean that flags of a
-    // nested message have changed. In order to always be consistent, we have to find the thread root and emit dataChanged() on that
-    // as well.
-    QModelIndex rootCandidate = translated;
-    while (rootCandidate.parent().isValid()) {
-        rootCandidate = rootCandidate.parent();
-    }
-    if (rootCandidate != translated) {
-        // We're really an embedded message
-        emit dataChanged(rootCandidate, rootCandidate.sibling(rootCandidate.row(), bottomRight.column()));
+            // The message wasn't fully synced before, and now it might be
+            unknownUids.remove(message);
+        }
     }
 
-    auto message = dynamic_cast<TreeItemMessage*>(static_cast<TreeItemMessage*>(topLeft.internalPointer()));
-    Q_ASSERT(message);
-    if (message->uid() == 0) {
-        // UID is not yet known.
-        // This is a legal situation, for example when an unsolicited FETCH FLAGS arrives and there's no UID in there.
-        return;
+    QModelIndex first, last;
+    if (showsSourceOrder()) {
+        first = mapFromSource(topLeft);
+        last = mapFromSource(bottomRight);
     }
+    if (first.isValid() && last.isValid() && !first.parent().isValid() && !last.parent().isValid()
+            && last.row() - first.row() == bottomRight.row() - topLeft.row()) {
+        // The messages are shown in the same order as in the source model, so the range can be passed on as-is
+        emit dataChanged(first, last);
+    } else {
+        // The messages which are adjacent in the source model are scattered all over the threads. Their rows are grouped by
+        // the parent and reported as contiguous ranges, so that a bulk change does not result in one signal per message.
+        QMap<QModelIndex, QVector<int>> changedRows;
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+            QModelIndex translated = mapFromSource(row == topLeft.row() ? topLeft : topLeft.sibling(row, topLeft.column()));
+            if (!translated.isValid()) {
+                // Not shown because of the search criteria
+                continue;
+            }
+            changedRows[translated.parent()] << translated.row();
 
-    QSet<TreeItem*>::iterator persistent = unknownUids.find(message);
-    if (persistent != unknownUids.end()) {
-        // The message wasn't fully synced before, and now it is
-        persistent = unknownUids.erase(persistent);
-        if (unknownUids.isEmpty()) {
-            wantThreading();
+            // We provide funny data like "does this thread contain unread messages?". Now the original signal might mean that
+            // flags of a nested message have changed. In order to always be consistent, we have to report the thread root as well.
+            QModelIndex rootCandidate = translated;
+            while (rootCandidate.parent().isValid()) {
+                rootCandidate = rootCandidate.parent();
+            }
+            if (rootCandidate != translated) {
+                // We're really an embedded message
+                changedRows[QModelIndex()] << rootCandidate.row();
+            }
         }
+
+        for (auto it = changedRows.begin(); it != changedRows.end(); ++it) {
+            QVector<int> &rows = it.value();
+            std::sort(rows.begin(), rows.end());
+            rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+            int i = 0;
+            while (i < rows.size()) {
+                int firstRow = rows[i];
+                int lastRow = firstRow;
+                while (++i < rows.size() && rows[i] == lastRow + 1)
+                    ++lastRow;
+                emit dataChanged(index(firstRow, topLeft.column(), it.key()), index(lastRow, bottomRight.column(), it.key()));
+            }
+        }
+    }
+
+    if (wasMissingUids && unknownUids.isEmpty()) {
+        wantThreading();
     }
 }
 
+/** @short Are the messages shown as a flat list in the order of the source model? */
+bool ThreadingMsgListModel::showsSourceOrder() const
+{
+    return !m_shallBeThreading && m_currentSortingCriteria == SORT_NONE && !m_sortReverse && m_currentSearchConditions.isEmpty();
+}
+
 QModelIndex ThreadingMsgListModel::index(int row, int column, const QModelIndex &parent) const
 {
     Q_ASSERT(!parent.isValid() || parent.model() == this);
@@ -1448,6 +1489,61 @@ Qt::SortOrder ThreadingMsgListModel::currentSortOrder() const
     return m_sortReverse ? Qt::DescendingOrder : Qt::AscendingOrder;
 }
 
+/** @short Find the next (or previous) unread message without walking through all messages of the mailbox
+
+When the messages are neither threaded, nor sorted, nor filtered, the order of this model matches the order of UIDs and the
+lookup is delegated to the Model's index of unread messages. Otherwise only the unread messages are checked for their position
+within the tree of threads.
+*/
+QModelIndex ThreadingMsgListModel::findUnreadMessage(const QModelIndex &current, const bool forward)
+{
+    MsgListModel *msgList = qobject_cast<MsgListModel *>(sourceModel());
+    if (!msgList || !current.isValid())
+        return QModelIndex();
+    Q_ASSERT(current.model() == this);
+
+    const Model *constModel = 0;
+    QModelIndex mailbox;
+    Model::realTreeItem(msgList->currentMailbox(), &constModel, &mailbox);
+    if (!constModel)
+        return QModelIndex();
+    Model *model = const_cast<Model *>(constModel);
+
+    if (showsSourceOrder()) {
+        return mapFromSource(msgList->mapFromSource(
+                                 model->findUnreadMessage(mailbox, current.data(RoleMessageUid).toUInt(), forward)));
+    }
+
+    // The rows on the path from the root compare in the same order in which a view shows the threads, i.e. in pre-order
+    auto position = [](QModelIndex index) {
+        std::vector<int> res;
+        for (; index.isValid(); index = index.parent())
+            res.insert(res.begin(), index.row());
+        return res;
+    };
+    const std::vector<int> currentPosition = position(current);
+    std::vector<int> bestPosition, wrappedPosition;
+    QModelIndex best, wrapped;
+    Q_FOREACH(const QModelIndex &message, model->unreadMessages(mailbox)) {
+        QModelIndex candidate = mapFromSource(msgList->mapFromSource(message));
+        if (!candidate.isValid())
+            continue;
+        const std::vector<int> candidatePosition = position(candidate);
+        if (candidatePosition == currentPosition)
+            continue;
+        if (forward ? candidatePosition > currentPosition : candidatePosition < currentPosition) {
+            if (!best.isValid() || (forward ? candidatePosition < bestPosition : candidatePosition > bestPosition)) {
+                best = candidate;
+                bestPosition = candidatePosition;
+            }
+        } else if (!wrapped.isValid() || (forward ? candidatePosition < wrappedPosition : candidatePosition > wrappedPosition)) {
+            wrapped = candidate;
+            wrappedPosition = candidatePosition;
+        }
+    }
+    return best.isValid() ? best : wrapped;
+}
+
 QModelIndex ThreadingMsgListModel::sibling(int row, int column, const QModelIndex &idx) const
 {
     return index(row, column, idx.parent());
@@ -151,6 +151,9 @@ public:
     SortCriterium currentSortCriterium() const;
     Q_INVOKABLE Qt::SortOrder currentSortOrder() const;
 
+    /** @short Find the closest unread message after (or before) the @arg current one in the order of this model, wrapping around */
+    QModelIndex findUnreadMessage(const QModelIndex &current, const bool forward);
+
 public slots:
     void resetMe();
     void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
@@ -222,6 +225,8 @@ private:
     /** @short Remove fake messages from the threading tree */
     void pruneTree();
 
+    bool showsSourceOrder() const;
+
     /** @short Check current thread for "unread messages" */
     bool threadContainsUnreadMessages(const uint root) const;
 
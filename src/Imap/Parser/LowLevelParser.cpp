@@ -413,6 +413,42 @@ Imap::Uids getSequence(const QByteArray &line, int &start)
     }
 }
 
+Imap::Sequence getSequenceSet(const QByteArray &line, int &start)
+{
+    uint lo = LowLevelParser::getUInt(line, start);
+    Imap::Sequence res(lo);
+    if (start >= line.size() - 2) {
+        // It's definitely just a number because there's no more data in here
+        return res;
+    }
+
+    // Try to find further items in the sequence set
+    while (start < line.size() && (line[start] == ':' || line[start] == ',')) {
+        if (line[start] == ':') {
+            ++start;
+            if (start >= line.size() - 2) throw NoData("Truncated sequence set", line, start);
+
+            uint hi = LowLevelParser::getUInt(line, start);
+            if (lo >= hi)
+                throw UnexpectedHere("Sequence set contains an invalid range. "
+                                     "First item of a range must always be smaller than the second item.", line, start);
+            res.addRange(lo, hi);
+
+            if (start < line.size() && line[start] == ':') {
+                // Now "x:y:z" is a funny syntax
+                throw UnexpectedHere("Sequence set: range cannot me defined by three numbers", line, start);
+            }
+        } else {
+            ++start;
+            if (start >= line.size() - 2) throw NoData("Truncated sequence set", line, start);
+
+            lo = LowLevelParser::getUInt(line, start);
+            res.add(lo);
+        }
+    }
+    return res;
+}
+
 QDateTime parseRFC2822DateTime(const QByteArray &input)
 {
     QStringList monthNames = QStringList() << QStringLiteral("jan") << QStringLiteral("feb") << QStringLiteral("mar")
@@ -25,6 +25,7 @@
 #include <QList>
 #include <QPair>
 #include <QVariant>
+#include "Imap/Parser/Sequence.h"
 #include "Imap/Parser/Uids.h"
 
 namespace Imap
@@ -95,9 +96,19 @@ QVariantList parseList(const char open, const char close,
 /** @short Read one item from input, store it in a most-appropriate form */
 QVariant getAnything(const QByteArray &line, int &start);
 
-/** @short Parse a sequence set from the input */
+/** @short Parse a sequence set from the input
+
+The numbers are returned in the same order as they were listed on the wire, with ranges expanded into individual items.
+*/
 Imap::Uids getSequence(const QByteArray &line, int &start);
 
+/** @short Parse a sequence set from the input into a set of ranges
+
+Unlike getSequence(), the order of items is not preserved and the ranges are not expanded, which means that the
+result takes space proportional to the number of ranges only.
+*/
+Imap::Sequence getSequenceSet(const QByteArray &line, int &start);
+
 /** @short Parse RFC2822-like formatted date
  *
  * Code for this class was lobotomized from KDE's KDateTime.
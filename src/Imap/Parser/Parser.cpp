@@ -20,6 +20,7 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <algorithm>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QStringList>
 #include <QMutexLocker>
@@ -47,6 +48,16 @@
 # endif
 #endif
 
+namespace {
+
+/** @short How many parsed responses can wait for the consumer before the parser stops reading */
+const int DEFAULT_MAX_QUEUED_RESPONSES = 1000;
+
+/** @short How much raw data the waiting responses can represent before the parser stops reading */
+const qint64 DEFAULT_MAX_QUEUED_BYTES = 16 * 1024 * 1024;
+
+}
+
 /*
  * Parser interface considerations:
  *
@@ -90,7 +101,9 @@ Parser::Parser(QObject *parent, Streams::Socket *socket, const uint myId):
     QObject(parent), socket(socket), m_lastTagUsed(0), idling(false), waitForInitialIdle(false),
     m_literalPlus(LiteralPlus::Unsupported), waitingForContinuation(false), startTlsInProgress(false), compressDeflateInProgress(false),
     waitingForConnection(true), waitingForEncryption(socket->isConnectingEncryptedSinceStart()), waitingForSslPolicy(false),
-    m_expectsInitialGreeting(true), readingMode(ReadingLine), oldLiteralPosition(0), m_parserId(myId)
+    m_expectsInitialGreeting(true), readingMode(ReadingLine), oldLiteralPosition(0), m_parserId(myId),
+    m_maxQueuedResponses(DEFAULT_MAX_QUEUED_RESPONSES), m_maxQueuedBytes(DEFAULT_MAX_QUEUED_BYTES), m_queuedBytes(0),
+    m_readingPaused(false)
 {
     socket->setParent(this);
     connect(socket, &Streams::Socket::disconnected, this, &Parser::handleDisconnected);
@@ -310,8 +323,11 @@ CommandHandle Parser::expunge()
 
 CommandHandle Parser::searchHelper(const QByteArray &command, const QStringList &criteria, const QByteArray &charset)
 {
-    Commands::Command cmd(command);
+    return searchHelper(Commands::Command(command), criteria, charset);
+}
 
+CommandHandle Parser::searchHelper(Commands::Command cmd, const QStringList &criteria, const QByteArray &charset)
+{
     if (!charset.isEmpty())
         cmd << "CHARSET" << charset;
 
@@ -387,6 +403,20 @@ CommandHandle Parser::uidESearch(const QByteArray &charset, const QStringList &s
                         searchCriteria, charset);
 }
 
+CommandHandle Parser::eSearchInSubtrees(const QStringList &mailboxes, const QByteArray &charset, const QStringList &searchCriteria,
+                                        const QStringList &returnOptions)
+{
+    Q_ASSERT(!mailboxes.isEmpty());
+    Commands::Command cmd("ESEARCH");
+    cmd << Commands::PartOfCommand(Commands::ATOM, "IN") << Commands::PartOfCommand(Commands::ATOM_NO_SPACE_AROUND, " (SUBTREE (");
+    Q_FOREACH(const QString &mailbox, mailboxes) {
+        cmd << encodeImapFolderName(mailbox);
+    }
+    cmd << Commands::PartOfCommand(Commands::ATOM_NO_SPACE_AROUND, ")) ")
+        << Commands::PartOfCommand(Commands::ATOM, "RETURN (" + returnOptions.join(QStringLiteral(" ")).toUtf8() + ")");
+    return searchHelper(cmd, searchCriteria, charset);
+}
+
 CommandHandle Parser::cancelUpdate(const CommandHandle &tag)
 {
     Commands::Command command("CANCELUPDATE");
@@ -457,7 +487,7 @@ CommandHandle Parser::copy(const Sequence &seq, const QString &mailbox)
                         encodeImapFolderName(mailbox));
 }
 
-CommandHandle Parser::uidFetch(const Sequence &seq, const QList<QByteArray> &items)
+CommandHandle Parser::uidFetch(const Sequence &seq, const QList<QByteArray> &items, const QMap<QByteArray, quint64> &uint64Modifiers)
 {
     QByteArray buf;
     Q_FOREACH(const QByteArray &item, items) {
@@ -465,9 +495,18 @@ CommandHandle Parser::uidFetch(const Sequence &seq, const QList<QByteArray> &ite
     }
     buf += ')';
     buf[0] = '(';
-    return queueCommand(Commands::Command("UID FETCH") <<
+    Commands::Command cmd = Commands::Command("UID FETCH") <<
                         Commands::PartOfCommand(Commands::ATOM, seq.toByteArray()) <<
-                        Commands::PartOfCommand(Commands::ATOM, buf));
+                        Commands::PartOfCommand(Commands::ATOM, buf);
+    if (!uint64Modifiers.isEmpty()) {
+        cmd << Commands::PartOfCommand(Commands::ATOM_NO_SPACE_AROUND, " (");
+        for (QMap<QByteArray, quint64>::const_iterator it = uint64Modifiers.constBegin(); it != uint64Modifiers.constEnd(); ++it) {
+            cmd << Commands::PartOfCommand(Commands::ATOM, it.key()) <<
+                   Commands::PartOfCommand(Commands::ATOM, QByteArray::number(it.value()));
+        }
+        cmd << Commands::PartOfCommand(Commands::ATOM_NO_SPACE_AROUND, ")");
+    }
+    return queueCommand(cmd);
 }
 
 CommandHandle Parser::uidStore(const Sequence &seq, const QString &item, const QString &value)
@@ -616,9 +655,10 @@ CommandHandle Parser::queueCommand(Commands::Command command)
     return tag;
 }
 
-void Parser::queueResponse(const QSharedPointer<Responses::AbstractResponse> &resp)
+void Parser::queueResponse(const QSharedPointer<Responses::AbstractResponse> &resp, const int size)
 {
-    respQueue.push_back(resp);
+    respQueue.push_back(qMakePair(resp, size));
+    m_queuedBytes += size;
     // Try to limit the signal rate -- when there are multiple items in the queue, there's no point in sending more signals
     if (respQueue.size() == 1) {
         emit responseReceived(this);
@@ -651,11 +691,44 @@ QSharedPointer<Responses::AbstractResponse> Parser::getResponse()
     QSharedPointer<Responses::AbstractResponse> ptr;
     if (respQueue.empty())
         return ptr;
-    ptr = respQueue.front();
+    ptr = respQueue.front().first;
+    m_queuedBytes -= respQueue.front().second;
     respQueue.pop_front();
+    // Resume only after a substantial part of the queue is gone, so that reading does not stop and start after each response
+    if (m_readingPaused
+            && (!m_maxQueuedResponses || respQueue.size() <= m_maxQueuedResponses / 2)
+            && (!m_maxQueuedBytes || m_queuedBytes <= m_maxQueuedBytes / 2)) {
+        setReadingPaused(false);
+    }
     return ptr;
 }
 
+void Parser::setResponseBudget(const int responses, const qint64 bytes)
+{
+    m_maxQueuedResponses = qMax(0, responses);
+    m_maxQueuedBytes = qMax<qint64>(0, bytes);
+    if (m_readingPaused && !responseBudgetExhausted())
+        setReadingPaused(false);
+}
+
+bool Parser::responseBudgetExhausted() const
+{
+    return (m_maxQueuedResponses && respQueue.size() >= m_maxQueuedResponses)
+            || (m_maxQueuedBytes && m_queuedBytes >= m_maxQueuedBytes);
+}
+
+void Parser::setReadingPaused(const bool paused)
+{
+    if (m_readingPaused == paused)
+        return;
+    m_readingPaused = paused;
+    socket->setReadingPaused(paused);
+    if (!paused) {
+        // There might be complete responses in the socket's buffer already, and no readyRead() is going to announce them
+        QTimer::singleShot(0, this, SLOT(handleReadyRead()));
+    }
+}
+
 QByteArray Parser::generateTag()
 {
     return QStringLiteral("y%1").arg(m_lastTagUsed++).toUtf8();
@@ -664,6 +737,12 @@ QByteArray Parser::generateTag()
 void Parser::handleReadyRead()
 {
     while (!waitingForEncryption && !waitingForSslPolicy) {
+        if (responseBudgetExhausted()) {
+            // The consumer is behind. Leave the rest in the socket so that the server gets throttled, getResponse() will
+            // resume reading once the queue shrinks.
+            setReadingPaused(true);
+            return;
+        }
         switch (readingMode) {
         case ReadingLine:
             if (socket->canReadLine()) {
@@ -941,7 +1020,7 @@ void Parser::processLine(QByteArray line)
         throw NotAnImapServerError(std::string(), line, -1);
     } else if (line.startsWith("* ")) {
         m_expectsInitialGreeting = false;
-        queueResponse(parseUntagged(line));
+        queueResponse(parseUntagged(line), line.size());
     } else if (line.startsWith("+ ")) {
         if (waitingForContinuation) {
             waitingForContinuation = false;
@@ -954,7 +1033,7 @@ void Parser::processLine(QByteArray line)
             throw ContinuationRequest(line.constData());
         }
     } else {
-        queueResponse(parseTagged(line));
+        queueResponse(parseTagged(line), line.size());
     }
 }
 
@@ -1010,6 +1089,20 @@ QSharedPointer<Responses::AbstractResponse> Parser::parseUntaggedNumber(
                    new Responses::Fetch(number, line, start));
         break;
 
+    case Responses::UIDFETCH:
+    {
+        // RFC 9586: the number is an UID, the sequence number is not known at all
+        if (!number)
+            throw UnexpectedHere("UIDFETCH for UID zero", line, start);
+        QSharedPointer<Responses::Fetch> fetch(new Responses::Fetch(0, line, start));
+        auto uidRecord = fetch->data.constFind("UID");
+        if (uidRecord != fetch->data.constEnd()
+                && static_cast<const Responses::RespData<uint>&>(*(uidRecord.value())).data != number)
+            throw UnexpectedHere("UIDFETCH contains a different UID", line, start);
+        fetch->data["UID"] = QSharedPointer<Responses::AbstractData>(new Responses::RespData<uint>(number));
+        return fetch;
+    }
+
     default:
         break;
     }
@@ -1156,6 +1249,13 @@ uint Parser::parserId() const
     return m_parserId;
 }
 
+bool Parser::flushCommands(const int msecs)
+{
+    // The commands only get written from a queued call to executeCommands()
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    return socket->waitForBytesWritten(msecs);
+}
+
 void Parser::slotSocketStateChanged(const Imap::ConnectionState connState, const QString &message)
 {
     if (connState == CONN_STATE_CONNECTED_PRETLS_PRECAPS) {
@@ -22,6 +22,7 @@
 #ifndef IMAP_PARSER_H
 #define IMAP_PARSER_H
 #include <QLinkedList>
+#include <QPair>
 #include <QSharedPointer>
 #include "Command.h"
 #include "Response.h"
@@ -75,6 +76,14 @@ public:
     /** @short De-queue and return parsed response */
     QSharedPointer<Responses::AbstractResponse> getResponse();
 
+    /** @short Limit the amount of parsed responses which are waiting for getResponse()
+
+    When either the number of the queued responses or the size of the data they were parsed from reaches its limit,
+    the parser stops reading from the socket until the consumer catches up. The server is then throttled by the TCP
+    flow control instead of having the whole mailbox parsed into memory at once. A zero disables the respective limit.
+    */
+    void setResponseBudget(const int responses, const qint64 bytes);
+
     /** @short Support of the LITERAL+ and LITERAL- extensions, RFC 7888 and RFC 2088 */
     enum class LiteralPlus {
         Unsupported, /**< @short No joy, use synchronizing literals */
@@ -87,6 +96,12 @@ public:
 
     uint parserId() const;
 
+    /** @short Send the queued commands and wait for at most @arg msecs milliseconds until the socket has written them
+
+    This blocks the caller and should only be used when the event loop is not going to run anymore.
+    */
+    bool flushCommands(const int msecs);
+
 public slots:
 
     /** @short CAPABILITY, RFC 3501 section 6.1.1 */
@@ -180,7 +195,8 @@ public slots:
     CommandHandle copy(const Sequence &seq, const QString &mailbox);
 
     /** @short UID command (FETCH), RFC3501 sect 6.4.8 */
-    CommandHandle uidFetch(const Sequence &seq, const QList<QByteArray> &items);
+    CommandHandle uidFetch(const Sequence &seq, const QList<QByteArray> &items,
+                           const QMap<QByteArray, quint64> &uint64Modifiers = MapByteArrayUint64());
 
     /** @short UID command (STORE), RFC3501 sect 6.4.8 */
     CommandHandle uidStore(const Sequence &seq, const QString &item, const QString &value);
@@ -248,6 +264,10 @@ public slots:
     /** @short ESEARCH, the extended UID SEARCH with support for ESEARCH return options from RFC 5267 */
     CommandHandle uidESearch(const QByteArray &charset, const QStringList &searchCriteria, const QStringList &returnOptions);
 
+    /** @short The ESEARCH command from RFC 7377, searching in the passed mailboxes and all their descendants */
+    CommandHandle eSearchInSubtrees(const QStringList &mailboxes, const QByteArray &charset, const QStringList &searchCriteria,
+                                    const QStringList &returnOptions);
+
 
     CommandHandle uidEThread(const QByteArray &algo, const QByteArray &charset, const QStringList &searchCriteria,
                              const QStringList &returnOptions);
@@ -342,6 +362,7 @@ private:
     /** @short Helper for search() and uidSearch() */
     CommandHandle searchHelper(const QByteArray &command, const QStringList &criteria,
                                const QByteArray &charset = QByteArray());
+    CommandHandle searchHelper(Commands::Command cmd, const QStringList &criteria, const QByteArray &charset);
 
     CommandHandle sortHelper(const QByteArray &command, const QStringList &sortCriteria, const QByteArray &charset, const QStringList &searchCriteria);
     CommandHandle threadHelper(const QByteArray &command, const QByteArray &algo, const QByteArray &charset, const QStringList &searchCriteria);
@@ -365,8 +386,17 @@ private:
     QSharedPointer<Responses::AbstractResponse> parseUntaggedText(
         const QByteArray &line, int &start);
 
-    /** @short Add parsed response to the internal queue, emit notification signal */
-    void queueResponse(const QSharedPointer<Responses::AbstractResponse> &resp);
+    /** @short Add parsed response to the internal queue, emit notification signal
+
+    The @arg size is the number of bytes the response was parsed from; it counts against the response budget.
+    */
+    void queueResponse(const QSharedPointer<Responses::AbstractResponse> &resp, const int size = 0);
+
+    /** @short Are there enough unprocessed responses to stop reading from the socket? */
+    bool responseBudgetExhausted() const;
+
+    /** @short Stop or resume reading from the socket */
+    void setReadingPaused(const bool paused);
 
     /** @short Connection to the IMAP server */
     Streams::Socket *socket;
@@ -377,8 +407,17 @@ private:
     /** @short Queue storing commands that are about to be executed */
     QLinkedList<Commands::Command> cmdQueue;
 
-    /** @short Queue storing parsed replies from the IMAP server */
-    QLinkedList<QSharedPointer<Responses::AbstractResponse> > respQueue;
+    /** @short Queue storing parsed replies from the IMAP server along with the size of their raw data */
+    QLinkedList<QPair<QSharedPointer<Responses::AbstractResponse>, int> > respQueue;
+
+    /** @short Maximal number of responses in the respQueue before reading gets paused */
+    int m_maxQueuedResponses;
+    /** @short Maximal size of the raw data of the responses in the respQueue before reading gets paused */
+    qint64 m_maxQueuedBytes;
+    /** @short Size of the raw data of all responses in the respQueue */
+    qint64 m_queuedBytes;
+    /** @short Is reading from the socket suspended until the respQueue gets drained? */
+    bool m_readingPaused;
 
     bool idling;
     bool waitForInitialIdle;
@@ -184,6 +184,9 @@ QTextStream &operator<<(QTextStream &stream, const Kind &res)
     case GENURLAUTH:
         stream << "GENURLAUTH";
         break;
+    case UIDFETCH:
+        stream << "UIDFETCH";
+        break;
     }
     return stream;
 }
@@ -240,6 +243,8 @@ Kind kindFromString(QByteArray str) throw(UnrecognizedResponseKind)
         return VANISHED;
     if (str == "GENURLAUTH")
         return GENURLAUTH;
+    if (str == "UIDFETCH")
+        return UIDFETCH;
     throw UnrecognizedResponseKind(str.constData());
 }
 
@@ -504,7 +509,7 @@ State::State(const QByteArray &tag, const Kind kind, const QByteArray &line, int
                 throw InvalidResponseCode("Malformed APPENDUID: cannot extract UIDVALIDITY", line, start);
             int pos = 0;
             QByteArray s1 = originalList[2].toByteArray();
-            Sequence seq = Sequence::fromVector(LowLevelParser::getSequence(s1, pos));
+            Sequence seq = LowLevelParser::getSequenceSet(s1, pos);
             if (!seq.isValid())
                 throw InvalidResponseCode("Malformed APPENDUID: cannot extract UID or the list of UIDs", line, start);
             if (pos != s1.size())
@@ -524,14 +529,14 @@ State::State(const QByteArray &tag, const Kind kind, const QByteArray &line, int
                 throw InvalidResponseCode("Malformed COPYUID: cannot extract UIDVALIDITY", line, start);
             int pos = 0;
             QByteArray s1 = originalList[2].toByteArray();
-            Sequence seq1 = Sequence::fromVector(LowLevelParser::getSequence(s1, pos));
+            Sequence seq1 = LowLevelParser::getSequenceSet(s1, pos);
             if (!seq1.isValid())
                 throw InvalidResponseCode("Malformed COPYUID: cannot extract the first sequence", line, start);
             if (pos != s1.size())
                 throw InvalidResponseCode("Malformed COPYUID: garbage found after the first sequence", line, start);
             pos = 0;
             QByteArray s2 = originalList[3].toByteArray();
-            Sequence seq2 = Sequence::fromVector(LowLevelParser::getSequence(s2, pos));
+            Sequence seq2 = LowLevelParser::getSequenceSet(s2, pos);
             if (!seq2.isValid())
                 throw InvalidResponseCode("Malformed COPYUID: cannot extract the second sequence", line, start);
             if (pos != s2.size())
@@ -660,7 +665,7 @@ Search::Search(const QByteArray &line, int &start)
     }
 }
 
-ESearch::ESearch(const QByteArray &line, int &start): seqOrUids(SEQUENCE)
+ESearch::ESearch(const QByteArray &line, int &start): seqOrUids(SEQUENCE), uidValidity(0)
 {
     LowLevelParser::eatSpaces(line, start);
 
@@ -687,6 +692,25 @@ ESearch::ESearch(const QByteArray &line, int &start): seqOrUids(SEQUENCE)
         tag = astring.first;
         if (start >= line.size()) throw NoData(line, start);
 
+        // RFC 7377 extends the search-correlator with the mailbox which the results belong to
+        while (line[start] == ' ') {
+            LowLevelParser::eatSpaces(line, start);
+            if (start >= line.size()) throw NoData(line, start);
+            if (line[start] == ')')
+                break;
+            QByteArray item = LowLevelParser::getAtom(line, start).toUpper();
+            LowLevelParser::eatSpaces(line, start);
+            if (start >= line.size()) throw NoData(line, start);
+            if (item == "MAILBOX") {
+                mailbox = LowLevelParser::getMailbox(line, start);
+            } else if (item == "UIDVALIDITY") {
+                uidValidity = LowLevelParser::getUInt(line, start);
+            } else {
+                throw ParseError("ESEARCH response: malformed search-correlator", line, start);
+            }
+            if (start >= line.size()) throw NoData(line, start);
+        }
+
         if (line[start] != ')')
             throw ParseError("ESEARCH: search-correlator not enclosed in parentheses", line, start);
 
@@ -879,6 +903,12 @@ Fetch::Fetch(const uint number, const QByteArray &line, int &start): number(numb
             int pos = line.indexOf(']', posBeforeIdentifier);
             if (pos == -1)
                 throw UnexpectedHere("FETCH identifier contains \"[\", but no matching \"]\" was found", line, posBeforeIdentifier);
+            if (pos + 1 < line.size() && line[pos + 1] == '<') {
+                // A partial fetch, "BODY[1]<0>", the origin is a part of the identifier
+                pos = line.indexOf('>', pos);
+                if (pos == -1)
+                    throw UnexpectedHere("FETCH identifier contains \"<\", but no matching \">\" was found", line, posBeforeIdentifier);
+            }
             identifier = line.mid(posBeforeIdentifier, pos - posBeforeIdentifier + 1).toUpper();
             start = pos + 1;
         }
@@ -1092,7 +1122,7 @@ Vanished::Vanished(const QByteArray &line, int &start): earlier(NOT_EARLIER)
         start += prefixLength + 1; // one for the required space
     }
 
-    uids = LowLevelParser::getSequence(line, start);
+    uids = LowLevelParser::getSequenceSet(line, start);
 
     if (start != line.size() - 2)
         throw TooMuchData(line, start);
@@ -1163,6 +1193,8 @@ QTextStream &ESearch::dump(QTextStream &stream) const
     stream << "ESEARCH ";
     if (!tag.isEmpty())
         stream << "TAG " << tag << " ";
+    if (!mailbox.isEmpty())
+        stream << "MAILBOX " << mailbox << " UIDVALIDITY " << uidValidity << " ";
     if (seqOrUids == UIDS)
         stream << "UID ";
     for (ListData_t::const_iterator it = listData.constBegin(); it != listData.constEnd(); ++it) {
@@ -1289,11 +1321,7 @@ QTextStream &Vanished::dump(QTextStream &s) const
     s << "VANISHED ";
     if (earlier == EARLIER)
         s << "(EARLIER) ";
-    s << "(";
-    Q_FOREACH(const uint &uid, uids) {
-        s << " " << uid;
-    }
-    return s << ")";
+    return s << "(" << uids.toByteArray() << ")";
 }
 
 QTextStream &GenUrlAuth::dump(QTextStream &s) const
@@ -1447,7 +1475,7 @@ bool ESearch::eq(const AbstractResponse &other) const
 {
     try {
         const ESearch &s = dynamic_cast<const ESearch &>(other);
-        return tag == s.tag && seqOrUids == s.seqOrUids && listData == s.listData &&
+        return tag == s.tag && mailbox == s.mailbox && uidValidity == s.uidValidity && seqOrUids == s.seqOrUids && listData == s.listData &&
                 incrementalContextData == s.incrementalContextData && incThreadData == s.incThreadData;
     } catch (std::bad_cast &) {
         return false;
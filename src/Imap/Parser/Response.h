@@ -32,6 +32,7 @@
 #include "Command.h"
 #include "../Exceptions.h"
 #include "Data.h"
+#include "Sequence.h"
 #include "ThreadingNode.h"
 #include "Uids.h"
 
@@ -94,7 +95,8 @@ enum Kind {
     ID,
     ENABLED, /**< @short RFC 5161 ENABLE */
     VANISHED, /**< @short RFC 5162 VANISHED (for QRESYNC) */
-    GENURLAUTH /**< @short GENURLAUTH, RFC 4467 */
+    GENURLAUTH, /**< @short GENURLAUTH, RFC 4467 */
+    UIDFETCH /**< @short RFC 9586 UIDFETCH */
 }; // aren't those comments just sexy? :)
 
 /** @short Response Code */
@@ -475,6 +477,12 @@ public:
     /** @short The tag of the command which requested in this operation */
     QByteArray tag;
 
+    /** @short Name of the mailbox which the results belong to, if they came from an RFC 7377 multi-mailbox search */
+    QString mailbox;
+
+    /** @short UIDVALIDITY of the mailbox, only set along with the mailbox name */
+    uint uidValidity;
+
     /** @short Are the numbers given in UIDs, or as sequence numbers? */
     SequencesOrUids seqOrUids;
 
@@ -510,11 +518,14 @@ public:
 
     ESearch(const QByteArray &line, int &start);
     ESearch(const QByteArray &tag, const SequencesOrUids seqOrUids, const ListData_t &listData) :
-        tag(tag), seqOrUids(seqOrUids), listData(listData) {}
+        tag(tag), uidValidity(0), seqOrUids(seqOrUids), listData(listData) {}
+    ESearch(const QByteArray &tag, const QString &mailbox, const uint uidValidity, const SequencesOrUids seqOrUids,
+            const ListData_t &listData) :
+        tag(tag), mailbox(mailbox), uidValidity(uidValidity), seqOrUids(seqOrUids), listData(listData) {}
     ESearch(const QByteArray &tag, const SequencesOrUids seqOrUids, const IncrementalContextData_t &incrementalContextData) :
-        tag(tag), seqOrUids(seqOrUids), incrementalContextData(incrementalContextData) {}
+        tag(tag), uidValidity(0), seqOrUids(seqOrUids), incrementalContextData(incrementalContextData) {}
     ESearch(const QByteArray &tag, const SequencesOrUids seqOrUids, const IncrementalThreadingData_t &incThreadData):
-        tag(tag), seqOrUids(seqOrUids), incThreadData(incThreadData) {}
+        tag(tag), uidValidity(0), seqOrUids(seqOrUids), incThreadData(incThreadData) {}
     virtual QTextStream &dump(QTextStream &stream) const;
     virtual bool eq(const AbstractResponse &other) const;
     virtual void plug(Imap::Parser *parser, Imap::Mailbox::Model *model) const;
@@ -557,7 +568,10 @@ class Fetch : public AbstractResponse
 public:
     typedef QMap<QByteArray,QSharedPointer<AbstractData> > dataType;
 
-    /** @short Sequence number of message that we're working with */
+    /** @short Sequence number of message that we're working with
+
+    This is zero for the RFC 9586 UIDFETCH responses which only identify the message by its UID.
+    */
     uint number;
 
     /** @short Fetched items */
@@ -634,9 +648,10 @@ class Vanished: public AbstractResponse
 public:
     typedef enum {EARLIER, NOT_EARLIER} EarlierOrNow;
     EarlierOrNow earlier;
-    Uids uids;
+    /** @short The removed UIDs, kept as ranges because VANISHED (EARLIER) can easily cover the whole mailbox */
+    Sequence uids;
     Vanished(const QByteArray &line, int &start);
-    Vanished(EarlierOrNow earlier, const Uids &uids): earlier(earlier), uids(uids) {}
+    Vanished(EarlierOrNow earlier, const Sequence &uids): earlier(earlier), uids(uids) {}
     virtual QTextStream &dump(QTextStream &s) const;
     virtual bool eq(const AbstractResponse &other) const;
     virtual void plug(Imap::Parser *parser, Imap::Mailbox::Model *model) const;
@@ -20,21 +20,27 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include "Sequence.h"
-#include <QStringList>
+#include <algorithm>
+#include <climits>
 #include <QTextStream>
+#include "Sequence.h"
 
 namespace Imap
 {
 
-Sequence::Sequence(const uint num): kind(DISTINCT)
+Sequence::Sequence(const uint num): lo(0), kind(DISTINCT)
+{
+    ranges << Range(num, num);
+}
+
+Sequence::Sequence(const uint lo, const uint hi): lo(lo), kind(RANGE)
 {
-    numbers << num;
+    ranges << Range(lo, hi);
 }
 
 Sequence Sequence::startingAt(const uint lo)
 {
-    Sequence res(lo);
+    Sequence res;
     res.lo = lo;
     res.kind = UNLIMITED;
     return res;
@@ -44,32 +50,25 @@ QByteArray Sequence::toByteArray() const
 {
     switch (kind) {
     case DISTINCT:
+    case RANGE:
     {
-        Q_ASSERT(! numbers.isEmpty());
-
-        QStringList res;
-        int i = 0;
-        while (i < numbers.size()) {
-            int old = i;
-            while (i < numbers.size() - 1 &&
-                   numbers[i] == numbers[ i + 1 ] - 1)
-                ++i;
-            if (old != i) {
-                // we've found a sequence
-                res << QString::number(numbers[old]) + QLatin1Char(':') + QString::number(numbers[i]);
-            } else {
-                res << QString::number(numbers[i]);
+        Q_ASSERT(!ranges.isEmpty());
+
+        QByteArray res;
+        // Each range takes at most two ten-digit numbers and two separators
+        res.reserve(ranges.size() * 22);
+        for (auto it = ranges.constBegin(); it != ranges.constEnd(); ++it) {
+            Q_ASSERT(it->lo <= it->hi);
+            if (it != ranges.constBegin())
+                res.append(',');
+            res.append(QByteArray::number(it->lo));
+            if (it->lo != it->hi) {
+                res.append(':');
+                res.append(QByteArray::number(it->hi));
             }
-            ++i;
         }
-        return res.join(QStringLiteral(",")).toLocal8Bit();
+        return res;
     }
-    case RANGE:
-        Q_ASSERT(lo <= hi);
-        if (lo == hi)
-            return QByteArray::number(lo);
-        else
-            return QByteArray::number(lo) + ':' + QByteArray::number(hi);
     case UNLIMITED:
         return QByteArray::number(lo) + ":*";
     }
@@ -82,18 +81,19 @@ Imap::Uids Sequence::toVector() const
 {
     switch (kind) {
     case DISTINCT:
-        Q_ASSERT(!numbers.isEmpty());
-        return numbers;
     case RANGE:
-        Q_ASSERT(lo <= hi);
-        if (lo == hi) {
-            return Imap::Uids() << lo;
-        } else {
-            Imap::Uids res;
-            for (uint i = lo; i < hi; ++i)
+    {
+        Q_ASSERT(!ranges.isEmpty());
+        Imap::Uids res;
+        res.reserve(count());
+        Q_FOREACH(const Range &range, ranges) {
+            Q_ASSERT(range.lo <= range.hi);
+            for (uint i = range.lo; i < range.hi; ++i)
                 res << i;
-            return res;
+            res << range.hi;
         }
+        return res;
+    }
     case UNLIMITED:
         Q_ASSERT(false);
         return Imap::Uids();
@@ -103,11 +103,38 @@ Imap::Uids Sequence::toVector() const
 }
 
 Sequence &Sequence::add(uint num)
+{
+    return addRange(num, num);
+}
+
+Sequence &Sequence::addRange(const uint lo, const uint hi)
 {
     Q_ASSERT(kind == DISTINCT);
-    auto it = qLowerBound(numbers.begin(), numbers.end(), num);
-    if (it == numbers.end() || *it != num)
-        numbers.insert(it, num);
+    Q_ASSERT(lo <= hi);
+
+    // The common case is building the sequence in an ascending order
+    if (ranges.isEmpty() || (ranges.last().hi != UINT_MAX && lo > ranges.last().hi + 1)) {
+        ranges << Range(lo, hi);
+        return *this;
+    }
+
+    // Find the first range which is not completely to the left of the new one, not even adjacent to it
+    auto first = std::lower_bound(ranges.begin(), ranges.end(), lo, [](const Range &range, const uint value) {
+        return range.hi != UINT_MAX && range.hi + 1 < value;
+    });
+    // ...and the first one which is completely to the right
+    auto last = std::upper_bound(first, ranges.end(), hi, [](const uint value, const Range &range) {
+        return value != UINT_MAX && value + 1 < range.lo;
+    });
+
+    if (first == last) {
+        ranges.insert(first, Range(lo, hi));
+    } else {
+        // Everything in [first, last) overlaps with or touches the new range, so these can be merged together
+        first->lo = qMin(first->lo, lo);
+        first->hi = qMax((last - 1)->hi, hi);
+        ranges.erase(first + 1, last);
+    }
     return *this;
 }
 
@@ -117,19 +144,96 @@ Sequence Sequence::fromVector(Imap::Uids numbers)
     qSort(numbers);
     Sequence seq(numbers.first());
     for (int i = 1; i < numbers.size(); ++i) {
-        seq.add(numbers[i]);
+        Range &current = seq.ranges.last();
+        if (numbers[i] == current.hi) {
+            continue;
+        } else if (numbers[i] == current.hi + 1) {
+            current.hi = numbers[i];
+        } else {
+            seq.ranges << Range(numbers[i], numbers[i]);
+        }
     }
     return seq;
 }
 
 bool Sequence::isValid() const
 {
-    if (kind == DISTINCT && numbers.isEmpty())
+    if (kind == DISTINCT && ranges.isEmpty())
         return false;
     else
         return true;
 }
 
+bool Sequence::contains(const uint num) const
+{
+    if (kind == UNLIMITED)
+        return num >= lo;
+
+    auto it = std::lower_bound(ranges.constBegin(), ranges.constEnd(), num, [](const Range &range, const uint value) {
+        return range.hi < value;
+    });
+    return it != ranges.constEnd() && it->lo <= num;
+}
+
+uint Sequence::count() const
+{
+    Q_ASSERT(kind != UNLIMITED);
+    uint res = 0;
+    Q_FOREACH(const Range &range, ranges) {
+        res += range.hi - range.lo + 1;
+    }
+    return res;
+}
+
+const Sequence::Ranges &Sequence::toRanges() const
+{
+    Q_ASSERT(kind != UNLIMITED);
+    return ranges;
+}
+
+Sequence Sequence::united(const Sequence &other) const
+{
+    Q_ASSERT(kind != UNLIMITED);
+    Q_ASSERT(other.kind != UNLIMITED);
+
+    Sequence res;
+    res.ranges.reserve(ranges.size() + other.ranges.size());
+    auto a = ranges.constBegin();
+    auto b = other.ranges.constBegin();
+    while (a != ranges.constEnd() || b != other.ranges.constEnd()) {
+        // Always continue with the range which starts first, and merge it with the previous one if they overlap or touch
+        const Range &next = (b == other.ranges.constEnd() || (a != ranges.constEnd() && a->lo <= b->lo)) ? *a++ : *b++;
+        if (!res.ranges.isEmpty() && (res.ranges.last().hi == UINT_MAX || next.lo <= res.ranges.last().hi + 1)) {
+            res.ranges.last().hi = qMax(res.ranges.last().hi, next.hi);
+        } else {
+            res.ranges << next;
+        }
+    }
+    return res;
+}
+
+Sequence Sequence::intersected(const Sequence &other) const
+{
+    Q_ASSERT(kind != UNLIMITED);
+    Q_ASSERT(other.kind != UNLIMITED);
+
+    Sequence res;
+    auto a = ranges.constBegin();
+    auto b = other.ranges.constBegin();
+    while (a != ranges.constEnd() && b != other.ranges.constEnd()) {
+        const uint lo = qMax(a->lo, b->lo);
+        const uint hi = qMin(a->hi, b->hi);
+        if (lo <= hi)
+            res.ranges << Range(lo, hi);
+        // Drop the range which ends first, it cannot overlap with anything else
+        if (a->hi < b->hi)
+            ++a;
+        else
+            ++b;
+    }
+    return res;
+}
+
 QTextStream &operator<<(QTextStream &stream, const Sequence &s)
 {
     return stream << s.toByteArray();
@@ -138,7 +242,9 @@ QTextStream &operator<<(QTextStream &stream, const Sequence &s)
 bool operator==(const Sequence &a, const Sequence &b)
 {
     // This operator is used only in the test suite, so performance doesn't matter and this was *so* easy to hack together...
-    return a.toVector() == b.toVector();
+    if (!a.isValid() || !b.isValid())
+        return a.isValid() == b.isValid();
+    return a.toByteArray() == b.toByteArray();
 }
 
 }
@@ -24,6 +24,7 @@
 #define IMAP_PARSER_SEQUENCE_H
 
 #include <QString>
+#include <QVector>
 #include "Imap/Parser/Uids.h"
 
 /** @short Namespace for IMAP interaction */
@@ -35,15 +36,30 @@ namespace Imap
   Although named a sequence, there's no reason for a sequence to contain
   only consecutive ranges of numbers. For example, a set of
   { 1, 2, 3, 10, 15, 16, 17 } is perfectly valid sequence.
+
+  The numbers are stored as a sorted list of disjoint, non-adjacent closed
+  intervals, so the memory footprint and the cost of most operations depend
+  on the number of ranges and not on the number of items.
 */
 class Sequence
 {
-    uint lo, hi;
-    Imap::Uids numbers;
+public:
+    /** @short One contiguous range of numbers, both boundaries are inclusive */
+    struct Range {
+        uint lo;
+        uint hi;
+        Range(): lo(0), hi(0) {}
+        Range(const uint lo, const uint hi): lo(lo), hi(hi) {}
+    };
+    typedef QVector<Range> Ranges;
+
+private:
+    uint lo;
+    Ranges ranges;
     enum { DISTINCT, RANGE, UNLIMITED } kind;
 public:
     /** @short Construct an invalid sequence */
-    Sequence(): kind(DISTINCT) {}
+    Sequence(): lo(0), kind(DISTINCT) {}
 
     /** @short Construct a sequence holding only one number
 
@@ -58,7 +74,7 @@ public:
       This sequence can't be expanded ever after. Calling add() on it will
       assert().
     */
-    Sequence(const uint lo, const uint hi): lo(lo), hi(hi), kind(RANGE) {}
+    Sequence(const uint lo, const uint hi);
 
     /** @short Create an "unlimited" sequence
 
@@ -72,9 +88,17 @@ public:
       Note that you can only add numbers to a sequence created by the
       Sequence( const uint num ) constructor. Attempting to do so on other
       kinds of sequences will assert().
+
+      Adding numbers in an ascending order is a constant-time operation.
     */
     Sequence &add(const uint num);
 
+    /** @short Add a closed range of numbers to the sequence
+
+      The same restrictions as for add() apply.
+    */
+    Sequence &addRange(const uint lo, const uint hi);
+
     /** @short Converts sequence to a textual representation suitable for sending over the wire */
     QByteArray toByteArray() const;
 
@@ -87,9 +111,37 @@ public:
     /** @short Return true if the sequence contains at least some items */
     bool isValid() const;
 
+    /** @short Return true if the specified number is a member of this sequence
+
+      Unlimited sequences are treated as if they continued up to the largest possible number.
+    */
+    bool contains(const uint num) const;
+
+    /** @short Number of items in a finite sequence */
+    uint count() const;
+
+    /** @short Access the underlying ranges of a finite sequence */
+    const Ranges &toRanges() const;
+
+    /** @short Return a union of this sequence and the other one
+
+      Neither of these is allowed to be an unlimited sequence. The result is always a distinct sequence, which means that
+      it can be extended by add() afterwards.
+    */
+    Sequence united(const Sequence &other) const;
+
+    /** @short Return an intersection of this sequence and the other one
+
+      The same restrictions as for united() apply. The result might be invalid if these sequences have nothing in common.
+    */
+    Sequence intersected(const Sequence &other) const;
+
 };
 
 bool operator==(const Sequence &a, const Sequence &b);
 
 }
+
+Q_DECLARE_TYPEINFO(Imap::Sequence::Range, Q_PRIMITIVE_TYPE);
+
 #endif /* IMAP_PARSER_SEQUENCE_H */
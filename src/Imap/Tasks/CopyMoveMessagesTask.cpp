@@ -35,17 +35,16 @@ namespace Mailbox
 {
 
 
-CopyMoveMessagesTask::CopyMoveMessagesTask(Model *model, const QModelIndexList &messages_, const QString &targetMailbox,
-                                           const CopyMoveOperation op):
-    ImapTask(model), targetMailbox(targetMailbox), shouldDelete(op == MOVE)
+CopyMoveMessagesTask::CopyMoveMessagesTask(Model *model, const QModelIndex &mailbox, const Sequence &uids,
+                                           const QString &targetMailbox, const CopyMoveOperation op):
+    ImapTask(model), mailboxIndex(mailbox), uidValidity(0), uids(uids), targetMailbox(targetMailbox), shouldDelete(op == MOVE)
 {
-    if (messages_.isEmpty()) {
+    if (!uids.isValid()) {
         throw CantHappen("CopyMoveMessagesTask called with empty message set");
     }
-    Q_FOREACH(const QModelIndex& index, messages_) {
-        messages << index;
+    if (mailboxIndex.isValid()) {
+        uidValidity = dynamic_cast<TreeItemMailbox *>(static_cast<TreeItem *>(mailboxIndex.internalPointer()))->syncState.uidValidity();
     }
-    QModelIndex mailboxIndex = model->findMailboxForItems(messages_);
     conn = model->findTaskResponsibleFor(mailboxIndex);
     conn->addDependentTask(this);
 }
@@ -57,32 +56,29 @@ void CopyMoveMessagesTask::perform()
 
     IMAP_TASK_CHECK_ABORT_DIE;
 
-    Sequence seq;
-    bool first = true;
-
-    Q_FOREACH(const QPersistentModelIndex& index, messages) {
-        if (! index.isValid()) {
-            // FIXME: add proper fix
-            log(QStringLiteral("Some message got removed before we could copy them"));
-        } else {
-            TreeItem *item = static_cast<TreeItem *>(index.internalPointer());
-            Q_ASSERT(item);
-            TreeItemMessage *message = dynamic_cast<TreeItemMessage *>(item);
-            Q_ASSERT(message);
-            if (first) {
-                seq = Sequence(message->uid());
-                first = false;
-            } else {
-                seq.add(message->uid());
-            }
-        }
+    TreeItemMailbox *mailbox = mailboxIndex.isValid() ?
+                dynamic_cast<TreeItemMailbox *>(static_cast<TreeItem *>(mailboxIndex.internalPointer())) : 0;
+    if (mailbox && mailbox->syncState.uidValidity() != uidValidity) {
+        _failed(tr("UIDVALIDITY mismatch: expected %1, got %2")
+                .arg(QString::number(uidValidity), QString::number(mailbox->syncState.uidValidity())));
+        return;
     }
-
-    if (first) {
+    const QList<TreeItemMessage *> messages = mailbox ? model->findMessagesByUids(mailbox, uids) : QList<TreeItemMessage *>();
+    if (messages.isEmpty()) {
         // No valid messages
         _failed(tr("All messages disappeared before we could have copied them"));
         return;
     }
+    if (static_cast<uint>(messages.size()) != uids.count()) {
+        // FIXME: add proper fix
+        log(QStringLiteral("Some message got removed before we could copy them"));
+    }
+
+    Sequence seq(messages.first()->uid());
+    for (int i = 1; i < messages.size(); ++i) {
+        seq.add(messages[i]->uid());
+    }
+    uids = seq;
 
     if (shouldDelete && model->accessParser(parser).capabilities.contains(QStringLiteral("MOVE"))) {
         moveTag = parser->uidMove(seq, targetMailbox);
@@ -106,9 +102,9 @@ bool CopyMoveMessagesTask::handleStateHelper(const Imap::Responses::State *const
                     return true;
                 }
                 // We ignore the _aborted status here, though -- we just want to finish in an "atomic" manner
-                ImapTask *flagTask = new UpdateFlagsTask(model, this, messages, FLAG_ADD_SILENT, QStringLiteral("\\Deleted"));
+                ImapTask *flagTask = new UpdateFlagsTask(model, this, mailboxIndex, uids, FLAG_ADD_SILENT, QStringLiteral("\\Deleted"));
                 if (model->accessParser(parser).capabilities.contains(QStringLiteral("UIDPLUS"))) {
-                    new ExpungeMessagesTask(model, flagTask, messages);
+                    new ExpungeMessagesTask(model, flagTask, mailboxIndex, uids);
                 }
             }
             _completed();
@@ -37,7 +37,8 @@ class CopyMoveMessagesTask : public ImapTask
 {
     Q_OBJECT
 public:
-    CopyMoveMessagesTask(Model *model, const QModelIndexList &messages, const QString &targetMailbox, const CopyMoveOperation op);
+    CopyMoveMessagesTask(Model *model, const QModelIndex &mailbox, const Sequence &uids, const QString &targetMailbox,
+                         const CopyMoveOperation op);
     virtual void perform();
 
     virtual bool handleStateHelper(const Imap::Responses::State *const resp);
@@ -47,7 +48,11 @@ private:
     CommandHandle copyTag;
     CommandHandle moveTag;
     ImapTask *conn;
-    QList<QPersistentModelIndex> messages;
+    QPersistentModelIndex mailboxIndex;
+    /** @short UIDVALIDITY of the mailbox at the time the task was created */
+    uint uidValidity;
+    /** @short UIDs of the messages; once the command is sent, only those which were actually copied */
+    Sequence uids;
     QString targetMailbox;
     bool shouldDelete;
 };
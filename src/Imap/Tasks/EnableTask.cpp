@@ -53,12 +53,18 @@ void EnableTask::perform()
 
 bool EnableTask::handleEnabled(const Responses::Enabled *const resp)
 {
+    bool handled = false;
     Q_FOREACH(const QByteArray &anExtension, resp->extensions) {
         // as soon as at least one of them was requested, let's declare that we've eaten this response
-        if (extensions.contains(anExtension.toUpper()))
-            return true;
+        if (extensions.contains(anExtension.toUpper())) {
+            handled = true;
+            if (anExtension.toUpper() == "UIDONLY") {
+                // RFC 9586: from now on, the server won't use any sequence numbers
+                model->accessParser(parser).uidOnly = true;
+            }
+        }
     }
-    return false;
+    return handled;
 }
 
 bool EnableTask::handleStateHelper(const Imap::Responses::State *const resp)
@@ -33,12 +33,15 @@ namespace Mailbox
 {
 
 
-ExpungeMessagesTask::ExpungeMessagesTask(Model *model, ImapTask *parentTask, const QList<QPersistentModelIndex> &messages):
-    ImapTask(model), conn(parentTask), messages(messages)
+ExpungeMessagesTask::ExpungeMessagesTask(Model *model, ImapTask *parentTask, const QModelIndex &mailbox, const Sequence &uids):
+    ImapTask(model), conn(parentTask), mailboxIndex(mailbox), uidValidity(0), uids(uids)
 {
-    if (messages.isEmpty()) {
+    if (!uids.isValid()) {
         throw CantHappen("ExpungeMessagesTask called with empty message set");
     }
+    if (mailboxIndex.isValid()) {
+        uidValidity = dynamic_cast<TreeItemMailbox *>(static_cast<TreeItem *>(mailboxIndex.internalPointer()))->syncState.uidValidity();
+    }
     Q_ASSERT(conn);
     conn->addDependentTask(this);
 }
@@ -50,32 +53,26 @@ void ExpungeMessagesTask::perform()
 
     IMAP_TASK_CHECK_ABORT_DIE;
 
-    Sequence seq;
-    bool first = true;
-
-    Q_FOREACH(const QPersistentModelIndex& index, messages) {
-        if (! index.isValid()) {
-            // That message is gone already
-        } else {
-            TreeItem *item = static_cast<TreeItem *>(index.internalPointer());
-            Q_ASSERT(item);
-            TreeItemMessage *message = dynamic_cast<TreeItemMessage *>(item);
-            Q_ASSERT(message);
-            if (first) {
-                seq = Sequence(message->uid());
-                first = false;
-            } else {
-                seq.add(message->uid());
-            }
-        }
+    TreeItemMailbox *mailbox = mailboxIndex.isValid() ?
+                dynamic_cast<TreeItemMailbox *>(static_cast<TreeItem *>(mailboxIndex.internalPointer())) : 0;
+    if (mailbox && mailbox->syncState.uidValidity() != uidValidity) {
+        _failed(tr("UIDVALIDITY mismatch: expected %1, got %2")
+                .arg(QString::number(uidValidity), QString::number(mailbox->syncState.uidValidity())));
+        return;
     }
-
-    if (first) {
+    // Some of these messages might be gone already
+    const QList<TreeItemMessage *> messages = mailbox ? model->findMessagesByUids(mailbox, uids) : QList<TreeItemMessage *>();
+    if (messages.isEmpty()) {
         // No valid messages
         _failed(tr("All messages are gone already"));
         return;
     }
 
+    Sequence seq(messages.first()->uid());
+    for (int i = 1; i < messages.size(); ++i) {
+        seq.add(messages[i]->uid());
+    }
+
     if (!model->accessParser(parser).capabilities.contains(QStringLiteral("UIDPLUS"))) {
         _failed(tr("The IMAP server doesn't support the UIDPLUS extension"));
     }
@@ -25,6 +25,7 @@
 
 #include <QPersistentModelIndex>
 #include "ImapTask.h"
+#include "Imap/Parser/Sequence.h"
 
 namespace Imap
 {
@@ -39,7 +40,7 @@ class ExpungeMessagesTask : public ImapTask
 {
     Q_OBJECT
 public:
-    ExpungeMessagesTask(Model *model, ImapTask *parentTask, const QList<QPersistentModelIndex> &messages);
+    ExpungeMessagesTask(Model *model, ImapTask *parentTask, const QModelIndex &mailbox, const Sequence &uids);
     virtual void perform();
 
     virtual bool handleStateHelper(const Imap::Responses::State *const resp);
@@ -48,7 +49,10 @@ public:
 private:
     CommandHandle tag;
     ImapTask *conn;
-    QList<QPersistentModelIndex> messages;
+    QPersistentModelIndex mailboxIndex;
+    /** @short UIDVALIDITY of the mailbox at the time the task was created */
+    uint uidValidity;
+    Sequence uids;
 };
 
 }
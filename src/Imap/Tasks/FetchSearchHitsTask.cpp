@@ -0,0 +1,230 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FetchSearchHitsTask.h"
+#include <QTimer>
+#include "Imap/Model/ItemRoles.h"
+#include "Imap/Model/Model.h"
+#include "Imap/Model/TaskFactory.h"
+#include "OfflineConnectionTask.h"
+#include "OpenConnectionTask.h"
+
+namespace {
+
+/** @short How long to keep the connection open after the last request got answered, in milliseconds */
+const int idleTimeout = 60 * 1000;
+
+}
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+FetchSearchHitsTask::FetchSearchHitsTask(Model *model):
+    ImapTask(model), m_examinedUidValidity(0), m_stopping(false)
+{
+    if (model->networkPolicy() == NETWORK_OFFLINE) {
+        conn = new OfflineConnectionTask(model);
+    } else {
+        conn = model->m_taskFactory->createOpenConnectionTask(model);
+        // Nobody else may use this connection, the mailbox which is open there changes all the time
+        model->accessParser(conn->parser).isReserved = true;
+    }
+    conn->addDependentTask(this);
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(idleTimeout);
+    connect(m_idleTimer, &QTimer::timeout, this, &FetchSearchHitsTask::stop);
+}
+
+void FetchSearchHitsTask::perform()
+{
+    parser = conn->parser;
+    Q_ASSERT(parser);
+    markAsActiveTask();
+
+    IMAP_TASK_CHECK_ABORT_DIE;
+
+    if (m_stopping) {
+        logout();
+        return;
+    }
+    processNext();
+}
+
+void FetchSearchHitsTask::requestMetadata(const QString &mailbox, const uint uidValidity, const Imap::Uids &uids)
+{
+    if (_finished || m_stopping || uids.isEmpty())
+        return;
+
+    auto it = m_queue.begin();
+    while (it != m_queue.end() && (it->mailbox != mailbox || it->uidValidity != uidValidity))
+        ++it;
+    if (it == m_queue.end()) {
+        Request request;
+        request.mailbox = mailbox;
+        request.uidValidity = uidValidity;
+        request.uids = uids;
+        m_queue << request;
+    } else {
+        it->uids += uids;
+    }
+
+    if (parser && m_examineCmd.isEmpty() && m_fetchCmd.isEmpty())
+        processNext();
+}
+
+void FetchSearchHitsTask::stop()
+{
+    m_queue.clear();
+    if (_finished || m_stopping)
+        return;
+    m_stopping = true;
+    if (parser && !_dead) {
+        // The connection is up already, otherwise perform() takes care of this
+        logout();
+    }
+}
+
+void FetchSearchHitsTask::logout()
+{
+    m_idleTimer->stop();
+    // Any responses to the commands which are still on the fly will be ignored by the Model
+    model->accessParser(parser).logoutCmd = parser->logout();
+    model->changeConnectionState(parser, CONN_STATE_LOGOUT);
+    _completed();
+}
+
+void FetchSearchHitsTask::processNext()
+{
+    if (m_queue.isEmpty()) {
+        m_idleTimer->start();
+        return;
+    }
+    m_idleTimer->stop();
+
+    m_current = m_queue.takeFirst();
+    if (m_current.mailbox != m_examinedMailbox) {
+        m_examinedMailbox = m_current.mailbox;
+        m_examinedUidValidity = 0;
+        m_examineCmd = parser->examine(m_current.mailbox);
+    }
+    // The UIDVALIDITY gets checked once the EXAMINE completes. Should it fail, the server deselects the previous mailbox
+    // and this command will fail as well.
+    m_fetchCmd = parser->uidFetch(Sequence::fromVector(m_current.uids),
+                                  QList<QByteArray>() << "FLAGS" << "ENVELOPE" << "INTERNALDATE" << "RFC822.SIZE");
+}
+
+bool FetchSearchHitsTask::handleStateHelper(const Imap::Responses::State *const resp)
+{
+    if (resp->tag.isEmpty()) {
+        if (resp->kind == Responses::BYE)
+            return false;
+        if (!m_examineCmd.isEmpty() && resp->respCode == Responses::UIDVALIDITY) {
+            const Responses::RespData<uint> *const num = dynamic_cast<const Responses::RespData<uint>* const>(resp->respCodeData.data());
+            if (num)
+                m_examinedUidValidity = num->data;
+        }
+        // The rest of the data about the mailbox is of no interest to us
+        return !m_examineCmd.isEmpty();
+    }
+
+    if (resp->tag == m_examineCmd) {
+        m_examineCmd.clear();
+        if (resp->kind != Responses::OK) {
+            log(QStringLiteral("Cannot EXAMINE %1: %2").arg(m_current.mailbox, resp->message));
+            m_examinedMailbox.clear();
+        }
+        return true;
+    } else if (resp->tag == m_fetchCmd) {
+        m_fetchCmd.clear();
+        if (resp->kind != Responses::OK)
+            log(QStringLiteral("UID FETCH failed: %1").arg(resp->message));
+        processNext();
+        return true;
+    }
+    return false;
+}
+
+bool FetchSearchHitsTask::handleNumberResponse(const Imap::Responses::NumberResponse *const resp)
+{
+    // EXISTS, RECENT and EXPUNGE of the examined mailbox do not matter, we do not keep any state about its messages
+    Q_UNUSED(resp);
+    return true;
+}
+
+bool FetchSearchHitsTask::handleFlags(const Imap::Responses::Flags *const resp)
+{
+    Q_UNUSED(resp);
+    return true;
+}
+
+bool FetchSearchHitsTask::handleVanished(const Imap::Responses::Vanished *const resp)
+{
+    Q_UNUSED(resp);
+    return true;
+}
+
+bool FetchSearchHitsTask::handleFetch(const Imap::Responses::Fetch *const resp)
+{
+    if (m_fetchCmd.isEmpty() || m_examinedMailbox.isEmpty() || m_examinedUidValidity != m_current.uidValidity) {
+        // Either an unsolicited update, or the UIDs refer to messages which are gone
+        return true;
+    }
+
+    AbstractCache::MessageDataBundle data;
+    QStringList flags;
+    bool gotEnvelope = false;
+    for (Responses::Fetch::dataType::const_iterator it = resp->data.constBegin(); it != resp->data.constEnd(); ++it) {
+        if (it.key() == "UID") {
+            data.uid = static_cast<const Responses::RespData<uint>&>(*(it.value())).data;
+        } else if (it.key() == "FLAGS") {
+            flags = model->normalizeFlags(static_cast<const Responses::RespData<QStringList>&>(*(it.value())).data);
+        } else if (it.key() == "ENVELOPE") {
+            data.envelope = static_cast<const Responses::RespData<Message::Envelope>&>(*(it.value())).data;
+            gotEnvelope = true;
+        } else if (it.key() == "INTERNALDATE") {
+            data.internalDate = static_cast<const Responses::RespData<QDateTime>&>(*(it.value())).data;
+        } else if (it.key() == "RFC822.SIZE") {
+            data.size = static_cast<const Responses::RespData<quint64>&>(*(it.value())).data;
+        }
+    }
+
+    if (data.uid && gotEnvelope)
+        emit metadataAvailable(m_current.mailbox, m_current.uidValidity, data, flags);
+    return true;
+}
+
+QString FetchSearchHitsTask::debugIdentification() const
+{
+    return QStringLiteral("%1 mailbox(es) in the queue, examined: %2").arg(QString::number(m_queue.size()), m_examinedMailbox);
+}
+
+QVariant FetchSearchHitsTask::taskData(const int role) const
+{
+    return role == RoleTaskCompactName ? QVariant(tr("Downloading search results")) : QVariant();
+}
+
+}
+}
@@ -0,0 +1,98 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAP_FETCHSEARCHHITSTASK_H
+#define IMAP_FETCHSEARCHHITSTASK_H
+
+#include "ImapTask.h"
+#include "Imap/Model/Cache.h"
+#include "Imap/Parser/Uids.h"
+
+class QTimer;
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+/** @short Download the metadata of a few messages without synchronizing their mailboxes
+
+The results of a multi-mailbox search refer to messages from mailboxes which are usually not open. Synchronizing each of
+them just to show some subjects would be very expensive, so this task EXAMINEs the mailboxes one after another and only
+asks for the metadata of the requested UIDs. Nothing gets stored in the Model's tree; the data are only passed on through
+the metadataAvailable() signal.
+
+The task works over a connection of its own which is reserved for it, so that the mailbox which the user has open is not
+affected. The connection is closed when no further requests have arrived for a while.
+*/
+class FetchSearchHitsTask : public ImapTask
+{
+    Q_OBJECT
+public:
+    explicit FetchSearchHitsTask(Model *model);
+    virtual void perform();
+
+    /** @short Ask for the metadata of the @arg uids from the @arg mailbox */
+    void requestMetadata(const QString &mailbox, const uint uidValidity, const Imap::Uids &uids);
+    /** @short Close the connection, the pending requests are forgotten */
+    void stop();
+
+    virtual bool handleStateHelper(const Imap::Responses::State *const resp);
+    virtual bool handleNumberResponse(const Imap::Responses::NumberResponse *const resp);
+    virtual bool handleFlags(const Imap::Responses::Flags *const resp);
+    virtual bool handleFetch(const Imap::Responses::Fetch *const resp);
+    virtual bool handleVanished(const Imap::Responses::Vanished *const resp);
+    virtual QString debugIdentification() const;
+    virtual QVariant taskData(const int role) const;
+    virtual bool needsMailbox() const {return false;}
+
+signals:
+    /** @short The metadata of a message from the @arg mailbox have arrived */
+    void metadataAvailable(const QString &mailbox, const uint uidValidity,
+                           const Imap::Mailbox::AbstractCache::MessageDataBundle &data, const QStringList &flags);
+
+private:
+    void processNext();
+    void logout();
+
+    struct Request {
+        QString mailbox;
+        uint uidValidity;
+        Imap::Uids uids;
+    };
+
+    ImapTask *conn;
+    QList<Request> m_queue;
+    Request m_current;
+    CommandHandle m_examineCmd;
+    CommandHandle m_fetchCmd;
+    /** @short The mailbox which is open on the connection, along with its UIDVALIDITY */
+    QString m_examinedMailbox;
+    uint m_examinedUidValidity;
+    QTimer *m_idleTimer;
+    bool m_stopping;
+};
+
+}
+}
+
+#endif // IMAP_FETCHSEARCHHITSTASK_H
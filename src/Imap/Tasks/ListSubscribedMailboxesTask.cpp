@@ -0,0 +1,97 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ListSubscribedMailboxesTask.h"
+#include "Imap/Model/ItemRoles.h"
+#include "Imap/Model/Model.h"
+#include "GetAnyConnectionTask.h"
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+
+ListSubscribedMailboxesTask::ListSubscribedMailboxesTask(Model *model):
+    ImapTask(model)
+{
+    conn = model->m_taskFactory->createGetAnyConnectionTask(model);
+    conn->addDependentTask(this);
+}
+
+void ListSubscribedMailboxesTask::perform()
+{
+    parser = conn->parser;
+    markAsActiveTask();
+
+    IMAP_TASK_CHECK_ABORT_DIE;
+
+    // LSUB is unambiguous even when some LIST commands are in flight at the same time, and the "*" wildcard
+    // gets us the whole subscription list at once; the parent mailboxes are derived from the names locally.
+    tag = parser->lSub(QLatin1String(""), QStringLiteral("*"));
+}
+
+bool ListSubscribedMailboxesTask::handleList(const Imap::Responses::List *const resp)
+{
+    if (resp->kind != Responses::LSUB)
+        return false;
+
+    m_subscribed << qMakePair(resp->mailbox, resp->separator);
+    return true;
+}
+
+bool ListSubscribedMailboxesTask::handleStateHelper(const Imap::Responses::State *const resp)
+{
+    if (resp->tag.isEmpty())
+        return false;
+
+    if (resp->tag == tag) {
+        if (resp->kind == Responses::OK) {
+            model->setSubscribedMailboxes(m_subscribed);
+            _completed();
+        } else {
+            _failed(tr("LSUB failed"));
+        }
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void ListSubscribedMailboxesTask::_failed(const QString &errorMessage)
+{
+    model->subscribedMailboxesUnavailable();
+    ImapTask::_failed(errorMessage);
+}
+
+QString ListSubscribedMailboxesTask::debugIdentification() const
+{
+    return QStringLiteral("Listing subscribed mailboxes");
+}
+
+QVariant ListSubscribedMailboxesTask::taskData(const int role) const
+{
+    return role == RoleTaskCompactName ? QVariant(tr("Listing subscribed mailboxes")) : QVariant();
+}
+
+}
+}
@@ -0,0 +1,66 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAP_LISTSUBSCRIBEDMAILBOXESTASK_H
+#define IMAP_LISTSUBSCRIBEDMAILBOXESTASK_H
+
+#include <QPair>
+#include "ImapTask.h"
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+/** @short Find out which mailboxes are subscribed
+
+The whole subscription list is obtained through a single LSUB command so that the Model can tell whether a mailbox
+has any subscribed descendants without listing each and every level of the mailbox tree.
+*/
+class ListSubscribedMailboxesTask : public ImapTask
+{
+    Q_OBJECT
+public:
+    explicit ListSubscribedMailboxesTask(Model *model);
+    virtual void perform();
+
+    virtual bool handleStateHelper(const Imap::Responses::State *const resp);
+    virtual bool handleList(const Imap::Responses::List *const resp);
+
+    virtual QString debugIdentification() const;
+    virtual QVariant taskData(const int role) const;
+    virtual bool needsMailbox() const {return false;}
+
+protected:
+    virtual void _failed(const QString &errorMessage);
+
+private:
+    CommandHandle tag;
+    ImapTask *conn;
+    /** @short Names and hierarchy separators of the subscribed mailboxes */
+    QList<QPair<QString, QString>> m_subscribed;
+};
+
+}
+}
+
+#endif // IMAP_LISTSUBSCRIBEDMAILBOXESTASK_H
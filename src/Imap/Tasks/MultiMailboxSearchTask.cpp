@@ -0,0 +1,87 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MultiMailboxSearchTask.h"
+#include <algorithm>
+#include "Imap/Model/ItemRoles.h"
+#include "Imap/Model/Model.h"
+#include "GetAnyConnectionTask.h"
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+MultiMailboxSearchTask::MultiMailboxSearchTask(Model *model, const QStringList &mailboxes, const QStringList &searchConditions):
+    ImapTask(model), mailboxes(mailboxes), searchConditions(searchConditions)
+{
+    conn = model->m_taskFactory->createGetAnyConnectionTask(model);
+    conn->addDependentTask(this);
+}
+
+void MultiMailboxSearchTask::perform()
+{
+    parser = conn->parser;
+    Q_ASSERT(parser);
+    markAsActiveTask();
+
+    IMAP_TASK_CHECK_ABORT_DIE;
+
+    tag = parser->eSearchInSubtrees(mailboxes, "utf-8", searchConditions, QStringList() << QStringLiteral("ALL"));
+}
+
+bool MultiMailboxSearchTask::handleStateHelper(const Imap::Responses::State *const resp)
+{
+    if (resp->tag.isEmpty() || resp->tag != tag)
+        return false;
+
+    if (resp->kind == Responses::OK) {
+        _completed();
+    } else {
+        _failed(tr("Search failed: %1").arg(resp->message));
+    }
+    return true;
+}
+
+bool MultiMailboxSearchTask::handleESearch(const Imap::Responses::ESearch *const resp)
+{
+    if (resp->tag != tag)
+        return false;
+
+    if (resp->mailbox.isEmpty())
+        throw UnexpectedResponseReceived("ESEARCH response to a multi-mailbox search does not say which mailbox it is about", *resp);
+
+    Responses::ESearch::CompareListDataIdentifier<Responses::ESearch::ListData_t> allComparator("ALL");
+    Responses::ESearch::ListData_t::const_iterator allIterator =
+            std::find_if(resp->listData.constBegin(), resp->listData.constEnd(), allComparator);
+    if (allIterator != resp->listData.constEnd() && !allIterator->second.isEmpty())
+        emit matchesFound(resp->mailbox, resp->uidValidity, allIterator->second);
+    return true;
+}
+
+QVariant MultiMailboxSearchTask::taskData(const int role) const
+{
+    return role == RoleTaskCompactName ? QVariant(tr("Searching in mailboxes")) : QVariant();
+}
+
+}
+}
@@ -0,0 +1,64 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAP_MULTIMAILBOXSEARCHTASK_H
+#define IMAP_MULTIMAILBOXSEARCHTASK_H
+
+#include "ImapTask.h"
+#include "Imap/Parser/Uids.h"
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+/** @short Search in several mailboxes at once through the RFC 7377 ESEARCH command
+
+The results are reported per mailbox, as soon as they arrive.
+*/
+class MultiMailboxSearchTask : public ImapTask
+{
+    Q_OBJECT
+public:
+    MultiMailboxSearchTask(Model *model, const QStringList &mailboxes, const QStringList &searchConditions);
+    virtual void perform();
+
+    virtual bool handleStateHelper(const Imap::Responses::State *const resp);
+    virtual bool handleESearch(const Imap::Responses::ESearch *const resp);
+    virtual bool needsMailbox() const {return false;}
+    virtual QVariant taskData(const int role) const;
+
+signals:
+    /** @short Some messages in the @arg mailbox match the search criteria */
+    void matchesFound(const QString &mailbox, const uint uidValidity, const Imap::Uids &uids);
+
+private:
+    ImapTask *conn;
+    CommandHandle tag;
+    QStringList mailboxes;
+    QStringList searchConditions;
+};
+
+}
+}
+
+#endif // IMAP_MULTIMAILBOXSEARCHTASK_H
@@ -31,6 +31,30 @@
 #include "KeepMailboxOpenTask.h"
 #include "UnSelectTask.h"
 
+namespace {
+
+/** @short Rough size of a tag, a command's name and its tagged OK response */
+const int COMMAND_OVERHEAD_BYTES = 32;
+
+/** @short Estimate how many bytes would a UID SEARCH ALL and a FETCH 1:* (FLAGS) take in this mailbox */
+quint64 estimateFullResyncBytes(const Imap::Uids &uids, const QList<QStringList> &flags)
+{
+    quint64 bytes = 2 * COMMAND_OVERHEAD_BYTES;
+    // "* SEARCH 1 2 3\r\n"
+    bytes += 10;
+    Q_FOREACH(const uint uid, uids)
+        bytes += 1 + QByteArray::number(uid).size();
+    // "* 1 FETCH (FLAGS (\Seen))\r\n"
+    for (int i = 0; i < flags.size(); ++i) {
+        bytes += 21 + QByteArray::number(i + 1).size();
+        Q_FOREACH(const QString &flag, flags[i])
+            bytes += 1 + flag.size();
+    }
+    return bytes;
+}
+
+}
+
 namespace Imap
 {
 namespace Mailbox
@@ -95,7 +119,11 @@ void ObtainSynchronizedMailboxTask::perform()
     if (hasQresync && oldSyncState.isUsableForCondstore()) {
         m_usingQresync = true;
         auto oldUidMap = model->cache()->uidMapping(mailbox->mailbox());
-        if (oldUidMap.isEmpty()) {
+        // The sequence numbers cannot be used in the UIDONLY mode. This SELECT might have been pipelined before the server
+        // confirmed the ENABLE UIDONLY, so even the mere request has to be taken into account.
+        const bool uidOnly = model->accessParser(parser).uidOnly
+                || model->accessParser(parser).capabilities.contains(QStringLiteral("UIDONLY"));
+        if (oldUidMap.isEmpty() || uidOnly) {
             selectCmd = parser->selectQresync(mailbox->mailbox(), oldSyncState.uidValidity(),
                                               oldSyncState.highestModSeq());
         } else {
@@ -354,6 +382,11 @@ void ObtainSynchronizedMailboxTask::finalizeSelect()
                 return;
             }
 
+            if (cachedStateIsCurrent(mailbox, list)) {
+                syncFromCachedState(mailbox, list);
+                return;
+            }
+
             if (syncState.exists() == 0) {
                 // This is a special case, the mailbox doesn't contain any messages now.
                 // Let's just save ourselves some work and reuse the "smart" code in the fullMboxSync() here, it will
@@ -413,6 +446,7 @@ void ObtainSynchronizedMailboxTask::fullMboxSync(TreeItemMailbox *mailbox, TreeI
         model->beginRemoveRows(parent, 0, list->m_children.size() - 1);
         auto oldItems = list->m_children;
         list->m_children.clear();
+        list->m_unreadUids.clear();
         model->endRemoveRows();
         qDeleteAll(oldItems);
     }
@@ -531,6 +565,81 @@ void ObtainSynchronizedMailboxTask::syncGeneric(TreeItemMailbox *mailbox, TreeIt
     syncUids(mailbox);
 }
 
+/** @short Can we trust the cached UID map and flags without asking the server about them?
+
+This is the case when the untagged data of the SELECT match the cached state exactly, including the HIGHESTMODSEQ
+which guarantees that no flags have changed in the meanwhile.
+*/
+bool ObtainSynchronizedMailboxTask::cachedStateIsCurrent(TreeItemMailbox *mailbox, TreeItemMsgList *list) const
+{
+    const SyncState &syncState = mailbox->syncState;
+    const QStringList &capabilities = model->accessParser(parser).capabilities;
+    if (!capabilities.contains(QStringLiteral("CONDSTORE")) && !capabilities.contains(QStringLiteral("QRESYNC")))
+        return false;
+
+    if (!syncState.exists() || !syncState.isUsableForCondstore() || !oldSyncState.isUsableForCondstore())
+        return false;
+
+    if (syncState.uidValidity() != oldSyncState.uidValidity() || syncState.uidNext() != oldSyncState.uidNext() ||
+            syncState.exists() != oldSyncState.exists() || syncState.highestModSeq() != oldSyncState.highestModSeq())
+        return false;
+
+    if (!list->m_children.isEmpty()) {
+        // The tree has been populated already, either from the cache or by the previous session
+        if (static_cast<uint>(list->m_children.size()) != syncState.exists())
+            return false;
+        for (int i = 0; i < list->m_children.size(); ++i) {
+            if (static_cast<TreeItemMessage *>(list->m_children[i])->uid() != uidMap[i])
+                return false;
+        }
+    }
+    return true;
+}
+
+/** @short Finish the sync by accepting the cached UID map and flags, without any further commands */
+void ObtainSynchronizedMailboxTask::syncFromCachedState(TreeItemMailbox *mailbox, TreeItemMsgList *list)
+{
+    QList<QStringList> flags;
+    flags.reserve(uidMap.size());
+
+    if (list->m_children.isEmpty()) {
+        QModelIndex parent = list->toIndex(model);
+        model->beginInsertRows(parent, 0, uidMap.size() - 1);
+        list->m_children.reserve(uidMap.size());
+        for (int i = 0; i < uidMap.size(); ++i) {
+            TreeItemMessage *msg = new TreeItemMessage(list);
+            msg->m_offset = i;
+            msg->m_uid = uidMap[i];
+            QStringList cachedFlags = model->cache()->msgFlags(mailbox->mailbox(), msg->m_uid);
+            cachedFlags.removeOne(QStringLiteral("\\Recent"));
+            msg->m_flags = model->normalizeFlags(cachedFlags);
+            list->m_children << msg;
+            flags << msg->m_flags;
+        }
+        model->endInsertRows();
+    } else {
+        for (int i = 0; i < list->m_children.size(); ++i)
+            flags << static_cast<TreeItemMessage *>(list->m_children[i])->m_flags;
+    }
+    list->setFetchStatus(TreeItem::DONE);
+
+    const quint64 savedBytes = estimateFullResyncBytes(uidMap, flags);
+    MailboxSyncStatistics &stats = model->m_syncStatistics;
+    ++stats.cachedResyncs;
+    stats.savedCommands += 2;
+    stats.savedBytes += savedBytes;
+    log(QStringLiteral("Cached state is current, skipping UID SEARCH and FETCH FLAGS (about %1 bytes saved, %2 bytes in %3 syncs so far)")
+        .arg(QString::number(savedBytes), QString::number(stats.savedBytes), QString::number(stats.cachedResyncs)),
+        Common::LOG_MAILBOX_SYNC);
+
+    status = STATE_DONE;
+    emit model->mailboxSyncingProgress(mailboxIndex, status);
+    notifyInterestingMessages(mailbox);
+    mailbox->saveSyncStateAndUids(model);
+    model->changeConnectionState(parser, CONN_STATE_SELECTED);
+    _completed();
+}
+
 void ObtainSynchronizedMailboxTask::syncUids(TreeItemMailbox *mailbox, const uint lowestUidToQuery)
 {
     status = STATE_SYNCING_UIDS;
@@ -542,7 +651,8 @@ void ObtainSynchronizedMailboxTask::syncUids(TreeItemMailbox *mailbox, const uin
         uidSpecification = QStringLiteral("UID %1:*").arg(QString::number(lowestUidToQuery)).toUtf8();
     }
     uidMap.clear();
-    if (model->accessParser(parser).capabilities.contains(QStringLiteral("ESEARCH"))) {
+    // With UIDONLY, the server is going to reply with an ESEARCH anyway
+    if (model->accessParser(parser).capabilities.contains(QStringLiteral("ESEARCH")) || model->accessParser(parser).uidOnly) {
         uidSyncingCmd = parser->uidESearchUid(uidSpecification);
     } else {
         uidSyncingCmd = parser->uidSearchUid(uidSpecification);
@@ -599,12 +709,15 @@ void ObtainSynchronizedMailboxTask::syncFlags(TreeItemMailbox *mailbox)
             useModSeq = oldSyncState.highestModSeq();
         }
     }
+    QMap<QByteArray, quint64> fetchModifier;
     if (useModSeq > 0) {
-        QMap<QByteArray, quint64> fetchModifier;
         fetchModifier["CHANGEDSINCE"] = oldSyncState.highestModSeq();
-        flagsCmd = parser->fetch(Sequence(1, mailbox->syncState.exists()), QStringList() << QStringLiteral("FLAGS"), fetchModifier);
+    }
+    if (model->accessParser(parser).uidOnly) {
+        // There are no sequence numbers in the UIDONLY mode; the UIDs are known by now, so the replies can be matched by them
+        flagsCmd = parser->uidFetch(Sequence::startingAt(1), QList<QByteArray>() << "FLAGS", fetchModifier);
     } else {
-        flagsCmd = parser->fetch(Sequence(1, mailbox->syncState.exists()), QStringList() << QStringLiteral("FLAGS"));
+        flagsCmd = parser->fetch(Sequence(1, mailbox->syncState.exists()), QStringList() << QStringLiteral("FLAGS"), fetchModifier);
     }
     list->m_numberFetchingStatus = TreeItem::LOADING;
     emit model->mailboxSyncingProgress(mailboxIndex, status);
@@ -995,8 +1108,7 @@ bool ObtainSynchronizedMailboxTask::handleFetch(const Imap::Responses::Fetch *co
     TreeItemMessage *changedMessage = 0;
     mailbox->handleFetchResponse(model, *resp, changedParts, changedMessage, m_usingQresync);
     if (changedMessage) {
-        QModelIndex index = changedMessage->toIndex(model);
-        emit model->dataChanged(index, index);
+        model->queueDataChanged(changedMessage);
         if (mailbox->syncState.uidNext() <= changedMessage->uid()) {
             mailbox->syncState.setUidNext(changedMessage->uid() + 1);
         }
@@ -1059,6 +1171,7 @@ void ObtainSynchronizedMailboxTask::applyUids(TreeItemMailbox *mailbox)
             TreeItemMessage *msg = static_cast<TreeItemMessage*>(list->m_children[i]);
             msg->m_uid = uidMap[uidOffset];
             msg->m_offset = i;
+            list->updateUnreadIndex(msg);
             QModelIndex idx = model->createIndex(i, 0, msg);
             emit model->dataChanged(idx, idx);
             if (msg->accessFetchStatus() == TreeItem::LOADING) {
@@ -70,6 +70,8 @@ private:
     void syncNoNewNoDeletions(TreeItemMailbox *mailbox, TreeItemMsgList *list);
     void syncOnlyAdditions(TreeItemMailbox *mailbox, TreeItemMsgList *list);
     void syncGeneric(TreeItemMailbox *mailbox, TreeItemMsgList *list);
+    bool cachedStateIsCurrent(TreeItemMailbox *mailbox, TreeItemMsgList *list) const;
+    void syncFromCachedState(TreeItemMailbox *mailbox, TreeItemMsgList *list);
 
     void applyUids(TreeItemMailbox *mailbox);
     void finalizeSearch();
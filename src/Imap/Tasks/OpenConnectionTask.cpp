@@ -427,6 +427,11 @@ void OpenConnectionTask::onComplete()
             extensions << "QRESYNC";
         }
 
+        if (model->accessParser(parser).capabilities.contains(QStringLiteral("UIDONLY"))) {
+            // The mode is only switched on once the server confirms it, see EnableTask::handleEnabled()
+            extensions << "UIDONLY";
+        }
+
         if (!extensions.isEmpty()) {
             model->m_taskFactory->createEnableTask(model, this, extensions)->perform();
         }
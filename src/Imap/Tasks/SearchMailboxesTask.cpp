@@ -0,0 +1,201 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SearchMailboxesTask.h"
+#include <algorithm>
+#include "Imap/Model/ItemRoles.h"
+#include "Imap/Model/Model.h"
+#include "Imap/Model/TaskFactory.h"
+#include "OfflineConnectionTask.h"
+#include "OpenConnectionTask.h"
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+SearchMailboxesTask::SearchMailboxesTask(Model *model, const QStringList &searchConditions):
+    ImapTask(model), m_searchConditions(searchConditions), m_uidValidity(0), m_examineFailed(false), m_stopping(false)
+{
+    if (model->networkPolicy() == NETWORK_OFFLINE) {
+        conn = new OfflineConnectionTask(model);
+    } else {
+        conn = model->m_taskFactory->createOpenConnectionTask(model);
+        // Nobody else may use this connection, the mailbox which is open there changes all the time
+        model->accessParser(conn->parser).isReserved = true;
+    }
+    conn->addDependentTask(this);
+    if (m_searchConditions.isEmpty())
+        m_searchConditions << QStringLiteral("ALL");
+}
+
+void SearchMailboxesTask::perform()
+{
+    parser = conn->parser;
+    Q_ASSERT(parser);
+    markAsActiveTask();
+
+    IMAP_TASK_CHECK_ABORT_DIE;
+
+    if (m_stopping) {
+        logout();
+        return;
+    }
+    searchNextMailbox();
+}
+
+void SearchMailboxesTask::searchMailbox(const QString &mailbox)
+{
+    if (_finished || m_stopping)
+        return;
+
+    Q_ASSERT(m_nextMailbox.isEmpty());
+    m_nextMailbox = mailbox;
+    if (parser && m_examineCmd.isEmpty() && m_searchCmd.isEmpty())
+        searchNextMailbox();
+}
+
+void SearchMailboxesTask::stop()
+{
+    m_nextMailbox.clear();
+    if (_finished || m_stopping)
+        return;
+    m_stopping = true;
+    if (parser && !_dead) {
+        // The connection is up already, otherwise perform() takes care of this
+        logout();
+    }
+}
+
+void SearchMailboxesTask::logout()
+{
+    // Any responses to the commands which are still on the fly will be ignored by the Model
+    model->accessParser(parser).logoutCmd = parser->logout();
+    model->changeConnectionState(parser, CONN_STATE_LOGOUT);
+    _completed();
+}
+
+void SearchMailboxesTask::searchNextMailbox()
+{
+    if (m_nextMailbox.isEmpty())
+        return;
+
+    m_mailbox = m_nextMailbox;
+    m_nextMailbox.clear();
+    m_uidValidity = 0;
+    m_examineFailed = false;
+    m_uids.clear();
+    m_examineCmd = parser->examine(m_mailbox);
+    // Should the EXAMINE fail, the server deselects the previous mailbox and the search fails as well
+    m_searchCmd = parser->uidSearch(m_searchConditions,
+                                    model->m_capabilitiesBlacklist.contains(QStringLiteral("X-NO-UTF8-SEARCH")) ? QByteArray() : "utf-8");
+}
+
+bool SearchMailboxesTask::handleStateHelper(const Imap::Responses::State *const resp)
+{
+    if (resp->tag.isEmpty()) {
+        if (resp->kind == Responses::BYE)
+            return false;
+        if (!m_examineCmd.isEmpty() && resp->respCode == Responses::UIDVALIDITY) {
+            const Responses::RespData<uint> *const num = dynamic_cast<const Responses::RespData<uint>* const>(resp->respCodeData.data());
+            if (num)
+                m_uidValidity = num->data;
+        }
+        // The rest of the data about the mailbox is of no interest to us
+        return !m_examineCmd.isEmpty();
+    }
+
+    if (resp->tag == m_examineCmd) {
+        m_examineCmd.clear();
+        if (resp->kind != Responses::OK) {
+            log(QStringLiteral("Cannot EXAMINE %1: %2").arg(m_mailbox, resp->message));
+            m_examineFailed = true;
+        }
+        return true;
+    } else if (resp->tag == m_searchCmd) {
+        m_searchCmd.clear();
+        if (resp->kind != Responses::OK) {
+            log(QStringLiteral("Cannot search %1: %2").arg(m_mailbox, resp->message));
+            m_examineFailed = true;
+        }
+        const uint uidValidity = m_examineFailed ? 0 : m_uidValidity;
+        Imap::Uids uids;
+        if (uidValidity) {
+            uids.swap(m_uids);
+            std::sort(uids.begin(), uids.end());
+            uids.erase(std::unique(uids.begin(), uids.end()), uids.end());
+        }
+        m_uids.clear();
+        // The receiver will pass another mailbox or stop us right away
+        emit mailboxSearched(m_mailbox, uidValidity, uids);
+        if (!_finished)
+            searchNextMailbox();
+        return true;
+    }
+    return false;
+}
+
+bool SearchMailboxesTask::handleNumberResponse(const Imap::Responses::NumberResponse *const resp)
+{
+    // EXISTS, RECENT and EXPUNGE of the examined mailbox do not matter, we do not keep any state about its messages
+    Q_UNUSED(resp);
+    return true;
+}
+
+bool SearchMailboxesTask::handleFlags(const Imap::Responses::Flags *const resp)
+{
+    Q_UNUSED(resp);
+    return true;
+}
+
+bool SearchMailboxesTask::handleFetch(const Imap::Responses::Fetch *const resp)
+{
+    Q_UNUSED(resp);
+    return true;
+}
+
+bool SearchMailboxesTask::handleVanished(const Imap::Responses::Vanished *const resp)
+{
+    Q_UNUSED(resp);
+    return true;
+}
+
+bool SearchMailboxesTask::handleSearch(const Imap::Responses::Search *const resp)
+{
+    // The matches can be split into several responses
+    if (!m_searchCmd.isEmpty())
+        m_uids += resp->items;
+    return true;
+}
+
+QString SearchMailboxesTask::debugIdentification() const
+{
+    return QStringLiteral("searching: %1, next: %2").arg(m_mailbox, m_nextMailbox);
+}
+
+QVariant SearchMailboxesTask::taskData(const int role) const
+{
+    return role == RoleTaskCompactName ? QVariant(tr("Searching mailboxes")) : QVariant();
+}
+
+}
+}
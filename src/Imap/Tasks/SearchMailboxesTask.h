@@ -0,0 +1,89 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAP_SEARCHMAILBOXESTASK_H
+#define IMAP_SEARCHMAILBOXESTASK_H
+
+#include "ImapTask.h"
+#include "Imap/Parser/Uids.h"
+
+namespace Imap
+{
+namespace Mailbox
+{
+
+/** @short Search several mailboxes one after another without synchronizing them
+
+This is what a search which spans several mailboxes falls back to when the server does not support MULTISEARCH. Each
+mailbox is EXAMINEd and searched via UID SEARCH; nothing about its messages gets stored in the Model's tree.
+
+The task works over a connection of its own which is reserved for it, so that the mailbox which the user has open is not
+affected. Several of these tasks can run in parallel. The owner hands out the mailboxes one at a time through
+searchMailbox(), and it shall either pass the next one or call stop() once the mailboxSearched() signal arrives.
+*/
+class SearchMailboxesTask : public ImapTask
+{
+    Q_OBJECT
+public:
+    SearchMailboxesTask(Model *model, const QStringList &searchConditions);
+    virtual void perform();
+
+    /** @short Search the @arg mailbox as soon as the connection is ready */
+    void searchMailbox(const QString &mailbox);
+    /** @short Close the connection, any search which is in progress is forgotten */
+    void stop();
+
+    virtual bool handleStateHelper(const Imap::Responses::State *const resp);
+    virtual bool handleNumberResponse(const Imap::Responses::NumberResponse *const resp);
+    virtual bool handleFlags(const Imap::Responses::Flags *const resp);
+    virtual bool handleFetch(const Imap::Responses::Fetch *const resp);
+    virtual bool handleVanished(const Imap::Responses::Vanished *const resp);
+    virtual bool handleSearch(const Imap::Responses::Search *const resp);
+    virtual QString debugIdentification() const;
+    virtual QVariant taskData(const int role) const;
+    virtual bool needsMailbox() const {return false;}
+
+signals:
+    /** @short The @arg mailbox has been searched; the @arg uidValidity is zero when it could not be examined or searched */
+    void mailboxSearched(const QString &mailbox, const uint uidValidity, const Imap::Uids &uids);
+
+private:
+    void searchNextMailbox();
+    void logout();
+
+    ImapTask *conn;
+    QStringList m_searchConditions;
+    /** @short The mailbox to search once the current one is done */
+    QString m_nextMailbox;
+    QString m_mailbox;
+    CommandHandle m_examineCmd;
+    CommandHandle m_searchCmd;
+    uint m_uidValidity;
+    bool m_examineFailed;
+    Imap::Uids m_uids;
+    bool m_stopping;
+};
+
+}
+}
+
+#endif // IMAP_SEARCHMAILBOXESTASK_H
@@ -72,23 +72,7 @@ bool SubscribeUnsubscribeTask::handleStateHelper(const Imap::Responses::State *c
 
     if (resp->tag == tag) {
         if (resp->kind == Responses::OK) {
-            TreeItemMailbox *mailbox = dynamic_cast<TreeItemMailbox *>(model->findMailboxByName(mailboxName));
-            QString subscribed = QStringLiteral("\\SUBSCRIBED");
-            switch (operation) {
-            case SUBSCRIBE:
-                if (mailbox && !mailbox->m_metadata.flags.contains(subscribed)) {
-                    mailbox->m_metadata.flags.append(subscribed);
-                }
-                break;
-            case UNSUBSCRIBE:
-                if (mailbox) {
-                    mailbox->m_metadata.flags.removeOne(subscribed);
-                }
-            }
-            if (mailbox) {
-                auto index = mailbox->toIndex(model);
-                emit model->dataChanged(index, index);
-            }
+            model->updateSubscription(mailboxName, operation == SUBSCRIBE);
             _completed();
         } else {
             _failed(tr("SUBSCRIBE/UNSUBSCRIBE has failed"));
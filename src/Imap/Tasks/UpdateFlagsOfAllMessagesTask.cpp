@@ -21,12 +21,21 @@
 */
 
 
+#include <algorithm>
+#include <QTimer>
 #include "UpdateFlagsOfAllMessagesTask.h"
 #include "Imap/Model/ItemRoles.h"
 #include "Imap/Model/MailboxTree.h"
 #include "Imap/Model/Model.h"
 #include "KeepMailboxOpenTask.h"
 
+namespace {
+
+/** @short For how long can a single batch of the local flag updates block the event loop */
+const qint64 LOCAL_UPDATE_SLICE_MSECS = 10;
+
+}
+
 namespace Imap
 {
 namespace Mailbox
@@ -34,7 +43,8 @@ namespace Mailbox
 
 UpdateFlagsOfAllMessagesTask::UpdateFlagsOfAllMessagesTask(Model *model, const QModelIndex &mailboxIndex,
                                                            const FlagsOperation flagOperation, const QString &flags):
-    ImapTask(model), flagOperation(flagOperation), flags(flags), mailboxIndex(mailboxIndex)
+    ImapTask(model), flagOperation(flagOperation), flags(flags), mailboxIndex(mailboxIndex), m_nextUidIndex(0),
+    m_longestSlice(0), m_slices(0)
 {
     Q_ASSERT(mailboxIndex.isValid());
     Q_ASSERT(flagOperation == Imap::Mailbox::FLAG_ADD || flagOperation == Imap::Mailbox::FLAG_ADD_SILENT);
@@ -51,7 +61,12 @@ void UpdateFlagsOfAllMessagesTask::perform()
     IMAP_TASK_CHECK_ABORT_DIE;
 
     Sequence seq = Sequence::startingAt(1);
-    tag = parser->store(seq, toImapString(flagOperation), flags);
+    if (model->accessParser(parser).uidOnly) {
+        // Both refer to all messages, but the plain STORE is not allowed in the UIDONLY mode
+        tag = parser->uidStore(seq, toImapString(flagOperation), flags);
+    } else {
+        tag = parser->store(seq, toImapString(flagOperation), flags);
+    }
 }
 
 bool UpdateFlagsOfAllMessagesTask::handleStateHelper(const Imap::Responses::State *const resp)
@@ -65,38 +80,27 @@ bool UpdateFlagsOfAllMessagesTask::handleStateHelper(const Imap::Responses::Stat
             if (!mailbox) {
                 // There isn't much to be done here -- let's assume that the index has disappeared.
                 // The flags will be resynced the next time we open that mailbox.
-                _failed(QStringLiteral("Mailbox is gone"));
+                _failed(tr("Mailbox is gone"));
                 return true;
             }
             Q_ASSERT(mailbox);
             TreeItemMsgList *list = dynamic_cast<TreeItemMsgList*>(mailbox->m_children [0]);
             Q_ASSERT(list);
 
-            Q_FOREACH (TreeItem *item, list->m_children) {
-                TreeItemMessage *message = dynamic_cast<TreeItemMessage *>(item);
-                Q_ASSERT(message);
-
-                if (message->uid() == 0) {
-                    // UID not determined yet, so we cannot really modify its flags
-                    continue;
-                }
-
-                Q_ASSERT(flagOperation == Imap::Mailbox::FLAG_ADD || flagOperation == Imap::Mailbox::FLAG_ADD_SILENT);
-                QStringList newFlags = message->m_flags;
-                if (!newFlags.contains(flags)) {
-                    newFlags << flags;
-                    message->setFlags(list, model->normalizeFlags(newFlags));
-                    model->cache()->setMsgFlags(mailbox->mailbox(), message->uid(), newFlags);
-                    QModelIndex messageIndex = model->createIndex(message->m_offset, 0, message);
-
-                    // emitting dataChanged() separately for each message in the mailbox:
-                    // Trojita model assmues that dataChanged is emitted individually
-                    model->dataChanged(messageIndex, messageIndex);
-                }
+            // Only the messages which were known when the server confirmed the change are affected
+            m_uids.clear();
+            m_uids.reserve(list->m_children.size());
+            for (TreeItemChildrenList::const_iterator it = list->m_children.constBegin(); it != list->m_children.constEnd(); ++it) {
+                // Messages whose UID is not determined yet cannot really get their flags modified
+                if (const uint uid = static_cast<TreeItemMessage *>(*it)->uid())
+                    m_uids << uid;
             }
-            model->emitMessageCountChanged(mailbox);
-            list->fetchNumbers(model);
-            _completed();
+            m_mailboxName = mailbox->mailbox();
+            model->cache()->addMsgFlag(m_mailboxName, m_uids, flags);
+            connect(model, &Model::messageFlagsReceived, this, &UpdateFlagsOfAllMessagesTask::slotMessageFlagsReceived);
+
+            m_localUpdateTimer.start();
+            applyFlagsLocally();
         } else {
             _failed(tr("Failed to update Mailbox FLAGS"));
         }
@@ -105,6 +109,88 @@ bool UpdateFlagsOfAllMessagesTask::handleStateHelper(const Imap::Responses::Stat
     return false;
 }
 
+void UpdateFlagsOfAllMessagesTask::applyFlagsLocally()
+{
+    if (isFinished())
+        return;
+
+    TreeItemMailbox *mailbox = model->mailboxForSomeItem(mailboxIndex);
+    if (!mailbox) {
+        _failed(tr("Mailbox is gone"));
+        return;
+    }
+    TreeItemMsgList *list = dynamic_cast<TreeItemMsgList*>(mailbox->m_children [0]);
+    Q_ASSERT(list);
+
+    QElapsedTimer slice;
+    slice.start();
+    ++m_slices;
+    model->beginBatchedChanges();
+
+    // Messages which arrived after the snapshot are left alone, and those which got expunged in the meanwhile are skipped
+    bool done = true;
+    for (; m_nextUidIndex < m_uids.size(); ++m_nextUidIndex) {
+        if (slice.hasExpired(LOCAL_UPDATE_SLICE_MSECS)) {
+            done = false;
+            break;
+        }
+        const uint uid = m_uids[m_nextUidIndex];
+        if (m_reportedUids.contains(uid))
+            continue;
+        auto it = model->findMessageOrNextOneByUid(list, uid);
+        if (it == list->m_children.end() || static_cast<TreeItemMessage *>(*it)->uid() != uid)
+            continue;
+        TreeItemMessage *message = static_cast<TreeItemMessage *>(*it);
+        Q_ASSERT(flagOperation == Imap::Mailbox::FLAG_ADD || flagOperation == Imap::Mailbox::FLAG_ADD_SILENT);
+        if (!message->m_flags.contains(flags)) {
+            QStringList newFlags = message->m_flags;
+            newFlags << flags;
+            message->setFlags(list, model->normalizeFlags(newFlags));
+            // The Model merges these into ranges of adjacent messages
+            model->queueDataChanged(message);
+        }
+    }
+
+    if (done) {
+        if (list->m_numberFetchingStatus == TreeItem::DONE) {
+            // The counts were kept up to date by setFlags()
+            model->queueMessageCountChanged(mailbox);
+        } else if (list->fetched()) {
+            list->recalcVariousMessageCounts(model);
+        } else {
+            // Nothing is known about the messages, so there's no way around asking the server
+            list->fetchNumbers(model);
+        }
+    }
+
+    model->endBatchedChanges();
+    m_longestSlice = qMax(m_longestSlice, slice.elapsed());
+
+    if (!done) {
+        QTimer::singleShot(0, this, &UpdateFlagsOfAllMessagesTask::applyFlagsLocally);
+        return;
+    }
+
+    log(QStringLiteral("Flags of the messages updated in %1 ms, %2 slices, the longest one took %3 ms")
+        .arg(QString::number(m_localUpdateTimer.elapsed()), QString::number(m_slices), QString::number(m_longestSlice)));
+    _completed();
+}
+
+void UpdateFlagsOfAllMessagesTask::slotMessageFlagsReceived(const QString &mailbox, const uint uid, const QStringList &currentFlags)
+{
+    if (isFinished() || mailbox != m_mailboxName)
+        return;
+
+    // The messages are in the order of their UIDs, and those before m_nextUidIndex are already done
+    if (!std::binary_search(m_uids.constBegin() + m_nextUidIndex, m_uids.constEnd(), uid))
+        return;
+
+    // These flags are newer than our STORE. The cache got the new flag in advance, so it has to be told as well, even when
+    // the tree has not noticed any change.
+    m_reportedUids.insert(uid);
+    model->cache()->setMsgFlags(mailbox, uid, currentFlags);
+}
+
 QVariant UpdateFlagsOfAllMessagesTask::taskData(const int role) const
 {
     return role == RoleTaskCompactName ? QVariant(tr("Saving mailbox state")) : QVariant();
@@ -24,8 +24,11 @@
 #define IMAP_UPDATEFLAGSOFALLMESSAGES_TASK_H
 
 
+#include <QElapsedTimer>
 #include <QPersistentModelIndex>
+#include <QSet>
 #include "Imap/Model/FlagsOperation.h"
+#include "Imap/Parser/Uids.h"
 #include "ImapTask.h"
 
 namespace Imap
@@ -37,6 +40,12 @@ namespace Mailbox
 
 The purpose of this task is to make sure the IMAP flags for all messages of
 a given mailbox are changed.
+
+Once the server confirms the change, the cache is updated in one go. The messages in the tree are updated in short
+slices, returning to the event loop in between, so that even huge mailboxes do not block the GUI. Only the messages
+which were known at the time of the server's confirmation are updated; anything which arrives later keeps its flags.
+When the server reports the flags of a message which has not been updated yet, these flags win, both in the tree and
+in the cache.
 */
 class UpdateFlagsOfAllMessagesTask : public ImapTask
 {
@@ -51,12 +60,29 @@ public:
     virtual bool handleStateHelper(const Imap::Responses::State *const resp);
     virtual QVariant taskData(const int role) const;
     virtual bool needsMailbox() const {return true;}
+private slots:
+    /** @short Update the flags of the next batch of messages in the tree */
+    void applyFlagsLocally();
+    /** @short Leave the message alone if the server has told us about its flags while the update was pending */
+    void slotMessageFlagsReceived(const QString &mailbox, const uint uid, const QStringList &currentFlags);
 private:
     CommandHandle tag;
     ImapTask *conn;
     FlagsOperation flagOperation;
     QString flags;
-    QModelIndex mailboxIndex;
+    QPersistentModelIndex mailboxIndex;
+    /** @short UIDs of the messages which were in the mailbox when the server confirmed the change */
+    Imap::Uids m_uids;
+    /** @short Name of the mailbox at the time of the server's confirmation */
+    QString m_mailboxName;
+    /** @short UIDs from m_uids whose flags were reported by the server before they got updated in the tree */
+    QSet<uint> m_reportedUids;
+    /** @short Position in m_uids of the next message to update */
+    int m_nextUidIndex;
+    /** @short Time spent in the slices of the local update, and the longest one */
+    QElapsedTimer m_localUpdateTimer;
+    qint64 m_longestSlice;
+    int m_slices;
 };
 
 }
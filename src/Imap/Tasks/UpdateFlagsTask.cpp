@@ -33,24 +33,26 @@ namespace Imap
 namespace Mailbox
 {
 
-UpdateFlagsTask::UpdateFlagsTask(Model *model, const QModelIndexList &messages_, const FlagsOperation flagOperation, const QString &flags):
-    ImapTask(model), copyMove(0), flagOperation(flagOperation), flags(flags)
+UpdateFlagsTask::UpdateFlagsTask(Model *model, const QModelIndex &mailbox, const Sequence &uids, const FlagsOperation flagOperation,
+                                 const QString &flags):
+    ImapTask(model), copyMove(0), mailboxIndex(mailbox), uidValidity(0), uids(uids), flagOperation(flagOperation), flags(flags)
 {
-    if (messages_.isEmpty()) {
-        throw CantHappen("UpdateFlagsTask called with empty message set");
+    // The UIDs are only meaningful within this UIDVALIDITY
+    if (mailboxIndex.isValid()) {
+        uidValidity = dynamic_cast<TreeItemMailbox *>(static_cast<TreeItem *>(mailboxIndex.internalPointer()))->syncState.uidValidity();
     }
-    Q_FOREACH(const QModelIndex& index, messages_) {
-        messages << index;
-    }
-    QModelIndex mailboxIndex = model->findMailboxForItems(messages_);
     conn = model->findTaskResponsibleFor(mailboxIndex);
     conn->addDependentTask(this);
 }
 
-UpdateFlagsTask::UpdateFlagsTask(Model *model, CopyMoveMessagesTask *copyTask, const QList<QPersistentModelIndex> &messages,
+UpdateFlagsTask::UpdateFlagsTask(Model *model, CopyMoveMessagesTask *copyTask, const QModelIndex &mailbox, const Sequence &uids,
                                  const FlagsOperation flagOperation, const QString &flags):
-    ImapTask(model), conn(0), copyMove(copyTask), messages(messages), flagOperation(flagOperation), flags(flags)
+    ImapTask(model), conn(0), copyMove(copyTask), mailboxIndex(mailbox), uidValidity(0), uids(uids), flagOperation(flagOperation),
+    flags(flags)
 {
+    if (mailboxIndex.isValid()) {
+        uidValidity = dynamic_cast<TreeItemMailbox *>(static_cast<TreeItem *>(mailboxIndex.internalPointer()))->syncState.uidValidity();
+    }
     copyTask->addDependentTask(this);
 }
 
@@ -65,62 +67,69 @@ void UpdateFlagsTask::perform()
 
     IMAP_TASK_CHECK_ABORT_DIE;
 
-    Sequence seq;
-    bool first = true;
+    if (!mailboxIndex.isValid()) {
+        _failed(tr("Mailbox disappeared"));
+        return;
+    }
+    TreeItemMailbox *mailbox = dynamic_cast<TreeItemMailbox *>(static_cast<TreeItem *>(mailboxIndex.internalPointer()));
+    Q_ASSERT(mailbox);
+    if (mailbox->syncState.uidValidity() != uidValidity) {
+        _failed(tr("UIDVALIDITY mismatch: expected %1, got %2")
+                .arg(QString::number(uidValidity), QString::number(mailbox->syncState.uidValidity())));
+        return;
+    }
 
-    Q_FOREACH(const QPersistentModelIndex& index, messages) {
-        if (!index.isValid()) {
-            log(QStringLiteral("Some message got removed before we could update its flags"), Common::LOG_MESSAGES);
-        } else {
-            TreeItem *item = static_cast<TreeItem *>(index.internalPointer());
-            Q_ASSERT(item);
-            TreeItemMessage *message = dynamic_cast<TreeItemMessage *>(item);
-            Q_ASSERT(message);
-            if (first) {
-                seq = Sequence(message->uid());
-                first = false;
-            } else {
-                seq.add(message->uid());
-            }
-            switch (flagOperation) {
-            case FLAG_ADD:
-            case FLAG_REMOVE:
-            case FLAG_USE_THESE:
-                // we aren't supposed to update them ourselves; the IMAP server will tell us
-                break;
-            case FLAG_REMOVE_SILENT:
-            {
-                TreeItemMsgList *list = dynamic_cast<TreeItemMsgList*>(message->parent());
-                Q_ASSERT(list);
-                QStringList newFlags = message->m_flags;
-                newFlags.removeOne(flags);
-                message->setFlags(list, newFlags);
+    // Only the messages which are still around are affected; they come sorted by UID
+    const QList<TreeItemMessage *> messages = model->findMessagesByUids(mailbox, uids);
+    if (messages.isEmpty()) {
+        _failed(tr("All messages got removed before we could've updated their flags"));
+        return;
+    }
+    if (static_cast<uint>(messages.size()) != uids.count()) {
+        log(QStringLiteral("Some message got removed before we could update its flags"), Common::LOG_MESSAGES);
+    }
+
+    Sequence seq(messages.first()->uid());
+    for (int i = 1; i < messages.size(); ++i) {
+        seq.add(messages[i]->uid());
+    }
+
+    switch (flagOperation) {
+    case FLAG_ADD:
+    case FLAG_REMOVE:
+    case FLAG_USE_THESE:
+        // we aren't supposed to update them ourselves; the IMAP server will tell us
+        break;
+    case FLAG_REMOVE_SILENT:
+    case FLAG_ADD_SILENT:
+    {
+        // The server won't tell us about the result, so let's update everything in one go
+        TreeItemMsgList *list = dynamic_cast<TreeItemMsgList*>(messages.first()->parent());
+        Q_ASSERT(list);
+        model->beginBatchedChanges();
+        Q_FOREACH(TreeItemMessage *message, messages) {
+            QStringList newFlags = message->m_flags;
+            if (flagOperation == FLAG_REMOVE_SILENT) {
+                if (!newFlags.removeOne(flags))
+                    continue;
                 // we don't have to either re-sort or call Model::normalizeFlags again from this context;
                 // this will change when the model starts de-duplicating whole lists
-                model->cache()->setMsgFlags(static_cast<TreeItemMailbox*>(list->parent())->mailbox(), message->uid(), newFlags);
-                break;
-            }
-            case FLAG_ADD_SILENT:
-            {
-                TreeItemMsgList *list = dynamic_cast<TreeItemMsgList*>(message->parent());
-                Q_ASSERT(list);
-                QStringList newFlags = message->m_flags;
-                if (!newFlags.contains(flags)) {
-                    newFlags << flags;
-                    message->setFlags(list, model->normalizeFlags(newFlags));
-                    model->cache()->setMsgFlags(static_cast<TreeItemMailbox*>(list->parent())->mailbox(), message->uid(), newFlags);
-                }
-                break;
-            }
+                message->setFlags(list, newFlags);
+            } else {
+                if (newFlags.contains(flags))
+                    continue;
+                newFlags << flags;
+                message->setFlags(list, model->normalizeFlags(newFlags));
             }
+            model->cache()->setMsgFlags(mailbox->mailbox(), message->uid(), newFlags);
+            model->queueDataChanged(message);
         }
+        model->queueMessageCountChanged(mailbox);
+        model->endBatchedChanges();
+        break;
     }
-
-    if (first) {
-        // No valid messages
-        _failed(tr("All messages got removed before we could've updated their flags"));
-        return;
     }
+
     tag = parser->uidStore(seq, toImapString(flagOperation), flags);
 }
 
@@ -25,6 +25,7 @@
 
 #include <QPersistentModelIndex>
 #include "Imap/Model/FlagsOperation.h"
+#include "Imap/Parser/Sequence.h"
 #include "ImapTask.h"
 
 namespace Imap
@@ -37,7 +38,8 @@ class CopyMoveMessagesTask;
 /** @short Update message flags for a particular message set
 
 The purpose of this task is to make sure the IMAP flags for a set of messages from
-a given mailbox are changed.
+a given mailbox are changed. The messages are identified by their UIDs, so that even
+a huge selection does not have to be tracked through persistent indexes.
 */
 class UpdateFlagsTask : public ImapTask
 {
@@ -49,10 +51,11 @@ public:
     should be FLAGS, +FLAGS or -FLAGS (all of them optionally with the ".silent" modifier),
     and the desired change (actual flags) is passed in the @arg flags argument.
     */
-    UpdateFlagsTask(Model *model, const QModelIndexList &messages, const FlagsOperation flagOperation, const QString &flags);
+    UpdateFlagsTask(Model *model, const QModelIndex &mailbox, const Sequence &uids, const FlagsOperation flagOperation,
+                    const QString &flags);
 
     /** @short Marking moved messages as deleted */
-    UpdateFlagsTask(Model *model, CopyMoveMessagesTask *copyTask, const QList<QPersistentModelIndex> &messages,
+    UpdateFlagsTask(Model *model, CopyMoveMessagesTask *copyTask, const QModelIndex &mailbox, const Sequence &uids,
                     const FlagsOperation flagOperation, const QString &flags);
     virtual void perform();
 
@@ -63,7 +66,10 @@ private:
     CommandHandle tag;
     ImapTask *conn;
     CopyMoveMessagesTask *copyMove;
-    QList<QPersistentModelIndex> messages;
+    QPersistentModelIndex mailboxIndex;
+    /** @short UIDVALIDITY of the mailbox at the time the task was created */
+    uint uidValidity;
+    Sequence uids;
     FlagsOperation flagOperation;
     QString flags;
 };
@@ -0,0 +1,257 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "HappyEyeballs.h"
+#include <QHash>
+#include <QHostInfo>
+#include <QNetworkProxy>
+#include <QSslSocket>
+#include <QTimer>
+
+namespace {
+
+/** @short The "Connection Attempt Delay" as recommended by RFC 8305 */
+const int DEFAULT_ATTEMPT_DELAY = 250;
+
+/** @short Address family which has most recently won for each host name */
+QHash<QString, QAbstractSocket::NetworkLayerProtocol> &preferredFamilies()
+{
+    static QHash<QString, QAbstractSocket::NetworkLayerProtocol> families;
+    return families;
+}
+
+QString formatAddress(const QHostAddress &address, const quint16 port)
+{
+    if (address.protocol() == QAbstractSocket::IPv6Protocol)
+        return QStringLiteral("[%1]:%2").arg(address.toString(), QString::number(port));
+    return QStringLiteral("%1:%2").arg(address.toString(), QString::number(port));
+}
+
+}
+
+namespace Streams {
+
+HappyEyeballs::HappyEyeballs(QObject *parent, const QString &host, const quint16 port):
+    QObject(parent), m_host(host), m_port(port), m_lookupId(-1), m_attemptTimer(new QTimer(this)), m_finished(false)
+{
+    m_attemptTimer->setSingleShot(true);
+    m_attemptTimer->setInterval(DEFAULT_ATTEMPT_DELAY);
+    connect(m_attemptTimer, &QTimer::timeout, this, &HappyEyeballs::startNextAttempt);
+}
+
+HappyEyeballs::~HappyEyeballs()
+{
+    if (m_lookupId != -1)
+        QHostInfo::abortHostLookup(m_lookupId);
+    abortPendingAttempts();
+}
+
+void HappyEyeballs::setAttemptDelay(const int msecs)
+{
+    m_attemptTimer->setInterval(msecs);
+}
+
+void HappyEyeballs::start()
+{
+    m_lookupId = QHostInfo::lookupHost(m_host, this, SLOT(slotLookupFinished(QHostInfo)));
+}
+
+void HappyEyeballs::slotLookupFinished(const QHostInfo &info)
+{
+    m_lookupId = -1;
+    if (info.error() != QHostInfo::NoError) {
+        m_finished = true;
+        emit failed(tr("Cannot look up %1: %2").arg(m_host, info.errorString()));
+        return;
+    }
+    start(info.addresses());
+}
+
+void HappyEyeballs::start(const QList<QHostAddress> &addresses)
+{
+    m_addresses = sortAddresses(addresses, preferredFamily(m_host));
+    if (m_addresses.isEmpty()) {
+        m_finished = true;
+        emit failed(tr("No usable address found for %1").arg(m_host));
+        return;
+    }
+    startNextAttempt();
+}
+
+void HappyEyeballs::startNextAttempt()
+{
+    if (m_finished || m_addresses.isEmpty())
+        return;
+
+    Attempt attempt;
+    attempt.address = m_addresses.takeFirst();
+    attempt.latency = -1;
+    attempt.succeeded = false;
+    m_attempts << attempt;
+
+    PendingAttempt pending;
+    pending.socket = new QSslSocket(this);
+    pending.socket->setProxy(QNetworkProxy::NoProxy);
+    pending.index = m_attempts.size() - 1;
+    pending.timer.start();
+    m_pending << pending;
+
+    QSslSocket *socket = pending.socket;
+    connect(socket, &QAbstractSocket::connected, this, [this, socket]() {
+        slotAttemptConnected(socket);
+    });
+    connect(socket, static_cast<void (QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error),
+            this, [this, socket]() {
+        slotAttemptFailed(socket);
+    });
+    socket->connectToHost(attempt.address, m_port);
+
+    if (!m_finished && !m_addresses.isEmpty())
+        m_attemptTimer->start();
+}
+
+void HappyEyeballs::slotAttemptConnected(QSslSocket *socket)
+{
+    for (int i = 0; i < m_pending.size(); ++i) {
+        if (m_pending[i].socket != socket)
+            continue;
+
+        PendingAttempt pending = m_pending.takeAt(i);
+        Attempt &attempt = m_attempts[pending.index];
+        attempt.latency = pending.timer.elapsed();
+        attempt.succeeded = true;
+
+        preferredFamilies()[m_host] = attempt.address.protocol();
+        m_finished = true;
+        m_attemptTimer->stop();
+        abortPendingAttempts();
+
+        socket->disconnect(this);
+        socket->setParent(0);
+        emit connected(socket);
+        return;
+    }
+}
+
+void HappyEyeballs::slotAttemptFailed(QSslSocket *socket)
+{
+    for (int i = 0; i < m_pending.size(); ++i) {
+        if (m_pending[i].socket != socket)
+            continue;
+
+        PendingAttempt pending = m_pending.takeAt(i);
+        Attempt &attempt = m_attempts[pending.index];
+        attempt.latency = pending.timer.elapsed();
+        attempt.error = socket->errorString();
+        // We're being called from a signal of that socket
+        socket->disconnect(this);
+        socket->deleteLater();
+
+        if (m_finished)
+            return;
+
+        if (!m_addresses.isEmpty()) {
+            // There's no point in waiting for the rest of the delay when this attempt is already over
+            m_attemptTimer->stop();
+            startNextAttempt();
+        } else if (m_pending.isEmpty()) {
+            m_finished = true;
+            emit failed(tr("Cannot connect to %1:%2: %3").arg(m_host, QString::number(m_port), attemptsSummary()));
+        }
+        return;
+    }
+}
+
+void HappyEyeballs::abortPendingAttempts()
+{
+    Q_FOREACH(const PendingAttempt &pending, m_pending) {
+        m_attempts[pending.index].error = tr("Cancelled");
+        pending.socket->disconnect(this);
+        pending.socket->abort();
+        pending.socket->deleteLater();
+    }
+    m_pending.clear();
+}
+
+QVector<HappyEyeballs::Attempt> HappyEyeballs::attempts() const
+{
+    return m_attempts;
+}
+
+QString HappyEyeballs::attemptsSummary() const
+{
+    QStringList res;
+    Q_FOREACH(const Attempt &attempt, m_attempts) {
+        QString address = formatAddress(attempt.address, m_port);
+        if (attempt.succeeded) {
+            res << tr("%1 connected in %2 ms").arg(address, QString::number(attempt.latency));
+        } else if (attempt.latency == -1) {
+            res << tr("%1 cancelled").arg(address);
+        } else {
+            res << tr("%1 failed after %2 ms (%3)").arg(address, QString::number(attempt.latency), attempt.error);
+        }
+    }
+    return res.join(QStringLiteral(", "));
+}
+
+QList<QHostAddress> HappyEyeballs::sortAddresses(const QList<QHostAddress> &addresses,
+                                                 const QAbstractSocket::NetworkLayerProtocol preferred)
+{
+    QList<QHostAddress> ipv6, ipv4;
+    Q_FOREACH(const QHostAddress &address, addresses) {
+        switch (address.protocol()) {
+        case QAbstractSocket::IPv6Protocol:
+            if (!ipv6.contains(address))
+                ipv6 << address;
+            break;
+        case QAbstractSocket::IPv4Protocol:
+            if (!ipv4.contains(address))
+                ipv4 << address;
+            break;
+        default:
+            break;
+        }
+    }
+
+    QList<QHostAddress> &first = preferred == QAbstractSocket::IPv4Protocol ? ipv4 : ipv6;
+    QList<QHostAddress> &second = preferred == QAbstractSocket::IPv4Protocol ? ipv6 : ipv4;
+    QList<QHostAddress> res;
+    while (!first.isEmpty() || !second.isEmpty()) {
+        if (!first.isEmpty())
+            res << first.takeFirst();
+        if (!second.isEmpty())
+            res << second.takeFirst();
+    }
+    return res;
+}
+
+QAbstractSocket::NetworkLayerProtocol HappyEyeballs::preferredFamily(const QString &host)
+{
+    return preferredFamilies().value(host, QAbstractSocket::IPv6Protocol);
+}
+
+void HappyEyeballs::clearPreferredFamilies()
+{
+    preferredFamilies().clear();
+}
+
+}
@@ -0,0 +1,120 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STREAMS_HAPPYEYEBALLS_H
+#define STREAMS_HAPPYEYEBALLS_H
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QVector>
+#include <QAbstractSocket>
+
+class QHostInfo;
+class QSslSocket;
+class QTimer;
+
+namespace Streams {
+
+/** @short Establish a TCP connection by racing all addresses of a host against each other
+
+This is an implementation of the "Happy Eyeballs" algorithm from RFC 8305. The addresses are tried in an order which
+alternates between IPv6 and IPv4, and a new attempt is started whenever the previous one has failed or has not
+finished within the attempt delay. The first attempt which succeeds wins and all others are aborted. This means that
+a network where one of the address families is broken does not have to wait for a full TCP timeout.
+
+The address family of the winner is remembered for each host name, so the next connection tries that family first.
+
+The sockets are plain TCP connections at this point; it is up to the caller to negotiate encryption on the winner.
+*/
+class HappyEyeballs: public QObject
+{
+    Q_OBJECT
+public:
+    /** @short Result of a single connection attempt */
+    struct Attempt {
+        QHostAddress address;
+        /** @short Time since the start of this attempt till its completion, in milliseconds; -1 if it was aborted */
+        qint64 latency;
+        bool succeeded;
+        QString error;
+    };
+
+    HappyEyeballs(QObject *parent, const QString &host, const quint16 port);
+    virtual ~HappyEyeballs();
+
+    /** @short Delay before starting the next attempt while the previous one is still pending, in milliseconds */
+    void setAttemptDelay(const int msecs);
+
+    /** @short Resolve the host name and start connecting */
+    void start();
+    /** @short Start connecting to a known list of addresses */
+    void start(const QList<QHostAddress> &addresses);
+
+    /** @short Results of all connection attempts made so far, in the order in which they were started */
+    QVector<Attempt> attempts() const;
+    /** @short Human-readable description of all attempts, including their latency */
+    QString attemptsSummary() const;
+
+    /** @short Sort the @arg addresses so that the families alternate, starting with the @arg preferred one */
+    static QList<QHostAddress> sortAddresses(const QList<QHostAddress> &addresses,
+                                             const QAbstractSocket::NetworkLayerProtocol preferred);
+    /** @short Address family which has won the last race for this @arg host */
+    static QAbstractSocket::NetworkLayerProtocol preferredFamily(const QString &host);
+    /** @short Forget about all remembered address families */
+    static void clearPreferredFamilies();
+
+signals:
+    /** @short The connection has been established; the receiver takes ownership of the @arg socket */
+    void connected(QSslSocket *socket);
+    /** @short None of the addresses could be connected to */
+    void failed(const QString &message);
+
+private slots:
+    void slotLookupFinished(const QHostInfo &info);
+    void startNextAttempt();
+
+private:
+    void slotAttemptConnected(QSslSocket *socket);
+    void slotAttemptFailed(QSslSocket *socket);
+    void abortPendingAttempts();
+
+    struct PendingAttempt {
+        QSslSocket *socket;
+        QElapsedTimer timer;
+        /** @short Position in m_attempts */
+        int index;
+    };
+
+    QString m_host;
+    quint16 m_port;
+    int m_lookupId;
+    QList<QHostAddress> m_addresses;
+    QVector<Attempt> m_attempts;
+    QList<PendingAttempt> m_pending;
+    QTimer *m_attemptTimer;
+    bool m_finished;
+};
+
+}
+
+#endif
@@ -22,21 +22,30 @@
 
 #include "IODeviceSocket.h"
 #include <stdexcept>
+#include <QElapsedTimer>
 #include <QNetworkProxy>
 #include <QNetworkProxyFactory>
 #include <QNetworkProxyQuery>
 #include <QSslConfiguration>
 #include <QSslSocket>
 #include <QTimer>
+#include "HappyEyeballs.h"
 #include "TrojitaZlibStatus.h"
 #if TROJITA_COMPRESS_DEFLATE
 #include "3rdparty/rfc1951.h"
 #endif
 #include "Common/InvokeMethod.h"
 
+namespace {
+
+/** @short How much data a network socket may buffer while the reading is paused */
+const qint64 PAUSED_READ_BUFFER_SIZE = 64 * 1024;
+
+}
+
 namespace Streams {
 
-IODeviceSocket::IODeviceSocket(QIODevice *device): d(device), m_compressor(0), m_decompressor(0)
+IODeviceSocket::IODeviceSocket(QIODevice *device): d(device), m_compressor(0), m_decompressor(0), m_readingPaused(false)
 {
     connect(d, &QIODevice::readyRead, this, &IODeviceSocket::handleReadyRead);
     connect(d, &QIODevice::readChannelFinished, this, &IODeviceSocket::handleStateChanged);
@@ -122,10 +131,42 @@ void IODeviceSocket::startDeflate()
 #endif
 }
 
+void IODeviceSocket::setReadingPaused(const bool paused)
+{
+    if (m_readingPaused == paused)
+        return;
+    m_readingPaused = paused;
+    updateReadBufferSize();
+    if (!paused && d->bytesAvailable()) {
+        // Compressed data which were left in the device have not been fed to the decompressor yet
+        QTimer::singleShot(0, this, SLOT(handleReadyRead()));
+    }
+}
+
+bool IODeviceSocket::waitForBytesWritten(const int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (d->bytesToWrite() > 0) {
+        const qint64 remaining = msecs - timer.elapsed();
+        if (remaining <= 0 || !d->waitForBytesWritten(static_cast<int>(remaining)))
+            return false;
+    }
+    return true;
+}
+
+void IODeviceSocket::updateReadBufferSize()
+{
+    // Only the network sockets have a buffer which can be limited; the pipe of a QProcess always reads everything
+    if (QAbstractSocket *sock = qobject_cast<QAbstractSocket *>(d)) {
+        sock->setReadBufferSize(m_readingPaused ? PAUSED_READ_BUFFER_SIZE : 0);
+    }
+}
+
 void IODeviceSocket::handleReadyRead()
 {
 #if TROJITA_COMPRESS_DEFLATE
-    if (m_decompressor) {
+    if (m_decompressor && !m_readingPaused) {
         m_decompressor->consume(d);
     }
 #endif
@@ -137,6 +178,19 @@ void IODeviceSocket::emitError()
     emit disconnected(disconnectedMessage);
 }
 
+void IODeviceSocket::replaceDevice(QIODevice *device)
+{
+    Q_ASSERT(!m_compressor && !m_decompressor);
+    d->disconnect(this);
+    d->deleteLater();
+    d = device;
+    connect(d, &QIODevice::readyRead, this, &IODeviceSocket::handleReadyRead);
+    connect(d, &QIODevice::readChannelFinished, this, &IODeviceSocket::handleStateChanged);
+    updateReadBufferSize();
+    if (d->bytesAvailable())
+        QTimer::singleShot(0, this, SLOT(handleReadyRead()));
+}
+
 ProcessSocket::ProcessSocket(QProcess *proc, const QString &executable, const QStringList &args):
     IODeviceSocket(proc), executable(executable), args(args)
 {
@@ -218,7 +272,13 @@ void ProcessSocket::delayedStart()
 }
 
 SslTlsSocket::SslTlsSocket(QSslSocket *sock, const QString &host, const quint16 port, const bool startEncrypted):
-    IODeviceSocket(sock), startEncrypted(startEncrypted), host(host), port(port), m_proxySettings(ProxySettings::RespectSystemProxy)
+    IODeviceSocket(sock), startEncrypted(startEncrypted), host(host), port(port), m_proxySettings(ProxySettings::RespectSystemProxy),
+    m_racer(0)
+{
+    setupSocket(sock);
+}
+
+void SslTlsSocket::setupSocket(QSslSocket *sock)
 {
     // The Qt API for deciding about whereabouts of a SSL connection is unfortunately blocking, ie. one is expected to
     // call a function from a slot attached to the sslErrors signal to tell the code whether to proceed or not.
@@ -255,6 +315,8 @@ void SslTlsSocket::close()
 {
     QSslSocket *sock = qobject_cast<QSslSocket*>(d);
     Q_ASSERT(sock);
+    delete m_racer;
+    m_racer = 0;
     sock->abort();
     emit disconnected(tr("Connection closed"));
 }
@@ -388,12 +450,46 @@ void SslTlsSocket::delayedStart()
         break;
     }
 
+    if (sock->proxy().type() == QNetworkProxy::NoProxy) {
+        // A dual-stack host might have one of its address families broken, so let's try all of them in parallel
+        m_racer = new HappyEyeballs(this, host, port);
+        connect(m_racer, &HappyEyeballs::connected, this, &SslTlsSocket::slotRaceWon);
+        connect(m_racer, &HappyEyeballs::failed, this, &SslTlsSocket::slotRaceFailed);
+        emit stateChanged(Imap::CONN_STATE_HOST_LOOKUP, tr("Looking up %1...").arg(host));
+        m_racer->start();
+        return;
+    }
+
     if (startEncrypted)
         sock->connectToHostEncrypted(host, port);
     else
         sock->connectToHost(host, port);
 }
 
+void SslTlsSocket::slotRaceWon(QSslSocket *sock)
+{
+    emit stateChanged(Imap::CONN_STATE_CONNECTING, tr("Connecting to %1:%2%3: %4").arg(
+                          host, QString::number(port), startEncrypted ? tr(" (SSL)") : QString(), m_racer->attemptsSummary()));
+    m_racer->deleteLater();
+    m_racer = 0;
+
+    setupSocket(sock);
+    replaceDevice(sock);
+    // The certificate has to match the host name, not the address which we happened to connect to
+    sock->setPeerVerifyName(host);
+    handleStateChanged();
+    if (startEncrypted)
+        sock->startClientEncryption();
+}
+
+void SslTlsSocket::slotRaceFailed(const QString &message)
+{
+    m_racer->deleteLater();
+    m_racer = 0;
+    emit disconnected(tr("The underlying socket is having troubles when processing connection to %1:%2: %3").arg(
+                          host, QString::number(port), message));
+}
+
 QList<QSslCertificate> SslTlsSocket::sslChain() const
 {
     QSslSocket *sock = qobject_cast<QSslSocket *>(d);
@@ -31,6 +31,7 @@ class QTimer;
 
 namespace Streams {
 
+class HappyEyeballs;
 class Rfc1951Compressor;
 class Rfc1951Decompressor;
 class SocketFactory;
@@ -49,6 +50,8 @@ public:
     virtual qint64 write(const QByteArray &byteArray);
     virtual void startTls();
     virtual void startDeflate();
+    virtual void setReadingPaused(const bool paused);
+    virtual bool waitForBytesWritten(const int msecs);
     virtual bool isDead() = 0;
 private slots:
     virtual void handleStateChanged() = 0;
@@ -56,9 +59,15 @@ private slots:
     virtual void handleReadyRead();
     void emitError();
 protected:
+    /** @short Start using another underlying device, dropping the old one */
+    void replaceDevice(QIODevice *device);
+    /** @short Limit the buffer of the underlying socket while the reading is paused */
+    void updateReadBufferSize();
+
     QIODevice *d;
     Rfc1951Compressor *m_compressor;
     Rfc1951Decompressor *m_decompressor;
+    bool m_readingPaused;
     QTimer *delayedDisconnect;
     QString disconnectedMessage;
 };
@@ -102,11 +111,17 @@ private slots:
     void handleSocketError(QAbstractSocket::SocketError);
     void delayedStart();
 private:
+    void setupSocket(QSslSocket *sock);
+    void slotRaceWon(QSslSocket *sock);
+    void slotRaceFailed(const QString &message);
+
     bool startEncrypted;
     QString host;
     quint16 port;
     QString m_protocolTag;
     ProxySettings m_proxySettings;
+    /** @short Racing of multiple addresses of the host when connecting without a proxy */
+    HappyEyeballs *m_racer;
 };
 
 };
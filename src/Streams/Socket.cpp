@@ -44,4 +44,15 @@ QList<QSslError> Socket::sslErrors() const
     return QList<QSslError>();
 }
 
+void Socket::setReadingPaused(const bool paused)
+{
+    Q_UNUSED(paused);
+}
+
+bool Socket::waitForBytesWritten(const int msecs)
+{
+    Q_UNUSED(msecs);
+    return true;
+}
+
 }
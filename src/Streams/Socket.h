@@ -77,6 +77,19 @@ public:
 
     /** @short Start the DEFLATE algorithm on both directions of this stream */
     virtual void startDeflate() = 0;
+
+    /** @short Stop or resume buffering of the incoming data while the reader is not consuming them
+
+      While paused, the socket keeps at most a small amount of data in its own buffers, which lets the TCP flow
+    control slow down the remote peer. The default implementation does nothing.
+    */
+    virtual void setReadingPaused(const bool paused);
+
+    /** @short Block for at most @arg msecs milliseconds until the written data are passed to the operating system
+
+      Returns true if nothing remains to be written. The default implementation has no buffers of its own.
+    */
+    virtual bool waitForBytesWritten(const int msecs);
 signals:
     /** @short The socket got disconnected */
     void disconnected(const QString);
@@ -28,29 +28,38 @@
 */
 
 #include <QDebug>
+#include <QTimer>
 #include "MailSynchronizer.h"
 #include "Imap/Model/ItemRoles.h"
 #include "Imap/Model/MailboxFinder.h"
+#include "Imap/Model/Utils.h"
 #include "MessageDownloader.h"
 #include "SqlStorage.h"
 
 namespace XtConnect {
 
-MailSynchronizer::MailSynchronizer( QObject *parent, Imap::Mailbox::Model *model, MailboxFinder *finder, MessageDownloader *downloader, SqlStorage *storage ) :
+/** @short How many downloaded messages to save in a single transaction */
+enum {SAVE_BATCH_SIZE = 50};
+
+MailSynchronizer::MailSynchronizer( QObject *parent, Imap::Mailbox::Model *model, Imap::Mailbox::MailboxFinder *finder, MessageDownloader *downloader, SqlStorage *storage ) :
     QObject(parent), m_model(model), m_finder(finder), m_downloader(downloader), m_storage(storage)
 {
     Q_ASSERT(m_model);
     Q_ASSERT(m_finder);
     Q_ASSERT(m_downloader);
     Q_ASSERT(m_storage);
-    connect( m_model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(slotRowsInserted(QModelIndex,int,int)) );
-    connect( m_finder, SIGNAL(mailboxFound(QString,QModelIndex)), this, SLOT(slotMailboxFound(QString,QModelIndex)) );
-    connect( m_downloader, SIGNAL(messageDownloaded(QModelIndex,QByteArray,QByteArray,QString)),
-             this, SLOT(slotMessageDataReady(QModelIndex,QByteArray,QByteArray,QString)) );
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, &MailSynchronizer::slotRowsInserted);
+    connect(m_finder, &Imap::Mailbox::MailboxFinder::mailboxFound, this, &MailSynchronizer::slotMailboxFound);
+    connect(m_downloader, &MessageDownloader::messageDownloaded, this, &MailSynchronizer::slotMessageDataReady);
     m_deferredTimer = new QTimer(this);
     m_deferredTimer->setSingleShot(true);
     m_deferredTimer->setInterval(5000);
-    connect(m_deferredTimer, SIGNAL(timeout()), this, SLOT(slotWalkDeferredMessages()));
+    connect(m_deferredTimer, &QTimer::timeout, this, &MailSynchronizer::slotWalkDeferredMessages);
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(500);
+    connect(m_saveTimer, &QTimer::timeout, this, &MailSynchronizer::slotSavePendingMails);
 }
 
 void MailSynchronizer::setMailbox( const QString &mailbox )
@@ -71,7 +80,7 @@ void MailSynchronizer::slotMailboxFound( const QString &mailbox, const QModelInd
     if ( mailbox != m_mailbox )
         return;
 
-    m_index = index;
+    m_index = Imap::deproxifiedIndex( index );
     switchHere();
     walkThroughMessages( -1, -1 );
 }
@@ -125,7 +134,7 @@ bool MailSynchronizer::renewMailboxIndex()
 {
     if ( ! m_index.isValid() ) {
         qDebug() << "Oops, we've lost the mailbox" << m_mailbox <<", will ask for it again in a while.";
-        QTimer::singleShot( 14*1000 /*1000 * 60 * 2*/, this, SLOT(slotGetMailboxIndexAgain()) );
+        QTimer::singleShot( 14*1000 /*1000 * 60 * 2*/, this, &MailSynchronizer::slotGetMailboxIndexAgain );
         return true;
     } else {
         return false;
@@ -142,86 +151,102 @@ void MailSynchronizer::switchHere()
 
 void MailSynchronizer::slotMessageDataReady( const QModelIndex &message, const QByteArray &headers, const QByteArray &body, const QString &mainPart )
 {
-    Common::SqlTransactionAutoAborter guard = m_storage->transactionGuard();
-
     QVariant dateTimeVariant = message.data( Imap::Mailbox::RoleMessageDate );
     QVariant subject = message.data( Imap::Mailbox::RoleMessageSubject );
     Q_ASSERT(dateTimeVariant.isValid());
     Q_ASSERT(subject.isValid());
-    QDateTime dateTime = dateTimeVariant.toDateTime();
-    if ( dateTime.isNull() ) {
-        m_model->logTrace(message, Common::LOG_OTHER, QLatin1String("MailSynchronizer"),
-                          QString::fromUtf8("Warning: unknown timestamp for UID %1 in %2 - using current one").arg(
+
+    SqlStorage::Mail mail;
+    mail.dateTime = dateTimeVariant.toDateTime();
+    if ( mail.dateTime.isNull() ) {
+        m_model->logTrace(message, Common::LOG_OTHER, QStringLiteral("MailSynchronizer"),
+                          QStringLiteral("Warning: unknown timestamp for UID %1 in %2 - using current one").arg(
                               message.data(Imap::Mailbox::RoleMessageUid).toString(),
                               message.parent().parent().data(Imap::Mailbox::RoleMailboxName).toString()));
-        dateTime = QDateTime::currentDateTimeUtc();
+        mail.dateTime = QDateTime::currentDateTimeUtc();
     }
-
-    quint64 emlId;
-    SqlStorage::ResultType res = m_storage->insertMail( dateTime, subject.toString(),
-                                                        mainPart, headers, body, emlId );
-
-    if ( res == SqlStorage::RESULT_DUPLICATE ) {
-        m_model->logTrace(message, Common::LOG_OTHER, QLatin1String("MailSynchronizer"), QLatin1String("Duplicate message"));
-        emit messageIsDuplicate( m_mailbox, message );
-        return;
+    mail.subject = subject.toString();
+    mail.readableText = mainPart;
+    mail.headers = headers;
+    mail.body = body;
+
+    // The envelope has to be copied right now; the downloader asks the Model to free the message data soon
+    appendAddresses( mail.addresses, message.data( Imap::Mailbox::RoleMessageFrom ), QStringLiteral("FROM") );
+    appendAddresses( mail.addresses, message.data( Imap::Mailbox::RoleMessageTo ), QStringLiteral("TO") );
+    appendAddresses( mail.addresses, message.data( Imap::Mailbox::RoleMessageCc ), QStringLiteral("CC") );
+    appendAddresses( mail.addresses, message.data( Imap::Mailbox::RoleMessageBcc ), QStringLiteral("BCC") );
+
+    m_pendingMails << mail;
+    m_pendingIndexes << message;
+
+    if (m_pendingMails.size() >= SAVE_BATCH_SIZE) {
+        slotSavePendingMails();
+    } else if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
     }
+}
 
-    if ( res == SqlStorage::RESULT_ERROR ) {
-        m_model->logTrace(message, Common::LOG_OTHER, QLatin1String("MailSynchronizer"), QLatin1String("Cannot store into Postgres"));
-        qWarning() << "Inserting failed";
+void MailSynchronizer::slotSavePendingMails()
+{
+    m_saveTimer->stop();
+    if (m_pendingMails.isEmpty())
         return;
-    }
 
-    _saveAddrList( emlId, message.data( Imap::Mailbox::RoleMessageFrom ), QLatin1String("FROM") );
-    _saveAddrList( emlId, message.data( Imap::Mailbox::RoleMessageTo ), QLatin1String("TO") );
-    _saveAddrList( emlId, message.data( Imap::Mailbox::RoleMessageCc ), QLatin1String("CC") );
-    _saveAddrList( emlId, message.data( Imap::Mailbox::RoleMessageBcc ), QLatin1String("BCC") );
+    QVector<SqlStorage::Mail> mails;
+    mails.swap(m_pendingMails);
+    QList<QPersistentModelIndex> indexes;
+    indexes.swap(m_pendingIndexes);
 
-    if ( m_storage->markMailReady( emlId ) != SqlStorage::RESULT_OK ) {
-        m_model->logTrace(message, Common::LOG_OTHER, QLatin1String("MailSynchronizer"),
-                          QLatin1String("Failed to mark mail ready"));
-        qWarning() << "Failed to mark mail ready";
+    // Messages which fail to get stored are not marked as saved in the cache, so they will be retried after a restart
+    Common::SqlTransactionAutoAborter guard = m_storage->transactionGuard();
+    QVector<quint64> emlIds;
+    if (m_storage->insertMails(mails, emlIds) != SqlStorage::RESULT_OK) {
+        m_model->logTrace(0, Common::LOG_OTHER, QStringLiteral("MailSynchronizer"),
+                          QStringLiteral("Cannot store %1 messages into Postgres").arg(mails.size()));
+        qWarning() << "Inserting failed";
         return;
     }
 
     if ( ! guard.commit() ) {
-        m_model->logTrace(message, Common::LOG_OTHER, QLatin1String("MailSynchronizer"),
-                          QLatin1String("Failed to commit current transaction"));
-        m_storage->fail( QLatin1String("Failed to commit current transaction") );
+        m_model->logTrace(0, Common::LOG_OTHER, QStringLiteral("MailSynchronizer"),
+                          QStringLiteral("Failed to commit current transaction"));
+        m_storage->fail( QStringLiteral("Failed to commit current transaction") );
         return;
     }
 
-    emit messageSaved( m_mailbox, message );
+    for (int i = 0; i < indexes.size(); ++i) {
+        if (!indexes[i].isValid())
+            continue;
+        if (emlIds[i]) {
+            emit messageSaved(m_mailbox, indexes[i]);
+        } else {
+            m_model->logTrace(indexes[i], Common::LOG_OTHER, QStringLiteral("MailSynchronizer"), QStringLiteral("Duplicate message"));
+            emit messageIsDuplicate(m_mailbox, indexes[i]);
+        }
+    }
 }
 
-void MailSynchronizer::_saveAddrList( const quint64 emlId, const QVariant &addresses, const QLatin1String kind )
+void MailSynchronizer::appendAddresses( QVector<SqlStorage::MailAddress> &target, const QVariant &addresses, const QString &kind )
 {
-    // FIXME: batched updates would be great...
     Q_ASSERT( addresses.type() == QVariant::List );
     Q_FOREACH( const QVariant &item, addresses.toList() ) {
         Q_ASSERT( item.isValid() );
         Q_ASSERT( item.type() == QVariant::StringList );
         QStringList expanded = item.toStringList();
         Q_ASSERT( expanded.size() == 4 );
-        QString name = expanded[0];
-
-        QString address;
+        SqlStorage::MailAddress address;
+        address.kind = kind;
+        address.name = expanded[0];
         if ( expanded[2].isEmpty() && expanded[3].isEmpty() ) {
-            address = QLatin1String("undisclosed-recipients;");
+            address.address = QStringLiteral("undisclosed-recipients;");
         } else if ( expanded[2].isEmpty() ) {
-            address = expanded[3];
+            address.address = expanded[3];
         } else if ( expanded[3].isEmpty() ) {
-            address = expanded[2];
+            address.address = expanded[2];
         } else {
-            address = expanded[2] + QLatin1Char('@') + expanded[3];
-        }
-
-        if ( m_storage->insertAddress( emlId, name, address, kind ) != SqlStorage::RESULT_OK ) {
-            m_model->logTrace(0, Common::LOG_OTHER, QLatin1String("MailSynchronizer"),
-                              QLatin1String("Failed to insert address"));
-            qWarning() << "Failed to insert address";
+            address.address = expanded[2] + QLatin1Char('@') + expanded[3];
         }
+        target << address;
     }
 }
 
@@ -232,7 +257,7 @@ void MailSynchronizer::debugStats() const
                 ( m_index.data(Imap::Mailbox::RoleMailboxItemsAreLoading).toBool() ? "[loading]" : "" ) <<
                 "total" << m_index.data( Imap::Mailbox::RoleTotalMessageCount ).toUInt() <<
                 ", active" << m_downloader->activeMessages() << ", queued" << m_downloader->pendingMessages() <<
-                ", uid_wait" << m_deferredMessages.count();
+                ", uid_wait" << m_deferredMessages.count() << ", db_wait" << m_pendingMails.size();
     } else {
         qDebug() << "Mailbox" << m_mailbox << ": waiting for sync.";
     }
@@ -32,8 +32,10 @@
 
 #include <QObject>
 #include <QModelIndex>
-
 #include "Imap/Model/Model.h"
+#include "SqlStorage.h"
+
+class QTimer;
 
 namespace Imap {
 namespace Mailbox {
@@ -44,62 +46,83 @@ class MailboxFinder;
 namespace XtConnect {
 
 class MessageDownloader;
-class SqlStorage;
 
 /** @short Make sure that everything from a mailbox is eventually saved into the DB
 
 This class is responsible for checking all messages in a given mailbox, verifying if they were
 processed already, and if required, downloading them from the IMAP server and storing the data
 into the database.
+
+Downloaded messages are not written one by one; they are collected and saved in batches, each batch
+within a single transaction.
 */
 class MailSynchronizer : public QObject
 {
     Q_OBJECT
 public:
-    explicit MailSynchronizer( QObject *parent, Imap::Mailbox::Model *model, MailboxFinder *finder, MessageDownloader *downloader, SqlStorage *storage );
+    explicit MailSynchronizer( QObject *parent, Imap::Mailbox::Model *model, Imap::Mailbox::MailboxFinder *finder, MessageDownloader *downloader, SqlStorage *storage );
+
     void setMailbox( const QString &mailbox );
+
     /** @short Ask the Model that we're still here and need updates
 
 This is required if the total number of mailboxes exceeds the configured limit of parallel connections
 */
     void switchHere();
+
     /** @short Dump some statistics about how many messages are we waiting for */
     void debugStats() const;
+
 signals:
     /** @short The synchronizer is about to ask for a message
 
 It's possibly to make it not request the message by setting the *shouldLoad to false.
  */
     void aboutToRequestMessage( const QString &mailbox, const QModelIndex &message, bool *shouldLoad );
+
     /** @short The message has been saved to the database as a unique one */
     void messageSaved( const QString &mailbox, const QModelIndex &message );
+
     /** @short The database has detected that a message with the same body has been saved before */
     void messageIsDuplicate( const QString &mailbox, const QModelIndex &message );
+
 private slots:
     void slotRowsInserted( const QModelIndex &parent, int start, int end );
     void slotMailboxFound( const QString &mailbox, const QModelIndex &index );
     void slotGetMailboxIndexAgain();
     void slotMessageDataReady( const QModelIndex &message, const QByteArray &headers, const QByteArray &body, const QString &mainPart );
     void slotWalkDeferredMessages();
+    /** @short Write all downloaded messages into the DB */
+    void slotSavePendingMails();
+
 private:
     /** @short Walk through the cached messages and store the new ones */
     void walkThroughMessages( int start, int end );
+
     /** @short Returns true if the m_index got invalidated
 
 This function will queue renewal automatically.
 */
     bool renewMailboxIndex();
 
-    void _saveAddrList( const quint64 emlId, const QVariant &addresses, const QLatin1String kind );
+    static void appendAddresses( QVector<SqlStorage::MailAddress> &target, const QVariant &addresses, const QString &kind );
 
     Imap::Mailbox::Model* m_model;
-    MailboxFinder *m_finder;
+    Imap::Mailbox::MailboxFinder *m_finder;
     MessageDownloader *m_downloader;
     SqlStorage *m_storage;
+
     QString m_mailbox;
     QPersistentModelIndex m_index;
+
     QList<QPersistentModelIndex> m_deferredMessages;
     QTimer *m_deferredTimer;
+
+    /** @short Messages which were downloaded, but not saved into the DB yet */
+    QVector<SqlStorage::Mail> m_pendingMails;
+    /** @short Indexes of messages in m_pendingMails, in the same order */
+    QList<QPersistentModelIndex> m_pendingIndexes;
+    QTimer *m_saveTimer;
 };
 
 }
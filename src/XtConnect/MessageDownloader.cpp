@@ -44,19 +44,19 @@ MessageDownloader::MessageDownloader(QObject *parent, Imap::Mailbox::Model *mode
 {
     m_releasingTimer = new QTimer(this);
     m_releasingTimer->setSingleShot(true);
-    connect(m_releasingTimer, SIGNAL(timeout()), this, SLOT(slotFreeProcessedMessages()));
+    connect(m_releasingTimer, &QTimer::timeout, this, &MessageDownloader::slotFreeProcessedMessages);
 
     m_queuedTimer = new QTimer(this);
     m_queuedTimer->setSingleShot(true);
-    connect(m_queuedTimer, SIGNAL(timeout()), this, SLOT(slotFetchQueuedMessages()));
+    connect(m_queuedTimer, &QTimer::timeout, this, &MessageDownloader::slotFetchQueuedMessages);
 
     Q_ASSERT(m_model);
-    connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(slotDataChanged(QModelIndex,QModelIndex)));
+    connect(m_model, &QAbstractItemModel::dataChanged, this, &MessageDownloader::slotDataChanged);
 }
 
 void MessageDownloader::log(const QString &message)
 {
-    m_model->logTrace(0, Common::LOG_OTHER, QLatin1String("MessageDownloader"), message);
+    m_model->logTrace(0, Common::LOG_OTHER, QStringLiteral("MessageDownloader"), message);
 }
 
 void MessageDownloader::requestDownload( const QModelIndex &message )
@@ -158,6 +158,17 @@ void MessageDownloader::slotDataChanged( const QModelIndex &a, const QModelIndex
         return;
     }
 
+    if ( a.row() != b.row() ) {
+        // The Model reports changes of adjacent messages at once
+        if ( m_parts.isEmpty() )
+            return;
+        for ( int row = a.row(); row <= b.row(); ++row ) {
+            QModelIndex message = a.sibling( row, 0 );
+            slotDataChanged( message, message );
+        }
+        return;
+    }
+
     if ( a != b ) {
 #ifdef DEBUG_PENDING_MESSAGES
         qDebug() << "MessageDownloader::slotDataChanged: a != b" << a;
@@ -165,7 +176,10 @@ void MessageDownloader::slotDataChanged( const QModelIndex &a, const QModelIndex
         return;
     }
 
-    QModelIndex message = Imap::Mailbox::Model::findMessageForItem( a );
+    // Message parts know their message; a message item has an UID, but no message index
+    QModelIndex message = a.data( Imap::Mailbox::RolePartMessageIndex ).toModelIndex();
+    if ( ! message.isValid() && a.data( Imap::Mailbox::RoleMessageUid ).isValid() )
+        message = a;
     if ( ! message.isValid() ) {
 #ifdef DEBUG_PENDING_MESSAGES_2
         qDebug() << "MessageDownloader::slotDataChanged: message not valid" << a;
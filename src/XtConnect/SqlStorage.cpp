@@ -30,121 +30,227 @@
 #include "SqlStorage.h"
 #include <QCryptographicHash>
 #include <QDebug>
+#include <QSet>
 #include <QSqlError>
+#include <QStringList>
 #include <QTimer>
 #include <QVariant>
 
 namespace XtConnect {
 
-SqlStorage::SqlStorage(QObject *parent, const QString &host, const int port, const QString &dbname, const QString &username, const QString &password ) :
-    QObject(parent), _host(host), _port(port), _dbname(dbname), _username(username), _password(password)
+/** @short Maximal number of rows in one INSERT into the emladdr table
+
+PostgreSQL limits the number of bind parameters in a single statement to 65535.
+*/
+enum {MAX_ADDRESS_ROWS = 1000};
+
+SqlStorage::SqlStorage(QObject *parent, const QString &host, const int port, const QString &dbname, const QString &username, const QString &password,
+                        const QString &driver) :
+    QObject(parent), _host(host), _port(port), _dbname(dbname), _username(username), _password(password), _driver(driver)
 {
     reconnect = new QTimer( this );
     reconnect->setSingleShot( true );
     reconnect->setInterval( 10 * 1000 );
-    connect( reconnect, SIGNAL(timeout()), this, SLOT(slotReconnect()) );
+    connect(reconnect, &QTimer::timeout, this, &SqlStorage::slotReconnect);
 }
 
 void SqlStorage::open()
 {
-    db = QSqlDatabase::addDatabase( QLatin1String("QPSQL"), QLatin1String("xtconnect-sqlstorage") );
+    db = QSqlDatabase::addDatabase( _driver, QStringLiteral("xtconnect-sqlstorage") );
     if ( ! _host.isEmpty() )
         db.setHostName(_host);
-
     if ( _port != 5432 && _port > 0 && _port < 65536 )
         db.setPort(_port);
-
     if ( ! _dbname.isEmpty() )
         db.setDatabaseName( _dbname );
-
     if ( ! _username.isEmpty() )
         db.setUserName( _username );
-
     if ( ! _password.isEmpty() )
         db.setPassword( _password );
 
     if ( ! db.open() ) {
-        _fail( "Failed to open database connection", db );
+        _fail( QStringLiteral("Failed to open database connection"), db );
     }
-
-    _prepareStatements();
 }
 
-void SqlStorage::_prepareStatements()
+QString SqlStorage::hashColumn() const
 {
-    _queryValidateMail = XSqlQuery(db);
-    if ( ! _queryValidateMail.prepare( QLatin1String("SELECT eml_id FROM xtbatch.eml "
-                                                     " WHERE :eml_hash=eml_hash::bytea;")) )
-                                                     _fail( "Failed to prepare query _queryValidateMail", _queryValidateMail );
-
-    _queryInsertMail = XSqlQuery(db);
-    if ( ! _queryInsertMail.prepare( QLatin1String("INSERT INTO xtbatch.eml "
-                                                   "(eml_hash, eml_date, eml_subj, eml_body, eml_msg, eml_status) "
-                                                   "VALUES "
-                                                   "(:eml_hash, :eml_date, :eml_subj, :eml_body,"
-                                                   " :eml_msg, 'I') "
-                                                   "returning eml_id;")) )
-                                                    _fail( "Failed to prepare query _queryInsertMail", _queryInsertMail );
-
-    _queryInsertAddress = XSqlQuery(db);
-    if ( ! _queryInsertAddress.prepare( QLatin1String("INSERT INTO xtbatch.emladdr "
-                                                      "(emladdr_eml_id, emladdr_type, emladdr_addr, emladdr_name) "
-                                                      "VALUES (:emladdr_eml_id, :emladdr_type, :emladdr_addr, "
-                                                      ":emladdr_name)") ) )
-        _fail( "Failed to prepare query _queryInsertAddress", _queryInsertAddress );
-
-    _queryMarkMailReady = QSqlQuery(db);
-    if ( ! _queryMarkMailReady.prepare( QLatin1String("UPDATE xtbatch.eml SET eml_status = 'O' WHERE eml_id = ?") ) )
-        _fail( "Failed to prepare query _queryMarkMailReady", _queryMarkMailReady );
+    // Older databases do not necessarily store the hash as a bytea, which is why it has always been compared through a cast.
+    // SQLite, which is only used by the unit tests, does not know that syntax.
+    return _driver == QLatin1String("QPSQL") ? QStringLiteral("eml_hash::bytea") : QStringLiteral("eml_hash");
 }
 
-SqlStorage::ResultType SqlStorage::insertMail( const QDateTime &dateTime, const QString &subject, const QString &readableText, const QByteArray &headers, const QByteArray &body, quint64 &emlId )
+SqlStorage::ResultType SqlStorage::insertMails(const QVector<Mail> &mails, QVector<quint64> &emlIds)
 {
-    QCryptographicHash hash( QCryptographicHash::Sha1 );
-    hash.addData( body );
-    QByteArray hashValue = hash.result();
+    emlIds.clear();
+    if (mails.isEmpty())
+        return RESULT_OK;
+
+    // Messages are recognized by the hash of their body
+    QVector<QByteArray> hashes;
+    hashes.reserve(mails.size());
+    Q_FOREACH(const Mail &mail, mails) {
+        hashes << QCryptographicHash::hash(mail.body, QCryptographicHash::Sha1);
+    }
 
-    _queryValidateMail.bindValue( ":eml_hash", hashValue );
-    if ( ! _queryValidateMail.exec() ) {
-        _fail( "Query _queryValidateMail failed", _queryValidateMail );
+    QSet<QByteArray> knownHashes;
+    if (findKnownHashes(hashes, knownHashes) != RESULT_OK)
         return RESULT_ERROR;
-    } else if ( _queryValidateMail.first() ) {
-        return RESULT_DUPLICATE;
+
+    // Skip the bodies which are stored already, and save those which occur more than once in this batch just once
+    emlIds.fill(0, mails.size());
+    QVector<int> newMails;
+    QStringList rows;
+    for (int i = 0; i < mails.size(); ++i) {
+        if (knownHashes.contains(hashes[i]))
+            continue;
+        knownHashes.insert(hashes[i]);
+        newMails << i;
+        rows << QStringLiteral("(?, ?, ?, ?, ?, 'I')");
     }
+    if (newMails.isEmpty())
+        return RESULT_OK;
 
-    _queryInsertMail.bindValue( ":eml_hash", hashValue );
-    // Use ISODate, because it will specify that the time is in UTC.
-    // Otherwise time is assumed to be local which would be bad
-    _queryInsertMail.bindValue( ":eml_date", dateTime.toString(Qt::ISODate));
-    _queryInsertMail.bindValue( ":eml_subj", subject );
-    _queryInsertMail.bindValue( ":eml_body", readableText );
-    _queryInsertMail.bindValue( ":eml_msg", headers + body);
+    QSqlQuery query(db);
+    if (!query.prepare(QStringLiteral("INSERT INTO xtbatch.eml "
+                                      "(eml_hash, eml_date, eml_subj, eml_body, eml_msg, eml_status) VALUES ")
+                       + rows.join(QStringLiteral(", "))
+                       + QStringLiteral(" RETURNING eml_id, ") + hashColumn())) {
+        _fail(QStringLiteral("Failed to prepare query for inserting mails"), query);
+        return RESULT_ERROR;
+    }
+    Q_FOREACH(const int i, newMails) {
+        const Mail &mail = mails[i];
+        query.addBindValue(hashes[i]);
+        // Use ISODate, because it will specify that the time is in UTC.
+        // Otherwise time is assumed to be local which would be bad
+        query.addBindValue(mail.dateTime.toString(Qt::ISODate));
+        query.addBindValue(mail.subject);
+        query.addBindValue(mail.readableText);
+        query.addBindValue(mail.headers + mail.body);
+    }
+    if (!query.exec()) {
+        _fail(QStringLiteral("Query for inserting mails failed"), query);
+        return RESULT_ERROR;
+    }
+
+    QHash<QByteArray, quint64> inserted;
+    while (query.next()) {
+        inserted[query.value(1).toByteArray()] = query.value(0).toULongLong();
+    }
+    Q_FOREACH(const int i, newMails) {
+        emlIds[i] = inserted.value(hashes[i]);
+        if (!emlIds[i]) {
+            _fail(QStringLiteral("The database did not report the eml_id of a new mail"), query);
+            return RESULT_ERROR;
+        }
+    }
+
+    if (insertAddresses(mails, emlIds) != RESULT_OK)
+        return RESULT_ERROR;
+    return markMailsReady(emlIds);
+}
 
-    if ( ! _queryInsertMail.exec() ) {
-        _fail( "Query _queryInsertMail failed", _queryInsertMail );
+SqlStorage::ResultType SqlStorage::findKnownHashes(const QVector<QByteArray> &hashes, QSet<QByteArray> &knownHashes)
+{
+    QStringList placeholders;
+    placeholders.reserve(hashes.size());
+    for (int i = 0; i < hashes.size(); ++i) {
+        placeholders << QStringLiteral("?");
+    }
+
+    QSqlQuery query(db);
+    if (!query.prepare(QStringLiteral("SELECT %1 FROM xtbatch.eml WHERE %1 IN (%2)")
+                       .arg(hashColumn(), placeholders.join(QStringLiteral(", "))))) {
+        _fail(QStringLiteral("Failed to prepare query for looking up known mails"), query);
+        return RESULT_ERROR;
+    }
+    Q_FOREACH(const QByteArray &hash, hashes) {
+        query.addBindValue(hash);
+    }
+    if (!query.exec()) {
+        _fail(QStringLiteral("Query for looking up known mails failed"), query);
         return RESULT_ERROR;
     }
+    while (query.next()) {
+        knownHashes.insert(query.value(0).toByteArray());
+    }
+    return RESULT_OK;
+}
+
+SqlStorage::ResultType SqlStorage::insertAddresses(const QVector<Mail> &mails, const QVector<quint64> &emlIds)
+{
+    Q_ASSERT(mails.size() == emlIds.size());
+
+    QSqlQuery query(db);
+    QStringList rows;
+    QVariantList values;
+
+    auto flush = [this, &query, &rows, &values]() {
+        if (rows.isEmpty())
+            return true;
+        if (!query.prepare(QStringLiteral("INSERT INTO xtbatch.emladdr "
+                                          "(emladdr_eml_id, emladdr_type, emladdr_addr, emladdr_name) VALUES ")
+                           + rows.join(QStringLiteral(", ")))) {
+            _fail(QStringLiteral("Failed to prepare query for inserting addresses"), query);
+            return false;
+        }
+        Q_FOREACH(const QVariant &value, values) {
+            query.addBindValue(value);
+        }
+        if (!query.exec()) {
+            _fail(QStringLiteral("Query for inserting addresses failed"), query);
+            return false;
+        }
+        rows.clear();
+        values.clear();
+        return true;
+    };
+
+    for (int i = 0; i < mails.size(); ++i) {
+        if (!emlIds[i])
+            continue;
+        Q_FOREACH(const MailAddress &address, mails[i].addresses) {
+            rows << QStringLiteral("(?, ?, ?, ?)");
+            values << emlIds[i] << address.kind << address.address << address.name;
+            if (rows.size() >= MAX_ADDRESS_ROWS && !flush())
+                return RESULT_ERROR;
+        }
+    }
+    return flush() ? RESULT_OK : RESULT_ERROR;
+}
 
-    if ( _queryInsertMail.first() ) {
-        emlId = _queryInsertMail.value( 0 ).toULongLong();
+SqlStorage::ResultType SqlStorage::markMailsReady(const QVector<quint64> &emlIds)
+{
+    QStringList ids;
+    Q_FOREACH(const quint64 emlId, emlIds) {
+        if (emlId)
+            ids << QString::number(emlId);
+    }
+    if (ids.isEmpty())
         return RESULT_OK;
-    } else {
+
+    // The IDs are plain numbers, so there's no need for bind parameters here
+    QSqlQuery query(db);
+    if (!query.exec(QStringLiteral("UPDATE xtbatch.eml SET eml_status = 'O' WHERE eml_id IN (%1)").arg(ids.join(QLatin1Char(','))))) {
+        _fail(QStringLiteral("Query for marking mails ready failed"), query);
         return RESULT_ERROR;
     }
+    return RESULT_OK;
 }
 
 void SqlStorage::_fail(const QString &message, const QSqlQuery &query)
 {
     if (!db.isOpen())
         reconnect->start();
-    emit encounteredError(QString::fromAscii("SqlStorage: Query Error: %1: %2").arg(message, query.lastError().text()));
+    emit encounteredError(QStringLiteral("SqlStorage: Query Error: %1: %2").arg(message, query.lastError().text()));
 }
 
 void SqlStorage::_fail(const QString &message, const QSqlDatabase &database)
 {
     if (!db.isOpen())
         reconnect->start();
-    emit encounteredError(QString::fromAscii("SqlStorage: Query Error: %1: %2").arg(message, database.lastError().text()));
+    emit encounteredError(QStringLiteral("SqlStorage: Query Error: %1: %2").arg(message, database.lastError().text()));
 }
 
 void SqlStorage::fail(const QString &message)
@@ -157,44 +263,16 @@ Common::SqlTransactionAutoAborter SqlStorage::transactionGuard()
     return Common::SqlTransactionAutoAborter(&db);
 }
 
-SqlStorage::ResultType SqlStorage::insertAddress( const quint64 emlId, const QString &name, const QString &address, const QLatin1String kind )
-{
-    _queryInsertAddress.bindValue( QLatin1String(":emladdr_eml_id"), emlId );
-    _queryInsertAddress.bindValue( QLatin1String(":emladdr_type"), kind );
-    _queryInsertAddress.bindValue( QLatin1String(":emladdr_addr"), address );
-    _queryInsertAddress.bindValue( QLatin1String(":emladdr_name"), name );
-
-    if ( ! _queryInsertAddress.exec() ) {
-        _fail( "Query _queryInsertAddress failed", _queryInsertAddress );
-        return RESULT_ERROR;
-    }
-
-    return RESULT_OK;
-}
-
-SqlStorage::ResultType SqlStorage::markMailReady( const quint64 emlId )
-{
-    _queryMarkMailReady.bindValue( 0, emlId );
-
-    if ( ! _queryMarkMailReady.exec() ) {
-        _fail( "Query _queryMarkMailReady failed", _queryMarkMailReady );
-        return RESULT_ERROR;
-    }
-
-    return RESULT_OK;
-}
-
 void SqlStorage::slotReconnect()
 {
     qDebug() << "Trying to reconnect to the database...";
+
     // Release all DB resources
-    _queryInsertAddress.clear();
-    _queryInsertMail.clear();
-    _queryMarkMailReady.clear();
     db.close();
 
     // Unregister the DB
-    QSqlDatabase::removeDatabase( QLatin1String("xtconnect-sqlstorage") );
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase( QStringLiteral("xtconnect-sqlstorage") );
 
     open();
 }
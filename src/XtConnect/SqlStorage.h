@@ -33,10 +33,12 @@
 
 #include <QDateTime>
 #include <QObject>
+#include <QSet>
 #include <QSqlDatabase>
 #include <QSqlQuery>
+#include <QVector>
+
 #include "Common/SqlTransactionAutoAborter.h"
-#include "xsqlquery.h"
 
 class QTimer;
 
@@ -47,21 +49,48 @@ class SqlStorage : public QObject
 {
     Q_OBJECT
 public:
+    typedef enum { RESULT_OK, RESULT_ERROR } ResultType;
+
+    /** @short One address from the envelope of a message */
+    struct MailAddress {
+        /** @short FROM, TO, CC or BCC */
+        QString kind;
+        QString name;
+        QString address;
+    };
+
+    /** @short Everything which gets stored about a single message */
+    struct Mail {
+        QDateTime dateTime;
+        QString subject;
+        QString readableText;
+        QByteArray headers;
+        QByteArray body;
+        QVector<MailAddress> addresses;
+    };
+
+    /** @short Prepare access to the database
+
+    The @arg driver is the name of the QtSql driver to use; anything but PostgreSQL is only meant for unit tests.
+    */
+    explicit SqlStorage(QObject *parent, const QString &host, const int port, const QString &dbname, const QString &username, const QString &password,
+                        const QString &driver = QStringLiteral("QPSQL"));
 
-    typedef enum { RESULT_OK, RESULT_DUPLICATE, RESULT_ERROR } ResultType;
-
-    explicit SqlStorage(QObject *parent, const QString &host, const int port, const QString &dbname, const QString &username, const QString &password);
     void open();
 
-    /** @short Save mail data to the "eml" table */
-    ResultType insertMail( const QDateTime &dateTime, const QString &subject, const QString &readableText, const QByteArray &headers, const QByteArray &body, quint64 &emlId );
-    /** @short Insert an e-mail address into the eml_emladdr table */
-    ResultType insertAddress( const quint64 emlId, const QString &name, const QString &address, const QLatin1String kind );
-    /** @short Mark the row in the eml table as "ready for processing" */
-    ResultType markMailReady( const quint64 emlId );
+    /** @short Save a batch of mails into the "eml" and "emladdr" tables and mark them as ready for processing
+
+    The whole batch is looked up and written through a few multi-row statements. The caller is expected to wrap the call
+    in a transaction, see transactionGuard().
+
+    Upon success, the @arg emlIds contains the eml_id of each saved message, in the order of @arg mails. A zero
+    means that a message with the same body has been saved before, either earlier in this batch or in the past.
+    */
+    ResultType insertMails(const QVector<Mail> &mails, QVector<quint64> &emlIds);
 
     /** @short Return an object which aborts the transaction upon its destruction (RIAA-like approach to transactions) */
     Common::SqlTransactionAutoAborter transactionGuard();
+
     /** @short Log a message saying that something talking to the DB failed */
     void fail( const QString &message );
 
@@ -73,15 +102,15 @@ private slots:
     void slotReconnect();
 
 private:
-    void _prepareStatements();
+    QString hashColumn() const;
+    ResultType findKnownHashes(const QVector<QByteArray> &hashes, QSet<QByteArray> &knownHashes);
+    ResultType insertAddresses(const QVector<Mail> &mails, const QVector<quint64> &emlIds);
+    ResultType markMailsReady(const QVector<quint64> &emlIds);
+
     void _fail( const QString &message, const QSqlQuery &query );
     void _fail( const QString &message, const QSqlDatabase &database );
 
     QSqlDatabase db;
-    XSqlQuery _queryValidateMail;
-    XSqlQuery _queryInsertMail;
-    XSqlQuery _queryInsertAddress;
-    QSqlQuery _queryMarkMailReady;
 
     QTimer *reconnect;
 
@@ -90,6 +119,7 @@ private:
     QString _dbname;
     QString _username;
     QString _password;
+    QString _driver;
 };
 
 }
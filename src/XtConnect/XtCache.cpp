@@ -24,11 +24,10 @@
 
 namespace XtConnect {
 
-XtCache::XtCache( QObject* parent, const QString& name, const QString& cacheDir ):
-        Imap::Mailbox::AbstractCache(parent), _name(name), _cacheDir(cacheDir)
+XtCache::XtCache( const QString& name, const QString& cacheDir ):
+        _sqlCache(new Imap::Mailbox::SQLCache()), _name(name), _cacheDir(cacheDir)
 {
-    _sqlCache = new Imap::Mailbox::SQLCache( this );
-    connect( _sqlCache, SIGNAL(error(QString)), this, SIGNAL(error(QString)) );
+    _sqlCache->setErrorHandler([this](const QString &e) { this->m_errorHandler(e); });
 }
 
 XtCache::~XtCache()
@@ -58,11 +57,6 @@ void XtCache::setChildMailboxes( const QString& mailbox, const QList<Imap::Mailb
     Q_UNUSED(data);
 }
 
-void XtCache::forgetChildMailboxes( const QString& mailbox )
-{
-    Q_UNUSED(mailbox);
-}
-
 Imap::Mailbox::SyncState XtCache::mailboxSyncState( const QString& mailbox ) const
 {
     return _sqlCache->mailboxSyncState( mailbox );
@@ -73,12 +67,12 @@ void XtCache::setMailboxSyncState( const QString& mailbox, const Imap::Mailbox::
     _sqlCache->setMailboxSyncState( mailbox, state );
 }
 
-QList<uint> XtCache::uidMapping( const QString& mailbox ) const
+Imap::Uids XtCache::uidMapping( const QString& mailbox ) const
 {
     return _sqlCache->uidMapping( mailbox );
 }
 
-void XtCache::setUidMapping( const QString& mailbox, const QList<uint>& seqToUid )
+void XtCache::setUidMapping( const QString& mailbox, const Imap::Uids& seqToUid )
 {
     _sqlCache->setUidMapping( mailbox, seqToUid );
 }
@@ -93,25 +87,32 @@ void XtCache::clearAllMessages( const QString& mailbox )
     _sqlCache->clearAllMessages( mailbox );
 }
 
-void XtCache::clearMessage( const QString mailbox, uint uid )
+void XtCache::clearMessage( const QString mailbox, const uint uid )
 {
     _sqlCache->clearMessage( mailbox, uid );
 }
 
-QStringList XtCache::msgFlags( const QString& mailbox, uint uid ) const
+QStringList XtCache::msgFlags( const QString& mailbox, const uint uid ) const
 {
     Q_UNUSED(mailbox);
     Q_UNUSED(uid);
     return QStringList();
 }
 
-void XtCache::setMsgFlags( const QString& mailbox, uint uid, const QStringList& flags )
+void XtCache::setMsgFlags( const QString& mailbox, const uint uid, const QStringList& flags )
 {
     Q_UNUSED(mailbox);
     Q_UNUSED(uid);
     Q_UNUSED(flags);
 }
 
+void XtCache::addMsgFlag( const QString& mailbox, const Imap::Uids& uids, const QString& flag )
+{
+    Q_UNUSED(mailbox);
+    Q_UNUSED(uids);
+    Q_UNUSED(flag);
+}
+
 XtCache::MessageDataBundle XtCache::messageMetadata( const QString& mailbox, uint uid ) const
 {
     Q_UNUSED(mailbox);
@@ -119,14 +120,14 @@ XtCache::MessageDataBundle XtCache::messageMetadata( const QString& mailbox, uin
     return MessageDataBundle();
 }
 
-void XtCache::setMessageMetadata( const QString& mailbox, uint uid, const MessageDataBundle& metadata )
+void XtCache::setMessageMetadata( const QString& mailbox, const uint uid, const MessageDataBundle& metadata )
 {
     Q_UNUSED(mailbox);
     Q_UNUSED(uid);
     Q_UNUSED(metadata);
 }
 
-QByteArray XtCache::messagePart( const QString& mailbox, uint uid, const QString& partId ) const
+QByteArray XtCache::messagePart( const QString& mailbox, const uint uid, const QByteArray& partId ) const
 {
     Q_UNUSED(mailbox);
     Q_UNUSED(uid);
@@ -134,7 +135,7 @@ QByteArray XtCache::messagePart( const QString& mailbox, uint uid, const QString
     return QByteArray();
 }
 
-void XtCache::setMsgPart( const QString& mailbox, uint uid, const QString& partId, const QByteArray& data )
+void XtCache::setMsgPart( const QString& mailbox, const uint uid, const QByteArray& partId, const QByteArray& data )
 {
     Q_UNUSED(mailbox);
     Q_UNUSED(uid);
@@ -142,6 +143,13 @@ void XtCache::setMsgPart( const QString& mailbox, uint uid, const QString& partI
     Q_UNUSED(data);
 }
 
+void XtCache::forgetMessagePart( const QString& mailbox, const uint uid, const QByteArray& partId )
+{
+    Q_UNUSED(mailbox);
+    Q_UNUSED(uid);
+    Q_UNUSED(partId);
+}
+
 XtCache::SavingState XtCache::messageSavingStatus( const QString &mailbox, const uint uid ) const
 {
     QStringList flags = _sqlCache->msgFlags( mailbox, uid );
@@ -187,4 +195,9 @@ void XtCache::setRenewalThreshold(const int days)
     Q_UNUSED(days);
 }
 
+void XtCache::flush()
+{
+    _sqlCache->flush();
+}
+
 }
@@ -22,6 +22,7 @@
 #ifndef XTCONNECT_XTCACHE
 #define XTCONNECT_XTCACHE
 
+#include <memory>
 #include "Imap/Model/Cache.h"
 
 namespace Imap {
@@ -44,7 +45,6 @@ setup with a reworked MemoryCache; this will have to be done when the actual Tre
 storing data inside themselves.
 */
 class XtCache : public Imap::Mailbox::AbstractCache {
-    Q_OBJECT
 public:
     /** @short Constructor
 
@@ -52,7 +52,7 @@ public:
       Store all data into the @arg cacheDir directory. Actual opening of the DB connection
       is deferred till a call to the load() method.
 */
-    XtCache( QObject* parent, const QString& name, const QString& cacheDir );
+    XtCache( const QString& name, const QString& cacheDir );
 
     virtual ~XtCache();
 
@@ -62,31 +62,33 @@ public:
     virtual bool childMailboxesFresh( const QString& mailbox ) const;
     /** @short Do nothing */
     virtual void setChildMailboxes( const QString& mailbox, const QList<Imap::Mailbox::MailboxMetadata>& data );
-    /** @short Do nothing */
-    virtual void forgetChildMailboxes( const QString& mailbox );
-
     virtual Imap::Mailbox::SyncState mailboxSyncState( const QString& mailbox ) const;
     virtual void setMailboxSyncState( const QString& mailbox, const Imap::Mailbox::SyncState& state );
 
-    virtual void setUidMapping( const QString& mailbox, const QList<uint>& seqToUid );
+    virtual void setUidMapping( const QString& mailbox, const Imap::Uids& seqToUid );
     virtual void clearUidMapping( const QString& mailbox );
-    virtual QList<uint> uidMapping( const QString& mailbox ) const;
+    virtual Imap::Uids uidMapping( const QString& mailbox ) const;
 
     virtual void clearAllMessages( const QString& mailbox );
-    virtual void clearMessage( const QString mailbox, uint uid );
+    virtual void clearMessage( const QString mailbox, const uint uid );
 
     virtual MessageDataBundle messageMetadata( const QString& mailbox, uint uid ) const;
-    virtual void setMessageMetadata( const QString& mailbox, uint uid, const MessageDataBundle& metadata );
+    virtual void setMessageMetadata( const QString& mailbox, const uint uid, const MessageDataBundle& metadata );
 
     /** @short Do nothing */
-    virtual QStringList msgFlags( const QString& mailbox, uint uid ) const;
+    virtual QStringList msgFlags( const QString& mailbox, const uint uid ) const;
     /** @short Returns no data */
-    virtual void setMsgFlags( const QString& mailbox, uint uid, const QStringList& flags );
+    virtual void setMsgFlags( const QString& mailbox, const uint uid, const QStringList& flags );
+    /** @short Do nothing */
+    virtual void addMsgFlag( const QString& mailbox, const Imap::Uids& uids, const QString& flag );
 
     /** @short ALways returns an empty QByteArray */
-    virtual QByteArray messagePart( const QString& mailbox, uint uid, const QString& partId ) const;
+    virtual QByteArray messagePart( const QString& mailbox, const uint uid, const QByteArray& partId ) const;
     /** @short Do nothing */
-    virtual void setMsgPart( const QString& mailbox, uint uid, const QString& partId, const QByteArray& data );
+    virtual void setMsgPart( const QString& mailbox, const uint uid, const QByteArray& partId, const QByteArray& data );
+
+    /** @short Do nothing */
+    virtual void forgetMessagePart( const QString& mailbox, const uint uid, const QByteArray& partId );
 
     /** @short Do nothing */
     virtual QVector<Imap::Responses::ThreadingNode> messageThreading(const QString &mailbox);
@@ -98,6 +100,8 @@ public:
 
     void setRenewalThreshold(const int days);
 
+    virtual void flush();
+
     /** @short Saving status of a message */
     typedef enum {
         STATE_SAVED, /**< Message has been already saved into the DB */
@@ -112,7 +116,7 @@ public:
 
 private:
     /** @short The SQL-based cache */
-    Imap::Mailbox::SQLCache* _sqlCache;
+    std::unique_ptr<Imap::Mailbox::SQLCache> _sqlCache;
     /** @short Name of the DB connection */
     QString _name;
     /** @short Directory to serve as a cache root */
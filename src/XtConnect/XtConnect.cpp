@@ -33,13 +33,16 @@
 #include <QDir>
 #include <QDebug>
 #include <QSettings>
+#include <QTextStream>
 #include "Common/FileLogger.h"
 #include "Common/PortNumbers.h"
 #include "Common/SettingsNames.h"
 #include "XtCache.h"
 #include "Imap/Model/ItemRoles.h"
 #include "Imap/Model/MailboxFinder.h"
+#include "Imap/Model/MailboxModel.h"
 #include "Imap/Model/MemoryCache.h"
+#include "Imap/Model/Utils.h"
 #include "MessageDownloader.h"
 #include "SqlStorage.h"
 #include "Streams/SocketFactory.h"
@@ -47,10 +50,12 @@
 namespace XtConnect {
 
 XtConnect::XtConnect(QObject *parent, QSettings *s) :
-    QObject(parent), m_model(0), m_settings(s), m_cache(0)
+    QObject(parent), m_settings(s), m_processedMessages(0), m_totalProcessedMessages(0)
 {
     Q_ASSERT(m_settings);
     m_settings->setParent(this);
+    Imap::migrateSettings(m_settings);
+
     if ( ! m_settings->contains( Common::SettingsNames::xtConnectCacheDirectory ) ) {
         qFatal("The service is not configured yet. Please use the Trojita GUI for configuration.");
     }
@@ -60,33 +65,34 @@ XtConnect::XtConnect(QObject *parent, QSettings *s) :
     QString dbname = s->value( Common::SettingsNames::xtDbDbName ).toString();
     QString username = s->value( Common::SettingsNames::xtDbUser ).toString();
     QString password;
+
     bool readstdin = true;
     bool logConsole = false;
     QString logFile;
 
     QStringList args = QCoreApplication::arguments();
     for ( int i = 1; i < args.length(); i++ ) {
-        if (args.at(i) == "-h" && args.length() > i ) {
+        if (args.at(i) == QLatin1String("-h") && args.length() > i ) {
             if (args.length() <= i + 1) qFatal("The \"-h\" option requires a value.");
             host = args.at(++i);
-        } else if (args.at(i) == "-d" && args.length() > i ) {
+        } else if (args.at(i) == QLatin1String("-d") && args.length() > i ) {
             if (args.length() <= i + 1) qFatal("The \"-d\" option requires a value.");
             dbname = args.at(++i);
-        } else if (args.at(i) == "-p" && args.length() > i ) {
+        } else if (args.at(i) == QLatin1String("-p") && args.length() > i ) {
             if (args.length() <= i + 1) qFatal("The \"-p\" option requires a value.");
             port = args.at(++i).toInt();
-        } else if (args.at(i) == "-U" && args.length() > i ) {
+        } else if (args.at(i) == QLatin1String("-U") && args.length() > i ) {
             if (args.length() <= i + 1) qFatal("The \"-U\" option requires a value.");
             username = args.at(++i);
-        } else if (args.at(i) == "-w") {
+        } else if (args.at(i) == QLatin1String("-w")) {
             if (args.length() <= i + 1) qFatal("The \"-w\" option requires a value.");
             readstdin = false;
             password = args.at(++i);
-        } else if (args.at(i) == "-W") {
+        } else if (args.at(i) == QLatin1String("-W")) {
             readstdin = true;
-        } else if (args.at(i) == "--debug") {
+        } else if (args.at(i) == QLatin1String("--debug")) {
             logConsole = true;
-        } else if (args.at(i) == "--log" && args.length() > i) {
+        } else if (args.at(i) == QLatin1String("--log") && args.length() > i) {
             if (args.length() <= i + 1) qFatal("The \"--log\" option requires a value.");
             logFile = args.at(++i);
         } else {
@@ -100,7 +106,24 @@ XtConnect::XtConnect(QObject *parent, QSettings *s) :
         password = QTextStream(stdin).readLine();
     }
 
-    setupModels();
+    QString cacheDir = m_settings->value( Common::SettingsNames::xtConnectCacheDirectory).toString();
+    if ( ! QDir().mkpath( cacheDir ) ) {
+        qCritical() << "Failed to create directory" << cacheDir << " -- will not remember anything on restart!";
+    } else {
+        m_cache = std::make_shared<XtCache>(QStringLiteral("trojita-imap-cache"), cacheDir);
+        m_cache->setErrorHandler([this](const QString &e) { this->cacheError(e); });
+        if ( ! m_cache->open() ) {
+            // Error message was already shown by the cacheError() slot
+            m_cache.reset();
+        }
+    }
+
+    QStringList mailboxes = s->value( Common::SettingsNames::xtSyncMailboxList ).toStringList();
+    bool ok;
+    int numConnections = s->value( Common::SettingsNames::xtParallelConnections, 4 ).toInt(&ok);
+    if (!ok)
+        numConnections = 4;
+    numConnections = qBound(1, numConnections, qMax(1, mailboxes.size()));
 
     Common::FileLogger *logger = new Common::FileLogger(this);
     if (logConsole)
@@ -109,48 +132,59 @@ XtConnect::XtConnect(QObject *parent, QSettings *s) :
         logger->setFileLogging(true, logFile);
         logger->setAutoFlush(true);
     }
-    connect(m_model, SIGNAL(logged(uint,Common::LogMessage)), logger, SLOT(slotImapLogged(uint,Common::LogMessage)));
 
-    // Prepare the mailboxes
-    m_finder = new MailboxFinder( this, m_model );
+    for (int i = 0; i < numConnections; ++i) {
+        Imap::Mailbox::Model *model = createModel(i);
+        connect(model, &Imap::Mailbox::Model::logged, logger, &Common::FileLogger::slotImapLogged);
+        // The MailboxFinder only works on top of a proxy model which contains just the mailboxes
+        Imap::Mailbox::MailboxModel *mailboxModel = new Imap::Mailbox::MailboxModel(this, model);
+        m_connections << qMakePair(model, new Imap::Mailbox::MailboxFinder(this, mailboxModel));
+    }
+
     SqlStorage *storage = new SqlStorage( this, host, port, dbname, username, password );
-    connect(storage, SIGNAL(encounteredError(QString)), this, SLOT(slotSqlError(QString)));
+    connect(storage, &SqlStorage::encounteredError, this, &XtConnect::slotSqlError);
     storage->open();
 
     QTimer *statsDumper = new QTimer(this);
-    connect( statsDumper, SIGNAL(timeout()), this, SLOT(slotDumpStats()) );
+    connect(statsDumper, &QTimer::timeout, this, &XtConnect::slotDumpStats);
     statsDumper->setInterval( 5000 );
     statsDumper->start();
-
-    Q_FOREACH( const QString &mailbox, s->value( Common::SettingsNames::xtSyncMailboxList ).toStringList() ) {
-        MessageDownloader *downloader = new MessageDownloader(this, m_model, mailbox);
-        MailSynchronizer *sync = new MailSynchronizer(this, m_model, m_finder, downloader, storage);
-        connect( sync, SIGNAL(aboutToRequestMessage(QString,QModelIndex,bool*)), this, SLOT(slotAboutToRequestMessage(QString,QModelIndex,bool*)) );
-        connect( sync, SIGNAL(messageSaved(QString,QModelIndex)), this, SLOT(slotMessageStored(QString,QModelIndex)) );
-        connect( sync, SIGNAL(messageIsDuplicate(QString,QModelIndex)), this, SLOT(slotMessageIsDuplicate(QString,QModelIndex)) );
+    m_statsTimer.start();
+    m_uptime.start();
+
+    // The mailboxes are spread evenly among the available connections
+    for (int i = 0; i < mailboxes.size(); ++i) {
+        const QString &mailbox = mailboxes[i];
+        Imap::Mailbox::Model *model = m_connections[i % m_connections.size()].first;
+        Imap::Mailbox::MailboxFinder *finder = m_connections[i % m_connections.size()].second;
+        MessageDownloader *downloader = new MessageDownloader(this, model, mailbox);
+        MailSynchronizer *sync = new MailSynchronizer(this, model, finder, downloader, storage);
+        connect(sync, &MailSynchronizer::aboutToRequestMessage, this, &XtConnect::slotAboutToRequestMessage);
+        connect(sync, &MailSynchronizer::messageSaved, this, &XtConnect::slotMessageStored);
+        connect(sync, &MailSynchronizer::messageIsDuplicate, this, &XtConnect::slotMessageIsDuplicate);
         m_syncers[ mailbox ] = sync;
         sync->setMailbox( mailbox );
     }
 
     m_rotateMailboxes = new QTimer(this);
     m_rotateMailboxes->setInterval( 1000 * 60 * 3 ); // every three minutes
-    connect( m_rotateMailboxes, SIGNAL(timeout()), this, SLOT(goTroughMailboxes()) );
+    connect(m_rotateMailboxes, &QTimer::timeout, this, &XtConnect::goTroughMailboxes);
     m_rotateMailboxes->start();
 }
 
-void XtConnect::setupModels()
+Imap::Mailbox::Model *XtConnect::createModel(const int number)
 {
     Imap::Mailbox::SocketFactoryPtr factory;
-    Imap::Mailbox::TaskFactoryPtr taskFactory( new Imap::Mailbox::TaskFactory() );
+    Imap::Mailbox::TaskFactoryPtr taskFactory(new Imap::Mailbox::TaskFactory());
 
     using Common::SettingsNames;
     if ( m_settings->value( SettingsNames::imapMethodKey ).toString() == SettingsNames::methodTCP ) {
-        factory.reset( new Imap::Mailbox::TlsAbleSocketFactory(
+        factory.reset( new Streams::TlsAbleSocketFactory(
                 m_settings->value( SettingsNames::imapHostKey ).toString(),
                 m_settings->value( SettingsNames::imapPortKey, QString::number(Common::PORT_IMAP) ).toUInt() ) );
         factory->setStartTlsRequired( m_settings->value( SettingsNames::imapStartTlsKey, true ).toBool() );
     } else if ( m_settings->value( SettingsNames::imapMethodKey ).toString() == SettingsNames::methodSSL ) {
-        factory.reset( new Imap::Mailbox::SslSocketFactory(
+        factory.reset( new Streams::SslSocketFactory(
                 m_settings->value( SettingsNames::imapHostKey ).toString(),
                 m_settings->value( SettingsNames::imapPortKey, QString::number(Common::PORT_IMAPS) ).toUInt() ) );
     } else {
@@ -159,45 +193,50 @@ void XtConnect::setupModels()
             qFatal("Invalid value found in the settings of imapProcessKey");
         }
         QString appName = args.takeFirst();
-        factory.reset( new Imap::Mailbox::ProcessSocketFactory( appName, args ) );
+        factory.reset( new Streams::ProcessSocketFactory( appName, args ) );
     }
 
-    bool shouldUsePersistentCache = true;
-    QString cacheDir = m_settings->value( Common::SettingsNames::xtConnectCacheDirectory).toString();
+    std::shared_ptr<Imap::Mailbox::AbstractCache> cache;
+    if (m_cache)
+        cache = m_cache;
+    else
+        cache = std::make_shared<Imap::Mailbox::MemoryCache>();
 
-    if ( ! QDir().mkpath( cacheDir ) ) {
-        qCritical() << "Failed to create directory" << cacheDir << " -- will not remember anything on restart!";
-        shouldUsePersistentCache = false;
-    }
-
-    if ( shouldUsePersistentCache ) {
-        m_cache = new XtCache( this, QLatin1String("trojita-imap-cache"), cacheDir );
-        connect( m_cache, SIGNAL(error(QString)), this, SLOT(cacheError(QString)) );
-        if ( ! m_cache->open() ) {
-            // Error message was already shown by the cacheError() slot
-            m_cache->deleteLater();
-            m_cache = 0;
-        }
-    }
+    Imap::Mailbox::Model *model = new Imap::Mailbox::Model(this, cache, std::move(factory), std::move(taskFactory));
+    model->setObjectName(QStringLiteral("model%1").arg(number));
 
-    m_model = new Imap::Mailbox::Model(this, m_cache ? static_cast<Imap::Mailbox::AbstractCache*>(m_cache) :
-                                                       static_cast<Imap::Mailbox::AbstractCache*>(new Imap::Mailbox::MemoryCache(this)),
-                                       factory, taskFactory, m_settings->value(SettingsNames::imapStartOffline).toBool());
-    m_model->setObjectName( QLatin1String("model") );
     // We want to wait longer to increase the potential of better grouping -- we don't care much about the latency
-    m_model->setProperty( "trojita-imap-delayed-fetch-part", 300 );
+    model->setProperty( "trojita-imap-delayed-fetch-part", 300 );
+
     // Disable preload of message envelopes. We are aggresively cleaning the cache as soon as possible, and
     // we don't want to re-request message envelopes for messages which have been already processed before.
-    m_model->setProperty("trojita-imap-preload-msg-metadata", 0);
-
-    connect( m_model, SIGNAL( alertReceived( const QString& ) ), this, SLOT( alertReceived( const QString& ) ) );
-    connect( m_model, SIGNAL( imapError( const QString& ) ), this, SLOT( connectionError( const QString& ) ) );
-    connect( m_model, SIGNAL( networkError( const QString& ) ), this, SLOT( connectionError( const QString& ) ) );
-    connect(m_model, SIGNAL(authRequested()), this, SLOT(authenticationRequested()), Qt::QueuedConnection);
-    connect(m_model, SIGNAL(authAttemptFailed(QString)), this, SLOT(authenticationFailed(QString)));
-    connect(m_model, SIGNAL(needsSslDecision(QList<QSslCertificate>,QList<QSslError>)),
-            this, SLOT(sslErrors(QList<QSslCertificate>,QList<QSslError>)), Qt::QueuedConnection);
-    connect( m_model, SIGNAL(connectionStateChanged(QObject*,Imap::ConnectionState)), this, SLOT(showConnectionStatus(QObject*,Imap::ConnectionState)) );
+    model->setProperty("trojita-imap-preload-msg-metadata", 0);
+
+    connect(model, &Imap::Mailbox::Model::alertReceived, this, &XtConnect::alertReceived);
+    connect(model, &Imap::Mailbox::Model::imapError, this, [this, model](const QString &message) {
+        connectionError(model, message);
+    });
+    connect(model, &Imap::Mailbox::Model::networkError, this, [this, model](const QString &message) {
+        connectionError(model, message);
+    });
+    connect(model, &Imap::Mailbox::Model::authRequested, this, [this, model]() {
+        authenticationRequested(model);
+    }, Qt::QueuedConnection);
+    connect(model, &Imap::Mailbox::Model::authAttemptFailed, this, [this, model](const QString &message) {
+        authenticationFailed(model, message);
+    });
+    connect(model, &Imap::Mailbox::Model::needsSslDecision, this,
+            [this, model](const QList<QSslCertificate> &certificateChain, const QList<QSslError> &errors) {
+        sslErrors(model, certificateChain, errors);
+    }, Qt::QueuedConnection);
+    connect(model, &Imap::Mailbox::Model::connectionStateChanged, this, &XtConnect::showConnectionStatus);
+
+    if (m_settings->value(Common::SettingsNames::imapStartMode).toString() == Common::SettingsNames::netOffline) {
+        model->setNetworkPolicy(Imap::Mailbox::NETWORK_OFFLINE);
+    } else {
+        model->setNetworkPolicy(Imap::Mailbox::NETWORK_ONLINE);
+    }
+    return model;
 }
 
 void XtConnect::alertReceived(const QString &alert)
@@ -205,60 +244,59 @@ void XtConnect::alertReceived(const QString &alert)
     qCritical() << "ALERT: " << alert;
 }
 
-void XtConnect::authenticationRequested()
+void XtConnect::authenticationRequested(Imap::Mailbox::Model *model)
 {
-    if ( ! m_settings->contains(Common::SettingsNames::imapPassKey) ) {
+    // This is where the cleartext password plugin of the GUI keeps the password
+    const QString imapPassKey = QStringLiteral("imap.auth.pass");
+    if ( ! m_settings->contains(imapPassKey) ) {
         qWarning() << "Warning: no IMAP password set in the configuration.";
         qWarning() << "Please remember to configure the synchronization service in Trojita GUI's settings dialog.";
     }
-    m_model->setImapUser(m_settings->value(Common::SettingsNames::imapUserKey).toString());
-    m_model->setImapPassword(m_settings->value(Common::SettingsNames::imapPassKey).toString());
+    model->setImapUser(m_settings->value(Common::SettingsNames::imapUserKey).toString());
+    model->setImapPassword(m_settings->value(imapPassKey).toString());
 }
 
-void XtConnect::sslErrors(const QList<QSslCertificate> &certificateChain, const QList<QSslError> &errors)
+void XtConnect::sslErrors(Imap::Mailbox::Model *model, const QList<QSslCertificate> &certificateChain, const QList<QSslError> &errors)
 {
-    QByteArray lastKnownCertPem = m_settings->value(Common::SettingsNames::imapSslPemCertificate).toByteArray();
-    QList<QSslCertificate> lastKnownCerts = lastKnownCertPem.isEmpty() ?
-                QList<QSslCertificate>() :
-                QSslCertificate::fromData(lastKnownCertPem, QSsl::Pem);
-    if (!certificateChain.isEmpty() && !lastKnownCerts.isEmpty() && certificateChain == lastKnownCerts) {
-        // It's the same certificate as the last time; we should accept that
-        m_model->setSslPolicy(certificateChain, errors, true);
+    QByteArray lastKnownPubKey = m_settings->value(Common::SettingsNames::imapSslPemPubKey).toByteArray();
+    if (!certificateChain.isEmpty() && !lastKnownPubKey.isEmpty() && lastKnownPubKey == certificateChain[0].publicKey().toPem()) {
+        // It's the same public key as the last time; we should accept that
+        model->setSslPolicy(certificateChain, errors, true);
         return;
     }
-    m_model->setSslPolicy(certificateChain, errors, false);
+
+    model->setSslPolicy(certificateChain, errors, false);
     qFatal("SECURITY ERROR: SSL certificate validation has failed. Please run Trojita to accept the certificate.");
 }
 
-void XtConnect::connectionError(const QString &error)
+void XtConnect::connectionError(Imap::Mailbox::Model *model, const QString &error)
 {
     qCritical() << "Connection error: " << error;
-    m_model->setNetworkOffline();
+    model->setNetworkPolicy(Imap::Mailbox::NETWORK_OFFLINE);
     // FIXME: add some nice behavior for reconnecting. Also handle failed logins...
     qFatal("Reconnects not supported yet -> see you.");
 }
 
-void XtConnect::authenticationFailed(const QString &message)
+void XtConnect::authenticationFailed(Imap::Mailbox::Model *model, const QString &message)
 {
     qCritical() << "Cannot login to the IMAP server: " << message;
-    m_model->setNetworkOffline();
+    model->setNetworkPolicy(Imap::Mailbox::NETWORK_OFFLINE);
     qFatal("Unable to login to the IMAP server");
 }
 
 void XtConnect::cacheError(const QString &error)
 {
     qCritical() << "Cache error: " << error;
-    if ( m_model ) {
-        m_cache = 0;
-        m_model->setCache(new Imap::Mailbox::MemoryCache(m_model));
+    m_cache.reset();
+    for (auto it = m_connections.constBegin(); it != m_connections.constEnd(); ++it) {
+        it->first->setCache(std::make_shared<Imap::Mailbox::MemoryCache>());
     }
 }
 
-void XtConnect::showConnectionStatus( QObject* parser, Imap::ConnectionState state )
+void XtConnect::showConnectionStatus(uint parserId, Imap::ConnectionState state)
 {
-    Q_UNUSED( parser );
+    Q_UNUSED(parserId);
     using namespace Imap;
-
     switch ( state ) {
     case CONN_STATE_FETCHING_MSG_METADATA:
     case CONN_STATE_FETCHING_PART:
@@ -270,7 +308,6 @@ void XtConnect::showConnectionStatus( QObject* parser, Imap::ConnectionState sta
         // well, we're interested in the rest
         break;
     }
-
     qDebug() << "Connection status:" <<  Imap::connectionStateToString( state );
 }
 
@@ -299,6 +336,7 @@ void XtConnect::slotAboutToRequestMessage( const QString &mailbox, const QModelI
 
 void XtConnect::slotMessageStored( const QString &mailbox, const QModelIndex &message )
 {
+    ++m_processedMessages;
     if ( m_cache ) {
         m_cache->setMessageSavingStatus( mailbox,  message.data( Imap::Mailbox::RoleMessageUid ).toUInt(), XtCache::STATE_SAVED );
     }
@@ -306,6 +344,7 @@ void XtConnect::slotMessageStored( const QString &mailbox, const QModelIndex &me
 
 void XtConnect::slotMessageIsDuplicate( const QString &mailbox, const QModelIndex &message )
 {
+    ++m_processedMessages;
     if ( m_cache ) {
         m_cache->setMessageSavingStatus( mailbox,  message.data( Imap::Mailbox::RoleMessageUid ).toUInt(), XtCache::STATE_DUPLICATE );
     }
@@ -313,7 +352,12 @@ void XtConnect::slotMessageIsDuplicate( const QString &mailbox, const QModelInde
 
 void XtConnect::slotDumpStats()
 {
-    qDebug() << QDateTime::currentDateTime();
+    qint64 elapsed = qMax<qint64>(m_statsTimer.restart(), 1);
+    m_totalProcessedMessages += m_processedMessages;
+    qDebug() << QDateTime::currentDateTime() << "processed" << m_processedMessages << "messages," <<
+                QString::number(m_processedMessages * 1000.0 / elapsed, 'f', 1) << "msg/s," <<
+                QString::number(m_totalProcessedMessages * 1000.0 / qMax<qint64>(m_uptime.elapsed(), 1), 'f', 1) << "msg/s on average";
+    m_processedMessages = 0;
     Q_FOREACH( const QPointer<MailSynchronizer> item, m_syncers ) {
         item->debugStats();
     }
@@ -322,7 +366,8 @@ void XtConnect::slotDumpStats()
 void XtConnect::slotSqlError(const QString &message)
 {
     qWarning() << message;
-    m_model->logTrace(0, Common::LOG_OTHER, QLatin1String("SqlCache"), message);
+    if (!m_connections.isEmpty())
+        m_connections.first().first->logTrace(0, Common::LOG_OTHER, QStringLiteral("SqlStorage"), message);
 }
 
 }
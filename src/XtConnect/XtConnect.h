@@ -30,6 +30,8 @@
 #ifndef XTCONNECT_H
 #define XTCONNECT_H
 
+#include <memory>
+#include <QElapsedTimer>
 #include <QModelIndex>
 #include "Imap/Model/Model.h"
 #include "MailSynchronizer.h"
@@ -40,7 +42,11 @@ namespace XtConnect {
 
 class XtCache;
 
-/** @short Handle storing the mails into the XTuple Connect database */
+/** @short The synchronization service
+
+The mailboxes to watch are distributed among several independent IMAP connections, each of them
+driven by its own Model, so that messages from different mailboxes are downloaded in parallel.
+*/
 class XtConnect : public QObject
 {
     Q_OBJECT
@@ -51,41 +57,47 @@ public slots:
     /** @short IMAP alerts */
     void alertReceived(const QString &alert);
     /** @short Error in connecting */
-    void connectionError(const QString &error);
+    void connectionError(Imap::Mailbox::Model *model, const QString &error);
     /** @short Feed the auth data back to the Model */
-    void authenticationRequested();
+    void authenticationRequested(Imap::Mailbox::Model *model);
     /** @short Authentication error */
-    void authenticationFailed(const QString &message);
+    void authenticationFailed(Imap::Mailbox::Model *model, const QString &message);
     /** @short Refuse to work when SSL validation fails */
-    void sslErrors(const QList<QSslCertificate> &certificateChain, const QList<QSslError> &errors);
+    void sslErrors(Imap::Mailbox::Model *model, const QList<QSslCertificate> &certificateChain, const QList<QSslError> &errors);
     /** @short Cache has encountered some error */
     void cacheError(const QString &error);
     /** @short Updating progress */
-    void showConnectionStatus(QObject* parser, Imap::ConnectionState state);
+    void showConnectionStatus(uint parserId, Imap::ConnectionState state);
     /** @short Go through all mailboxes and check for new stuff */
     void goTroughMailboxes();
-
     /** @short A decision is needed whether to download a message */
     void slotAboutToRequestMessage( const QString &mailbox, const QModelIndex &message, bool *shouldLoad );
     /** @short A message has been stored into the database */
     void slotMessageStored( const QString &mailbox, const QModelIndex &message );
     /** @short A message is already present in the database */
     void slotMessageIsDuplicate( const QString &mailbox, const QModelIndex &message );
-
     /** @short Dump some statistics about how is it going */
     void slotDumpStats();
 
     void slotSqlError(const QString &message);
 
 private:
-    void setupModels();
+    /** @short Create one IMAP connection along with its Model */
+    Imap::Mailbox::Model *createModel(const int number);
 
-    Imap::Mailbox::Model *m_model;
     QSettings *m_settings;
-    MailboxFinder *m_finder;
+    /** @short All IMAP connections, each of them with its own MailboxFinder */
+    QVector<QPair<Imap::Mailbox::Model*, Imap::Mailbox::MailboxFinder*> > m_connections;
     QMap<QString, QPointer<MailSynchronizer> > m_syncers;
     QTimer *m_rotateMailboxes;
-    XtCache *m_cache;
+    std::shared_ptr<XtCache> m_cache;
+
+    /** @short Number of messages which were saved or found to be duplicates since the last statistics dump */
+    int m_processedMessages;
+    /** @short Number of messages processed since the start */
+    quint64 m_totalProcessedMessages;
+    QElapsedTimer m_statsTimer;
+    QElapsedTimer m_uptime;
 };
 
 }
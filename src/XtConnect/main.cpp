@@ -36,12 +36,12 @@
 int main( int argc, char** argv) {
     Common::registerMetaTypes();
     QCoreApplication app( argc, argv );
-    Common::Application::name = QString::fromAscii("xtconnect-trojita");
+    Common::Application::name = QStringLiteral("xtconnect-trojita");
     AppVersion::setGitVersion();
     AppVersion::setCoreApplicationData();
-    QCoreApplication::setOrganizationDomain( QString::fromAscii("xtuple.com") );
-    QCoreApplication::setOrganizationName( QString::fromAscii("xtuple.com") );
-    QSettings s(QSettings::UserScope, QString::fromAscii("xTuple.com"), QString::fromAscii("xTuple"));
-    XtConnect::XtConnect conn(0, &s);
+    QCoreApplication::setOrganizationDomain( QStringLiteral("xtuple.com") );
+    QCoreApplication::setOrganizationName( QStringLiteral("xtuple.com") );
+    QSettings *s = new QSettings(QSettings::UserScope, QStringLiteral("xTuple.com"), QStringLiteral("xTuple"));
+    XtConnect::XtConnect conn(0, s);
     return app.exec();
 }
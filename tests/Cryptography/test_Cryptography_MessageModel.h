@@ -42,7 +42,8 @@ private Q_SLOTS:
     /* test mixed messages with custom messages added to an existing IMAP message */
     void testMixedMessageParts();
 
-    void testLocalMimeParsing();
+    void testStructureFirstRfc822();
+    void testStructureFirstRfc822_data();
 
     void testDelayedLoading();
 };
@@ -240,6 +240,78 @@ void CryptographyPGPTest::testDecryptWithoutEnvelope()
 #endif
 }
 
+/** @short Showing an already decrypted message once again shall not go through GpgME */
+void CryptographyPGPTest::testDecryptionCache()
+{
+#if defined(TROJITA_HAVE_CRYPTO_MESSAGES) && defined(TROJITA_HAVE_GPGMEPP)
+    model->setProperty("trojita-imap-delayed-fetch-part", 0);
+
+    helperSyncBNoMessages();
+    cServer("* 1 EXISTS\r\n");
+    cClient(t.mk("UID FETCH 1:* (FLAGS)\r\n"));
+    cServer("* 1 FETCH (UID 333 FLAGS ())\r\n" + t.last("OK fetched\r\n"));
+    QModelIndex msg = msgListB.child(0, 0);
+    QVERIFY(msg.isValid());
+    QCOMPARE(model->rowCount(msg), 0);
+    cClient(t.mk("UID FETCH 333 (" FETCH_METADATA_ITEMS ")\r\n"));
+    cServer(helperCreateTrivialEnvelope(1, 333, QStringLiteral("subj"), QStringLiteral("valid@test.trojita.flaska.net"), bsEncrypted)
+            + t.last("OK fetched\r\n"));
+    cEmpty();
+
+    auto replacer = std::make_shared<Cryptography::GpgMeReplacer>();
+    replacer->decryptedMessageCache()->setBudget(1024 * 1024);
+    QString status;
+
+    {
+        Cryptography::MessageModel msgModel(0, msg);
+        msgModel.registerPartHandler(replacer);
+        QModelIndex data = msgModel.index(0, 0).child(0, 0);
+        QVERIFY(data.isValid());
+
+        cClientRegExp(t.mk("UID FETCH 333 \\((BODY\\.PEEK\\[2\\] BODY\\.PEEK\\[1\\]|BODY.PEEK\\[1\\] BODY\\.PEEK\\[2\\])\\)"));
+        cServer("* 1 FETCH (UID 333 BODY[2] " + asLiteral(encValid) + " BODY[1] " + asLiteral("Version: 1\r\n") + ")\r\n"
+                + t.last("OK fetched"));
+
+        int i = 0;
+        while (data.isValid() && data.data(Imap::Mailbox::RolePartCryptoNotFinishedYet).toBool() && i++ < 1000) {
+            QTest::qWait(10);
+        }
+        QCoreApplication::processEvents();
+        QVERIFY(msgModel.rowCount(data) > 0);
+        QCOMPARE(replacer->decryptedMessageCache()->hits(), 0ull);
+        QCOMPARE(replacer->decryptedMessageCache()->misses(), 1ull);
+        status = data.data(Imap::Mailbox::RolePartCryptoTLDR).toString();
+    }
+
+    // The message is shown once again; the result shall be available right after the event loop runs
+    Cryptography::MessageModel msgModel(0, msg);
+    msgModel.registerPartHandler(replacer);
+    QModelIndex data = msgModel.index(0, 0).child(0, 0);
+    QVERIFY(data.isValid());
+    QCoreApplication::processEvents();
+    QCOMPARE(replacer->decryptedMessageCache()->hits(), 1ull);
+    QCOMPARE(data.data(Imap::Mailbox::RolePartCryptoNotFinishedYet).toBool(), false);
+    QVERIFY(msgModel.rowCount(data) > 0);
+    QCOMPARE(data.data(Imap::Mailbox::RolePartCryptoTLDR).toString(), status);
+
+    // Disabling the cache forgets everything. A disabled cache is never asked, so look again once it is back.
+    const QString key = Cryptography::DecryptedMessageCache::keyForPart(msg.child(0, 0).child(1, 0));
+    QVERIFY(replacer->decryptedMessageCache()->find(key));
+    QCOMPARE(replacer->decryptedMessageCache()->hits(), 2ull);
+    QCOMPARE(replacer->decryptedMessageCache()->misses(), 1ull);
+    replacer->decryptedMessageCache()->setBudget(0);
+    replacer->decryptedMessageCache()->setBudget(1024 * 1024);
+    QVERIFY(!replacer->decryptedMessageCache()->find(key));
+    QCOMPARE(replacer->decryptedMessageCache()->hits(), 2ull);
+    QCOMPARE(replacer->decryptedMessageCache()->misses(), 2ull);
+
+    cEmpty();
+    QVERIFY(errorSpy->empty());
+#else
+    QSKIP("Cannot test without GpgME++ support");
+#endif
+}
+
 void CryptographyPGPTest::testVerification()
 {
     QFETCH(QByteArray, signature);
@@ -36,6 +36,7 @@ private Q_SLOTS:
     void testDecryption();
     void testDecryption_data();
     void testDecryptWithoutEnvelope();
+    void testDecryptionCache();
     void testVerification();
     void testVerification_data();
     void testMalformed();
@@ -395,6 +395,103 @@ void BodyPartsTest::testFetchingRawParts()
     cEmpty();
 }
 
+/** @short Check that big parts can be downloaded and shown in chunks */
+void BodyPartsTest::testPartialFetchPreview()
+{
+    QFETCH(QByteArray, encoding);
+
+    model->setProperty("trojita-imap-delayed-fetch-part", 0);
+    QByteArray fakePartData;
+    for (int i = 0; fakePartData.size() < 600 * 1024; ++i) {
+        fakePartData += "This is line #" + QByteArray::number(i) + " of a rather boring log file\r\n";
+    }
+    QByteArray rawPartData;
+    if (encoding == "base64") {
+        // The chunk boundaries do not align with the base64 quanta
+        const QByteArray encoded = fakePartData.toBase64();
+        for (int i = 0; i < encoded.size(); i += 76) {
+            rawPartData += encoded.mid(i, 76) + "\r\n";
+        }
+    } else {
+        rawPartData = fakePartData;
+    }
+    const int chunkSize = 256 * 1024;
+    const QByteArray bodystructure = "\"text\" \"plain\" () NIL NIL \"" + encoding + "\" "
+            + QByteArray::number(rawPartData.size()) + " 1 NIL NIL NIL NIL";
+
+    helperSyncBNoMessages();
+    cServer("* 1 EXISTS\r\n");
+    cClient(t.mk("UID FETCH 1:* (FLAGS)\r\n"));
+    cServer("* 1 FETCH (UID 333 FLAGS ())\r\n" + t.last("OK fetched\r\n"));
+    QCOMPARE(model->rowCount(msgListB), 1);
+    QModelIndex msg = msgListB.child(0, 0);
+    QVERIFY(msg.isValid());
+    QCOMPARE(model->rowCount(msg), 0);
+    cClient(t.mk("UID FETCH 333 (" FETCH_METADATA_ITEMS ")\r\n"));
+    cServer("* 1 FETCH (UID 333 BODYSTRUCTURE (" + bodystructure + "))\r\n" + t.last("OK fetched\r\n"));
+    QCOMPARE(model->rowCount(msg), 1);
+    QModelIndex part = msg.child(0, 0);
+    QVERIFY(part.isValid());
+    QCOMPARE(part.data(RolePartId).toString(), QString("1"));
+
+    QSignalSpy dataChangedSpy(model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+
+    // Only the first chunk is requested
+    QCOMPARE(part.data(RolePartPreviewData).toByteArray(), QByteArray());
+    QVERIFY(part.data(RolePartPreviewIsTruncated).toBool());
+    cClient(t.mk("UID FETCH 333 (BODY.PEEK[1]<0.262144>)\r\n"));
+    cServer("* 1 FETCH (UID 333 BODY[1]<0> " + asLiteral(rawPartData.left(chunkSize)) + ")\r\n" + t.last("OK fetched\r\n"));
+    QCOMPARE(dataChangedSpy.size(), 1);
+    QCOMPARE(dataChangedSpy[0][0].toModelIndex(), part);
+    dataChangedSpy.clear();
+    QByteArray preview = part.data(RolePartPreviewData).toByteArray();
+    // Just the complete lines are shown
+    QVERIFY(preview.size() > (encoding == "base64" ? chunkSize * 3 / 4 - 200 : chunkSize - 100));
+    QVERIFY(preview.size() <= chunkSize);
+    QVERIFY(preview.endsWith("\r\n"));
+    QVERIFY(fakePartData.startsWith(preview));
+    QVERIFY(part.data(RolePartPreviewIsTruncated).toBool());
+    QVERIFY(!part.data(RoleIsFetched).toBool());
+    QVERIFY(model->cache()->messagePart("b", 333, "1").isNull());
+    // Asking for the preview again does not download anything
+    QCOMPARE(part.data(RolePartPreviewData).toByteArray(), preview);
+    cEmpty();
+
+    // The rest is streamed on demand, one chunk at a time
+    part.data(RolePartPreviewFetchMore);
+    cClient(t.mk("UID FETCH 333 (BODY.PEEK[1]<262144.262144>)\r\n"));
+    part.data(RolePartPreviewFetchMore);
+    cServer("* 1 FETCH (UID 333 BODY[1]<262144> " + asLiteral(rawPartData.mid(chunkSize, chunkSize)) + ")\r\n"
+            + t.last("OK fetched\r\n"));
+    QCOMPARE(dataChangedSpy.size(), 1);
+    dataChangedSpy.clear();
+    QVERIFY(part.data(RolePartPreviewData).toByteArray().size() > preview.size());
+    preview = part.data(RolePartPreviewData).toByteArray();
+    QVERIFY(fakePartData.startsWith(preview));
+    QVERIFY(part.data(RolePartPreviewIsTruncated).toBool());
+    cEmpty();
+
+    part.data(RolePartPreviewFetchMore);
+    cClient(t.mk("UID FETCH 333 (BODY.PEEK[1]<524288.262144>)\r\n"));
+    cServer("* 1 FETCH (UID 333 BODY[1]<524288> " + asLiteral(rawPartData.mid(2 * chunkSize)) + ")\r\n"
+            + t.last("OK fetched\r\n"));
+    QCOMPARE(dataChangedSpy.size(), 1);
+    QVERIFY(part.data(RoleIsFetched).toBool());
+    QVERIFY(!part.data(RolePartPreviewIsTruncated).toBool());
+    QCOMPARE(part.data(RolePartPreviewData).toByteArray(), fakePartData);
+    QCOMPARE(part.data(RolePartData).toByteArray(), fakePartData);
+    QCOMPARE(model->cache()->messagePart("b", 333, "1"), fakePartData);
+    part.data(RolePartPreviewFetchMore);
+    cEmpty();
+}
+
+void BodyPartsTest::testPartialFetchPreview_data()
+{
+    QTest::addColumn<QByteArray>("encoding");
+    QTest::newRow("8bit") << QByteArray("8bit");
+    QTest::newRow("base64") << QByteArray("base64");
+}
+
 void BodyPartsTest::testFilenameExtraction()
 {
     QFETCH(QByteArray, bodystructure);
@@ -38,6 +38,8 @@ private slots:
     void testInvalidPartFetch_data();
 
     void testFetchingRawParts();
+    void testPartialFetchPreview();
+    void testPartialFetchPreview_data();
 
     void testFilenameExtraction();
     void testFilenameExtraction_data();
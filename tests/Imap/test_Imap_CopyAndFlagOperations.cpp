@@ -20,6 +20,7 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <QElapsedTimer>
 #include "test_Imap_CopyAndFlagOperations.h"
 #include "Utils/FakeCapabilitiesInjector.h"
 #include "Streams/FakeSocket.h"
@@ -166,4 +167,135 @@ void CopyAndFlagTest::testUpdateAllFlags()
     justKeepTask();
 }
 
+/** @short Marking a huge mailbox as read returns to the event loop and does not ask for the message counts again
+
+The messages which arrive while the tree is being updated are not marked as read.
+*/
+void CopyAndFlagTest::testUpdateAllFlagsLargeMailbox()
+{
+    existsA = 20000;
+    uidValidityA = 666;
+    for (uint i = 1; i <= existsA; ++i)
+        uidMapA << i;
+    uidNextA = existsA + 1;
+    helperSyncAWithMessagesEmptyState();
+    QVERIFY(idxA.data(RoleUnreadMessageCount).toInt() > 0);
+
+    model->markMailboxAsRead(idxA);
+    cClient(t.mk("STORE 1:* +FLAGS.SILENT \\Seen\r\n"));
+    qint64 longestPass = 0;
+    SOCK->fakeReading(t.last("OK stored\r\n") + "* " + QByteArray::number(existsA + 1) + " EXISTS\r\n");
+    QModelIndex lastMessage = msgListA.child(existsA - 1, 0);
+    for (uint i = 0; i < existsA && !lastMessage.data(RoleMessageIsMarkedRead).toBool(); ++i) {
+        QElapsedTimer pass;
+        pass.start();
+        QCoreApplication::processEvents();
+        longestPass = qMax(longestPass, pass.elapsed());
+    }
+    // Each slice is limited to 10 ms; leave plenty of room for slow and loaded machines
+    QVERIFY2(longestPass < 500, QByteArray::number(longestPass).constData());
+
+    cClient(t.mk("UID FETCH " + QByteArray::number(uidNextA) + ":* (FLAGS)\r\n"));
+    cServer("* " + QByteArray::number(existsA + 1) + " FETCH (UID " + QByteArray::number(uidNextA) + " FLAGS ())\r\n"
+            + t.last("OK fetched\r\n"));
+
+    QString mailbox = QStringLiteral("a");
+    QString seen = QStringLiteral("\\Seen");
+    for (uint i = 0; i < existsA; i += 997) {
+        QVERIFY(msgListA.child(i, 0).data(RoleMessageIsMarkedRead).toBool());
+        QVERIFY(model->cache()->msgFlags(mailbox, uidMapA[i]).contains(seen));
+    }
+    QVERIFY(lastMessage.data(RoleMessageIsMarkedRead).toBool());
+    QCOMPARE(model->rowCount(msgListA), static_cast<int>(existsA + 1));
+    QVERIFY(!msgListA.child(existsA, 0).data(RoleMessageIsMarkedRead).toBool());
+    QVERIFY(!model->cache()->msgFlags(mailbox, uidNextA).contains(seen));
+    QCOMPARE(idxA.data(RoleUnreadMessageCount).toInt(), 1);
+
+    // No STATUS to find out what we already know
+    cEmpty();
+    justKeepTask();
+}
+
+/** @short Flags which the server reports before the message got updated in the tree win, both in the tree and in the cache */
+void CopyAndFlagTest::testUpdateAllFlagsConcurrentChange()
+{
+    existsA = 20000;
+    uidValidityA = 666;
+    for (uint i = 1; i <= existsA; ++i)
+        uidMapA << i;
+    uidNextA = existsA + 1;
+    helperSyncAWithMessagesEmptyState();
+
+    model->markMailboxAsRead(idxA);
+    cClient(t.mk("STORE 1:* +FLAGS.SILENT \\Seen\r\n"));
+    // Another client touches the last two messages right after our STORE. The first of them changes in the tree, the
+    // other one does not.
+    SOCK->fakeReading(t.last("OK stored\r\n")
+                      + "* " + QByteArray::number(existsA - 1) + " FETCH (FLAGS (\\Flagged))\r\n"
+                      + "* " + QByteArray::number(existsA) + " FETCH (FLAGS ())\r\n");
+    for (uint i = 0; i < existsA && idxA.data(RoleUnreadMessageCount).toInt() != 2; ++i) {
+        QCoreApplication::processEvents();
+    }
+    QCOMPARE(idxA.data(RoleUnreadMessageCount).toInt(), 2);
+    // The last slice might only skip the reported messages
+    QCoreApplication::processEvents();
+
+    QString mailbox = QStringLiteral("a");
+    QString seen = QStringLiteral("\\Seen");
+    QString flagged = QStringLiteral("\\Flagged");
+    for (uint i = 0; i < existsA - 2; i += 997) {
+        QVERIFY(msgListA.child(i, 0).data(RoleMessageIsMarkedRead).toBool());
+        QVERIFY(model->cache()->msgFlags(mailbox, uidMapA[i]).contains(seen));
+    }
+    QVERIFY(msgListA.child(existsA - 3, 0).data(RoleMessageIsMarkedRead).toBool());
+    QVERIFY(model->cache()->msgFlags(mailbox, uidMapA[existsA - 3]).contains(seen));
+    QVERIFY(!msgListA.child(existsA - 2, 0).data(RoleMessageIsMarkedRead).toBool());
+    QVERIFY(msgListA.child(existsA - 2, 0).data(RoleMessageIsMarkedFlagged).toBool());
+    QCOMPARE(model->cache()->msgFlags(mailbox, uidMapA[existsA - 2]), QStringList() << flagged);
+    QVERIFY(!msgListA.child(existsA - 1, 0).data(RoleMessageIsMarkedRead).toBool());
+    QCOMPARE(model->cache()->msgFlags(mailbox, uidMapA[existsA - 1]), QStringList());
+
+    cEmpty();
+    justKeepTask();
+}
+
+/** @short Flag updates of a set of UIDs only affect messages which are still present */
+void CopyAndFlagTest::testFlagsByUidSet()
+{
+    existsA = 7;
+    uidNextA = 11;
+    uidValidityA = 666;
+    uidMapA << 1 << 2 << 3 << 5 << 7 << 8 << 10;
+    helperSyncAWithMessagesEmptyState();
+    helperCheckCache();
+    helperVerifyUidMapA();
+
+    model->markMessagesRead(idxA, Imap::Sequence::fromVector(Imap::Uids() << 10 << 2 << 3 << 4 << 5 << 11),
+                            Imap::Mailbox::FLAG_ADD);
+    cClient(t.mk("UID STORE 2:3,5,10 +FLAGS (\\Seen)\r\n"));
+    cServer(t.last("OK stored\r\n"));
+
+    cEmpty();
+    justKeepTask();
+}
+
+/** @short The UIDs are not used once the UIDVALIDITY changes */
+void CopyAndFlagTest::testFlagsUidValidityChanged()
+{
+    existsA = 3;
+    uidNextA = 4;
+    uidValidityA = 666;
+    uidMapA << 1 << 2 << 3;
+    helperSyncAWithMessagesEmptyState();
+
+    model->markMessagesRead(idxA, Imap::Sequence::fromVector(Imap::Uids() << 2), Imap::Mailbox::FLAG_ADD);
+    // Pretend that the mailbox got reset before the task could run
+    auto mailbox = dynamic_cast<Imap::Mailbox::TreeItemMailbox *>(static_cast<Imap::Mailbox::TreeItem *>(idxA.internalPointer()));
+    QVERIFY(mailbox);
+    mailbox->syncState.setUidValidity(667);
+
+    cEmpty();
+    justKeepTask();
+}
+
 QTEST_GUILESS_MAIN(CopyAndFlagTest)
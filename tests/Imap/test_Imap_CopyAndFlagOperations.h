@@ -40,6 +40,10 @@ private slots:
     void testMoveRfcMove();
 
     void testUpdateAllFlags();
+    void testUpdateAllFlagsLargeMailbox();
+    void testUpdateAllFlagsConcurrentChange();
+    void testFlagsByUidSet();
+    void testFlagsUidValidityChanged();
 };
 
 #endif
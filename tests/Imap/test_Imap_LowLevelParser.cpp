@@ -543,6 +543,52 @@ void ImapLowLevelParserTest::testGetRFC2822DateTime_data()
     
 }
 
+void ImapLowLevelParserTest::testGetSequenceSet()
+{
+    QFETCH(QByteArray, line);
+    QFETCH(QByteArray, muster);
+    QFETCH(Imap::Uids, items);
+
+    int pos = 0;
+    Imap::Sequence seq = Imap::LowLevelParser::getSequenceSet(line, pos);
+    QCOMPARE(seq.toByteArray(), muster);
+    QCOMPARE(seq.toVector(), items);
+    QCOMPARE(pos, line.size() - 2);
+    QCOMPARE(seq.count(), static_cast<uint>(items.size()));
+}
+
+void ImapLowLevelParserTest::testGetSequenceSet_data()
+{
+    QTest::addColumn<QByteArray>("line");
+    QTest::addColumn<QByteArray>("muster");
+    QTest::addColumn<Imap::Uids>("items");
+
+    QTest::newRow("one") << QByteArray("33\r\n") << QByteArray("33") << (Imap::Uids() << 33);
+    QTest::newRow("range") << QByteArray("3:5\r\n") << QByteArray("3:5") << (Imap::Uids() << 3 << 4 << 5);
+    QTest::newRow("unsorted") << QByteArray("10,3:5,1\r\n") << QByteArray("1,3:5,10") << (Imap::Uids() << 1 << 3 << 4 << 5 << 10);
+    QTest::newRow("adjacent") << QByteArray("1,2,3:5,6\r\n") << QByteArray("1:6") << (Imap::Uids() << 1 << 2 << 3 << 4 << 5 << 6);
+    QTest::newRow("overlapping") << QByteArray("1:5,3:8,20,2\r\n") << QByteArray("1:8,20")
+                                 << (Imap::Uids() << 1 << 2 << 3 << 4 << 5 << 6 << 7 << 8 << 20);
+}
+
+void ImapLowLevelParserTest::benchmarkGetSequence()
+{
+    QByteArray line = "1:900000,900002,900010:1000000\r\n";
+    QBENCHMARK {
+        int pos = 0;
+        Imap::LowLevelParser::getSequence(line, pos);
+    }
+}
+
+void ImapLowLevelParserTest::benchmarkGetSequenceSet()
+{
+    QByteArray line = "1:900000,900002,900010:1000000\r\n";
+    QBENCHMARK {
+        int pos = 0;
+        Imap::LowLevelParser::getSequenceSet(line, pos);
+    }
+}
+
 QTEST_GUILESS_MAIN( ImapLowLevelParserTest )
 
 namespace QTest {
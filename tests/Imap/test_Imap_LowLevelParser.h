@@ -46,6 +46,12 @@ private Q_SLOTS:
     /** @short Test Imap::LowLevelParser::getRFC2822DateTime() */
     void testGetRFC2822DateTime();
     void testGetRFC2822DateTime_data();
+    /** @short Test Imap::LowLevelParser::getSequenceSet() */
+    void testGetSequenceSet();
+    void testGetSequenceSet_data();
+    /** @short Compare the speed of parsing huge sequence sets into vectors and into ranges */
+    void benchmarkGetSequence();
+    void benchmarkGetSequenceSet();
 };
 
 #endif
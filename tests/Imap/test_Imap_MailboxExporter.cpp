@@ -0,0 +1,204 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@flaska.net>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QTemporaryDir>
+#include "test_Imap_MailboxExporter.h"
+#include "Imap/Model/ExportSink.h"
+#include "Imap/Model/ItemRoles.h"
+#include "Imap/Model/MailboxExporter.h"
+#include "Streams/FakeSocket.h"
+
+using namespace Imap::Mailbox;
+
+void ImapMailboxExporterTest::init()
+{
+    LibMailboxSync::init();
+    // Make the requests deterministic
+    model->setProperty("trojita-imap-delayed-fetch-part", 0);
+    model->setProperty("trojita-imap-preload-msg-metadata", 0);
+}
+
+QByteArray ImapMailboxExporterTest::messageHeader(const uint uid)
+{
+    return "Subject: message " + QByteArray::number(uid) + "\r\n\r\n";
+}
+
+QByteArray ImapMailboxExporterTest::messageText(const uint uid)
+{
+    return "body " + QByteArray::number(uid) + "\r\n";
+}
+
+/** @short Server's response with the complete source of a message */
+QByteArray ImapMailboxExporterTest::fetchParts(const uint uid)
+{
+    // The UIDs and sequence numbers are the same in these tests
+    return "* " + QByteArray::number(uid) + " FETCH (UID " + QByteArray::number(uid)
+            + " BODY[HEADER] " + asLiteral(messageHeader(uid)) + " BODY[TEXT] " + asLiteral(messageText(uid)) + ")\r\n";
+}
+
+/** @short Check that the message metadata and then the bodies are requested
+
+The parts are kept in a set by the KeepMailboxOpenTask, so their order is not defined.
+*/
+void ImapMailboxExporterTest::helperExpectFetch(const QByteArray &metadataUids, const QByteArray &partUids,
+                                                QByteArray &metadataTag, QByteArray &partsTag)
+{
+    const QByteArray metadata = t.mk("UID FETCH ") + metadataUids + " (" FETCH_METADATA_ITEMS ")\r\n";
+    metadataTag = t.last();
+    const QByteArray headerFirst = t.mk("UID FETCH ") + partUids + " (BODY.PEEK[HEADER] BODY.PEEK[TEXT])\r\n";
+    const QByteArray textFirst = t.last("UID FETCH ") + partUids + " (BODY.PEEK[TEXT] BODY.PEEK[HEADER])\r\n";
+    partsTag = t.last();
+
+    for (int i = 0; i < 20; ++i)
+        QCoreApplication::processEvents();
+    const QByteArray written = SOCK->writtenStuff();
+    if (written != metadata + headerFirst && written != metadata + textFirst) {
+        QCOMPARE(QString::fromUtf8(written), QString::fromUtf8(metadata + headerFirst));
+    }
+}
+
+/** @short The window of requested messages gets refilled as soon as the oldest message is written */
+void ImapMailboxExporterTest::testWindowRefill()
+{
+    initialMessages(3);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString stateFile = QDir(dir.path()).filePath(QStringLiteral(".trojita-export-state"));
+    MailboxExporter exporter(0, model, QStringList() << QStringLiteral("a"),
+                             std::unique_ptr<ExportSink>(new MboxExportSink(dir.path())), stateFile);
+    exporter.setWindowSize(2);
+    QSignalSpy finished(&exporter, SIGNAL(finished(quint64,quint64,qint64)));
+    QSignalSpy failed(&exporter, SIGNAL(failed(QString)));
+    exporter.start();
+
+    QByteArray metadataTag, partsTag;
+    helperExpectFetch("1:2", "1:2", metadataTag, partsTag);
+    cServer(helperCreateTrivialEnvelope(1, 1, QStringLiteral("s1")) + helperCreateTrivialEnvelope(2, 2, QStringLiteral("s2"))
+            + metadataTag + " OK fetched\r\n");
+
+    // The first message is complete, so it gets written and the third one is requested
+    cServer(fetchParts(1));
+    QByteArray metadataTag3, partsTag3;
+    helperExpectFetch("3", "3", metadataTag3, partsTag3);
+
+    cServer(fetchParts(2) + partsTag + " OK fetched\r\n");
+    cServer(helperCreateTrivialEnvelope(3, 3, QStringLiteral("s3")) + metadataTag3 + " OK fetched\r\n");
+    QVERIFY(finished.isEmpty());
+    cServer(fetchParts(3) + partsTag3 + " OK fetched\r\n");
+    cEmpty();
+
+    QCOMPARE(finished.size(), 1);
+    QCOMPARE(finished[0][0].value<quint64>(), 3ull);
+    QVERIFY(failed.isEmpty());
+
+    QFile mbox(QDir(dir.path()).filePath(QStringLiteral("a.mbox")));
+    QVERIFY(mbox.open(QIODevice::ReadOnly));
+    const QByteArray data = mbox.readAll();
+    QCOMPARE(data.count("From MAILER-DAEMON "), 3);
+    int previous = -1;
+    for (uint uid = 1; uid <= 3; ++uid) {
+        int offset = data.indexOf("\nbody " + QByteArray::number(uid) + "\n");
+        QVERIFY(offset > previous);
+        previous = offset;
+
+        // The data which were downloaded just for the export do not stay in the cache
+        QVERIFY(model->cache()->messagePart(QStringLiteral("a"), uid, "HEADER").isNull());
+        QVERIFY(model->cache()->messagePart(QStringLiteral("a"), uid, "TEXT").isNull());
+    }
+
+    ExportState state(stateFile);
+    QVERIFY(state.load());
+    QCOMPARE(state.lastUid(QStringLiteral("a"), uidValidityA), 3u);
+    QVERIFY(errorSpy->isEmpty());
+}
+
+/** @short An interrupted export continues after the last exported UID, unless the UIDVALIDITY has changed */
+void ImapMailboxExporterTest::testResume()
+{
+    QFETCH(uint, savedUidValidity);
+    QFETCH(QByteArray, metadataUids);
+    QFETCH(QByteArray, partUids);
+    QFETCH(uint, exported);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString stateFile = QDir(dir.path()).filePath(QStringLiteral(".trojita-export-state"));
+    {
+        ExportState state(stateFile);
+        state.setLastUid(QStringLiteral("a"), savedUidValidity, 2);
+        QVERIFY(state.save());
+    }
+
+    initialMessages(3);
+
+    // The first message is available from the cache already
+    model->cache()->setMsgPart(QStringLiteral("a"), 1, "HEADER", messageHeader(1));
+    model->cache()->setMsgPart(QStringLiteral("a"), 1, "TEXT", messageText(1));
+
+    MailboxExporter exporter(0, model, QStringList() << QStringLiteral("a"),
+                             std::unique_ptr<ExportSink>(new MaildirExportSink(dir.path())), stateFile);
+    QSignalSpy finished(&exporter, SIGNAL(finished(quint64,quint64,qint64)));
+    QSignalSpy failed(&exporter, SIGNAL(failed(QString)));
+    exporter.start();
+
+    QByteArray metadataTag, partsTag;
+    helperExpectFetch(metadataUids, partUids, metadataTag, partsTag);
+    QByteArray envelopes;
+    QByteArray parts;
+    for (uint uid = 4 - exported; uid <= 3; ++uid) {
+        envelopes += helperCreateTrivialEnvelope(uid, uid, QStringLiteral("s"));
+        if (uid > 1)
+            parts += fetchParts(uid);
+    }
+    cServer(envelopes + metadataTag + " OK fetched\r\n");
+    cServer(parts + partsTag + " OK fetched\r\n");
+    cEmpty();
+
+    QCOMPARE(finished.size(), 1);
+    QCOMPARE(finished[0][0].value<quint64>(), static_cast<quint64>(exported));
+    QVERIFY(failed.isEmpty());
+    QCOMPARE(QDir(QDir(dir.path()).filePath(QStringLiteral("a/cur"))).entryList(QDir::Files).size(), static_cast<int>(exported));
+
+    // Whatever was in the cache before remains there
+    QCOMPARE(model->cache()->messagePart(QStringLiteral("a"), 1, "TEXT"), messageText(1));
+    QVERIFY(model->cache()->messagePart(QStringLiteral("a"), 3, "TEXT").isNull());
+
+    ExportState state(stateFile);
+    QVERIFY(state.load());
+    QCOMPARE(state.lastUid(QStringLiteral("a"), uidValidityA), 3u);
+    QVERIFY(errorSpy->isEmpty());
+}
+
+void ImapMailboxExporterTest::testResume_data()
+{
+    QTest::addColumn<uint>("savedUidValidity");
+    QTest::addColumn<QByteArray>("metadataUids");
+    QTest::addColumn<QByteArray>("partUids");
+    QTest::addColumn<uint>("exported");
+
+    // initialMessages() uses UIDVALIDITY 333
+    QTest::newRow("resume") << 333u << QByteArray("3") << QByteArray("3") << 1u;
+    QTest::newRow("uidvalidity-changed") << 332u << QByteArray("1:3") << QByteArray("2:3") << 3u;
+}
+
+QTEST_GUILESS_MAIN(ImapMailboxExporterTest)
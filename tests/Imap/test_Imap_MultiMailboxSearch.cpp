@@ -0,0 +1,197 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@kde.org>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest>
+#include "test_Imap_MultiMailboxSearch.h"
+#include "Imap/Model/ItemRoles.h"
+#include "Imap/Model/MultiMailboxSearchModel.h"
+#include "Streams/FakeSocket.h"
+#include "Utils/FakeCapabilitiesInjector.h"
+
+using namespace Imap::Mailbox;
+
+/** @short Check that the results of a MULTISEARCH arrive incrementally and that only the shown ones are downloaded */
+void ImapModelMultiMailboxSearchTest::testMultiSearch()
+{
+    FakeCapabilitiesInjector(model).injectCapability(QStringLiteral("MULTISEARCH"));
+    MultiMailboxSearchModel searchModel(0, model);
+    QSignalSpy finishedSpy(&searchModel, SIGNAL(searchFinished()));
+
+    searchModel.search(QStringList() << QStringLiteral("a") << QStringLiteral("b"),
+                       QStringList() << QStringLiteral("SUBJECT") << QStringLiteral("x"));
+    QVERIFY(searchModel.isSearching());
+    cClient(t.mk("ESEARCH IN (SUBTREE (a b)) RETURN (ALL) CHARSET utf-8 SUBJECT x\r\n"));
+    cServer("* ESEARCH (TAG \"" + t.last() + "\" MAILBOX \"b\" UIDVALIDITY 666) UID ALL 3\r\n");
+    QCOMPARE(searchModel.rowCount(), 1);
+    QVERIFY(searchModel.isSearching());
+    cServer("* ESEARCH (TAG \"" + t.last() + "\" MAILBOX \"a\" UIDVALIDITY 333) UID ALL 1,3:4\r\n"
+            + t.last("OK searched\r\n"));
+    QCOMPARE(searchModel.rowCount(), 4);
+    QCOMPARE(finishedSpy.size(), 1);
+    QVERIFY(!searchModel.isSearching());
+    QCOMPARE(searchModel.index(1).data(RoleMailboxName).toString(), QStringLiteral("a"));
+    QCOMPARE(searchModel.index(3).data(RoleMessageUid).toUInt(), 4u);
+    QCOMPARE(searchModel.index(3).data(RoleMailboxUidValidity).toUInt(), 333u);
+    cEmpty();
+
+    // Showing a hit only downloads its metadata, and that happens over another connection
+    Streams::FakeSocket *mainSocket = SOCK;
+    QSignalSpy changedSpy(&searchModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+    QCOMPARE(searchModel.index(0).data(Qt::DisplayRole).toString(), QStringLiteral("Message 3 in b"));
+    QCOMPARE(searchModel.index(3).data(Qt::DisplayRole).toString(), QStringLiteral("Message 4 in a"));
+    TROJITA_CLIENT_LOOP
+    QVERIFY(SOCK != mainSocket);
+    cClient("y0 EXAMINE a\r\ny1 UID FETCH 4 (FLAGS ENVELOPE INTERNALDATE RFC822.SIZE)\r\n");
+    cServer("* 3 EXISTS\r\n* OK [UIDVALIDITY 333] .\r\n* FLAGS (\\Seen)\r\ny0 OK examined\r\n"
+            "* 3 FETCH (UID 4 FLAGS (\\Seen) RFC822.SIZE 89 ENVELOPE (NIL \"first\" NIL NIL NIL NIL NIL NIL NIL NIL))\r\n"
+            "y1 OK fetched\r\n");
+    cClient("y2 EXAMINE b\r\ny3 UID FETCH 3 (FLAGS ENVELOPE INTERNALDATE RFC822.SIZE)\r\n");
+    QCOMPARE(changedSpy.size(), 1);
+    QCOMPARE(searchModel.index(3).data(Qt::DisplayRole).toString(), QStringLiteral("first"));
+    QVERIFY(searchModel.index(3).data(RoleMessageIsMarkedRead).toBool());
+    // A message from a mailbox whose UIDVALIDITY has changed is not used
+    cServer("* OK [UIDVALIDITY 667] .\r\ny2 OK examined\r\n"
+            "* 1 FETCH (UID 3 FLAGS () ENVELOPE (NIL \"blah\" NIL NIL NIL NIL NIL NIL NIL NIL))\r\n"
+            "y3 OK fetched\r\n");
+    QCOMPARE(changedSpy.size(), 1);
+    QCOMPARE(searchModel.index(0).data(Qt::DisplayRole).toString(), QStringLiteral("Message 3 in b"));
+    cEmpty();
+    QCOMPARE(QString::fromUtf8(mainSocket->writtenStuff()), QString());
+
+    // Opening a hit synchronizes its mailbox on the main connection
+    changedSpy.clear();
+    QVERIFY(!searchModel.messageIndex(2).isValid());
+    TROJITA_CLIENT_LOOP
+    QCOMPARE(QString::fromUtf8(mainSocket->writtenStuff()), QString::fromUtf8(t.mk("SELECT a\r\n")));
+    mainSocket->fakeReading("* 1 EXISTS\r\n* OK [UIDVALIDITY 333] .\r\n* OK [UIDNEXT 4] .\r\n" + t.last("OK selected\r\n"));
+    TROJITA_CLIENT_LOOP
+    QCOMPARE(QString::fromUtf8(mainSocket->writtenStuff()), QString::fromUtf8(t.mk("UID SEARCH ALL\r\n")));
+    mainSocket->fakeReading("* SEARCH 3\r\n" + t.last("OK search\r\n"));
+    TROJITA_CLIENT_LOOP
+    QCOMPARE(QString::fromUtf8(mainSocket->writtenStuff()), QString::fromUtf8(t.mk("FETCH 1 (FLAGS)\r\n")));
+    mainSocket->fakeReading("* 1 FETCH (FLAGS ())\r\n" + t.last("OK fetched\r\n"));
+    TROJITA_CLIENT_LOOP
+    QVERIFY(!changedSpy.isEmpty());
+    QVERIFY(searchModel.messageIndex(2).isValid());
+    QCOMPARE(searchModel.messageIndex(2).data(RoleMessageUid).toUInt(), 3u);
+    // Neither connection was asked for anything else
+    QCOMPARE(QString::fromUtf8(mainSocket->writtenStuff()), QString());
+    cEmpty();
+}
+
+/** @short Check that a failed MULTISEARCH is reported */
+void ImapModelMultiMailboxSearchTest::testMultiSearchFailed()
+{
+    FakeCapabilitiesInjector(model).injectCapability(QStringLiteral("MULTISEARCH"));
+    MultiMailboxSearchModel searchModel(0, model);
+    QSignalSpy failedSpy(&searchModel, SIGNAL(searchFailed(QString)));
+
+    searchModel.search(QStringList() << QStringLiteral("a"), QStringList() << QStringLiteral("ALL"));
+    cClient(t.mk("ESEARCH IN (SUBTREE (a)) RETURN (ALL) CHARSET utf-8 ALL\r\n"));
+    cServer(t.last("NO [LIMIT] too many mailboxes\r\n"));
+    QCOMPARE(failedSpy.size(), 1);
+    QVERIFY(!searchModel.isSearching());
+    QCOMPARE(searchModel.rowCount(), 0);
+    cEmpty();
+}
+
+/** @short Without MULTISEARCH, the known mailboxes are examined and searched over a few connections of their own */
+void ImapModelMultiMailboxSearchTest::testFallbackSearch()
+{
+    MultiMailboxSearchModel searchModel(0, model);
+    QSignalSpy finishedSpy(&searchModel, SIGNAL(searchFinished()));
+    Streams::FakeSocket *mainSocket = SOCK;
+    const QList<Streams::FakeSocket *> oldSockets = model->findChildren<Streams::FakeSocket *>();
+
+    searchModel.search(QStringList() << QStringLiteral("a") << QStringLiteral("b") << QStringLiteral("c") << QStringLiteral("d"),
+                       QStringList() << QStringLiteral("SUBJECT") << QStringLiteral("x"));
+    QVERIFY(searchModel.isSearching());
+    TROJITA_CLIENT_LOOP
+    QList<Streams::FakeSocket *> sockets;
+    Q_FOREACH(Streams::FakeSocket *socket, model->findChildren<Streams::FakeSocket *>()) {
+        if (!oldSockets.contains(socket))
+            sockets << socket;
+    }
+    // The number of parallel searches is limited
+    QCOMPARE(sockets.size(), 3);
+    QCOMPARE(QString::fromUtf8(sockets[0]->writtenStuff()), QStringLiteral("y0 EXAMINE a\r\ny1 UID SEARCH CHARSET utf-8 SUBJECT x\r\n"));
+    QCOMPARE(QString::fromUtf8(sockets[1]->writtenStuff()), QStringLiteral("y0 EXAMINE b\r\ny1 UID SEARCH CHARSET utf-8 SUBJECT x\r\n"));
+    QCOMPARE(QString::fromUtf8(sockets[2]->writtenStuff()), QStringLiteral("y0 EXAMINE c\r\ny1 UID SEARCH CHARSET utf-8 SUBJECT x\r\n"));
+
+    // Whichever connection is done first takes the next mailbox
+    sockets[1]->fakeReading("* 2 EXISTS\r\n* OK [UIDVALIDITY 222] .\r\n* FLAGS (\\Seen)\r\ny0 OK examined\r\n"
+                            "* SEARCH 2\r\ny1 OK searched\r\n");
+    TROJITA_CLIENT_LOOP
+    QCOMPARE(searchModel.rowCount(), 1);
+    QCOMPARE(QString::fromUtf8(sockets[1]->writtenStuff()), QStringLiteral("y2 EXAMINE d\r\ny3 UID SEARCH CHARSET utf-8 SUBJECT x\r\n"));
+
+    // A mailbox which cannot be examined does not prevent searching the other ones
+    sockets[2]->fakeReading("y0 NO no such mailbox\r\ny1 NO no mailbox selected\r\n");
+    TROJITA_CLIENT_LOOP
+    QCOMPARE(QString::fromUtf8(sockets[2]->writtenStuff()), QStringLiteral("y2 LOGOUT\r\n"));
+    QCOMPARE(searchModel.rowCount(), 1);
+
+    sockets[0]->fakeReading("* OK [UIDVALIDITY 333] .\r\ny0 OK examined\r\n* SEARCH 10 9\r\n* SEARCH 9\r\ny1 OK searched\r\n");
+    TROJITA_CLIENT_LOOP
+    QCOMPARE(QString::fromUtf8(sockets[0]->writtenStuff()), QStringLiteral("y2 LOGOUT\r\n"));
+    QCOMPARE(searchModel.rowCount(), 3);
+    QCOMPARE(finishedSpy.size(), 0);
+    QVERIFY(searchModel.isSearching());
+
+    sockets[1]->fakeReading("* OK [UIDVALIDITY 444] .\r\ny2 OK examined\r\n* SEARCH\r\ny3 OK searched\r\n");
+    TROJITA_CLIENT_LOOP
+    QCOMPARE(QString::fromUtf8(sockets[1]->writtenStuff()), QStringLiteral("y4 LOGOUT\r\n"));
+    QCOMPARE(finishedSpy.size(), 1);
+    QVERIFY(!searchModel.isSearching());
+
+    QCOMPARE(searchModel.rowCount(), 3);
+    QCOMPARE(searchModel.index(0).data(RoleMailboxName).toString(), QStringLiteral("b"));
+    QCOMPARE(searchModel.index(0).data(RoleMessageUid).toUInt(), 2u);
+    QCOMPARE(searchModel.index(0).data(RoleMailboxUidValidity).toUInt(), 222u);
+    QCOMPARE(searchModel.index(1).data(RoleMailboxName).toString(), QStringLiteral("a"));
+    QCOMPARE(searchModel.index(1).data(RoleMessageUid).toUInt(), 9u);
+    QCOMPARE(searchModel.index(2).data(RoleMessageUid).toUInt(), 10u);
+    QCOMPARE(searchModel.index(2).data(RoleMailboxUidValidity).toUInt(), 333u);
+
+    // The mailbox which is open on the main connection is left alone
+    QCOMPARE(QString::fromUtf8(mainSocket->writtenStuff()), QString());
+}
+
+/** @short When the connections for searching the mailboxes cannot be used, the search fails */
+void ImapModelMultiMailboxSearchTest::testFallbackSearchOffline()
+{
+    LibMailboxSync::setModelNetworkPolicy(model, NETWORK_OFFLINE);
+    TROJITA_CLIENT_LOOP
+    MultiMailboxSearchModel searchModel(0, model);
+    QSignalSpy finishedSpy(&searchModel, SIGNAL(searchFinished()));
+    QSignalSpy failedSpy(&searchModel, SIGNAL(searchFailed(QString)));
+
+    searchModel.search(QStringList() << QStringLiteral("a") << QStringLiteral("b") << QStringLiteral("c") << QStringLiteral("d"),
+                       QStringList() << QStringLiteral("ALL"));
+    TROJITA_CLIENT_LOOP
+    QCOMPARE(failedSpy.size(), 1);
+    QCOMPARE(finishedSpy.size(), 0);
+    QVERIFY(!searchModel.isSearching());
+    QCOMPARE(searchModel.rowCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(ImapModelMultiMailboxSearchTest)
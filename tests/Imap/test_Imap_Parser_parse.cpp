@@ -21,6 +21,7 @@
 */
 
 #include <QBuffer>
+#include <QDebug>
 #include <QFile>
 #include <QTest>
 #include "Imap/Parser/Message.h"
@@ -376,6 +377,17 @@ void ImapParserParseTest::testParseUntagged_data()
         << QByteArray("* ESEArCH    (TaG   x)   Uid  foo 333 BLaH 10\r\n")
         << QSharedPointer<AbstractResponse>(new ESearch("x", ESearch::UIDS, esearchData));
 
+    esearchData.clear();
+    esearchData.push_back(qMakePair<>(QByteArray("ALL"), Imap::Uids() << 3 << 4 << 5 << 9));
+    QTest::newRow("esearch-multisearch")
+        << QByteArray("* ESEARCH (TAG \"y\" MAILBOX \"a.&AMk-t&AOk-\" UIDVALIDITY 666) UID ALL 3:5,9\r\n")
+        << QSharedPointer<AbstractResponse>(new ESearch("y", QStringLiteral("a.\u00c9t\u00e9"), 666, ESearch::UIDS, esearchData));
+
+    esearchData.clear();
+    QTest::newRow("esearch-multisearch-empty")
+        << QByteArray("* ESEARCH (TAG \"y\" MAILBOX INBOX UIDVALIDITY 1) UID\r\n")
+        << QSharedPointer<AbstractResponse>(new ESearch("y", QStringLiteral("INBOX"), 1, ESearch::UIDS, esearchData));
+
     esearchData.clear();
     esearchData.push_back(qMakePair<>(QByteArray("BLAH"), Imap::Uids() << 10 << 11 << 13 << 14 << 15 << 16 << 17));
     QTest::newRow("esearch-one-list-1")
@@ -894,6 +906,23 @@ void ImapParserParseTest::testParseUntagged_data()
             << QByteArray("* 81 FETCH (UID 81 BODY[HEADER.FIELDS (MESSAgE-Id)]{10}\r\n01234567\r\n)\r\n")
             << QSharedPointer<AbstractResponse>(new Fetch(81, fetchData));
 
+    fetchData.clear();
+    fetchData["UID"] = QSharedPointer<AbstractData>(new RespData<uint>(81));
+    fetchData["BODY[1.2]<1024>"] = QSharedPointer<AbstractData>(new RespData<QByteArray>("0123"));
+    QTest::newRow("fetch-partial")
+            << QByteArray("* 81 FETCH (UID 81 BODY[1.2]<1024> {4}\r\n0123)\r\n")
+            << QSharedPointer<AbstractResponse>(new Fetch(81, fetchData));
+
+    fetchData.clear();
+    fetchData["UID"] = QSharedPointer<AbstractData>(new RespData<uint>(81));
+    fetchData["FLAGS"] = QSharedPointer<AbstractData>(new RespData<QStringList>(QStringList() << QStringLiteral("\\Seen")));
+    QTest::newRow("uidfetch")
+            << QByteArray("* 81 UIDFETCH (FLAGS (\\Seen))\r\n")
+            << QSharedPointer<AbstractResponse>(new Fetch(0, fetchData));
+    QTest::newRow("uidfetch-with-uid")
+            << QByteArray("* 81 UIDFETCH (UID 81 FLAGS (\\Seen))\r\n")
+            << QSharedPointer<AbstractResponse>(new Fetch(0, fetchData));
+
     QTest::newRow("id-nil")
             << QByteArray("* ID nIl\r\n")
             << QSharedPointer<AbstractResponse>(new Id(QMap<QByteArray,QByteArray>()));
@@ -933,15 +962,19 @@ void ImapParserParseTest::testParseUntagged_data()
 
     QTest::newRow("vanished-one")
             << QByteArray("* VANIShED 1\r\n")
-            << QSharedPointer<AbstractResponse>(new Vanished(Vanished::NOT_EARLIER, Imap::Uids() << 1));
+            << QSharedPointer<AbstractResponse>(new Vanished(Vanished::NOT_EARLIER, Imap::Sequence(1)));
 
     QTest::newRow("vanished-earlier-one")
             << QByteArray("* VANIShED (EARlIER) 1\r\n")
-            << QSharedPointer<AbstractResponse>(new Vanished(Vanished::EARLIER, Imap::Uids() << 1));
+            << QSharedPointer<AbstractResponse>(new Vanished(Vanished::EARLIER, Imap::Sequence(1)));
 
     QTest::newRow("vanished-earlier-set")
             << QByteArray("* VANISHED (EARLIER) 300:303,405,411\r\n")
-            << QSharedPointer<AbstractResponse>(new Vanished(Vanished::EARLIER, Imap::Uids() << 300 << 301 << 302 << 303 << 405 << 411));
+            << QSharedPointer<AbstractResponse>(new Vanished(Vanished::EARLIER, Imap::Sequence(300).addRange(301, 303).add(405).add(411)));
+
+    QTest::newRow("vanished-unordered-duplicates")
+            << QByteArray("* VANISHED 411,300:303,302,405\r\n")
+            << QSharedPointer<AbstractResponse>(new Vanished(Vanished::NOT_EARLIER, Imap::Sequence(300).addRange(301, 303).add(405).add(411)));
 
     QTest::newRow("genurlauth-1")
             << QByteArray("* GENURLAUTH \"imap://joe@example.com/INBOX/;uid=20/;section=1.2;urlauth=submit+fred:internal:91354a473744909de610943775f92038\"\r\n")
@@ -1114,6 +1147,116 @@ void ImapParserParseTest::benchmarkInitialChat()
     }
 }
 
+void ImapParserParseTest::benchmarkSequenceFromVector()
+{
+    // Every tenth message is missing, which is a bit worse than what a typical selection looks like
+    Imap::Uids uids;
+    for (uint i = 1; i < 200000; ++i) {
+        if (i % 10)
+            uids << i;
+    }
+
+    QBENCHMARK {
+        Imap::Sequence::fromVector(uids).toByteArray();
+    }
+}
+
+void ImapParserParseTest::benchmarkResponseBudget()
+{
+    // A large mailbox sync, with the responses being consumed in batches of 100 per event loop pass like the Model does
+    const int total = 20000;
+    QByteArray data = "* PREAUTH hi\r\n";
+    int longestLine = data.size();
+    for (int i = 1; i < total; ++i) {
+        QByteArray line = "* " + QByteArray::number(i) + " FETCH (UID " + QByteArray::number(i)
+                + " FLAGS (\\Seen) RFC822.SIZE 12345)\r\n";
+        longestLine = qMax(longestLine, line.size());
+        data += line;
+    }
+
+    // Returns the number of responses received, and the peak size of the queue
+    auto drain = [&data, total](const bool limited, int &peakResponses, qint64 &peakBytes) {
+        Streams::FakeSocket *sock = new Streams::FakeSocket(Imap::CONN_STATE_CONNECTED_PRETLS_PRECAPS);
+        std::unique_ptr<Imap::Parser> p(new Imap::Parser(0, sock, 668));
+        if (!limited)
+            p->setResponseBudget(0, 0);
+        sock->fakeReading(data);
+        int received = 0;
+        for (int pass = 0; received < total && pass < total; ++pass) {
+            QCoreApplication::processEvents();
+            peakResponses = qMax(peakResponses, p->respQueue.size());
+            peakBytes = qMax(peakBytes, p->m_queuedBytes);
+            for (int i = 0; i < 100 && p->hasResponse(); ++i, ++received)
+                p->getResponse();
+        }
+        return received;
+    };
+
+    int unlimitedPeakResponses = 0;
+    qint64 unlimitedPeakBytes = 0;
+    QCOMPARE(drain(false, unlimitedPeakResponses, unlimitedPeakBytes), total);
+
+    int peakResponses = 0;
+    qint64 peakBytes = 0;
+    QBENCHMARK {
+        QCOMPARE(drain(true, peakResponses, peakBytes), total);
+    }
+
+    // The default budget of 1000 responses is the one which applies here, the data are way below the byte limit
+    QVERIFY(peakResponses > 0);
+    QVERIFY(peakResponses <= 1000);
+    QVERIFY(peakBytes <= qint64(peakResponses) * longestLine);
+    // Without the budget, the whole burst ends up in the queue at once
+    QCOMPARE(unlimitedPeakResponses, total);
+    QVERIFY(peakBytes * 10 < unlimitedPeakBytes);
+}
+
+void ImapParserParseTest::testResponseBudget()
+{
+    Streams::FakeSocket *sock = new Streams::FakeSocket(Imap::CONN_STATE_CONNECTED_PRETLS_PRECAPS);
+    std::unique_ptr<Imap::Parser> p(new Imap::Parser(0, sock, 667));
+    p->setResponseBudget(5, 100);
+
+    QByteArray data = "* PREAUTH hi\r\n";
+    for (int i = 1; i <= 50; ++i) {
+        data += "* " + QByteArray::number(i) + " FETCH (UID " + QByteArray::number(i) + " BODY[] {10}\r\n0123456789)\r\n";
+    }
+    sock->fakeReading(data);
+    QCoreApplication::processEvents();
+    QVERIFY(p->m_readingPaused);
+    QVERIFY(p->hasResponse());
+
+    int received = 0;
+    int idlePasses = 0;
+    while (received < 51 && idlePasses < 10) {
+        QVERIFY(p->respQueue.size() <= 5);
+        // The budget is checked before each response is read, so the last one can overshoot it
+        QVERIFY(p->m_queuedBytes < 100 + 50);
+        if (p->hasResponse()) {
+            QVERIFY(p->getResponse());
+            ++received;
+            idlePasses = 0;
+        } else {
+            QCoreApplication::processEvents();
+            ++idlePasses;
+        }
+    }
+    QCOMPARE(received, 51);
+    QVERIFY(!p->m_readingPaused);
+    QCOMPARE(p->m_queuedBytes, qint64(0));
+
+    // Without any limit, everything is read at once
+    p->setResponseBudget(0, 0);
+    data.clear();
+    for (int i = 51; i <= 100; ++i) {
+        data += "* " + QByteArray::number(i) + " EXISTS\r\n";
+    }
+    sock->fakeReading(data);
+    QCoreApplication::processEvents();
+    QCOMPARE(p->respQueue.size(), 50);
+    QVERIFY(!p->m_readingPaused);
+}
+
 void ImapParserParseTest::testSequences()
 {
     QFETCH( Imap::Sequence, sequence );
@@ -1167,6 +1310,20 @@ void ImapParserParseTest::testSequences_data()
     QTest::newRow("sequence-from-list-1") <<
             Imap::Sequence::fromVector(Imap::Uids() << 2 << 3 << 4 << 6 << 7 << 1 << 100 << 101 << 102 << 99 << 666 << 333 << 666) <<
             QByteArray("1:4,6:7,99:102,333,666");
+
+    QTest::newRow("sequence-add-range-merging") <<
+            Imap::Sequence(1).add(20).addRange(5, 10).addRange(11, 19).add(3) << QByteArray("1,3,5:20");
+
+    QTest::newRow("sequence-united") <<
+            Imap::Sequence(1).addRange(5, 10).add(30).united(Imap::Sequence(2).addRange(8, 20).add(40)) <<
+            QByteArray("1:2,5:20,30,40");
+
+    QTest::newRow("sequence-united-range") <<
+            Imap::Sequence(1, 10).united(Imap::Sequence(11)) << QByteArray("1:11");
+
+    QTest::newRow("sequence-intersected") <<
+            Imap::Sequence(1).addRange(5, 10).add(30).intersected(Imap::Sequence(2).addRange(8, 30)) <<
+            QByteArray("8:10,30");
 }
 
 /** @short Test responses which fail to parse */
@@ -52,12 +52,16 @@ private Q_SLOTS:
     /** @short Test for parsing errors */
     void testThrow();
     void testThrow_data();
+    /** @short Test that reading stops while the queue of parsed responses is full */
+    void testResponseBudget();
 
     void initTestCase();
     void cleanupTestCase();
 
     void benchmark();
     void benchmarkInitialChat();
+    void benchmarkSequenceFromVector();
+    void benchmarkResponseBudget();
 };
 
 #endif
@@ -26,8 +26,10 @@
 #include "Imap/Model/DummyNetworkWatcher.h"
 #include "Imap/Model/ItemRoles.h"
 #include "Imap/Model/MemoryCache.h"
+#include "Imap/Model/ThreadingMsgListModel.h"
 #include "Imap/Parser/Uids.h"
 #include "Streams/FakeSocket.h"
+#include "Utils/FakeCapabilitiesInjector.h"
 #include "Imap/data.h"
 
 /** @short Test that we survive a new message arrival and its subsequent removal in rapid sequence
@@ -1135,4 +1137,257 @@ void ImapModelSelectedMailboxUpdatesTest::testFetchMsgDuplicateBodystructure()
 
 }
 
+/** @short Flag changes of adjacent messages are reported as ranges, once per batch of responses */
+void ImapModelSelectedMailboxUpdatesTest::testBulkFlagsCoalesced()
+{
+    const int count = 300;
+    initialMessages(count);
+    justKeepTask();
+    cEmpty();
+
+    QSignalSpy changedSpy(model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+    QSignalSpy numbersWatcher(model, SIGNAL(messageCountPossiblyChanged(QModelIndex)));
+    QSignalSpy threadingChangedSpy(threadingModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+    QByteArray buf;
+    for (int i = 1; i <= count; ++i) {
+        buf += "* " + QByteArray::number(i) + " FETCH (FLAGS (\\Seen \\Flagged))\r\n";
+    }
+    cServer(buf);
+    for (int i = 0; i < 10; ++i)
+        QCoreApplication::processEvents();
+
+    // The Model processes at most a hundred responses before returning to the event loop
+    const int maxBatches = (count + 99) / 100;
+    int messageSignals = 0;
+    int reportedRows = 0;
+    for (const auto &signal : changedSpy) {
+        QModelIndex topLeft = signal[0].toModelIndex();
+        QModelIndex bottomRight = signal[1].toModelIndex();
+        if (topLeft.parent() == msgListA) {
+            QCOMPARE(bottomRight.parent(), QModelIndex(msgListA));
+            QVERIFY(topLeft.row() <= bottomRight.row());
+            ++messageSignals;
+            reportedRows += bottomRight.row() - topLeft.row() + 1;
+        }
+    }
+    QVERIFY(messageSignals >= 1);
+    QVERIFY(messageSignals <= maxBatches);
+    QCOMPARE(reportedRows, count);
+    QVERIFY(numbersWatcher.size() >= 1);
+    QVERIFY(numbersWatcher.size() <= maxBatches);
+    // two more signals for the list and the mailbox per each batch
+    QVERIFY(changedSpy.size() <= 3 * maxBatches);
+
+    // The flat view passes the ranges on instead of splitting them into single messages
+    QVERIFY(threadingChangedSpy.size() >= 1);
+    QVERIFY(threadingChangedSpy.size() <= maxBatches);
+    reportedRows = 0;
+    for (const auto &signal : threadingChangedSpy) {
+        QModelIndex topLeft = signal[0].toModelIndex();
+        QModelIndex bottomRight = signal[1].toModelIndex();
+        QVERIFY(!topLeft.parent().isValid());
+        QVERIFY(!bottomRight.parent().isValid());
+        reportedRows += bottomRight.row() - topLeft.row() + 1;
+    }
+    QCOMPARE(reportedRows, count);
+
+    for (int i = 0; i < count; ++i) {
+        QVERIFY(msgListA.child(i, 0).data(Imap::Mailbox::RoleMessageIsMarkedFlagged).toBool());
+    }
+    QCOMPARE(idxA.data(Imap::Mailbox::RoleUnreadMessageCount).toInt(), 0);
+
+    justKeepTask();
+    cEmpty();
+}
+
+/** @short Measure the processing of unsolicited flag updates of many messages */
+void ImapModelSelectedMailboxUpdatesTest::testBulkFlagsBenchmark()
+{
+    const int count = 10000;
+    initialMessages(count);
+    justKeepTask();
+    cEmpty();
+
+    QByteArray seen, unseen;
+    for (int i = 1; i <= count; ++i) {
+        seen += "* " + QByteArray::number(i) + " FETCH (FLAGS (\\Seen))\r\n";
+        unseen += "* " + QByteArray::number(i) + " FETCH (FLAGS ())\r\n";
+    }
+
+    QSignalSpy changedSpy(model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+    bool markRead = true;
+    int iterations = 0;
+    QBENCHMARK {
+        SOCK->fakeReading(markRead ? seen : unseen);
+        while (idxA.data(Imap::Mailbox::RoleUnreadMessageCount).toInt() != (markRead ? 0 : count))
+            QCoreApplication::processEvents();
+        markRead = !markRead;
+        ++iterations;
+    }
+
+    // One range for the messages, the list and the mailbox per each batch of at most a hundred responses
+    QVERIFY(iterations > 0);
+    QVERIFY(changedSpy.size() <= iterations * 3 * ((count + 99) / 100));
+}
+
+/** @short Check that jumping between unread messages uses the up-to-date flags and wraps around */
+void ImapModelSelectedMailboxUpdatesTest::testUnreadNavigation()
+{
+    initialMessages(10);
+    justKeepTask();
+    cEmpty();
+
+    QByteArray buf;
+    for (int i = 1; i <= 10; ++i) {
+        if (i != 3 && i != 7)
+            buf += "* " + QByteArray::number(i) + " FETCH (FLAGS (\\Seen))\r\n";
+    }
+    cServer(buf);
+    QCOMPARE(idxA.data(Imap::Mailbox::RoleUnreadMessageCount).toInt(), 2);
+
+    QCOMPARE(model->findUnreadMessage(idxA, 3, true), msgListA.child(6, 0));
+    QCOMPARE(model->findUnreadMessage(idxA, 7, true), msgListA.child(2, 0));
+    QCOMPARE(model->findUnreadMessage(idxA, 3, false), msgListA.child(6, 0));
+    QCOMPARE(model->findUnreadMessage(idxA, 5, false), msgListA.child(2, 0));
+    QCOMPARE(model->findUnreadMessage(idxA, 10, true), msgListA.child(2, 0));
+
+    // The flat view follows the order of UIDs
+    QModelIndex third = threadingModel->index(2, 0);
+    QCOMPARE(third.data(Imap::Mailbox::RoleMessageUid).toUInt(), 3u);
+    QCOMPARE(threadingModel->findUnreadMessage(third, true).data(Imap::Mailbox::RoleMessageUid).toUInt(), 7u);
+    QCOMPARE(threadingModel->findUnreadMessage(third, false).data(Imap::Mailbox::RoleMessageUid).toUInt(), 7u);
+
+    // A message which got read is no longer visited
+    cServer("* 7 FETCH (FLAGS (\\Seen))\r\n");
+    QCOMPARE(model->findUnreadMessage(idxA, 3, true), QModelIndex());
+    QCOMPARE(model->findUnreadMessage(idxA, 1, true), msgListA.child(2, 0));
+
+    // Neither is a message which got expunged
+    cServer("* 3 EXPUNGE\r\n");
+    QCOMPARE(model->findUnreadMessage(idxA, 1, true), QModelIndex());
+    QVERIFY(model->unreadMessages(idxA).isEmpty());
+
+    // ...but a message which became unread is
+    cServer("* 4 FETCH (FLAGS ())\r\n");
+    QCOMPARE(msgListA.child(3, 0).data(Imap::Mailbox::RoleMessageUid).toUInt(), 5u);
+    QCOMPARE(model->findUnreadMessage(idxA, 1, false), msgListA.child(3, 0));
+    QCOMPARE(model->unreadMessages(idxA), QModelIndexList() << msgListA.child(3, 0));
+
+    justKeepTask();
+    cEmpty();
+}
+
+/** @short Check that the RFC 9586 UIDFETCH responses are matched to messages by their UIDs */
+void ImapModelSelectedMailboxUpdatesTest::testUidOnlyUpdates()
+{
+    initialMessages(10);
+    FakeCapabilitiesInjector(model).injectUidOnly();
+
+    cServer("* 5 UIDFETCH (FLAGS (\\Seen))\r\n");
+    QVERIFY(msgListA.child(4, 0).data(Imap::Mailbox::RoleMessageIsMarkedRead).toBool());
+
+    cServer("* VANISHED 3\r\n");
+    uidMapA.remove(uidMapA.indexOf(3));
+    --existsA;
+    helperCheckUidMapFromModel();
+    helperCheckCache();
+
+    // The message with UID 5 has moved one row up, which doesn't matter because there are no sequence numbers anymore
+    cServer("* 5 UIDFETCH (FLAGS ())\r\n");
+    QCOMPARE(msgListA.child(3, 0).data(Imap::Mailbox::RoleMessageUid).toUInt(), 5u);
+    QVERIFY(!msgListA.child(3, 0).data(Imap::Mailbox::RoleMessageIsMarkedRead).toBool());
+
+    // New arrivals get their UIDs in order
+    cServer("* 11 EXISTS\r\n");
+    cClient(t.mk("UID FETCH 11:* (FLAGS)\r\n"));
+    cServer("* 11 UIDFETCH (FLAGS (x))\r\n* 13 UIDFETCH (FLAGS ())\r\n" + t.last("OK fetched\r\n"));
+    uidMapA << 11 << 13;
+    existsA += 2;
+    uidNextA = 14;
+    helperCheckUidMapFromModel();
+    helperCheckCache();
+    QCOMPARE(msgListA.child(9, 0).data(Imap::Mailbox::RoleMessageFlags).toStringList(), QStringList() << QStringLiteral("x"));
+
+    // Marking everything as read cannot use the sequence numbers
+    model->markMailboxAsRead(idxA);
+    cClient(t.mk("UID STORE 1:* +FLAGS.SILENT \\Seen\r\n"));
+    cServer(t.last("OK stored\r\n"));
+
+    justKeepTask();
+    cEmpty();
+}
+
+void ImapModelSelectedMailboxUpdatesTest::testExpungeBenchmark_data()
+{
+    QTest::addColumn<bool>("uidOnly");
+    QTest::newRow("expunge") << false;
+    QTest::newRow("uidonly-vanished") << true;
+}
+
+/** @short Measure how quickly half of a big mailbox gets removed through the EXPUNGE and the VANISHED responses */
+void ImapModelSelectedMailboxUpdatesTest::testExpungeBenchmark()
+{
+    QFETCH(bool, uidOnly);
+    const uint count = 10000;
+    initialMessages(count);
+    justKeepTask();
+    cEmpty();
+
+    // Remove all messages with an odd UID
+    QByteArray buf;
+    if (uidOnly) {
+        FakeCapabilitiesInjector(model).injectUidOnly();
+        buf = "* VANISHED ";
+        for (uint uid = 1; uid <= count; uid += 2) {
+            buf += QByteArray::number(uid) + ',';
+        }
+        buf.chop(1);
+        buf += "\r\n";
+    } else {
+        // Each EXPUNGE shifts the sequence numbers of all the following messages
+        for (uint seq = 1; seq <= count / 2; ++seq) {
+            buf += "* " + QByteArray::number(seq) + " EXPUNGE\r\n";
+        }
+    }
+
+    QBENCHMARK_ONCE {
+        SOCK->fakeReading(buf);
+        while (model->rowCount(msgListA) != static_cast<int>(count / 2))
+            QCoreApplication::processEvents();
+    }
+
+    uidMapA.erase(std::remove_if(uidMapA.begin(), uidMapA.end(), isOdd), uidMapA.end());
+    existsA = uidMapA.size();
+    helperCheckUidMapFromModel();
+    justKeepTask();
+    cEmpty();
+}
+
+void ImapModelSelectedMailboxUpdatesTest::testExitBenchmark_data()
+{
+    QTest::addColumn<bool>("prepareForExit");
+    QTest::newRow("destroy-tree") << false;
+    QTest::newRow("prepare-for-exit") << true;
+}
+
+/** @short Measure how long does it take to get rid of a model with a big mailbox */
+void ImapModelSelectedMailboxUpdatesTest::testExitBenchmark()
+{
+    QFETCH(bool, prepareForExit);
+    const uint count = 50000;
+    initialMessages(count);
+    justKeepTask();
+    cEmpty();
+
+    if (prepareForExit) {
+        model->prepareForExit();
+        cClient(t.mk("LOGOUT\r\n"));
+    }
+
+    QBENCHMARK_ONCE {
+        delete model;
+        model = 0;
+    }
+}
+
 QTEST_GUILESS_MAIN( ImapModelSelectedMailboxUpdatesTest )
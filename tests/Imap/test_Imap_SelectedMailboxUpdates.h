@@ -52,6 +52,14 @@ private slots:
     void testLogoutClosed();
     void testFetchMsgMetadataPerPartes();
     void testFetchMsgDuplicateBodystructure();
+    void testBulkFlagsCoalesced();
+    void testBulkFlagsBenchmark();
+    void testUnreadNavigation();
+    void testUidOnlyUpdates();
+    void testExpungeBenchmark_data();
+    void testExpungeBenchmark();
+    void testExitBenchmark_data();
+    void testExitBenchmark();
 
     void helperDataChangedUidNonZero(const QModelIndex &a, const QModelIndex &b);
 private:
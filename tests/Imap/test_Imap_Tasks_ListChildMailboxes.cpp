@@ -83,6 +83,132 @@ void ImapModelListChildMailboxesTest::testSimpleListing()
     cEmpty();
 }
 
+/** @short Delayed requests for message counts are only sent for mailboxes which are still wanted */
+void ImapModelListChildMailboxesTest::testDelayedMessageCounts()
+{
+    using namespace Imap::Mailbox;
+
+    SyncState s;
+    s.setExists(10);
+    s.setRecent(1);
+    s.setUnSeenCount(2);
+    model->cache()->setMailboxSyncState(QStringLiteral("b"), s);
+
+    QCOMPARE(model->rowCount(QModelIndex()), 1);
+    cClient(t.mk("LIST \"\" \"%\"\r\n"));
+    cServer("* LIST (\\HasNoChildren) \".\" a\r\n"
+            "* LIST (\\HasNoChildren) \".\" b\r\n"
+            "* LIST (\\HasNoChildren) \".\" c\r\n"
+            + t.last("OK listed\r\n"));
+    QModelIndex idxA = model->index(1, 0, QModelIndex());
+    QModelIndex idxB = model->index(2, 0, QModelIndex());
+    QModelIndex idxC = model->index(3, 0, QModelIndex());
+    QCOMPARE(idxC.data(RoleMailboxName).toString(), QStringLiteral("c"));
+
+    QStringList wanted;
+    wanted << QStringLiteral("b") << QStringLiteral("c");
+    model->setMessageCountDelay(50);
+    model->setMessageCountFilter([&wanted](const QModelIndex &mailbox) {
+        return wanted.contains(mailbox.data(RoleMailboxName).toString());
+    });
+
+    // Nothing goes to the network yet, but the cached numbers are available right away
+    QCOMPARE(idxA.data(RoleTotalMessageCount), QVariant());
+    QCOMPARE(idxB.data(RoleTotalMessageCount).toInt(), 10);
+    QCOMPARE(idxB.data(RoleUnreadMessageCount).toInt(), 2);
+    QCOMPARE(idxB.data(RoleMailboxNumbersFetched).toBool(), false);
+    QCOMPARE(idxC.data(RoleTotalMessageCount), QVariant());
+    cEmpty();
+
+    // By the time the delay is over, "c" is no longer interesting
+    wanted.removeOne(QStringLiteral("c"));
+    QTest::qWait(100);
+    cClient(t.mk("STATUS b (MESSAGES UNSEEN RECENT)\r\n"));
+    cServer("* STATUS b (MESSAGES 11 RECENT 0 UNSEEN 3)\r\n" + t.last("OK status\r\n"));
+    QCOMPARE(idxB.data(RoleTotalMessageCount).toInt(), 11);
+    QCOMPARE(idxB.data(RoleUnreadMessageCount).toInt(), 3);
+    QCOMPARE(idxB.data(RoleMailboxNumbersFetched).toBool(), true);
+    cEmpty();
+
+    // The dropped request is made again when somebody asks for the numbers later
+    wanted << QStringLiteral("c");
+    QCOMPARE(idxC.data(RoleTotalMessageCount), QVariant());
+    cEmpty();
+    QTest::qWait(100);
+    cClient(t.mk("STATUS c (MESSAGES UNSEEN RECENT)\r\n"));
+    cServer("* STATUS c (MESSAGES 1 RECENT 0 UNSEEN 1)\r\n" + t.last("OK status\r\n"));
+    QCOMPARE(idxC.data(RoleTotalMessageCount).toInt(), 1);
+    cEmpty();
+
+    model->setMessageCountFilter(nullptr);
+}
+
+/** @short The subscription state of whole subtrees is known from a single LSUB, without listing them */
+void ImapModelListChildMailboxesTest::testSubscribedDescendants()
+{
+    using namespace Imap::Mailbox;
+
+    QCOMPARE(model->rowCount(QModelIndex()), 1);
+    cClient(t.mk("LIST \"\" \"%\"\r\n"));
+    cServer("* LIST (\\HasChildren) \".\" a\r\n"
+            "* LIST (\\HasChildren) \".\" b\r\n"
+            "* LIST (\\HasNoChildren) \".\" c\r\n"
+            + t.last("OK listed\r\n"));
+    QPersistentModelIndex idxA = model->index(1, 0, QModelIndex());
+    QPersistentModelIndex idxB = model->index(2, 0, QModelIndex());
+    QPersistentModelIndex idxC = model->index(3, 0, QModelIndex());
+    QCOMPARE(idxC.data(RoleMailboxName).toString(), QStringLiteral("c"));
+
+    QList<QPersistentModelIndex> changed;
+    connect(model, &QAbstractItemModel::dataChanged, this, [&changed](const QModelIndex &topLeft) {
+        changed << topLeft;
+    });
+
+    // Until the subscriptions are known, anything with children might contain a subscribed mailbox
+    QCOMPARE(idxA.data(RoleMailboxIsSubscribed).toBool(), false);
+    QCOMPARE(idxA.data(RoleMailboxHasSubscribedDescendants).toBool(), true);
+    QCOMPARE(idxB.data(RoleMailboxHasSubscribedDescendants).toBool(), true);
+    QCOMPARE(idxC.data(RoleMailboxHasSubscribedDescendants).toBool(), false);
+    cClient(t.mk("LSUB \"\" \"*\"\r\n"));
+    cServer("* LSUB () \".\" a.x.y\r\n"
+            "* LSUB () \".\" c\r\n"
+            + t.last("OK subscriptions listed\r\n"));
+
+    // Only those mailboxes whose state has changed are reported
+    QCOMPARE(changed, QList<QPersistentModelIndex>() << idxB << idxC);
+    QCOMPARE(idxA.data(RoleMailboxIsSubscribed).toBool(), false);
+    QCOMPARE(idxA.data(RoleMailboxHasSubscribedDescendants).toBool(), true);
+    QCOMPARE(idxB.data(RoleMailboxHasSubscribedDescendants).toBool(), false);
+    QCOMPARE(idxC.data(RoleMailboxIsSubscribed).toBool(), true);
+    QCOMPARE(idxC.data(RoleMailboxHasSubscribedDescendants).toBool(), false);
+    // The children of "a" were not listed
+    cEmpty();
+
+    // A subscription update only touches the mailbox and its parents
+    QCOMPARE(model->rowCount(idxB), 1);
+    cClient(t.mk("LIST \"\" \"b.%\"\r\n"));
+    cServer("* LIST (\\HasNoChildren) \".\" b.z\r\n"
+            + t.last("OK listed\r\n"));
+    QPersistentModelIndex idxBZ = model->index(1, 0, idxB);
+    QCOMPARE(idxBZ.data(RoleMailboxName).toString(), QStringLiteral("b.z"));
+    changed.clear();
+    model->subscribeMailbox(QStringLiteral("b.z"));
+    cClient(t.mk("SUBSCRIBE b.z\r\n"));
+    cServer(t.last("OK subscribed\r\n"));
+    QCOMPARE(changed, QList<QPersistentModelIndex>() << idxBZ << idxB);
+    QCOMPARE(idxBZ.data(RoleMailboxIsSubscribed).toBool(), true);
+    QCOMPARE(idxB.data(RoleMailboxHasSubscribedDescendants).toBool(), true);
+
+    changed.clear();
+    model->unsubscribeMailbox(QStringLiteral("b.z"));
+    cClient(t.mk("UNSUBSCRIBE b.z\r\n"));
+    cServer(t.last("OK unsubscribed\r\n"));
+    QCOMPARE(changed, QList<QPersistentModelIndex>() << idxBZ << idxB);
+    QCOMPARE(idxB.data(RoleMailboxHasSubscribedDescendants).toBool(), false);
+    QCOMPARE(idxA.data(RoleMailboxHasSubscribedDescendants).toBool(), true);
+    cEmpty();
+}
+
 void ImapModelListChildMailboxesTest::testFailingList()
 {
     QCOMPARE(model->rowCount(QModelIndex()), 1);
@@ -42,6 +42,8 @@ private slots:
     void testBackslashes();
 
     void testNoStatusForCachedItems();
+    void testDelayedMessageCounts();
+    void testSubscribedDescendants();
 
     void testFailingList();
 
@@ -1468,6 +1468,53 @@ void ImapModelObtainSynchronizedMailboxTest::testCondstoreNoChanges()
     justKeepTask();
 }
 
+/** @short Test that an unchanged SELECT state is enough for opening the mailbox purely from the cached UIDs and flags */
+void ImapModelObtainSynchronizedMailboxTest::testCondstoreNoChangesFromCache()
+{
+    FakeCapabilitiesInjector injector(model);
+    injector.injectCapability(QStringLiteral("CONDSTORE"));
+    Imap::Mailbox::SyncState sync;
+    sync.setExists(3);
+    sync.setUidValidity(666);
+    sync.setUidNext(15);
+    sync.setHighestModSeq(33);
+    sync.setUnSeenCount(1);
+    sync.setRecent(0);
+    Imap::Uids uidMap;
+    uidMap << 6 << 9 << 10;
+    model->cache()->setMailboxSyncState(QStringLiteral("a"), sync);
+    model->cache()->setUidMapping(QStringLiteral("a"), uidMap);
+    model->cache()->setMsgFlags(QStringLiteral("a"), 6, QStringList() << QStringLiteral("\\Seen"));
+    model->cache()->setMsgFlags(QStringLiteral("a"), 9, QStringList() << QStringLiteral("y"));
+    model->cache()->setMsgFlags(QStringLiteral("a"), 10, QStringList() << QStringLiteral("\\Seen") << QStringLiteral("z"));
+    model->rowCount(msgListA);
+    cClient(t.mk("SELECT a (CONDSTORE)\r\n"));
+    cServer("* 3 EXISTS\r\n"
+            "* OK [UIDVALIDITY 666] .\r\n"
+            "* OK [UIDNEXT 15] .\r\n"
+            "* OK [HIGHESTMODSEQ 33] .\r\n"
+            );
+    cServer(t.last("OK selected\r\n"));
+    // Neither UID SEARCH nor FETCH FLAGS shall be needed
+    cEmpty();
+
+    QCOMPARE(model->rowCount(msgListA), 3);
+    for (int i = 0; i < uidMap.size(); ++i) {
+        QModelIndex message = msgListA.child(i, 0);
+        QCOMPARE(message.data(Imap::Mailbox::RoleMessageUid).toUInt(), uidMap[i]);
+        QCOMPARE(message.data(Imap::Mailbox::RoleMessageFlags).toStringList(), model->cache()->msgFlags("a", uidMap[i]));
+    }
+    QVERIFY(msgListA.child(0, 0).data(Imap::Mailbox::RoleMessageIsMarkedRead).toBool());
+    QVERIFY(!msgListA.child(1, 0).data(Imap::Mailbox::RoleMessageIsMarkedRead).toBool());
+
+    QCOMPARE(model->cache()->mailboxSyncState("a"), sync);
+    QCOMPARE(model->cache()->uidMapping("a"), uidMap);
+    QCOMPARE(model->syncStatistics().cachedResyncs, 1u);
+    QCOMPARE(model->syncStatistics().savedCommands, 2u);
+    QVERIFY(model->syncStatistics().savedBytes > 0);
+    justKeepTask();
+}
+
 /** @short Test changed HIGHESTMODSEQ */
 void ImapModelObtainSynchronizedMailboxTest::testCondstoreChangedFlags()
 {
@@ -1507,6 +1554,7 @@ void ImapModelObtainSynchronizedMailboxTest::testCondstoreChangedFlags()
     QCOMPARE(model->cache()->msgFlags("a", 6), QStringList() << "x");
     QCOMPARE(model->cache()->msgFlags("a", 9), QStringList() << "y");
     QCOMPARE(model->cache()->msgFlags("a", 10), QStringList() << "\\Seen" << "f101");
+    QCOMPARE(model->syncStatistics().cachedResyncs, 0u);
     justKeepTask();
 }
 
@@ -2456,6 +2504,116 @@ void ImapModelObtainSynchronizedMailboxTest::testQresyncEnabling()
     cEmpty();
 }
 
+/** @short Check that the UIDONLY mode is switched on by the ENABLED response, and that a mailbox can be synced in it */
+void ImapModelObtainSynchronizedMailboxTest::testUidOnlyEnabling()
+{
+    using namespace Imap::Mailbox;
+    QFETCH(bool, cached);
+
+    LibMailboxSync::setModelNetworkPolicy(model, Imap::Mailbox::NETWORK_OFFLINE);
+    cClient(t.mk("LOGOUT\r\n"));
+    cServer(t.last("OK logged out\r\n"));
+
+    taskFactoryUnsafe->fakeListChildMailboxes = false;
+    taskFactoryUnsafe->fakeOpenConnectionTask = false;
+    factory->setInitialState(Imap::CONN_STATE_CONNECTED_PRETLS_PRECAPS);
+    t.reset();
+
+    Imap::Mailbox::SyncState sync;
+    sync.setExists(3);
+    sync.setUidValidity(666);
+    sync.setUidNext(15);
+    sync.setHighestModSeq(33);
+    sync.setUnSeenCount(3);
+    sync.setRecent(0);
+    Imap::Uids uidMap;
+    uidMap << 6 << 9 << 10;
+    if (cached) {
+        model->cache()->setMailboxSyncState(QStringLiteral("a"), sync);
+        model->cache()->setUidMapping(QStringLiteral("a"), uidMap);
+        model->cache()->setMsgFlags(QStringLiteral("a"), 6, QStringList() << QStringLiteral("x"));
+        model->cache()->setMsgFlags(QStringLiteral("a"), 9, QStringList() << QStringLiteral("y"));
+        model->cache()->setMsgFlags(QStringLiteral("a"), 10, QStringList() << QStringLiteral("z"));
+    }
+
+    LibMailboxSync::setModelNetworkPolicy(model, Imap::Mailbox::NETWORK_ONLINE);
+    QCoreApplication::processEvents();
+    cServer("* OK [CAPABILITY IMAP4rev1] hi there\r\n");
+    QCOMPARE(model->rowCount(QModelIndex()), 26);
+    cEmpty();
+    model->setImapUser(QStringLiteral("user"));
+    model->setImapPassword(QStringLiteral("pw"));
+    cClient(t.mk("LOGIN user pw\r\n"));
+    cServer(t.last("OK [CAPABILITY IMAP4rev1 ENABLE QRESYNC UIDONLY ESEARCH UNSELECT] logged in\r\n"));
+
+    QByteArray enableCmd = t.mk("ENABLE QRESYNC UIDONLY\r\n");
+    QByteArray enableResp = t.last("OK enabled\r\n");
+    QByteArray listCmd = t.mk("LIST \"\" \"%\"\r\n");
+    QByteArray listResp = t.last("OK listed\r\n");
+    cClient(enableCmd + listCmd);
+    cServer("* ENABLED QRESYNC UIDONLY\r\n" + enableResp + "* LIST (\\HasNoChildren) \".\" \"a\"\r\n" + listResp);
+
+    idxA = model->index(1, 0, QModelIndex());
+    QVERIFY(idxA.isValid());
+    QCOMPARE(idxA.data(RoleMailboxName).toString(), QString("a"));
+    msgListA = idxA.child(0, 0);
+    QVERIFY(msgListA.isValid());
+    model->rowCount(msgListA);
+
+    if (cached) {
+        // No seq-match-data, the sequence numbers are not available in this mode
+        cClient(t.mk("SELECT a (QRESYNC (666 33))\r\n"));
+        cServer("* 3 EXISTS\r\n"
+                "* OK [UIDVALIDITY 666] .\r\n"
+                "* OK [UIDNEXT 15] .\r\n"
+                "* OK [HIGHESTMODSEQ 36] .\r\n"
+                "* 9 UIDFETCH (FLAGS (x2 \\Seen))\r\n"
+                + t.last("OK selected\r\n"));
+        sync.setHighestModSeq(36);
+    } else {
+        cClient(t.mk("SELECT a\r\n"));
+        cServer("* 3 EXISTS\r\n"
+                "* OK [UIDVALIDITY 666] .\r\n"
+                "* OK [UIDNEXT 15] .\r\n"
+                "* OK [HIGHESTMODSEQ 33] .\r\n"
+                + t.last("OK selected\r\n"));
+        cClient(t.mk("UID SEARCH RETURN (ALL) ALL\r\n"));
+        cServer("* ESEARCH (TAG \"" + t.last() + "\") UID ALL 6,9:10\r\n" + t.last("OK searched\r\n"));
+        // The flags are matched to the messages by their UIDs
+        cClient(t.mk("UID FETCH 1:* (FLAGS)\r\n"));
+        cServer("* 6 UIDFETCH (FLAGS (x))\r\n"
+                "* 9 UIDFETCH (FLAGS (x2 \\Seen))\r\n"
+                "* 10 UIDFETCH (FLAGS (z))\r\n"
+                + t.last("OK fetched\r\n"));
+    }
+    cEmpty();
+
+    sync.setUnSeenCount(2);
+    QCOMPARE(model->cache()->mailboxSyncState("a"), sync);
+    QCOMPARE(model->cache()->uidMapping("a"), uidMap);
+    QCOMPARE(model->cache()->msgFlags("a", 6), QStringList() << "x");
+    QCOMPARE(model->cache()->msgFlags("a", 9), QStringList() << "\\Seen" << "x2");
+    QCOMPARE(model->cache()->msgFlags("a", 10), QStringList() << "z");
+    QCOMPARE(model->rowCount(msgListA), 3);
+    QCOMPARE(msgListA.child(1, 0).data(RoleMessageUid).toUInt(), 9u);
+    QVERIFY(msgListA.child(1, 0).data(RoleMessageIsMarkedRead).toBool());
+    QCOMPARE(idxA.data(RoleUnreadMessageCount).toInt(), 2);
+
+    // Marking everything as read does not refer to the sequence numbers
+    model->markMailboxAsRead(idxA);
+    cClient(t.mk("UID STORE 1:* +FLAGS.SILENT \\Seen\r\n"));
+    cServer(t.last("OK stored\r\n"));
+    QCOMPARE(idxA.data(RoleUnreadMessageCount).toInt(), 0);
+    cEmpty();
+}
+
+void ImapModelObtainSynchronizedMailboxTest::testUidOnlyEnabling_data()
+{
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("fresh") << false;
+    QTest::newRow("qresync") << true;
+}
+
 /** @short VANISHED EARLIER which refers to meanwhile-arrived-and-deleted messages on an empty mailbox */
 void ImapModelObtainSynchronizedMailboxTest::testQresyncSpuriousVanishedEarlier()
 {
@@ -75,6 +75,7 @@ private slots:
     void testCacheArrivalsThenDynamic();
     void testCacheDeletionsThenDynamic();
     void testCondstoreNoChanges();
+    void testCondstoreNoChangesFromCache();
     void testCondstoreChangedFlags();
     void testCondstoreErrorExists();
     void testCondstoreErrorUidNext();
@@ -112,6 +113,8 @@ private slots:
     void testOfflineOpening();
 
     void testQresyncEnabling();
+    void testUidOnlyEnabling();
+    void testUidOnlyEnabling_data();
 
     void testSelectRetryNoBad();
 
@@ -1481,6 +1481,45 @@ void ImapModelThreadingTest::testDataChangedUnknownUid()
     cEmpty();
 }
 
+/** @short Changes of many messages are reported as ranges of siblings, not message by message */
+void ImapModelThreadingTest::testDataChangedRanges()
+{
+    initialMessages(5);
+    cClient(t.mk("UID THREAD REFS utf-8 ALL\r\n"));
+    cServer("* THREAD (1 (2)(3))(4)(5)\r\n" + t.last("OK thread\r\n"));
+    justKeepTask();
+    cEmpty();
+
+    QCOMPARE(threadingModel->rowCount(), 3);
+    QModelIndex root = threadingModel->index(0, 0);
+    QCOMPARE(root.data(Imap::Mailbox::RoleMessageUid).toUInt(), 1u);
+    QCOMPARE(threadingModel->rowCount(root), 2);
+
+    QSignalSpy changedSpy(threadingModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+    QByteArray buf;
+    for (int i = 1; i <= 5; ++i) {
+        buf += "* " + QByteArray::number(i) + " FETCH (FLAGS (\\Seen))\r\n";
+    }
+    cServer(buf);
+
+    // One range for the two nested messages, and one for the top-level ones, including the root of their thread
+    QCOMPARE(changedSpy.size(), 2);
+    for (const auto &signal : changedSpy) {
+        QModelIndex topLeft = signal[0].toModelIndex();
+        QModelIndex bottomRight = signal[1].toModelIndex();
+        QCOMPARE(topLeft.parent(), bottomRight.parent());
+        QCOMPARE(topLeft.row(), 0);
+        if (topLeft.parent().isValid()) {
+            QCOMPARE(topLeft.parent(), root);
+            QCOMPARE(bottomRight.row(), 1);
+        } else {
+            QCOMPARE(bottomRight.row(), 2);
+        }
+    }
+    justKeepTask();
+    cEmpty();
+}
+
 /** @short Verify parsing of various ESEARCH return results */
 void ImapModelThreadingTest::testESearchResults()
 {
@@ -46,6 +46,7 @@ private slots:
     void testMultipleExpunges();
     void testVanishedHierarchyReplacement();
     void testDataChangedUnknownUid();
+    void testDataChangedRanges();
     void testThreadingPerformance();
     void testSortingPerformance();
     void testSearchingPerformance();
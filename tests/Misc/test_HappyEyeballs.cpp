@@ -0,0 +1,148 @@
+/* Copyright (C) 2006 - 2014 Jan Kundrát <jkt@flaska.net>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QSignalSpy>
+#include <QSslSocket>
+#include <QTcpServer>
+#include <QTest>
+#include "test_HappyEyeballs.h"
+#include "Streams/HappyEyeballs.h"
+
+using namespace Streams;
+
+Q_DECLARE_METATYPE(QSslSocket*)
+
+namespace {
+const QString host = QStringLiteral("imap.example.org");
+}
+
+void TestHappyEyeballs::init()
+{
+    qRegisterMetaType<QSslSocket*>();
+    HappyEyeballs::clearPreferredFamilies();
+}
+
+/** @short The address families alternate, starting with the preferred one */
+void TestHappyEyeballs::testSortAddresses()
+{
+    const QHostAddress a4(QStringLiteral("192.0.2.1")), b4(QStringLiteral("192.0.2.2")), c4(QStringLiteral("192.0.2.3"));
+    const QHostAddress a6(QStringLiteral("2001:db8::1")), b6(QStringLiteral("2001:db8::2"));
+    QList<QHostAddress> input = QList<QHostAddress>() << a4 << b4 << c4 << a6 << b6 << a4;
+
+    QCOMPARE(HappyEyeballs::sortAddresses(input, QAbstractSocket::IPv6Protocol),
+             QList<QHostAddress>() << a6 << a4 << b6 << b4 << c4);
+    QCOMPARE(HappyEyeballs::sortAddresses(input, QAbstractSocket::IPv4Protocol),
+             QList<QHostAddress>() << a4 << a6 << b4 << b6 << c4);
+    QCOMPARE(HappyEyeballs::sortAddresses(QList<QHostAddress>() << b4 << a4, QAbstractSocket::IPv6Protocol),
+             QList<QHostAddress>() << b4 << a4);
+
+    QCOMPARE(HappyEyeballs::preferredFamily(host), QAbstractSocket::IPv6Protocol);
+}
+
+/** @short An address which does not work is skipped, and the working family is remembered */
+void TestHappyEyeballs::testFallbackAfterFailure()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    // Nothing listens on the IPv6 loopback at this port, or there's no IPv6 at all
+    HappyEyeballs racer(0, host, server.serverPort());
+    racer.setAttemptDelay(50);
+    QSignalSpy connectedSpy(&racer, SIGNAL(connected(QSslSocket*)));
+    QSignalSpy failedSpy(&racer, SIGNAL(failed(QString)));
+    racer.start(QList<QHostAddress>() << QHostAddress::LocalHost << QHostAddress::LocalHostIPv6);
+
+    QTRY_COMPARE(connectedSpy.size(), 1);
+    QCOMPARE(failedSpy.size(), 0);
+    QScopedPointer<QSslSocket> socket(connectedSpy[0][0].value<QSslSocket*>());
+    QCOMPARE(socket->state(), QAbstractSocket::ConnectedState);
+    QCOMPARE(socket->peerAddress(), QHostAddress(QHostAddress::LocalHost));
+
+    auto attempts = racer.attempts();
+    QCOMPARE(attempts.size(), 2);
+    QCOMPARE(attempts[0].address, QHostAddress(QHostAddress::LocalHostIPv6));
+    QVERIFY(!attempts[0].succeeded);
+    QCOMPARE(attempts[1].address, QHostAddress(QHostAddress::LocalHost));
+    QVERIFY(attempts[1].succeeded);
+    QVERIFY(attempts[1].latency >= 0);
+
+    QCOMPARE(HappyEyeballs::preferredFamily(host), QAbstractSocket::IPv4Protocol);
+}
+
+/** @short Once a family has won, it gets tried first next time */
+void TestHappyEyeballs::testPreferredFamilyFirst()
+{
+    QTcpServer server4, server6;
+    QVERIFY(server4.listen(QHostAddress::LocalHost));
+    const quint16 port = server4.serverPort();
+    if (!server6.listen(QHostAddress::LocalHostIPv6, port))
+        QSKIP("Cannot listen on the IPv6 loopback with the same port number");
+
+    const QList<QHostAddress> addresses = QList<QHostAddress>() << QHostAddress::LocalHost << QHostAddress::LocalHostIPv6;
+    // Returns the address family of the winner and the number of attempts which were needed
+    auto race = [&addresses, port]() -> QPair<QAbstractSocket::NetworkLayerProtocol, int> {
+        HappyEyeballs racer(0, host, port);
+        racer.setAttemptDelay(60 * 1000);
+        QSignalSpy connectedSpy(&racer, SIGNAL(connected(QSslSocket*)));
+        racer.start(addresses);
+        connectedSpy.wait(5000);
+        if (connectedSpy.size() != 1)
+            return qMakePair(QAbstractSocket::UnknownNetworkLayerProtocol, racer.attempts().size());
+        QScopedPointer<QSslSocket> socket(connectedSpy[0][0].value<QSslSocket*>());
+        return qMakePair(socket->peerAddress().protocol(), racer.attempts().size());
+    };
+
+    // IPv6 goes first by default; the stagger delay is long, so there's only a single attempt
+    QCOMPARE(race(), qMakePair(QAbstractSocket::IPv6Protocol, 1));
+
+    // IPv6 gets refused, IPv4 wins
+    server6.close();
+    QCOMPARE(race(), qMakePair(QAbstractSocket::IPv4Protocol, 2));
+    QCOMPARE(HappyEyeballs::preferredFamily(host), QAbstractSocket::IPv4Protocol);
+
+    // Now the IPv4 is tried first even though the IPv6 works again
+    if (!server6.listen(QHostAddress::LocalHostIPv6, port))
+        QSKIP("Cannot listen on the IPv6 loopback again");
+    QCOMPARE(race(), qMakePair(QAbstractSocket::IPv4Protocol, 1));
+}
+
+void TestHappyEyeballs::testAllFailed()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    const quint16 port = server.serverPort();
+    server.close();
+
+    HappyEyeballs racer(0, host, port);
+    QSignalSpy connectedSpy(&racer, SIGNAL(connected(QSslSocket*)));
+    QSignalSpy failedSpy(&racer, SIGNAL(failed(QString)));
+    racer.start(QList<QHostAddress>() << QHostAddress::LocalHost);
+
+    QTRY_COMPARE(failedSpy.size(), 1);
+    QCOMPARE(connectedSpy.size(), 0);
+    QCOMPARE(racer.attempts().size(), 1);
+    QVERIFY(!racer.attempts()[0].succeeded);
+    QVERIFY(!racer.attempts()[0].error.isEmpty());
+    QCOMPARE(HappyEyeballs::preferredFamily(host), QAbstractSocket::IPv6Protocol);
+}
+
+QTEST_GUILESS_MAIN(TestHappyEyeballs)
@@ -0,0 +1,166 @@
+/* Copyright (C) 2006 - 2014 Jan Kundrát <jkt@flaska.net>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QTemporaryDir>
+#include <QTest>
+#include "test_MailboxExport.h"
+#include "Imap/Model/ExportSink.h"
+#include "Imap/Model/MailboxExporter.h"
+
+using namespace Imap::Mailbox;
+
+void TestMailboxExport::testMboxrdEntry()
+{
+    QFETCH(QByteArray, message);
+    QFETCH(QByteArray, body);
+
+    QDateTime date(QDate(2016, 3, 7), QTime(9, 5, 1), Qt::UTC);
+    QCOMPARE(MboxExportSink::mboxrdEntry(message, date), QByteArray("From MAILER-DAEMON Mon Mar  7 09:05:01 2016\n") + body);
+}
+
+void TestMailboxExport::testMboxrdEntry_data()
+{
+    QTest::addColumn<QByteArray>("message");
+    QTest::addColumn<QByteArray>("body");
+
+    QTest::newRow("crlf")
+            << QByteArray("Subject: x\r\n\r\nhello\r\n")
+            << QByteArray("Subject: x\n\nhello\n\n");
+    QTest::newRow("no-trailing-newline")
+            << QByteArray("Subject: x\r\n\r\nhello")
+            << QByteArray("Subject: x\n\nhello\n\n");
+    QTest::newRow("from-quoting")
+            << QByteArray("Subject: x\r\n\r\nFrom here\r\n>From there\r\n>>From everywhere\r\nFromage\r\n > From\r\n")
+            << QByteArray("Subject: x\n\n>From here\n>>From there\n>>>From everywhere\nFromage\n > From\n\n");
+}
+
+void TestMailboxExport::testMaildirInfo()
+{
+    QCOMPARE(MaildirExportSink::maildirInfo(QStringList()), QStringLiteral(":2,"));
+    QCOMPARE(MaildirExportSink::maildirInfo(QStringList() << QStringLiteral("\\Seen") << QStringLiteral("\\Answered")
+                                            << QStringLiteral("$Forwarded") << QStringLiteral("\\Flagged")
+                                            << QStringLiteral("\\Deleted") << QStringLiteral("\\Draft")
+                                            << QStringLiteral("$Junk")),
+             QStringLiteral(":2,DFPRST"));
+    QCOMPARE(MaildirExportSink::maildirInfo(QStringList() << QStringLiteral("\\seen")), QStringLiteral(":2,S"));
+}
+
+void TestMailboxExport::testPathComponents()
+{
+    QCOMPARE(ExportSink::pathComponents(QStringLiteral("INBOX"), QStringLiteral(".")), QStringList() << QStringLiteral("INBOX"));
+    QCOMPARE(ExportSink::pathComponents(QStringLiteral("a.b.c"), QStringLiteral(".")),
+             QStringList() << QStringLiteral("a") << QStringLiteral("b") << QStringLiteral("c"));
+    QCOMPARE(ExportSink::pathComponents(QStringLiteral("a/b.c"), QString()), QStringList() << QStringLiteral("a_b.c"));
+    QCOMPARE(ExportSink::pathComponents(QStringLiteral("../x"), QStringLiteral("/")),
+             QStringList() << QStringLiteral("_..") << QStringLiteral("x"));
+    QCOMPARE(ExportSink::pathComponents(QStringLiteral("a//b"), QStringLiteral("/")),
+             QStringList() << QStringLiteral("a") << QStringLiteral("_") << QStringLiteral("b"));
+}
+
+/** @short Messages are appended to an existing mbox file, as happens when an export gets resumed */
+void TestMailboxExport::testMboxAppend()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QDateTime date(QDate(2016, 3, 7), QTime(9, 5, 1), Qt::UTC);
+
+    {
+        MboxExportSink sink(dir.path());
+        QVERIFY(sink.beginMailbox(QStringLiteral("a/b"), QStringLiteral("/")));
+        QVERIFY(sink.writeMessage("1\r\n", date, QStringList()));
+        QVERIFY(sink.flush());
+    }
+    {
+        MboxExportSink sink(dir.path());
+        QVERIFY(sink.beginMailbox(QStringLiteral("a/b"), QStringLiteral("/")));
+        QVERIFY(sink.writeMessage("2\r\n", date, QStringList()));
+        QVERIFY(sink.flush());
+    }
+
+    QFile file(QDir(dir.path()).filePath(QStringLiteral("a/b.mbox")));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), MboxExportSink::mboxrdEntry("1\r\n", date) + MboxExportSink::mboxrdEntry("2\r\n", date));
+}
+
+void TestMailboxExport::testMaildirWrite()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    MaildirExportSink sink(dir.path());
+    QVERIFY(sink.beginMailbox(QStringLiteral("INBOX"), QStringLiteral(".")));
+    QVERIFY(sink.writeMessage("Subject: a\r\n\r\nfoo\r\n", QDateTime(), QStringList() << QStringLiteral("\\Seen")));
+    QVERIFY(sink.writeMessage("Subject: b\r\n\r\nbar\r\n", QDateTime(), QStringList()));
+    QVERIFY(sink.flush());
+
+    QDir inbox(QDir(dir.path()).filePath(QStringLiteral("INBOX")));
+    QVERIFY(QDir(inbox.filePath(QStringLiteral("new"))).entryList(QDir::Files).isEmpty());
+    QVERIFY(QDir(inbox.filePath(QStringLiteral("tmp"))).entryList(QDir::Files).isEmpty());
+
+    QDir cur(inbox.filePath(QStringLiteral("cur")));
+    QStringList files = cur.entryList(QDir::Files, QDir::Name);
+    QCOMPARE(files.size(), 2);
+    QByteArray contents;
+    Q_FOREACH(const QString &name, files) {
+        QFile file(cur.filePath(name));
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QByteArray data = file.readAll();
+        if (name.endsWith(QLatin1String(":2,S"))) {
+            QCOMPARE(data, QByteArray("Subject: a\r\n\r\nfoo\r\n"));
+        } else {
+            QVERIFY(name.endsWith(QLatin1String(":2,")));
+            QCOMPARE(data, QByteArray("Subject: b\r\n\r\nbar\r\n"));
+        }
+    }
+}
+
+/** @short The resume state survives a restart and gets invalidated by a UIDVALIDITY change */
+void TestMailboxExport::testStateRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = QDir(dir.path()).filePath(QStringLiteral("state"));
+
+    {
+        ExportState state(fileName);
+        QVERIFY(state.load());
+        QCOMPARE(state.lastUid(QStringLiteral("INBOX"), 666), 0u);
+        state.setLastUid(QStringLiteral("INBOX"), 666, 333);
+        state.setLastUid(QStringLiteral("a.b"), 1, 10);
+        QVERIFY(state.save());
+    }
+
+    ExportState state(fileName);
+    QVERIFY(state.load());
+    QCOMPARE(state.lastUid(QStringLiteral("INBOX"), 666), 333u);
+    QCOMPARE(state.lastUid(QStringLiteral("INBOX"), 667), 0u);
+    QCOMPARE(state.lastUid(QStringLiteral("a.b"), 1), 10u);
+    QCOMPARE(state.lastUid(QStringLiteral("x"), 1), 0u);
+
+    QFile garbage(fileName);
+    QVERIFY(garbage.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    garbage.write("nonsense");
+    garbage.close();
+    QVERIFY(!state.load());
+}
+
+QTEST_GUILESS_MAIN(TestMailboxExport)
@@ -0,0 +1,136 @@
+/* Copyright (C) 2006 - 2014 Jan Kundrát <jkt@flaska.net>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QTest>
+#include "test_MemoryCache.h"
+#include "Imap/Model/MemoryCache.h"
+
+using namespace Imap::Mailbox;
+
+/** @short Check that whatever gets stored can be read back, and removed */
+void TestMemoryCache::testMessageData()
+{
+    MemoryCache cache;
+    const QString mailbox = QStringLiteral("a");
+
+    QCOMPARE(cache.msgFlags(mailbox, 1), QStringList());
+    QCOMPARE(cache.messageMetadata(mailbox, 1).uid, 0u);
+    QVERIFY(cache.messagePart(mailbox, 1, "1").isNull());
+
+    AbstractCache::MessageDataBundle bundle;
+    bundle.uid = 1;
+    bundle.size = 333;
+    cache.setMessageMetadata(mailbox, 1, bundle);
+    cache.setMsgFlags(mailbox, 1, QStringList() << QStringLiteral("\\Seen"));
+    cache.setMsgPart(mailbox, 1, "1", "foo");
+    cache.setMsgPart(mailbox, 1, "2", "blesmrt");
+    cache.setMsgPart(mailbox, 2, "1", "bar");
+
+    QCOMPARE(cache.messageMetadata(mailbox, 1), bundle);
+    QCOMPARE(cache.msgFlags(mailbox, 1), QStringList() << QStringLiteral("\\Seen"));
+    QCOMPARE(cache.messagePart(mailbox, 1, "1"), QByteArray("foo"));
+    QCOMPARE(cache.partBytes(), 13ull);
+
+    cache.setMsgPart(mailbox, 1, "1", "foobar");
+    QCOMPARE(cache.messagePart(mailbox, 1, "1"), QByteArray("foobar"));
+    QCOMPARE(cache.partBytes(), 16ull);
+
+    cache.forgetMessagePart(mailbox, 1, "2");
+    QVERIFY(cache.messagePart(mailbox, 1, "2").isNull());
+    QCOMPARE(cache.partBytes(), 9ull);
+
+    cache.clearMessage(mailbox, 1);
+    QCOMPARE(cache.msgFlags(mailbox, 1), QStringList());
+    QCOMPARE(cache.messageMetadata(mailbox, 1).uid, 0u);
+    QVERIFY(cache.messagePart(mailbox, 1, "1").isNull());
+    QCOMPARE(cache.messagePart(mailbox, 2, "1"), QByteArray("bar"));
+    QCOMPARE(cache.partBytes(), 3ull);
+
+    cache.clearAllMessages(mailbox);
+    QVERIFY(cache.messagePart(mailbox, 2, "1").isNull());
+    QCOMPARE(cache.partBytes(), 0ull);
+}
+
+/** @short The least recently used parts shall be dropped when over budget */
+void TestMemoryCache::testPartEviction()
+{
+    MemoryCache cache;
+    const QString mailbox = QStringLiteral("a");
+    cache.setPartBudget(10);
+
+    cache.setMsgPart(mailbox, 1, "1", "1234");
+    cache.setMsgPart(mailbox, 2, "1", "1234");
+    // Make the first one the most recently used
+    QCOMPARE(cache.messagePart(mailbox, 1, "1"), QByteArray("1234"));
+    cache.setMsgPart(mailbox, 3, "1", "1234");
+
+    QCOMPARE(cache.messagePart(mailbox, 1, "1"), QByteArray("1234"));
+    QVERIFY(cache.messagePart(mailbox, 2, "1").isNull());
+    QCOMPARE(cache.messagePart(mailbox, 3, "1"), QByteArray("1234"));
+    QCOMPARE(cache.partBytes(), 8ull);
+
+    // A part which is bigger than the whole budget is still kept, but nothing else is
+    cache.setMsgPart(mailbox, 4, "1", "12345678901");
+    QCOMPARE(cache.messagePart(mailbox, 4, "1"), QByteArray("12345678901"));
+    QVERIFY(cache.messagePart(mailbox, 1, "1").isNull());
+    QVERIFY(cache.messagePart(mailbox, 3, "1").isNull());
+    QCOMPARE(cache.partBytes(), 11ull);
+
+    // The metadata are not affected by the part budget
+    cache.setMsgFlags(mailbox, 2, QStringList() << QStringLiteral("\\Seen"));
+    cache.setMsgPart(mailbox, 5, "1", "1");
+    QCOMPARE(cache.msgFlags(mailbox, 2), QStringList() << QStringLiteral("\\Seen"));
+}
+
+void TestMemoryCache::benchmarkFlags()
+{
+    const QString mailbox = QStringLiteral("INBOX");
+    const QStringList flags = QStringList() << QStringLiteral("\\Seen") << QStringLiteral("$NotJunk");
+    QBENCHMARK {
+        MemoryCache cache;
+        for (uint uid = 1; uid <= 100000; ++uid) {
+            cache.setMsgFlags(mailbox, uid, flags);
+        }
+        for (uint uid = 1; uid <= 100000; ++uid) {
+            cache.msgFlags(mailbox, uid);
+        }
+    }
+}
+
+void TestMemoryCache::benchmarkPartsWithinBudget()
+{
+    const QString mailbox = QStringLiteral("INBOX");
+    const QByteArray data(64 * 1024, 'x');
+    const quint64 budget = 10 * 1024 * 1024;
+    MemoryCache cache;
+    cache.setPartBudget(budget);
+    QBENCHMARK {
+        // Put much more than the budget into the cache, and access the most recent ones along the way
+        for (uint uid = 1; uid <= 1000; ++uid) {
+            cache.setMsgPart(mailbox, uid, "1", data);
+            cache.messagePart(mailbox, uid / 2 + 1, "1");
+        }
+    }
+    QVERIFY(cache.partBytes() <= budget);
+}
+
+QTEST_GUILESS_MAIN(TestMemoryCache)
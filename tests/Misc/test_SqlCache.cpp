@@ -88,4 +88,44 @@ void TestSqlCache::testMailboxOperation()
     QVERIFY(errorLog.empty());
 }
 
+/** @short Check that only the messages which were not accessed recently get removed by the expiry */
+void TestSqlCache::testMessageExpiry()
+{
+    using namespace Imap::Mailbox;
+
+    AbstractCache::MessageDataBundle bundle;
+    bundle.uid = 1;
+    bundle.serializedBodyStructure = "foo";
+    cache->setMessageMetadata(QStringLiteral("a"), 1, bundle);
+    bundle.uid = 2;
+    cache->setMessageMetadata(QStringLiteral("a"), 2, bundle);
+    cache->setMsgFlags(QStringLiteral("a"), 2, QStringList() << QStringLiteral("\\Seen"));
+    cache->setMsgPart(QStringLiteral("a"), 2, "1", "blesmrt");
+    CHECK_CACHE_ERRORS;
+
+    quint64 reclaimed = 0;
+
+    // Everything has just been accessed
+    QVERIFY(cache->expireMessages(QDate::currentDate(), 10, &reclaimed).isEmpty());
+    QCOMPARE(reclaimed, 0ull);
+    CHECK_CACHE_ERRORS;
+
+    // Pretend that the time has passed
+    auto expired = cache->expireMessages(QDate::currentDate().addDays(1), 1, &reclaimed);
+    CHECK_CACHE_ERRORS;
+    QCOMPARE(expired.size(), 1);
+    expired += cache->expireMessages(QDate::currentDate().addDays(1), 10, &reclaimed);
+    CHECK_CACHE_ERRORS;
+    QCOMPARE(expired.size(), 2);
+    QVERIFY(reclaimed > 0);
+
+    QCOMPARE(cache->messageMetadata(QStringLiteral("a"), 1).uid, 0u);
+    QCOMPARE(cache->messageMetadata(QStringLiteral("a"), 2).uid, 0u);
+    QVERIFY(cache->msgFlags(QStringLiteral("a"), 2).isEmpty());
+    QVERIFY(cache->messagePart(QStringLiteral("a"), 2, "1").isNull());
+    CHECK_CACHE_ERRORS;
+
+    QVERIFY(errorLog.empty());
+}
+
 QTEST_GUILESS_MAIN(TestSqlCache)
@@ -39,6 +39,7 @@ private Q_SLOTS:
     void initTestCase();
     void cleanupTestCase();
     void testMailboxOperation();
+    void testMessageExpiry();
 
 private:
     std::shared_ptr<Imap::Mailbox::SQLCache> cache;
@@ -195,6 +195,30 @@ void RFCCodecsTest::testDecodeRFC2047String_data()
         << QStringLiteral("ěšč");
 }
 
+void RFCCodecsTest::benchmarkDecodeRFC2047String()
+{
+    QFETCH(QByteArray, raw);
+
+    QBENCHMARK {
+        Imap::decodeRFC2047String(raw);
+    }
+}
+
+void RFCCodecsTest::benchmarkDecodeRFC2047String_data()
+{
+    QTest::addColumn<QByteArray>("raw");
+
+    QTest::newRow("ascii-subject")
+        << QByteArray("Re: [Trojita] Bug 12345: the message list is not updated after the connection drops");
+    QTest::newRow("ascii-address")
+        << QByteArray("jkt@flaska.net");
+    QTest::newRow("encoded-name")
+        << QByteArray("=?ISO-8859-2?Q?Jan_Kundr=E1t?=");
+    QTest::newRow("mixed-subject")
+        << QByteArray("[foo] johoho tohlencto je ale pekne =?UTF-8?B?YmzEmyBzbXJ0IHRyb2o=?=\n"
+                      " =?UTF-8?B?aXRhIHMgbWF0b3ZvdSBvbWFja291?= blabla");
+}
+
 void RFCCodecsTest::testEncodeRFC2047StringAsciiPrefix()
 {
     QFETCH(QString, input);
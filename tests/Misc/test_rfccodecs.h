@@ -34,6 +34,9 @@ private Q_SLOTS:
   /** @short Test the RFC2047 decoder */
   void testDecodeRFC2047String();
   void testDecodeRFC2047String_data();
+  /** @short Measure the speed of the RFC2047 decoder on typical ENVELOPE fields */
+  void benchmarkDecodeRFC2047String();
+  void benchmarkDecodeRFC2047String_data();
 
   void testEncodeRFC2047StringAsciiPrefix();
   void testEncodeRFC2047StringAsciiPrefix_data();
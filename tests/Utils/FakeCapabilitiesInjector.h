@@ -47,6 +47,15 @@ public:
             model->updateCapabilities(it.key(), existingCaps);
         }
     }
+
+    /** @short Pretend that the RFC 9586 UIDONLY mode has been enabled */
+    void injectUidOnly()
+    {
+        injectCapability(QStringLiteral("UIDONLY"));
+        for (auto it = model->m_parsers.begin(); it != model->m_parsers.end(); ++it) {
+            it->uidOnly = true;
+        }
+    }
 private:
     Imap::Mailbox::Model *model;
 };
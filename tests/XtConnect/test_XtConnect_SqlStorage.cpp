@@ -0,0 +1,182 @@
+/* Copyright (C) 2006 - 2016 Jan Kundrát <jkt@flaska.net>
+
+   This file is part of the Trojita Qt IMAP e-mail client,
+   http://trojita.flaska.net/
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTest>
+#include "test_XtConnect_SqlStorage.h"
+#include "XtConnect/SqlStorage.h"
+
+using XtConnect::SqlStorage;
+
+namespace {
+
+const QString connectionName = QStringLiteral("xtconnect-sqlstorage");
+
+SqlStorage::Mail mail(const QString &subject, const QByteArray &body, const int numAddresses)
+{
+    SqlStorage::Mail res;
+    res.dateTime = QDateTime(QDate(2016, 2, 1), QTime(10, 20, 30), Qt::UTC);
+    res.subject = subject;
+    res.readableText = QString::fromUtf8(body);
+    res.headers = "Subject: " + subject.toUtf8() + "\r\n\r\n";
+    res.body = body;
+    for (int i = 0; i < numAddresses; ++i) {
+        SqlStorage::MailAddress address;
+        address.kind = i ? QStringLiteral("TO") : QStringLiteral("FROM");
+        address.name = QStringLiteral("Person %1").arg(i);
+        address.address = QStringLiteral("p%1@example.org").arg(i);
+        res.addresses << address;
+    }
+    return res;
+}
+
+}
+
+void XtConnectSqlStorageTest::initTestCase_data()
+{
+    QTest::addColumn<QString>("driver");
+
+    QTest::newRow("sqlite") << QStringLiteral("QSQLITE");
+    QTest::newRow("pgsql") << QStringLiteral("QPSQL");
+}
+
+void XtConnectSqlStorageTest::init()
+{
+    QFETCH_GLOBAL(QString, driver);
+    this->driver = driver;
+    storage = 0;
+    errors.clear();
+
+    if (driver == QLatin1String("QPSQL")) {
+        // The connection parameters other than the database name come from the usual PG* environment variables
+        const QByteArray dbName = qgetenv("TROJITA_XTCONNECT_PGSQL_DB");
+        if (dbName.isEmpty()) {
+            QSKIP("Set TROJITA_XTCONNECT_PGSQL_DB to the name of a scratch PostgreSQL database to test the real schema");
+        }
+        storage = new SqlStorage(this, QString(), 0, QString::fromLocal8Bit(dbName), QString(), QString(), driver);
+    } else {
+        storage = new SqlStorage(this, QString(), 0, QStringLiteral(":memory:"), QString(), QString(), driver);
+    }
+    connect(storage, &SqlStorage::encounteredError, this, [this](const QString &message) {
+        errors << message;
+    });
+    storage->open();
+    QVERIFY2(errors.isEmpty(), qPrintable(errors.join(QLatin1Char('\n'))));
+
+    QSqlDatabase db = QSqlDatabase::database(connectionName);
+    QSqlQuery q(db);
+
+    if (driver == QLatin1String("QPSQL")) {
+        // Everything happens within a transaction which gets rolled back afterwards, so the database is left as it was
+        QVERIFY(db.transaction());
+        QFile schema(QFINDTESTDATA("../../src/XtConnect/pgsql.sql"));
+        QVERIFY(schema.open(QIODevice::ReadOnly));
+        Q_FOREACH(const QString &statement, QString::fromUtf8(schema.readAll()).split(QLatin1Char(';'))) {
+            const QString trimmed = statement.trimmed();
+            // The xtrole only exists in a full xTuple installation
+            if (trimmed.isEmpty() || trimmed.startsWith(QLatin1String("GRANT ")))
+                continue;
+            QVERIFY2(q.exec(trimmed), qPrintable(q.lastError().text()));
+        }
+        return;
+    }
+
+    QVERIFY(q.exec(QStringLiteral("SELECT sqlite_version()")));
+    QVERIFY(q.next());
+    const QStringList version = q.value(0).toString().split(QLatin1Char('.'));
+    if (version.size() < 2 || qMakePair(version[0].toInt(), version[1].toInt()) < qMakePair(3, 35)) {
+        QSKIP("The SQLite library is too old to support the RETURNING clause");
+    }
+
+    // A cut-down version of the relevant parts of the xTuple schema
+    QVERIFY(q.exec(QStringLiteral("ATTACH DATABASE ':memory:' AS xtbatch")));
+    QVERIFY(q.exec(QStringLiteral("CREATE TABLE xtbatch.eml (eml_id INTEGER PRIMARY KEY AUTOINCREMENT, eml_hash BLOB UNIQUE NOT NULL, "
+                                  "eml_date TEXT, eml_subj TEXT, eml_body TEXT, eml_msg BLOB, eml_status TEXT)")));
+    QVERIFY(q.exec(QStringLiteral("CREATE TABLE xtbatch.emladdr (emladdr_id INTEGER PRIMARY KEY AUTOINCREMENT, emladdr_eml_id INTEGER, "
+                                  "emladdr_type TEXT, emladdr_addr TEXT, emladdr_name TEXT)")));
+}
+
+void XtConnectSqlStorageTest::cleanup()
+{
+    if (storage && driver == QLatin1String("QPSQL"))
+        QSqlDatabase::database(connectionName).rollback();
+    delete storage;
+    storage = 0;
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+int XtConnectSqlStorageTest::countRows(const QString &query)
+{
+    QSqlQuery q(QSqlDatabase::database(connectionName));
+    if (!q.exec(query) || !q.next())
+        return -1;
+    return q.value(0).toInt();
+}
+
+/** @short A batch gets written at once, with duplicate bodies skipped both within the batch and against older data */
+void XtConnectSqlStorageTest::testInsertBatch()
+{
+    QVector<quint64> emlIds;
+    QCOMPARE(storage->insertMails(QVector<SqlStorage::Mail>() << mail(QStringLiteral("old"), "old body", 2), emlIds), SqlStorage::RESULT_OK);
+    QCOMPARE(emlIds.size(), 1);
+    QVERIFY(emlIds[0]);
+
+    QVector<SqlStorage::Mail> mails;
+    mails << mail(QStringLiteral("a"), "body a", 3)
+          << mail(QStringLiteral("old again"), "old body", 5)
+          << mail(QStringLiteral("b"), "body b", 1)
+          << mail(QStringLiteral("a again"), "body a", 4);
+    QCOMPARE(storage->insertMails(mails, emlIds), SqlStorage::RESULT_OK);
+    QVERIFY(errors.isEmpty());
+    QCOMPARE(emlIds.size(), 4);
+    QVERIFY(emlIds[0]);
+    QCOMPARE(emlIds[1], 0ull);
+    QVERIFY(emlIds[2]);
+    QVERIFY(emlIds[0] != emlIds[2]);
+    QCOMPARE(emlIds[3], 0ull);
+
+    QCOMPARE(countRows(QStringLiteral("SELECT COUNT(*) FROM xtbatch.eml")), 3);
+    QCOMPARE(countRows(QStringLiteral("SELECT COUNT(*) FROM xtbatch.eml WHERE eml_status <> 'O'")), 0);
+    QCOMPARE(countRows(QStringLiteral("SELECT COUNT(*) FROM xtbatch.emladdr")), 2 + 3 + 1);
+    QCOMPARE(countRows(QStringLiteral("SELECT COUNT(*) FROM xtbatch.emladdr WHERE emladdr_eml_id = %1").arg(emlIds[0])), 3);
+    QCOMPARE(countRows(QStringLiteral("SELECT COUNT(*) FROM xtbatch.eml WHERE eml_subj = 'a'")), 1);
+
+    // An empty batch is not an error
+    QCOMPARE(storage->insertMails(QVector<SqlStorage::Mail>(), emlIds), SqlStorage::RESULT_OK);
+    QVERIFY(emlIds.isEmpty());
+}
+
+/** @short Addresses are split into several statements to stay within the limits on bind parameters */
+void XtConnectSqlStorageTest::testManyAddresses()
+{
+    QVector<SqlStorage::Mail> mails;
+    mails << mail(QStringLiteral("a"), "body a", 1500) << mail(QStringLiteral("b"), "body b", 1000);
+    QVector<quint64> emlIds;
+    QCOMPARE(storage->insertMails(mails, emlIds), SqlStorage::RESULT_OK);
+    QVERIFY(errors.isEmpty());
+    QCOMPARE(countRows(QStringLiteral("SELECT COUNT(*) FROM xtbatch.emladdr")), 2500);
+    QCOMPARE(countRows(QStringLiteral("SELECT COUNT(*) FROM xtbatch.emladdr WHERE emladdr_eml_id = %1").arg(emlIds[1])), 1000);
+}
+
+QTEST_GUILESS_MAIN(XtConnectSqlStorageTest)